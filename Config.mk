@@ -2,5 +2,6 @@ BOOTLOADER = GRUB
 ARCHITECTURE = i?86
 FORM = PC
 FONT = "/usr/share/fonts/ter-u16n.psf"
+COMPRESS_INITRD = no
 
 CONFIG = -D BOOTLOADER=$(BOOTLOADER) -D ARCHITECTURE=$(ARCHITECTURE) -D FORM=$(FORM) -D FONT=\"$(FONT)\"
\ No newline at end of file
@@ -38,6 +38,7 @@
  */
 
 #include "api/err.h"
+#include "api/poll.h"
 #include "api/sound.h"
 #include "api/sys/sysmacros.h"
 #include "boot_defs.h"
@@ -103,6 +104,7 @@ static void pci_enumeration_callback(const struct pci_addr* addr, uint16_t vendo
 
 static atomic_bool dma_is_running = false;
 static atomic_bool buffer_descriptor_list_is_full = false;
+static struct inode* device_inode;
 
 static void irq_handler(registers* regs) {
     (void)regs;
@@ -119,6 +121,8 @@ static void irq_handler(registers* regs) {
         dma_is_running = false;
 
     buffer_descriptor_list_is_full = false;
+    if (device_inode)
+        inode_notify(device_inode);
 }
 
 bool ac97_init(void) {
@@ -280,17 +284,25 @@ static int ac97_device_ioctl(file_description* desc, int request, void* argp) {
     return -EINVAL;
 }
 
+static short ac97_device_poll(file_description* desc, short events) {
+    if ((events & POLLOUT) && write_should_unblock(desc))
+        return POLLOUT;
+    return 0;
+}
+
 struct inode* ac97_device_create(void) {
     struct inode* inode = kmalloc(sizeof(struct inode));
     if (!inode)
         return ERR_PTR(-ENOMEM);
 
     static file_ops fops = {.write = ac97_device_write,
-                            .ioctl = ac97_device_ioctl};
+                            .ioctl = ac97_device_ioctl,
+                            .poll = ac97_device_poll};
     *inode = (struct inode){.fops = &fops,
                             .mode = S_IFCHR,
                             .device_id = makedev(14, 3),
                             .ref_count = 1};
+    device_inode = inode;
     return inode;
 }
 #endif
\ No newline at end of file
@@ -49,3 +49,10 @@
 #define O_CREAT 0x8
 #define O_EXCL 0x10
 #define O_NONBLOCK 0x100
+
+// modes of fallocate()
+#define FALLOC_FL_KEEP_SIZE 0x1
+#define FALLOC_FL_PUNCH_HOLE 0x2
+
+#define AT_FDCWD -100
+#define AT_REMOVEDIR 0x200
@@ -0,0 +1,99 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "sys/types.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IORING_MAX_ENTRIES 256
+
+#define IORING_OP_NOP 0
+#define IORING_OP_READ 1
+#define IORING_OP_WRITE 2
+#define IORING_OP_PREAD 3
+#define IORING_OP_PWRITE 4
+#define IORING_OP_OPENAT 5
+#define IORING_OP_CLOSE 6
+#define IORING_OP_FSYNC 7
+#define IORING_OP_POLL 8
+
+#define IORING_ENTER_GETEVENTS 0x1
+
+// submission queue entry. addr is the buffer for reads and writes and the
+// pathname for openat.
+struct io_uring_sqe {
+    uint8_t opcode;
+    short poll_events;
+    int fd;
+    off_t off;
+    void* addr;
+    size_t len;
+    int open_flags;
+    mode_t mode;
+    uint64_t user_data;
+};
+
+// completion queue entry. res is what the equivalent syscall would return.
+struct io_uring_cqe {
+    uint64_t user_data;
+    int res;
+};
+
+// header at the start of the shared mapping. heads and tails are
+// free-running and are masked to index the entry arrays. userland produces
+// sq_tail and cq_head, the kernel produces sq_head and cq_tail.
+struct io_uring_rings {
+    atomic_uint sq_head;
+    atomic_uint sq_tail;
+    atomic_uint cq_head;
+    atomic_uint cq_tail;
+    unsigned sq_mask;
+    unsigned cq_mask;
+};
+
+struct io_uring_params {
+    unsigned sq_entries;
+    unsigned cq_entries;
+    size_t sqes_offset;
+    size_t cqes_offset;
+    size_t ring_size; // length to pass to mmap
+};
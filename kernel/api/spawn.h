@@ -39,31 +39,36 @@
 
 #pragma once
 
-#include "api/sys/types.h"
-#include "lock.h"
-#include <common/extra.h>
-#include <stdarg.h>
+#include "sys/types.h"
+#include <stddef.h>
 
-typedef struct growable_buf {
-    mutex lock;
-    uintptr_t addr;
-    atomic_size_t capacity, size;
-} growable_buf;
+#define POSIX_SPAWN_SETPGROUP 0x1
 
-void growable_buf_destroy(growable_buf*);
+#define POSIX_SPAWN_MAX_FILE_ACTIONS 16
 
-NODISCARD ssize_t growable_buf_pread(growable_buf*, void* bytes, size_t count,
-                                     off_t offset);
-NODISCARD ssize_t growable_buf_pwrite(growable_buf*, const void* bytes,
-                                      size_t count, off_t offset);
-NODISCARD ssize_t growable_buf_append(growable_buf*, const void* bytes,
-                                      size_t count);
+enum {
+    POSIX_SPAWN_ACTION_CLOSE,
+    POSIX_SPAWN_ACTION_DUP2,
+    POSIX_SPAWN_ACTION_OPEN,
+};
 
-NODISCARD int growable_buf_truncate(growable_buf*, off_t length);
+struct posix_spawn_file_action {
+    int type;
+    int fd;
+    int new_fd;
+    const char* path;
+    int oflag;
+    mode_t mode;
+};
 
-NODISCARD uintptr_t growable_buf_mmap(growable_buf*, uintptr_t addr,
-                                      size_t length, off_t offset,
-                                      uint16_t page_flags);
+// file actions are applied in order to the child's copy of the parent's
+// file descriptor table before the executable is loaded
+typedef struct posix_spawn_file_actions {
+    size_t count;
+    struct posix_spawn_file_action actions[POSIX_SPAWN_MAX_FILE_ACTIONS];
+} posix_spawn_file_actions_t;
 
-int growable_buf_printf(growable_buf*, const char* format, ...);
-int growable_buf_vsprintf(growable_buf*, const char* format, va_list args);
+typedef struct posix_spawnattr {
+    short flags;
+    pid_t pgroup;
+} posix_spawnattr_t;
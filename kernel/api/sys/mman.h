@@ -49,3 +49,7 @@
 #define MAP_ANON MAP_ANONYMOUS
 
 #define MAP_FAILED ((void*)-1)
+
+#define MS_ASYNC 0x1
+#define MS_INVALIDATE 0x2
+#define MS_SYNC 0x4
@@ -79,4 +79,5 @@ struct stat {
     nlink_t st_nlink;
     dev_t st_rdev;
     off_t st_size;
+    blkcnt_t st_blocks; // number of 512-byte blocks allocated to the file
 };
@@ -46,6 +46,7 @@ typedef int32_t off_t;
 typedef uint32_t dev_t;
 typedef uint16_t mode_t;
 typedef uint32_t nlink_t;
+typedef int32_t blkcnt_t;
 typedef int32_t ssize_t;
 typedef int32_t pid_t;
 typedef int64_t time_t;
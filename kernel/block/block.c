@@ -0,0 +1,388 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "block.h"
+#include "buffer_cache.h"
+#include <common/stdio.h>
+#include <common/string.h>
+#include <kernel/api/err.h>
+#include <kernel/boot_defs.h>
+#include <kernel/interrupts.h>
+#include <kernel/memory/memory.h>
+#include <kernel/panic.h>
+#include <kernel/scheduler.h>
+
+size_t bio_num_segments(const struct bio* bio) {
+    uintptr_t start = (uintptr_t)bio->buffer;
+    uintptr_t end = start + bio->num_sectors * SECTOR_SIZE;
+    return div_ceil(end, PAGE_SIZE) - start / PAGE_SIZE;
+}
+
+static bool can_merge(const struct block_device* dev,
+                      const struct block_request* rq, bool write,
+                      size_t num_sectors, size_t num_segments) {
+    return rq->write == write &&
+           rq->num_sectors + num_sectors <= dev->max_sectors &&
+           rq->num_segments + num_segments <= dev->max_segments;
+}
+
+// joins the request following rq into rq if the two have become adjacent
+static void coalesce_with_next(struct block_device* dev,
+                               struct block_request* rq) {
+    struct block_request* next = rq->next;
+    if (!next || rq->sector + rq->num_sectors != next->sector ||
+        !can_merge(dev, rq, next->write, next->num_sectors,
+                   next->num_segments))
+        return;
+
+    rq->last_bio->next = next->bios;
+    rq->last_bio = next->last_bio;
+    rq->num_sectors += next->num_sectors;
+    rq->num_segments += next->num_segments;
+    rq->next = next->next;
+
+    next->next = dev->free_requests;
+    dev->free_requests = next;
+    ++dev->num_merges;
+}
+
+// adds the bio to a queued request it directly follows or precedes
+static bool try_merge(struct block_device* dev, struct bio* bio) {
+    size_t num_segments = bio_num_segments(bio);
+    struct block_request* prev = NULL;
+    for (struct block_request* rq = dev->queue; rq; prev = rq, rq = rq->next) {
+        if (!can_merge(dev, rq, bio->write, bio->num_sectors, num_segments))
+            continue;
+
+        if (rq->sector + rq->num_sectors == bio->sector) {
+            rq->last_bio->next = bio;
+            rq->last_bio = bio;
+        } else if (bio->sector + bio->num_sectors == rq->sector) {
+            bio->next = rq->bios;
+            rq->bios = bio;
+            rq->sector = bio->sector;
+        } else {
+            continue;
+        }
+        rq->num_sectors += bio->num_sectors;
+        rq->num_segments += num_segments;
+        ++dev->num_merges;
+
+        coalesce_with_next(dev, rq);
+        if (prev)
+            coalesce_with_next(dev, prev);
+        return true;
+    }
+    return false;
+}
+
+static void insert_request(struct block_device* dev,
+                           struct block_request* rq) {
+    struct block_request** it = &dev->queue;
+    while (*it && (*it)->sector <= rq->sector)
+        it = &(*it)->next;
+    rq->next = *it;
+    *it = rq;
+}
+
+static bool start_next_request(struct block_device* dev) {
+    if (dev->num_active >= dev->max_active || !dev->queue)
+        return false;
+
+    // continue the sweep from the head, or start over from the lowest sector
+    struct block_request** it = &dev->queue;
+    while (*it && (*it)->sector < dev->head)
+        it = &(*it)->next;
+    if (!*it)
+        it = &dev->queue;
+
+    struct block_request* rq = *it;
+    *it = rq->next;
+    rq->next = NULL;
+
+    ++dev->num_active;
+    dev->head = rq->sector + rq->num_sectors;
+    ++dev->num_requests;
+    dev->ops->start(dev, rq);
+    return true;
+}
+
+static void dispatch(struct block_device* dev) {
+    if (dev->plug_depth > 0)
+        return;
+    while (start_next_request(dev))
+        ;
+}
+
+static bool has_free_request(struct block_device* dev) {
+    return dev->free_requests;
+}
+
+void block_submit(struct block_device* dev, struct bio* bio) {
+    bio->next = NULL;
+    bio->rc = 0;
+    bio->done = false;
+    if (bio->num_sectors == 0 || bio->sector >= dev->num_sectors ||
+        bio->num_sectors > dev->num_sectors - bio->sector) {
+        bio->rc = -EIO;
+        bio->done = true;
+        return;
+    }
+
+    for (;;) {
+        bool int_flag = push_cli();
+        if (try_merge(dev, bio)) {
+            dispatch(dev);
+            pop_cli(int_flag);
+            return;
+        }
+
+        struct block_request* rq = dev->free_requests;
+        if (rq) {
+            dev->free_requests = rq->next;
+            *rq = (struct block_request){
+                .sector = bio->sector,
+                .num_sectors = bio->num_sectors,
+                .write = bio->write,
+                .bios = bio,
+                .last_bio = bio,
+                .num_segments = bio_num_segments(bio)};
+            insert_request(dev, rq);
+            dispatch(dev);
+            pop_cli(int_flag);
+            return;
+        }
+
+        // the queue is full. it is started even if it is plugged, as
+        // otherwise no request would ever be freed.
+        while (start_next_request(dev))
+            ;
+        pop_cli(int_flag);
+
+        // the bio has to be queued no matter what, so signals are ignored
+        while (scheduler_block((should_unblock_fn)has_free_request, dev) ==
+               -EINTR)
+            ;
+    }
+}
+
+static bool bio_is_done(struct bio* bio) { return bio->done; }
+
+int block_wait(struct bio* bio) {
+    // the device accesses the buffer until the bio is done, so the caller
+    // must not be woken up early by a signal
+    while (scheduler_block((should_unblock_fn)bio_is_done, bio) == -EINTR)
+        ;
+    return bio->rc;
+}
+
+void block_plug(struct block_device* dev) {
+    bool int_flag = push_cli();
+    ++dev->plug_depth;
+    pop_cli(int_flag);
+}
+
+void block_unplug(struct block_device* dev) {
+    bool int_flag = push_cli();
+    ASSERT(dev->plug_depth > 0);
+    --dev->plug_depth;
+    dispatch(dev);
+    pop_cli(int_flag);
+}
+
+int block_rw(struct block_device* dev, size_t sector, size_t num_sectors,
+             void* buffer, bool write) {
+    if (sector >= dev->num_sectors ||
+        num_sectors > dev->num_sectors - sector)
+        return -EINVAL;
+    if (num_sectors == 0)
+        return 0;
+
+    size_t sectors_per_page = PAGE_SIZE / SECTOR_SIZE;
+    size_t num_bios = div_ceil(num_sectors, sectors_per_page);
+    struct bio* bios = kmalloc(num_bios * sizeof(struct bio));
+    if (!bios)
+        return -ENOMEM;
+
+    unsigned char* dest = buffer;
+    block_plug(dev);
+    for (size_t i = 0; i < num_bios; ++i) {
+        size_t offset = i * sectors_per_page;
+        bios[i] = (struct bio){
+            .sector = sector + offset,
+            .num_sectors = MIN(sectors_per_page, num_sectors - offset),
+            .buffer = dest + offset * SECTOR_SIZE,
+            .write = write};
+        block_submit(dev, bios + i);
+    }
+    block_unplug(dev);
+
+    int rc = 0;
+    for (size_t i = 0; i < num_bios; ++i) {
+        int bio_rc = block_wait(bios + i);
+        if (IS_ERR(bio_rc))
+            rc = bio_rc;
+    }
+    kfree(bios);
+    return rc;
+}
+
+void block_request_complete(struct block_device* dev,
+                            struct block_request* rq, int rc) {
+    bool int_flag = push_cli();
+    ASSERT(dev->num_active > 0);
+    for (struct bio* bio = rq->bios; bio;) {
+        // the waiter may free the bio as soon as it is done
+        struct bio* next = bio->next;
+        bio->rc = rc;
+        bio->done = true;
+        bio = next;
+    }
+    rq->next = dev->free_requests;
+    dev->free_requests = rq;
+    --dev->num_active;
+    dispatch(dev);
+    pop_cli(int_flag);
+}
+
+// off_t limits how much of the device is reachable through the device file
+static size_t device_file_size(const struct block_device* dev) {
+    uint64_t size = (uint64_t)dev->num_sectors * SECTOR_SIZE;
+    return MIN(size, round_down(INT32_MAX, SECTOR_SIZE));
+}
+
+// the device file goes through the buffer cache, so writes reach the device
+// once they are written back
+static ssize_t transfer(file_description* desc, void* buffer, size_t count,
+                        bool write) {
+    struct block_device* dev = (struct block_device*)desc->inode;
+    mutex_lock(&desc->offset_lock);
+    size_t size = device_file_size(dev);
+    size_t offset = desc->offset;
+    if (offset >= size) {
+        mutex_unlock(&desc->offset_lock);
+        return write && count > 0 ? -ENOSPC : 0;
+    }
+    count = MIN(count, size - offset);
+
+    unsigned char* dest = buffer;
+    size_t done = 0;
+    while (done < count) {
+        size_t block = (offset + done) / BUFFER_SIZE;
+        size_t block_offset = (offset + done) % BUFFER_SIZE;
+        size_t n = MIN(count - done, BUFFER_SIZE - block_offset);
+
+        // blocks that are overwritten as a whole don't have to be read
+        struct buffer* buf = write && n == BUFFER_SIZE
+                                 ? buffer_get_new(dev, block)
+                                 : buffer_get(dev, block);
+        if (IS_ERR(buf)) {
+            if (done > 0)
+                break;
+            mutex_unlock(&desc->offset_lock);
+            return PTR_ERR(buf);
+        }
+        if (write) {
+            memcpy(buf->data + block_offset, dest + done, n);
+            buffer_mark_dirty(buf);
+        } else {
+            memcpy(dest + done, buf->data + block_offset, n);
+        }
+        buffer_put(buf);
+        done += n;
+    }
+
+    desc->offset += done;
+    mutex_unlock(&desc->offset_lock);
+    return done;
+}
+
+static ssize_t block_device_read(file_description* desc, void* buffer,
+                                 size_t count) {
+    return transfer(desc, buffer, count, false);
+}
+
+static ssize_t block_device_write(file_description* desc, const void* buffer,
+                                  size_t count) {
+    return transfer(desc, (void*)buffer, count, true);
+}
+
+static int block_device_fsync(file_description* desc) {
+    return buffer_cache_sync((struct block_device*)desc->inode);
+}
+
+static int block_device_stat(struct inode* inode, struct stat* buf) {
+    buf->st_mode = inode->mode;
+    buf->st_nlink = inode->num_links;
+    buf->st_rdev = inode->device_id;
+    buf->st_size = device_file_size((struct block_device*)inode);
+    buf->st_blocks = 0;
+    inode_unref(inode);
+    return 0;
+}
+
+int block_device_register(struct block_device* dev, dev_t device_id) {
+    static file_ops fops = {.read = block_device_read,
+                            .write = block_device_write,
+                            .fsync = block_device_fsync,
+                            .stat = block_device_stat};
+    dev->inode = (struct inode){.fops = &fops,
+                                .mode = S_IFBLK,
+                                .device_id = device_id,
+                                .ref_count = 1};
+
+    dev->queue = dev->free_requests = NULL;
+    dev->num_active = 0;
+    if (dev->max_active == 0)
+        dev->max_active = 1;
+    for (size_t i = 0; i < BLOCK_QUEUE_DEPTH; ++i) {
+        dev->requests[i].next = dev->free_requests;
+        dev->free_requests = dev->requests + i;
+    }
+
+    char pathname[32];
+    (void)snprintf(pathname, sizeof(pathname), "/dev/%s", dev->name);
+    struct inode* node = vfs_create(pathname, S_IFBLK);
+    if (IS_ERR(node))
+        return PTR_ERR(node);
+    node->device_id = device_id;
+    inode_unref(node);
+
+    return vfs_register_device(&dev->inode);
+}
@@ -0,0 +1,155 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <common/extra.h>
+#include <kernel/fs/fs.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SECTOR_SIZE 512
+
+// number of requests a device can have queued before submitters have to
+// wait for one to complete
+#define BLOCK_QUEUE_DEPTH 64
+
+// a transfer between consecutive sectors and a buffer in kernel memory. the
+// buffer doesn't need to be physically contiguous.
+struct bio {
+    size_t sector;
+    size_t num_sectors;
+    void* buffer;
+    bool write;
+
+    atomic_bool done;
+    int rc;
+
+    struct bio* next; // next bio of the same request
+};
+
+// bios for adjacent sectors that are handed to the driver as one transfer
+struct block_request {
+    size_t sector;
+    size_t num_sectors;
+    bool write;
+    struct bio* bios; // sorted by sector
+    struct bio* last_bio;
+    size_t num_segments; // number of pages the buffers of the bios touch
+
+    struct block_request* next;
+};
+
+struct block_device;
+
+typedef struct block_device_ops {
+    // starts the transfer of the request. the driver calls
+    // block_request_complete() once the transfer has finished, which may be
+    // from an interrupt handler. called with interrupts disabled, and never
+    // with more than max_active requests started at a time.
+    void (*start)(struct block_device*, struct block_request*);
+} block_device_ops;
+
+struct block_device {
+    struct inode inode; // the device file
+    const char* name;
+    size_t num_sectors;
+    const block_device_ops* ops;
+    void* private_data;
+
+    // limits of a single request, which merging doesn't go beyond
+    size_t max_sectors;
+    size_t max_segments;
+
+    // number of requests the device can work on at the same time
+    size_t max_active;
+
+    // the queue is sorted by sector, and is served by sweeping upwards from
+    // the head, wrapping around at the end (the C-LOOK elevator). all of
+    // these are protected by disabling interrupts.
+    struct block_request* queue;
+    size_t num_active;
+    struct block_request* free_requests;
+    size_t head;
+    size_t plug_depth;
+    struct block_request requests[BLOCK_QUEUE_DEPTH];
+
+    atomic_size_t num_requests;
+    atomic_size_t num_merges;
+
+    atomic_bool mounted; // a file system on the device is mounted
+
+    // sequential access detection of the buffer cache, protected by its lock
+    size_t ra_next;   // block that continues a sequential access
+    size_t ra_end;    // end of the blocks read ahead so far
+    size_t ra_window; // number of blocks to read ahead
+};
+
+// fills in the device file of the device and creates /dev/<name> for it
+NODISCARD int block_device_register(struct block_device*, dev_t);
+
+// queues the bio. the bio is done once bio->done is set.
+void block_submit(struct block_device*, struct bio*);
+NODISCARD int block_wait(struct bio*);
+
+// while plugged, bios are queued but not started so that bios submitted
+// together can be merged before the device sees them
+void block_plug(struct block_device*);
+void block_unplug(struct block_device*);
+
+// number of pages the buffer of the bio touches
+size_t bio_num_segments(const struct bio*);
+
+// reads or writes num_sectors sectors starting at sector, submitting a bio per
+// page of the buffer and waiting for all of them
+NODISCARD int block_rw(struct block_device*, size_t sector, size_t num_sectors,
+                       void* buffer, bool write);
+
+void block_request_complete(struct block_device*, struct block_request*,
+                            int rc);
+
+// creates /dev/ram0 from the disk image at the path given by the "ramdisk"
+// kernel parameter, or /ramdisk.img, if it is in the initrd
+void ramdisk_init(void);
+
+#if defined(__i386__)
+void ide_init(void);
+void virtio_blk_init(void);
+#endif
@@ -0,0 +1,475 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "buffer_cache.h"
+#include <common/string.h>
+#include <kernel/api/err.h>
+#include <kernel/memory/memory.h>
+#include <kernel/panic.h>
+#include <kernel/process.h>
+#include <kernel/scheduler.h>
+#include <kernel/system.h>
+#include <stdnoreturn.h>
+
+#define NUM_BUCKETS 4096
+
+// the cache takes up at most 1/MEMORY_SHARE of physical memory
+#define MEMORY_SHARE 8
+#define MIN_BUFFERS 64
+#define MAX_BUFFERS 16384
+
+#define SECTORS_PER_BUFFER (BUFFER_SIZE / SECTOR_SIZE)
+
+// in blocks. the window doubles while the access stays sequential.
+#define INITIAL_READ_AHEAD 4
+#define MAX_READ_AHEAD 32
+
+// the flusher wakes up this often and writes back the buffers that have been
+// dirty for longer than DIRTY_EXPIRE, or all of them once more than half of
+// the cache is dirty
+#define FLUSH_INTERVAL CLK_TCK
+#define DIRTY_EXPIRE (5 * CLK_TCK)
+
+// number of buffers written back with a single plug
+#define WRITE_BACK_BATCH 64
+
+static mutex lock;
+
+// buffers come from a single pool and are never freed, only reused
+static struct buffer* pool;
+static size_t max_buffers;
+static size_t num_buffers;
+static struct buffer* buckets[NUM_BUCKETS];
+
+// lru.lru_next is the most recently used buffer, lru.lru_prev the least
+static struct buffer lru = {.lru_prev = &lru, .lru_next = &lru};
+
+static size_t num_lookups;
+static size_t num_hits;
+static size_t num_misses;
+static size_t num_read_aheads;
+static size_t num_writebacks;
+static size_t num_dirty;
+
+static atomic_bool flush_requested;
+
+static size_t num_blocks(const struct block_device* dev) {
+    return div_ceil(dev->num_sectors, SECTORS_PER_BUFFER);
+}
+
+static struct buffer** bucket_of(const struct block_device* dev,
+                                 size_t block) {
+    uint32_t hash = block ^ ((uintptr_t)dev * 2654435761u);
+    return buckets + (hash % NUM_BUCKETS);
+}
+
+static struct buffer* find_buffer(const struct block_device* dev,
+                                  size_t block) {
+    for (struct buffer* it = *bucket_of(dev, block); it; it = it->hash_next) {
+        if (it->dev == dev && it->block == block)
+            return it;
+    }
+    return NULL;
+}
+
+static void lru_unlink(struct buffer* buf) {
+    buf->lru_prev->lru_next = buf->lru_next;
+    buf->lru_next->lru_prev = buf->lru_prev;
+}
+
+static void lru_push_front(struct buffer* buf) {
+    buf->lru_prev = &lru;
+    buf->lru_next = lru.lru_next;
+    lru.lru_next->lru_prev = buf;
+    lru.lru_next = buf;
+}
+
+static bool ensure_pool(void) {
+    if (pool)
+        return true;
+    struct physical_memory_info memory_info;
+    page_allocator_get_info(&memory_info);
+    size_t n = memory_info.total / (BUFFER_SIZE / 1024) / MEMORY_SHARE;
+    n = MAX(MIN_BUFFERS, MIN(n, MAX_BUFFERS));
+    pool = kmalloc(n * sizeof(struct buffer));
+    if (!pool)
+        return false;
+    max_buffers = n;
+    return true;
+}
+
+static uintptr_t alloc_page(void) {
+    uintptr_t addr = range_allocator_alloc(&kernel_vaddr_allocator, PAGE_SIZE);
+    if (IS_ERR(addr))
+        return addr;
+    int rc = paging_map_to_free_pages(addr, PAGE_SIZE, PAGE_WRITE | PAGE_GLOBAL);
+    if (IS_ERR(rc)) {
+        ASSERT_OK(range_allocator_free(&kernel_vaddr_allocator, addr, PAGE_SIZE));
+        return rc;
+    }
+    return addr;
+}
+
+// collects the result of the bio of the buffer if it has completed. returns
+// whether the bio is still in flight.
+static bool io_busy(struct buffer* buf) {
+    if (!buf->io_pending)
+        return false;
+    if (!buf->bio.done)
+        return true;
+    buf->io_pending = false;
+    if (!buf->bio.write) {
+        buf->uptodate = IS_OK(buf->bio.rc);
+    } else if (IS_OK(buf->bio.rc)) {
+        ++num_writebacks;
+    } else if (!buf->dirty) {
+        buf->dirty = true;
+        buf->dirtied_at = uptime;
+        ++num_dirty;
+    }
+    return false;
+}
+
+// returns a buffer for the block that is not in the cache yet, taking a new
+// one from the pool or reusing the least recently used idle clean buffer
+static struct buffer* alloc_buffer(struct block_device* dev, size_t block) {
+    struct buffer* buf = NULL;
+    if (num_buffers < max_buffers) {
+        uintptr_t data = alloc_page();
+        if (IS_OK(data)) {
+            buf = pool + num_buffers++;
+            *buf = (struct buffer){.data = (unsigned char*)data};
+        }
+    }
+    if (!buf) {
+        for (struct buffer* it = lru.lru_prev; it != &lru; it = it->lru_prev) {
+            if (it->ref_count == 0 && !it->dirty && !io_busy(it)) {
+                buf = it;
+                break;
+            }
+        }
+        if (!buf)
+            return NULL;
+
+        struct buffer** it = bucket_of(buf->dev, buf->block);
+        while (*it != buf)
+            it = &(*it)->hash_next;
+        *it = buf->hash_next;
+        lru_unlink(buf);
+
+        unsigned char* data = buf->data;
+        *buf = (struct buffer){.data = data};
+    }
+
+    buf->dev = dev;
+    buf->block = block;
+    struct buffer** bucket = bucket_of(dev, block);
+    buf->hash_next = *bucket;
+    *bucket = buf;
+    lru_push_front(buf);
+    return buf;
+}
+
+// prepares the bio of the buffer. it is submitted after the lock is
+// released, as submitting may block.
+static void start_io(struct buffer* buf, bool write) {
+    ASSERT(!buf->io_pending);
+    buf->io_pending = true;
+    size_t num_sectors =
+        MIN(SECTORS_PER_BUFFER,
+            buf->dev->num_sectors - buf->block * SECTORS_PER_BUFFER);
+    if (!write && num_sectors < SECTORS_PER_BUFFER)
+        memset(buf->data + num_sectors * SECTOR_SIZE, 0,
+               BUFFER_SIZE - num_sectors * SECTOR_SIZE);
+    buf->bio = (struct bio){.sector = buf->block * SECTORS_PER_BUFFER,
+                            .num_sectors = num_sectors,
+                            .buffer = buf->data,
+                            .write = write};
+}
+
+// submits the bios with the devices plugged so that bios of adjacent blocks
+// are merged
+static void submit(struct buffer** bufs, size_t n) {
+    struct block_device* plugged = NULL;
+    for (size_t i = 0; i < n; ++i) {
+        struct block_device* dev = bufs[i]->dev;
+        if (dev != plugged) {
+            if (plugged)
+                block_unplug(plugged);
+            block_plug(dev);
+            plugged = dev;
+        }
+        block_submit(dev, &bufs[i]->bio);
+    }
+    if (plugged)
+        block_unplug(plugged);
+}
+
+// starts reading the blocks after a sequential access to the block before
+// they are asked for. the first block read ahead is marked, so that reaching
+// it starts the next read-ahead while the rest are still being consumed.
+static size_t read_ahead(struct block_device* dev, size_t block, bool trigger,
+                         struct buffer** bufs) {
+    if (block != dev->ra_next) {
+        dev->ra_next = block + 1;
+        dev->ra_end = 0;
+        dev->ra_window = 0;
+        return 0;
+    }
+    dev->ra_next = block + 1;
+    if (!trigger)
+        return 0;
+
+    dev->ra_window = dev->ra_window ? MIN(dev->ra_window * 2, MAX_READ_AHEAD)
+                                    : INITIAL_READ_AHEAD;
+    size_t start = MAX(block + 1, dev->ra_end);
+    size_t end = MIN(block + 1 + dev->ra_window, num_blocks(dev));
+    size_t n = 0;
+    for (size_t i = start; i < end; ++i) {
+        if (find_buffer(dev, i))
+            continue;
+        struct buffer* buf = alloc_buffer(dev, i);
+        if (!buf)
+            break;
+        buf->read_ahead_mark = n == 0;
+        start_io(buf, false);
+        bufs[n++] = buf;
+    }
+    dev->ra_end = MAX(dev->ra_end, end);
+    num_read_aheads += n;
+    return n;
+}
+
+// writes back the dirty buffers of dev, or of every device if it is NULL,
+// and waits for them. with expired_only, only the buffers that have been
+// dirty for longer than DIRTY_EXPIRE are written back.
+static int write_back(struct block_device* dev, bool expired_only) {
+    int rc = 0;
+    for (;;) {
+        struct buffer* bufs[WRITE_BACK_BATCH];
+        struct buffer* started[WRITE_BACK_BATCH];
+        size_t n = 0;
+        size_t num_started = 0;
+
+        mutex_lock(&lock);
+        for (size_t i = 0; i < num_buffers && n < WRITE_BACK_BATCH; ++i) {
+            struct buffer* buf = pool + i;
+            if (dev && buf->dev != dev)
+                continue;
+            // a write someone else started has to be waited for as well
+            bool writing = io_busy(buf) && buf->bio.write;
+            if (!writing) {
+                if (!buf->dirty || buf->io_pending)
+                    continue;
+                if (expired_only && uptime - buf->dirtied_at < DIRTY_EXPIRE)
+                    continue;
+                buf->dirty = false;
+                --num_dirty;
+                start_io(buf, true);
+                started[num_started++] = buf;
+            }
+            ++buf->ref_count;
+            bufs[n++] = buf;
+        }
+        mutex_unlock(&lock);
+        if (n == 0)
+            return rc;
+
+        submit(started, num_started);
+        for (size_t i = 0; i < n; ++i) {
+            int bio_rc = block_wait(&bufs[i]->bio);
+            if (IS_ERR(bio_rc))
+                rc = bio_rc;
+            mutex_lock(&lock);
+            io_busy(bufs[i]);
+            --bufs[i]->ref_count;
+            mutex_unlock(&lock);
+        }
+
+        // the failed buffers are dirty again, so they would be retried
+        // forever
+        if (IS_ERR(rc))
+            return rc;
+    }
+}
+
+static struct buffer* get(struct block_device* dev, size_t block,
+                          bool read) {
+    if (block >= num_blocks(dev))
+        return ERR_PTR(-EINVAL);
+
+    mutex_lock(&lock);
+    if (!ensure_pool()) {
+        mutex_unlock(&lock);
+        return ERR_PTR(-ENOMEM);
+    }
+    ++num_lookups;
+
+    bool trigger_read_ahead = true;
+    struct buffer* buf = find_buffer(dev, block);
+    if (buf) {
+        lru_unlink(buf);
+        lru_push_front(buf);
+        trigger_read_ahead = buf->read_ahead_mark;
+        buf->read_ahead_mark = false;
+        if (buf->uptodate || io_busy(buf))
+            ++num_hits;
+        else
+            ++num_misses;
+    } else {
+        buf = alloc_buffer(dev, block);
+        if (!buf) {
+            // everything is dirty or in use. writing back makes room.
+            mutex_unlock(&lock);
+            int rc = write_back(NULL, false);
+            if (IS_ERR(rc))
+                return ERR_PTR(rc);
+            mutex_lock(&lock);
+            buf = find_buffer(dev, block);
+            if (!buf)
+                buf = alloc_buffer(dev, block);
+            if (!buf) {
+                mutex_unlock(&lock);
+                return ERR_PTR(-ENOMEM);
+            }
+        }
+        ++num_misses;
+    }
+    ++buf->ref_count;
+
+    struct buffer* bufs[MAX_READ_AHEAD + 1];
+    size_t n = read ? read_ahead(dev, block, trigger_read_ahead, bufs) : 0;
+    if (!io_busy(buf) && !buf->uptodate) {
+        if (read) {
+            start_io(buf, false);
+            bufs[n++] = buf;
+        } else {
+            memset(buf->data, 0, BUFFER_SIZE);
+            buf->uptodate = true;
+        }
+    }
+    // a write in flight doesn't stop the data from being used or modified
+    bool wait = buf->io_pending && !buf->bio.write;
+    mutex_unlock(&lock);
+
+    submit(bufs, n);
+    if (!wait)
+        return buf;
+
+    int rc = block_wait(&buf->bio);
+    mutex_lock(&lock);
+    io_busy(buf);
+    if (!buf->uptodate) {
+        if (read) {
+            --buf->ref_count;
+            mutex_unlock(&lock);
+            if (IS_OK(rc))
+                rc = -EIO;
+            return ERR_PTR(rc);
+        }
+        memset(buf->data, 0, BUFFER_SIZE);
+        buf->uptodate = true;
+    }
+    mutex_unlock(&lock);
+    return buf;
+}
+
+struct buffer* buffer_get(struct block_device* dev, size_t block) {
+    return get(dev, block, true);
+}
+
+struct buffer* buffer_get_new(struct block_device* dev, size_t block) {
+    return get(dev, block, false);
+}
+
+void buffer_mark_dirty(struct buffer* buf) {
+    mutex_lock(&lock);
+    ASSERT(buf->ref_count > 0);
+    ASSERT(buf->uptodate);
+    if (!buf->dirty) {
+        buf->dirty = true;
+        buf->dirtied_at = uptime;
+        if (++num_dirty > max_buffers / 2)
+            flush_requested = true;
+    }
+    mutex_unlock(&lock);
+}
+
+void buffer_put(struct buffer* buf) {
+    mutex_lock(&lock);
+    ASSERT(buf->ref_count > 0);
+    --buf->ref_count;
+    mutex_unlock(&lock);
+}
+
+int buffer_cache_sync(struct block_device* dev) {
+    return write_back(dev, false);
+}
+
+static bool should_flush(const uint32_t* deadline) {
+    return flush_requested || (int32_t)(uptime - *deadline) >= 0;
+}
+
+static noreturn void flusher(void) {
+    for (;;) {
+        uint32_t deadline = uptime + FLUSH_INTERVAL;
+        while (scheduler_block((should_unblock_fn)should_flush, &deadline) ==
+               -EINTR)
+            ;
+        bool all = atomic_exchange(&flush_requested, false);
+        (void)write_back(NULL, !all);
+    }
+}
+
+void buffer_cache_init(void) {
+    ASSERT_OK(process_spawn_kernel_process("flusher", flusher));
+}
+
+void buffer_cache_get_stats(struct buffer_cache_stats* stats) {
+    mutex_lock(&lock);
+    *stats = (struct buffer_cache_stats){.lookups = num_lookups,
+                                         .hits = num_hits,
+                                         .misses = num_misses,
+                                         .read_aheads = num_read_aheads,
+                                         .writebacks = num_writebacks,
+                                         .num_buffers = num_buffers,
+                                         .max_buffers = max_buffers,
+                                         .num_dirty = num_dirty};
+    mutex_unlock(&lock);
+}
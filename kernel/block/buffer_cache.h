@@ -0,0 +1,101 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "block.h"
+#include <common/extra.h>
+#include <kernel/boot_defs.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// cache of device blocks shared by everything that reads or writes block
+// devices. blocks are written back to the device in the background by a
+// flusher thread, or on sync()/fsync().
+
+#define BUFFER_SIZE PAGE_SIZE
+
+struct buffer {
+    struct block_device* dev;
+    size_t block; // in units of BUFFER_SIZE
+    unsigned char* data;
+
+    // the rest is private to the buffer cache and protected by its lock
+    struct buffer* hash_next;
+    struct buffer* lru_prev;
+    struct buffer* lru_next;
+    size_t ref_count;
+    bool uptodate;         // data holds the contents of the block
+    bool dirty;            // data has to be written back
+    bool io_pending;       // bio is in flight
+    bool read_ahead_mark;  // reaching it starts the next read-ahead
+    uint32_t dirtied_at;   // uptime when it became dirty
+    struct bio bio;
+};
+
+struct buffer_cache_stats {
+    size_t lookups;
+    size_t hits;
+    size_t misses;
+    size_t read_aheads; // blocks read before they were asked for
+    size_t writebacks;  // blocks written back
+    size_t num_buffers;
+    size_t max_buffers;
+    size_t num_dirty;
+};
+
+// returns the buffer of the block with its contents read from the device
+NODISCARD struct buffer* buffer_get(struct block_device*, size_t block);
+
+// like buffer_get, but for a caller that overwrites the whole block, so the
+// block is not read if it is not in the cache
+NODISCARD struct buffer* buffer_get_new(struct block_device*, size_t block);
+
+void buffer_mark_dirty(struct buffer*);
+void buffer_put(struct buffer*);
+
+// writes back the dirty buffers of the device, or of all devices if it is
+// NULL, and waits for them to reach the device
+NODISCARD int buffer_cache_sync(struct block_device*);
+
+// starts the flusher thread
+void buffer_cache_init(void);
+
+void buffer_cache_get_stats(struct buffer_cache_stats*);
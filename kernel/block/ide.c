@@ -0,0 +1,362 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "block.h"
+#include <kernel/api/err.h>
+#include <kernel/boot_defs.h>
+#include <kernel/api/sys/sysmacros.h>
+#include <kernel/asm_wrapper.h>
+#include <kernel/interrupts.h>
+#include <kernel/kprintf.h>
+#include <kernel/memory/memory.h>
+#include <kernel/panic.h>
+#include <kernel/pci.h>
+#include <stdalign.h>
+
+/* Like the other PCI drivers, the IDE driver is i?86-only for now. */
+
+#if defined(__i386__)
+
+#define PCI_CLASS_MASS_STORAGE 1
+#define PCI_SUBCLASS_IDE 1
+#define PCI_TYPE_IDE_CONTROLLER (PCI_CLASS_MASS_STORAGE << 8 | PCI_SUBCLASS_IDE)
+
+#define ATA_DATA 0x0
+#define ATA_SECTOR_COUNT 0x2
+#define ATA_LBA_LOW 0x3
+#define ATA_LBA_MID 0x4
+#define ATA_LBA_HIGH 0x5
+#define ATA_DRIVE_HEAD 0x6
+#define ATA_STATUS 0x7
+#define ATA_COMMAND 0x7
+
+#define ATA_STATUS_ERR 0x1
+#define ATA_STATUS_DRQ 0x8
+#define ATA_STATUS_DF 0x20
+#define ATA_STATUS_BSY 0x80
+
+#define ATA_CONTROL_INTERRUPT_DISABLE 0x2
+
+#define ATA_CMD_READ_DMA 0xc8
+#define ATA_CMD_WRITE_DMA 0xca
+#define ATA_CMD_IDENTIFY 0xec
+
+#define DRIVE_HEAD_LBA 0xe0
+#define DRIVE_HEAD_SLAVE 0x10
+
+#define IDENTIFY_CAPABILITIES 49
+#define IDENTIFY_LBA28_SECTORS 60
+
+#define CAPABILITIES_DMA 0x100
+#define CAPABILITIES_LBA 0x200
+
+#define BUS_MASTER_COMMAND 0x0
+#define BUS_MASTER_STATUS 0x2
+#define BUS_MASTER_PRDT 0x4
+
+#define BUS_MASTER_COMMAND_START 0x1
+#define BUS_MASTER_COMMAND_READ 0x8 // the device writes to memory
+
+#define BUS_MASTER_STATUS_ERROR 0x2
+#define BUS_MASTER_STATUS_INTERRUPT 0x4
+
+#define PRD_END_OF_TABLE 0x8000
+
+#define IDENTIFY_TIMEOUT 100000
+
+// LBA28 commands transfer at most 256 sectors (a sector count of 0)
+#define MAX_SECTORS 256
+
+struct prd {
+    uint32_t paddr;
+    uint16_t size;
+    uint16_t flags;
+} __attribute__((packed));
+
+// physical regions are split at page boundaries, so a request needs one per
+// segment
+#define MAX_PRDS (PAGE_SIZE / sizeof(struct prd))
+
+struct ide_drive;
+
+struct channel {
+    uint16_t io_base;
+    uint16_t control_base;
+    uint8_t irq;
+    uint16_t bus_master_base;
+    struct prd* prdt;
+
+    struct ide_drive* drives[2];
+    struct ide_drive* active; // drive whose request is being transferred
+    struct block_request* request;
+};
+
+struct ide_drive {
+    struct block_device block;
+    struct channel* channel;
+    bool slave;
+    struct block_request* pending; // waiting for the other drive
+};
+
+// a page-aligned table that fits in a page never crosses a 64KiB boundary
+alignas(PAGE_SIZE) static struct prd prdts[2][MAX_PRDS];
+
+// the legacy ports, which PIIX controllers in compatibility mode use
+static struct channel channels[2] = {
+    {.io_base = 0x1f0, .control_base = 0x3f6, .irq = 14},
+    {.io_base = 0x170, .control_base = 0x376, .irq = 15},
+};
+
+static bool controller_detected = false;
+static struct pci_addr controller_addr;
+static uint16_t bus_master_base;
+
+static void pci_enumeration_callback(const struct pci_addr* addr,
+                                     uint16_t vendor_id, uint16_t device_id) {
+    (void)vendor_id;
+    (void)device_id;
+    if (!controller_detected &&
+        pci_get_type(addr) == PCI_TYPE_IDE_CONTROLLER) {
+        controller_detected = true;
+        controller_addr = *addr;
+        bus_master_base = pci_get_bar4(addr) & ~3;
+    }
+}
+
+static void start_transfer(struct ide_drive* drive,
+                           struct block_request* rq) {
+    struct channel* channel = drive->channel;
+
+    size_t num_prds = 0;
+    for (struct bio* bio = rq->bios; bio; bio = bio->next) {
+        uintptr_t addr = (uintptr_t)bio->buffer;
+        size_t count = bio->num_sectors * SECTOR_SIZE;
+        while (count > 0) {
+            size_t size = MIN(count, PAGE_SIZE - addr % PAGE_SIZE);
+            ASSERT(num_prds < MAX_PRDS);
+            channel->prdt[num_prds++] = (struct prd){
+                .paddr = paging_virtual_to_physical_addr(addr),
+                .size = size};
+            addr += size;
+            count -= size;
+        }
+    }
+    channel->prdt[num_prds - 1].flags = PRD_END_OF_TABLE;
+
+    channel->active = drive;
+    channel->request = rq;
+
+    uint16_t bm = channel->bus_master_base;
+    out8(bm + BUS_MASTER_COMMAND, 0);
+    out32(bm + BUS_MASTER_PRDT,
+          paging_virtual_to_physical_addr((uintptr_t)channel->prdt));
+    out8(bm + BUS_MASTER_STATUS,
+         BUS_MASTER_STATUS_ERROR | BUS_MASTER_STATUS_INTERRUPT);
+    out8(bm + BUS_MASTER_COMMAND, rq->write ? 0 : BUS_MASTER_COMMAND_READ);
+
+    uint16_t io = channel->io_base;
+    while (in8(io + ATA_STATUS) & ATA_STATUS_BSY)
+        pause();
+    out8(io + ATA_DRIVE_HEAD, DRIVE_HEAD_LBA |
+                                  (drive->slave ? DRIVE_HEAD_SLAVE : 0) |
+                                  ((rq->sector >> 24) & 0xf));
+    out8(io + ATA_SECTOR_COUNT, rq->num_sectors & 0xff);
+    out8(io + ATA_LBA_LOW, rq->sector & 0xff);
+    out8(io + ATA_LBA_MID, (rq->sector >> 8) & 0xff);
+    out8(io + ATA_LBA_HIGH, (rq->sector >> 16) & 0xff);
+    out8(io + ATA_COMMAND, rq->write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+
+    out8(bm + BUS_MASTER_COMMAND,
+         in8(bm + BUS_MASTER_COMMAND) | BUS_MASTER_COMMAND_START);
+}
+
+// the two drives of a channel share it, so one waits while the other
+// transfers
+static void ide_start(struct block_device* block, struct block_request* rq) {
+    struct ide_drive* drive = (struct ide_drive*)block;
+    if (drive->channel->active)
+        drive->pending = rq;
+    else
+        start_transfer(drive, rq);
+}
+
+static const block_device_ops ops = {.start = ide_start};
+
+static void handle_irq(struct channel* channel) {
+    uint16_t bm = channel->bus_master_base;
+    uint8_t bm_status = in8(bm + BUS_MASTER_STATUS);
+    if (!(bm_status & BUS_MASTER_STATUS_INTERRUPT))
+        return;
+
+    out8(bm + BUS_MASTER_COMMAND, 0);
+    // reading the status register acknowledges the interrupt
+    uint8_t status = in8(channel->io_base + ATA_STATUS);
+    out8(bm + BUS_MASTER_STATUS,
+         BUS_MASTER_STATUS_ERROR | BUS_MASTER_STATUS_INTERRUPT);
+
+    struct ide_drive* drive = channel->active;
+    struct block_request* rq = channel->request;
+    if (!drive)
+        return;
+    channel->active = NULL;
+    channel->request = NULL;
+
+    struct ide_drive* other = channel->drives[!drive->slave];
+    if (other && other->pending) {
+        struct block_request* pending = other->pending;
+        other->pending = NULL;
+        start_transfer(other, pending);
+    }
+
+    bool failed = (status & (ATA_STATUS_ERR | ATA_STATUS_DF)) ||
+                  (bm_status & BUS_MASTER_STATUS_ERROR);
+    block_request_complete(&drive->block, rq, failed ? -EIO : 0);
+}
+
+static void primary_irq_handler(registers* regs) {
+    (void)regs;
+    handle_irq(channels);
+}
+
+static void secondary_irq_handler(registers* regs) {
+    (void)regs;
+    handle_irq(channels + 1);
+}
+
+static bool identify(struct channel* channel, bool slave, uint16_t* id) {
+    uint16_t io = channel->io_base;
+    out8(io + ATA_DRIVE_HEAD, 0xa0 | (slave ? DRIVE_HEAD_SLAVE : 0));
+    delay(5);
+    out8(io + ATA_SECTOR_COUNT, 0);
+    out8(io + ATA_LBA_LOW, 0);
+    out8(io + ATA_LBA_MID, 0);
+    out8(io + ATA_LBA_HIGH, 0);
+    out8(io + ATA_COMMAND, ATA_CMD_IDENTIFY);
+
+    // a floating bus reads as all ones
+    uint8_t status = in8(io + ATA_STATUS);
+    if (status == 0 || status == 0xff)
+        return false;
+    for (size_t i = 0; status & ATA_STATUS_BSY; ++i) {
+        if (i >= IDENTIFY_TIMEOUT)
+            return false;
+        status = in8(io + ATA_STATUS);
+    }
+
+    // ATAPI devices abort the command and leave a signature here
+    if (in8(io + ATA_LBA_MID) || in8(io + ATA_LBA_HIGH))
+        return false;
+
+    while (!(status & (ATA_STATUS_DRQ | ATA_STATUS_ERR)))
+        status = in8(io + ATA_STATUS);
+    if (status & ATA_STATUS_ERR)
+        return false;
+
+    for (size_t i = 0; i < 256; ++i)
+        id[i] = in16(io + ATA_DATA);
+    return true;
+}
+
+static void probe_drive(struct channel* channel, size_t channel_index,
+                        bool slave) {
+    static const char* names[] = {"hda", "hdb", "hdc", "hdd"};
+    static const unsigned majors[] = {3, 22};
+
+    uint16_t id[256];
+    if (!identify(channel, slave, id))
+        return;
+
+    const char* name = names[channel_index * 2 + slave];
+    uint16_t capabilities = id[IDENTIFY_CAPABILITIES];
+    if (!(capabilities & CAPABILITIES_DMA) ||
+        !(capabilities & CAPABILITIES_LBA)) {
+        kprintf("ide: %s doesn't support LBA and DMA\n", name);
+        return;
+    }
+
+    struct ide_drive* drive = kmalloc(sizeof(struct ide_drive));
+    ASSERT(drive);
+    *drive = (struct ide_drive){
+        .block = {.name = name,
+                  .num_sectors = id[IDENTIFY_LBA28_SECTORS] |
+                                 ((size_t)id[IDENTIFY_LBA28_SECTORS + 1]
+                                  << 16),
+                  .ops = &ops,
+                  .max_sectors = MAX_SECTORS,
+                  .max_segments = MAX_PRDS,
+                  .max_active = 1},
+        .channel = channel,
+        .slave = slave};
+
+    ASSERT_OK(block_device_register(
+        &drive->block, makedev(majors[channel_index], slave * 64)));
+    channel->drives[slave] = drive;
+    kprintf("ide: /dev/%s: %u MiB\n", name,
+            drive->block.num_sectors / (1024 * 1024 / SECTOR_SIZE));
+}
+
+void ide_init(void) {
+    pci_enumerate(pci_enumeration_callback);
+    if (!controller_detected)
+        return;
+    if (!bus_master_base) {
+        kprintf("ide: the controller doesn't support bus mastering\n");
+        return;
+    }
+    pci_set_bus_mastering_enabled(&controller_addr, true);
+
+    static const interrupt_handler_fn handlers[] = {primary_irq_handler,
+                                                    secondary_irq_handler};
+    for (size_t i = 0; i < 2; ++i) {
+        struct channel* channel = channels + i;
+        channel->bus_master_base = bus_master_base + i * 8;
+        channel->prdt = prdts[i];
+
+        out8(channel->control_base, ATA_CONTROL_INTERRUPT_DISABLE);
+        probe_drive(channel, i, false);
+        probe_drive(channel, i, true);
+        if (!channel->drives[0] && !channel->drives[1])
+            continue;
+
+        idt_register_interrupt_handler(IRQ(channel->irq), handlers[i]);
+        out8(channel->control_base, 0);
+    }
+}
+
+#endif
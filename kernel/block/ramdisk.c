@@ -0,0 +1,135 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#include "block.h"
+#include <common/string.h>
+#include <kernel/api/err.h>
+#include <kernel/api/fcntl.h>
+#include <kernel/api/sys/sysmacros.h>
+#include <kernel/kprintf.h>
+#include <kernel/memory/memory.h>
+#include <kernel/panic.h>
+#include <kernel/system.h>
+
+// a block device kept in memory. its initial contents come from a disk image
+// in the initrd, so a file system image can be mounted without a disk.
+
+#define DEFAULT_IMAGE_PATH "/ramdisk.img"
+
+struct ramdisk {
+    struct block_device block;
+    unsigned char* data;
+};
+
+static void ramdisk_start(struct block_device* block,
+                          struct block_request* rq) {
+    struct ramdisk* disk = (struct ramdisk*)block;
+    for (struct bio* bio = rq->bios; bio; bio = bio->next) {
+        unsigned char* data = disk->data + bio->sector * SECTOR_SIZE;
+        size_t count = bio->num_sectors * SECTOR_SIZE;
+        if (rq->write)
+            memcpy(data, bio->buffer, count);
+        else
+            memcpy(bio->buffer, data, count);
+    }
+    block_request_complete(block, rq, 0);
+}
+
+static NODISCARD int load_image(struct ramdisk* disk, const char* path) {
+    file_description* desc = vfs_open(path, O_RDONLY, 0);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+
+    struct stat st;
+    int rc = file_description_stat(desc, &st);
+    if (IS_ERR(rc))
+        goto done;
+    if (!S_ISREG(st.st_mode) || st.st_size < SECTOR_SIZE) {
+        rc = -EINVAL;
+        goto done;
+    }
+
+    size_t num_sectors = st.st_size / SECTOR_SIZE;
+    disk->data = kmalloc(num_sectors * SECTOR_SIZE);
+    if (!disk->data) {
+        rc = -ENOMEM;
+        goto done;
+    }
+    for (size_t count = 0; count < num_sectors * SECTOR_SIZE;) {
+        ssize_t nread = file_description_pread(
+            desc, disk->data + count, num_sectors * SECTOR_SIZE - count, count);
+        if (IS_ERR(nread) || nread == 0) {
+            kfree(disk->data);
+            rc = nread == 0 ? -EIO : nread;
+            goto done;
+        }
+        count += nread;
+    }
+    disk->block.num_sectors = num_sectors;
+
+done:
+    file_description_close(desc);
+    return rc;
+}
+
+void ramdisk_init(void) {
+    static const block_device_ops ops = {.start = ramdisk_start};
+
+    const char* requested_path = cmdline_lookup("ramdisk");
+    const char* path = requested_path ? requested_path : DEFAULT_IMAGE_PATH;
+
+    struct ramdisk* disk = kmalloc(sizeof(struct ramdisk));
+    ASSERT(disk);
+    *disk = (struct ramdisk){.block = {.name = "ram0",
+                                       .ops = &ops,
+                                       .max_sectors = SIZE_MAX,
+                                       .max_segments = SIZE_MAX}};
+
+    int rc = load_image(disk, path);
+    if (IS_ERR(rc)) {
+        // booting without an image is fine unless one was asked for
+        if (rc != -ENOENT || requested_path)
+            kprintf("ramdisk: failed to load %s (%d)\n", path, rc);
+        kfree(disk);
+        return;
+    }
+
+    ASSERT_OK(block_device_register(&disk->block, makedev(1, 0)));
+    kprintf("ramdisk: /dev/ram0: %u KiB from %s\n",
+            disk->block.num_sectors * SECTOR_SIZE / 1024, path);
+}
@@ -0,0 +1,272 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "block.h"
+#include <kernel/api/err.h>
+#include <kernel/api/sys/sysmacros.h>
+#include <kernel/boot_defs.h>
+#include <kernel/interrupts.h>
+#include <kernel/kprintf.h>
+#include <kernel/memory/memory.h>
+#include <kernel/panic.h>
+#include <kernel/system.h>
+#include <kernel/virtio.h>
+
+/* Like the virtio transport, the virtio-blk driver is i?86-only for now. */
+
+#if defined(__i386__)
+
+#define VIRTIO_BLK_F_SEG_MAX 2
+
+#define VIRTIO_BLK_CONFIG_CAPACITY 0x0 // 64-bit number of sectors
+#define VIRTIO_BLK_CONFIG_SEG_MAX 0xc
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+
+#define VIRTIO_BLK_S_OK 0
+
+#define MAX_DEVICES 4
+
+// number of requests a device can have in flight
+#define NUM_SLOTS 32
+
+// the header and the status byte take up two of the descriptors
+#define MAX_DESCS 64
+#define MAX_SEGMENTS (MAX_DESCS - 2)
+
+struct request_header {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} __attribute__((packed));
+
+// the parts of an in-flight request the device reads or writes. slots are
+// aligned to their size, so none of them crosses a page.
+struct slot {
+    struct request_header header;
+    uint8_t status;
+} __attribute__((aligned(32)));
+
+struct indirect_table {
+    struct virtq_desc descs[MAX_DESCS];
+};
+
+struct virtio_blk {
+    struct block_device block;
+    virtio_device virtio;
+    virtqueue queue;
+    uint8_t irq;
+
+    // both are page-aligned arrays of NUM_SLOTS entries
+    struct slot* slots;
+    struct indirect_table* tables;
+
+    struct block_request* requests[NUM_SLOTS];
+    uint32_t free_slots; // bitmap
+};
+
+static struct virtio_blk* devices[MAX_DEVICES];
+static size_t num_devices;
+
+static struct pci_addr found_addrs[MAX_DEVICES];
+static size_t num_found;
+
+static void pci_enumeration_callback(const struct pci_addr* addr,
+                                     uint16_t vendor_id, uint16_t device_id) {
+    if (vendor_id == VIRTIO_PCI_VENDOR_ID &&
+        device_id == VIRTIO_PCI_DEVICE_ID_BLOCK && num_found < MAX_DEVICES)
+        found_addrs[num_found++] = *addr;
+}
+
+static void virtio_blk_start(struct block_device* block,
+                             struct block_request* rq) {
+    struct virtio_blk* dev = (struct virtio_blk*)block;
+
+    // max_active keeps a slot free for every request that gets here
+    int slot_index = __builtin_ffs(dev->free_slots) - 1;
+    ASSERT(slot_index >= 0);
+    struct slot* slot = dev->slots + slot_index;
+    slot->header = (struct request_header){
+        .type = rq->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN,
+        .sector = rq->sector};
+    slot->status = 0xff;
+
+    // interrupts are disabled, so a single scratch array is enough
+    static struct virtq_buf bufs[MAX_DESCS];
+    size_t num_bufs = 0;
+    bufs[num_bufs++] = (struct virtq_buf){
+        .paddr = paging_virtual_to_physical_addr((uintptr_t)&slot->header),
+        .len = sizeof(struct request_header)};
+    for (struct bio* bio = rq->bios; bio; bio = bio->next) {
+        uintptr_t addr = (uintptr_t)bio->buffer;
+        size_t count = bio->num_sectors * SECTOR_SIZE;
+        while (count > 0) {
+            size_t size = MIN(count, PAGE_SIZE - addr % PAGE_SIZE);
+            uintptr_t paddr = paging_virtual_to_physical_addr(addr);
+            struct virtq_buf* prev = bufs + num_bufs - 1;
+            if (num_bufs > 1 && prev->paddr + prev->len == paddr) {
+                prev->len += size;
+            } else {
+                ASSERT(num_bufs < MAX_DESCS - 1);
+                bufs[num_bufs++] =
+                    (struct virtq_buf){.paddr = paddr, .len = size};
+            }
+            addr += size;
+            count -= size;
+        }
+    }
+    bufs[num_bufs++] = (struct virtq_buf){
+        .paddr = paging_virtual_to_physical_addr((uintptr_t)&slot->status),
+        .len = 1};
+
+    // the device reads the header and the data of writes, and writes the
+    // data of reads and the status
+    size_t num_out = rq->write ? num_bufs - 1 : 1;
+    int rc = virtqueue_add(&dev->queue, bufs, num_out, num_bufs - num_out,
+                           dev->tables[slot_index].descs, slot);
+    if (IS_ERR(rc)) {
+        block_request_complete(block, rq, rc);
+        return;
+    }
+    dev->free_slots &= ~(1u << slot_index);
+    dev->requests[slot_index] = rq;
+    virtqueue_kick(&dev->queue);
+}
+
+static const block_device_ops ops = {.start = virtio_blk_start};
+
+static void handle_irq(struct virtio_blk* dev) {
+    if (!(virtio_read_isr(&dev->virtio) & 1))
+        return;
+
+    struct slot* slot;
+    while ((slot = virtqueue_get_used(&dev->queue, NULL))) {
+        size_t i = slot - dev->slots;
+        struct block_request* rq = dev->requests[i];
+        dev->requests[i] = NULL;
+        dev->free_slots |= 1u << i;
+        block_request_complete(&dev->block, rq,
+                               slot->status == VIRTIO_BLK_S_OK ? 0 : -EIO);
+    }
+}
+
+// devices may share an interrupt line
+static void irq_handler(registers* regs) {
+    for (size_t i = 0; i < num_devices; ++i) {
+        if ((uint32_t)IRQ(devices[i]->irq) == regs->num)
+            handle_irq(devices[i]);
+    }
+}
+
+static void probe(const struct pci_addr* addr) {
+    static const char* names[] = {"vda", "vdb", "vdc", "vdd"};
+    const char* name = names[num_devices];
+
+    struct virtio_blk* dev = kmalloc(sizeof(struct virtio_blk));
+    ASSERT(dev);
+    *dev = (struct virtio_blk){0};
+
+    int rc = virtio_init(&dev->virtio, addr,
+                         (1u << VIRTIO_F_INDIRECT_DESC) |
+                             (1u << VIRTIO_BLK_F_SEG_MAX));
+    if (IS_OK(rc))
+        rc = virtqueue_init(&dev->queue, &dev->virtio, 0);
+    if (IS_ERR(rc)) {
+        kprintf("virtio-blk: failed to initialize %s\n", name);
+        virtio_fail(&dev->virtio);
+        kfree(dev);
+        return;
+    }
+
+    dev->slots = kaligned_alloc(PAGE_SIZE, NUM_SLOTS * sizeof(struct slot));
+    ASSERT(dev->slots);
+    dev->tables = kaligned_alloc(PAGE_SIZE,
+                                 NUM_SLOTS * sizeof(struct indirect_table));
+    ASSERT(dev->tables);
+    dev->free_slots = UINT32_MAX >> (32 - NUM_SLOTS);
+
+    // sectors beyond what size_t can count are left unused
+    size_t num_sectors =
+        virtio_read_config32(&dev->virtio, VIRTIO_BLK_CONFIG_CAPACITY + 4)
+            ? SIZE_MAX
+            : virtio_read_config32(&dev->virtio, VIRTIO_BLK_CONFIG_CAPACITY);
+
+    size_t max_segments = MAX_SEGMENTS;
+    if (virtio_has_feature(&dev->virtio, VIRTIO_BLK_F_SEG_MAX)) {
+        uint32_t seg_max =
+            virtio_read_config32(&dev->virtio, VIRTIO_BLK_CONFIG_SEG_MAX);
+        if (seg_max > 0)
+            max_segments = MIN(max_segments, seg_max);
+    }
+
+    // without indirect descriptors, every part of a request takes up a
+    // descriptor of the ring
+    size_t max_active = NUM_SLOTS;
+    bool indirect = virtio_has_feature(&dev->virtio, VIRTIO_F_INDIRECT_DESC);
+    if (!indirect)
+        max_active = MIN(max_active,
+                         MAX(1, dev->queue.size / (max_segments + 2)));
+
+    dev->block = (struct block_device){
+        .name = name,
+        .num_sectors = num_sectors,
+        .ops = &ops,
+        .max_sectors = max_segments * PAGE_SIZE / SECTOR_SIZE,
+        .max_segments = max_segments,
+        .max_active = max_active};
+    dev->irq = pci_get_interrupt_line(addr);
+
+    devices[num_devices++] = dev;
+    idt_register_interrupt_handler(IRQ(dev->irq), irq_handler);
+    virtio_driver_ok(&dev->virtio);
+
+    ASSERT_OK(block_device_register(&dev->block,
+                                    makedev(254, (num_devices - 1) * 16)));
+    kprintf("virtio-blk: /dev/%s: %u MiB, %u requests in flight\n", name,
+            num_sectors / (1024 * 1024 / SECTOR_SIZE), max_active);
+}
+
+void virtio_blk_init(void) {
+    pci_enumerate(pci_enumeration_callback);
+    for (size_t i = 0; i < num_found; ++i)
+        probe(found_addrs + i);
+}
+
+#endif
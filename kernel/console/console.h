@@ -53,5 +53,7 @@ struct inode* serial_console_device_create(uint16_t port);
 
 void system_console_init(void);
 struct inode* system_console_device_create(void);
+// wakes the watchers of /dev/console if console is the active console
+void system_console_notify(struct inode* console);
 
 void tty_maybe_send_signal(pid_t pgid, char ch);
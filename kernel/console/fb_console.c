@@ -45,6 +45,7 @@
 #include <kernel/api/fb.h>
 #include <kernel/api/fcntl.h>
 #include <kernel/api/hid.h>
+#include <kernel/api/poll.h>
 #include <kernel/api/signum.h>
 #include <kernel/api/sys/ioctl.h>
 #include <kernel/api/sys/sysmacros.h>
@@ -516,10 +517,20 @@ void fb_console_init(void) {
     initialized = true;
 }
 
+static struct inode* device_inode;
+
+static void notify_readers(void) {
+    if (!device_inode)
+        return;
+    inode_notify(device_inode);
+    system_console_notify(device_inode);
+}
+
 static void input_buf_write_str(const char* s) {
     bool int_flag = push_cli();
     ring_buf_write_evicting_oldest(&input_buf, s, strlen(s));
     pop_cli(int_flag);
+    notify_readers();
 }
 
 static pid_t pgid;
@@ -568,6 +579,7 @@ void fb_console_on_key(const key_event* event) {
     bool int_flag = push_cli();
     ring_buf_write_evicting_oldest(&input_buf, &key, 1);
     pop_cli(int_flag);
+    notify_readers();
 }
 
 static bool read_should_unblock(file_description* desc) {
@@ -598,6 +610,13 @@ static ssize_t fb_console_device_read(file_description* desc, void* buffer, size
     }
 }
 
+static short fb_console_device_poll(file_description* desc, short events) {
+    short revents = events & POLLOUT;
+    if ((events & POLLIN) && read_should_unblock(desc))
+        revents |= POLLIN;
+    return revents;
+}
+
 static ssize_t fb_console_device_write(file_description* desc, const void* buffer, size_t count) {
     (void)desc;
     const char* chars = (char*)buffer;
@@ -642,10 +661,12 @@ struct inode* fb_console_device_create(void) {
 
     static file_ops fops = {.read = fb_console_device_read,
                             .write = fb_console_device_write,
-                            .ioctl = fb_console_device_ioctl};
+                            .ioctl = fb_console_device_ioctl,
+                            .poll = fb_console_device_poll};
     *inode = (struct inode){.fops = &fops,
                             .mode = S_IFCHR,
                             .device_id = makedev(5, 0),
                             .ref_count = 1};
+    device_inode = inode;
     return inode;
 }
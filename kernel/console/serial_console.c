@@ -38,6 +38,7 @@
  */
 
 #include "console.h"
+#include <kernel/api/poll.h>
 #include <kernel/api/signum.h>
 #include <kernel/api/sys/ioctl.h>
 #include <kernel/api/sys/sysmacros.h>
@@ -49,6 +50,7 @@
 #include <kernel/serial.h>
 
 static ring_buf input_bufs[4];
+static struct inode* devices[4];
 static pid_t pgid;
 
 void serial_console_init(void) {
@@ -73,6 +75,12 @@ void serial_console_on_char(uint16_t port, char ch) {
     bool int_flag = push_cli();
     ring_buf_write_evicting_oldest(buf, &ch, 1);
     pop_cli(int_flag);
+
+    struct inode* device = devices[buf - input_bufs];
+    if (device) {
+        inode_notify(device);
+        system_console_notify(device);
+    }
 }
 
 typedef struct serial_console_device {
@@ -110,6 +118,14 @@ static ssize_t serial_console_device_read(file_description* desc, void* buffer,
     }
 }
 
+static short serial_console_device_poll(file_description* desc,
+                                        short events) {
+    short revents = events & POLLOUT;
+    if ((events & POLLIN) && read_should_unblock(desc))
+        revents |= POLLIN;
+    return revents;
+}
+
 static ssize_t serial_console_device_write(file_description* desc,
                                            const void* buffer, size_t count) {
     serial_console_device* dev = (serial_console_device*)desc->inode;
@@ -150,11 +166,13 @@ struct inode* serial_console_device_create(uint16_t port) {
     struct inode* inode = (struct inode*)dev;
     static file_ops fops = {.read = serial_console_device_read,
                             .write = serial_console_device_write,
-                            .ioctl = serial_console_device_ioctl};
+                            .ioctl = serial_console_device_ioctl,
+                            .poll = serial_console_device_poll};
     inode->fops = &fops;
     inode->mode = S_IFCHR;
     inode->device_id = makedev(4, 63 + (dev_t)serial_port_to_com_number(port));
     inode->ref_count = 1;
 
+    devices[serial_port_to_com_number(port) - 1] = inode;
     return inode;
 }
@@ -45,6 +45,7 @@
 #include <kernel/memory/memory.h>
 
 static file_description* active_console = NULL;
+static struct inode* device_inode;
 
 void system_console_init(void) {
     active_console = vfs_open("/dev/tty", O_RDWR, 0);
@@ -58,6 +59,11 @@ void system_console_init(void) {
     UNIMPLEMENTED();
 }
 
+void system_console_notify(struct inode* console) {
+    if (device_inode && active_console && active_console->inode == console)
+        inode_notify(device_inode);
+}
+
 static ssize_t system_console_device_read(file_description* desc, void* buffer, size_t count) {
     (void)desc;
     return file_description_read(active_console, buffer, count);
@@ -73,6 +79,11 @@ static int system_console_device_ioctl(file_description* desc, int request, void
     return file_description_ioctl(active_console, request, argp);
 }
 
+static short system_console_device_poll(file_description* desc, short events) {
+    (void)desc;
+    return file_description_poll(active_console, events);
+}
+
 struct inode* system_console_device_create(void) {
     struct inode* inode = kmalloc(sizeof(struct inode));
     if (!inode)
@@ -82,10 +93,12 @@ struct inode* system_console_device_create(void) {
         .read = system_console_device_read,
         .write = system_console_device_write,
         .ioctl = system_console_device_ioctl,
+        .poll = system_console_device_poll,
     };
     *inode = (struct inode){.fops = &fops,
                             .mode = S_IFCHR,
                             .device_id = makedev(5, 1),
                             .ref_count = 1};
+    device_inode = inode;
     return inode;
 }
@@ -0,0 +1,197 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "exec_cache.h"
+#include "boot_defs.h"
+#include "panic.h"
+#include <common/string.h>
+
+#define MAX_IMAGES 16
+
+static mutex cache_lock;
+static struct exec_image* images[MAX_IMAGES];
+static size_t last_used[MAX_IMAGES];
+static size_t clock;
+static size_t num_lookups;
+static size_t num_hits;
+
+void exec_image_ref(struct exec_image* image) {
+    ASSERT(image);
+    ++image->ref_count;
+}
+
+void exec_image_unref(struct exec_image* image) {
+    if (!image)
+        return;
+    ASSERT(image->ref_count > 0);
+    if (--image->ref_count > 0)
+        return;
+
+    for (size_t i = 0; i < image->num_pages; ++i) {
+        if (image->pages[i])
+            page_allocator_unref_page(image->pages[i]);
+    }
+    kfree(image->pages);
+    kfree(image->regions);
+    inode_unref(image->inode);
+    kfree(image);
+}
+
+static ssize_t find_slot(struct inode* inode) {
+    for (size_t i = 0; i < MAX_IMAGES; ++i) {
+        if (images[i] && images[i]->inode == inode)
+            return i;
+    }
+    return -1;
+}
+
+struct exec_image* exec_cache_lookup(struct inode* inode) {
+    mutex_lock(&cache_lock);
+    ++num_lookups;
+    ssize_t i = find_slot(inode);
+    if (i < 0) {
+        mutex_unlock(&cache_lock);
+        return NULL;
+    }
+    ++num_hits;
+    last_used[i] = ++clock;
+    struct exec_image* image = images[i];
+    exec_image_ref(image);
+    mutex_unlock(&cache_lock);
+    return image;
+}
+
+struct exec_image* exec_cache_insert(struct inode* inode,
+                                     const vm_region* regions,
+                                     size_t num_regions,
+                                     const struct exec_info* info) {
+    struct exec_image* image = kmalloc(sizeof(struct exec_image));
+    if (!image)
+        return ERR_PTR(-ENOMEM);
+    *image = (struct exec_image){.info = *info, .num_regions = num_regions};
+
+    image->regions = kmalloc(num_regions * sizeof(vm_region));
+    if (!image->regions) {
+        kfree(image);
+        return ERR_PTR(-ENOMEM);
+    }
+    memcpy(image->regions, regions, num_regions * sizeof(vm_region));
+
+    // only read-only segments are backed by shared pages
+    for (size_t i = 0; i < num_regions; ++i) {
+        vm_region* region = image->regions + i;
+        region->desc = NULL;
+        region->image = NULL;
+        region->image_page = image->num_pages;
+        if (!(region->page_flags & PAGE_WRITE))
+            image->num_pages += (region->end - region->start) / PAGE_SIZE;
+    }
+    if (image->num_pages > 0) {
+        size_t size = image->num_pages * sizeof(uintptr_t);
+        image->pages = kmalloc(size);
+        if (!image->pages) {
+            kfree(image->regions);
+            kfree(image);
+            return ERR_PTR(-ENOMEM);
+        }
+        memset(image->pages, 0, size);
+    }
+
+    image->inode = inode;
+    inode_ref(inode);
+    image->ref_count = 2; // one for the cache and one for the caller
+
+    mutex_lock(&cache_lock);
+    ssize_t slot = find_slot(inode);
+    if (slot < 0) {
+        // evict the least recently used image
+        slot = 0;
+        for (size_t i = 0; i < MAX_IMAGES; ++i) {
+            if (!images[i]) {
+                slot = i;
+                break;
+            }
+            if (last_used[i] < last_used[slot])
+                slot = i;
+        }
+    }
+    struct exec_image* evicted = images[slot];
+    images[slot] = image;
+    last_used[slot] = ++clock;
+    mutex_unlock(&cache_lock);
+
+    exec_image_unref(evicted);
+    return image;
+}
+
+// processes that are already running keep their reference to the image.
+// its pages stay as they are, because the page cache copies the pages that
+// are mapped privately before the file writes to them.
+void exec_cache_invalidate(struct inode* inode) {
+    mutex_lock(&cache_lock);
+    ssize_t i = find_slot(inode);
+    if (i < 0) {
+        mutex_unlock(&cache_lock);
+        return;
+    }
+    struct exec_image* image = images[i];
+    images[i] = NULL;
+    mutex_unlock(&cache_lock);
+
+    exec_image_unref(image);
+}
+
+void exec_cache_get_stats(struct exec_cache_stats* stats) {
+    *stats = (struct exec_cache_stats){0};
+
+    mutex_lock(&cache_lock);
+    stats->lookups = num_lookups;
+    stats->hits = num_hits;
+    for (size_t i = 0; i < MAX_IMAGES; ++i) {
+        struct exec_image* image = images[i];
+        if (!image)
+            continue;
+        ++stats->num_images;
+        for (size_t j = 0; j < image->num_pages; ++j) {
+            if (image->pages[j])
+                ++stats->shared_pages;
+        }
+    }
+    mutex_unlock(&cache_lock);
+}
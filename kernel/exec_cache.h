@@ -0,0 +1,87 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "fs/fs.h"
+#include "lock.h"
+#include "memory/memory.h"
+
+// what the program headers of an executable say besides its segments
+struct exec_info {
+    uintptr_t entry_point;
+    uintptr_t max_segment_addr;
+    uintptr_t phdr_addr; // 0 if the program headers are not loaded
+    size_t num_phdrs;
+    char interp[64]; // empty if the executable is statically linked
+};
+
+// the parsed program headers of an executable, along with the physical pages
+// of its read-only segments. the pages are populated on the first fault and
+// are then mapped by every process running the executable.
+struct exec_image {
+    atomic_size_t ref_count;
+    struct inode* inode;
+
+    struct exec_info info;
+    vm_region* regions; // desc and image are not used
+    size_t num_regions;
+
+    mutex lock;
+    uintptr_t* pages; // physical addresses, or 0 if not populated yet
+    size_t num_pages;
+};
+
+struct exec_cache_stats {
+    size_t lookups;
+    size_t hits;
+    size_t num_images;
+    size_t shared_pages;
+};
+
+struct exec_image* exec_cache_lookup(struct inode*);
+NODISCARD struct exec_image* exec_cache_insert(struct inode*,
+                                               const vm_region* regions,
+                                               size_t num_regions,
+                                               const struct exec_info*);
+void exec_cache_invalidate(struct inode*);
+void exec_cache_get_stats(struct exec_cache_stats*);
+
+void exec_image_ref(struct exec_image*);
+void exec_image_unref(struct exec_image*);
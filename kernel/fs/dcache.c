@@ -0,0 +1,302 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "dcache.h"
+#include <common/string.h>
+#include <kernel/memory/memory.h>
+#include <kernel/panic.h>
+
+#define NUM_BUCKETS 4096
+#define MAX_ENTRIES 16384
+#define MAX_NAME_LEN 43 // longer names are not cached
+
+struct dcache_entry {
+    struct dcache_entry* hash_next;
+    struct dcache_entry* lru_prev;
+    struct dcache_entry* lru_next;
+    struct inode* parent;
+    struct inode* child; // NULL for a negative entry
+    uint32_t hash;
+    char name[MAX_NAME_LEN + 1];
+};
+
+static mutex lock;
+
+// entries come from a single pool because kmalloc() hands out whole pages
+static struct dcache_entry* pool;
+static struct dcache_entry* free_entries;
+static struct dcache_entry* buckets[NUM_BUCKETS];
+
+// lru.lru_next is the most recently used entry, lru.lru_prev the least
+static struct dcache_entry lru = {.lru_prev = &lru, .lru_next = &lru};
+
+static size_t generation;
+static size_t num_lookups;
+static size_t num_hits;
+static size_t num_negative_hits;
+static size_t num_entries;
+static size_t num_negative_entries;
+
+static uint32_t hash_key(const struct inode* parent, const char* name) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (const unsigned char* p = (const unsigned char*)name; *p; ++p) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash ^ ((uintptr_t)parent * 2654435761u);
+}
+
+static struct dcache_entry** bucket_of(uint32_t hash) {
+    return buckets + (hash % NUM_BUCKETS);
+}
+
+static struct dcache_entry* find_entry(const struct inode* parent,
+                                       const char* name, uint32_t hash) {
+    for (struct dcache_entry* it = *bucket_of(hash); it; it = it->hash_next) {
+        if (it->hash == hash && it->parent == parent &&
+            !strcmp(it->name, name))
+            return it;
+    }
+    return NULL;
+}
+
+static void lru_unlink(struct dcache_entry* entry) {
+    entry->lru_prev->lru_next = entry->lru_next;
+    entry->lru_next->lru_prev = entry->lru_prev;
+}
+
+static void lru_push_front(struct dcache_entry* entry) {
+    entry->lru_prev = &lru;
+    entry->lru_next = lru.lru_next;
+    lru.lru_next->lru_prev = entry;
+    lru.lru_next = entry;
+}
+
+// unlinks the entry and returns it to the free list. the references it held
+// are handed to the caller, which drops them after releasing the lock.
+static void detach_entry(struct dcache_entry* entry, struct inode** out_parent,
+                         struct inode** out_child) {
+    struct dcache_entry** it = bucket_of(entry->hash);
+    while (*it != entry)
+        it = &(*it)->hash_next;
+    *it = entry->hash_next;
+    lru_unlink(entry);
+
+    --num_entries;
+    if (!entry->child)
+        --num_negative_entries;
+
+    *out_parent = entry->parent;
+    *out_child = entry->child;
+    entry->hash_next = free_entries;
+    free_entries = entry;
+}
+
+static bool ensure_pool(void) {
+    if (pool)
+        return true;
+    pool = kmalloc(MAX_ENTRIES * sizeof(struct dcache_entry));
+    if (!pool)
+        return false;
+    for (size_t i = 0; i < MAX_ENTRIES; ++i) {
+        pool[i].hash_next = free_entries;
+        free_entries = pool + i;
+    }
+    return true;
+}
+
+struct inode* dcache_lookup(struct inode* parent, const char* name) {
+    if (strlen(name) > MAX_NAME_LEN)
+        return NULL;
+    uint32_t hash = hash_key(parent, name);
+
+    mutex_lock(&lock);
+    ++num_lookups;
+    struct dcache_entry* entry = find_entry(parent, name, hash);
+    if (!entry) {
+        mutex_unlock(&lock);
+        return NULL;
+    }
+    lru_unlink(entry);
+    lru_push_front(entry);
+
+    struct inode* child = entry->child;
+    if (child) {
+        ++num_hits;
+        inode_ref(child);
+    } else {
+        ++num_negative_hits;
+    }
+    mutex_unlock(&lock);
+
+    return child ? child : ERR_PTR(-ENOENT);
+}
+
+size_t dcache_generation(void) {
+    mutex_lock(&lock);
+    size_t ret = generation;
+    mutex_unlock(&lock);
+    return ret;
+}
+
+void dcache_insert(struct inode* parent, const char* name,
+                   struct inode* child, size_t expected_generation) {
+    size_t len = strlen(name);
+    if (len > MAX_NAME_LEN)
+        return;
+    uint32_t hash = hash_key(parent, name);
+
+    struct inode* evicted_parent = NULL;
+    struct inode* evicted_child = NULL;
+
+    mutex_lock(&lock);
+    if (generation != expected_generation || !ensure_pool() ||
+        find_entry(parent, name, hash)) {
+        mutex_unlock(&lock);
+        return;
+    }
+
+    if (!free_entries) {
+        ASSERT(lru.lru_prev != &lru);
+        detach_entry(lru.lru_prev, &evicted_parent, &evicted_child);
+    }
+    struct dcache_entry* entry = free_entries;
+    free_entries = entry->hash_next;
+
+    entry->parent = parent;
+    inode_ref(parent);
+    entry->child = child;
+    if (child)
+        inode_ref(child);
+    else
+        ++num_negative_entries;
+    entry->hash = hash;
+    strlcpy(entry->name, name, sizeof(entry->name));
+
+    struct dcache_entry** bucket = bucket_of(hash);
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    lru_push_front(entry);
+    ++num_entries;
+    mutex_unlock(&lock);
+
+    if (evicted_parent)
+        inode_unref(evicted_parent);
+    if (evicted_child)
+        inode_unref(evicted_child);
+}
+
+void dcache_invalidate(struct inode* parent, const char* name) {
+    struct inode* old_parent = NULL;
+    struct inode* old_child = NULL;
+
+    mutex_lock(&lock);
+    ++generation;
+    if (strlen(name) <= MAX_NAME_LEN) {
+        struct dcache_entry* entry =
+            find_entry(parent, name, hash_key(parent, name));
+        if (entry)
+            detach_entry(entry, &old_parent, &old_child);
+    }
+    mutex_unlock(&lock);
+
+    if (old_parent)
+        inode_unref(old_parent);
+    if (old_child)
+        inode_unref(old_child);
+}
+
+static bool parent_is(const struct dcache_entry* entry,
+                      const struct inode* dir) {
+    return entry->parent == dir;
+}
+
+static bool parent_is_in_fs(const struct dcache_entry* entry,
+                            const struct inode* fs_root) {
+    return entry->parent->fs_root_inode == fs_root;
+}
+
+static void invalidate_matching(bool (*match)(const struct dcache_entry*,
+                                              const struct inode*),
+                                const struct inode* key) {
+    // references are dropped in batches outside the lock
+    enum { BATCH_SIZE = 32 };
+    struct inode* refs[2 * BATCH_SIZE];
+    for (;;) {
+        size_t num_refs = 0;
+        mutex_lock(&lock);
+        ++generation;
+        for (struct dcache_entry* it = lru.lru_next;
+             it != &lru && num_refs < 2 * BATCH_SIZE;) {
+            struct dcache_entry* next = it->lru_next;
+            if (match(it, key)) {
+                detach_entry(it, refs + num_refs, refs + num_refs + 1);
+                num_refs += 2;
+            }
+            it = next;
+        }
+        mutex_unlock(&lock);
+
+        if (num_refs == 0)
+            return;
+        for (size_t i = 0; i < num_refs; ++i) {
+            if (refs[i])
+                inode_unref(refs[i]);
+        }
+    }
+}
+
+void dcache_invalidate_dir(struct inode* dir) {
+    invalidate_matching(parent_is, dir);
+}
+
+void dcache_invalidate_fs(struct inode* fs_root) {
+    invalidate_matching(parent_is_in_fs, fs_root);
+}
+
+void dcache_get_stats(struct dcache_stats* stats) {
+    mutex_lock(&lock);
+    *stats = (struct dcache_stats){.lookups = num_lookups,
+                                   .hits = num_hits,
+                                   .negative_hits = num_negative_hits,
+                                   .num_entries = num_entries,
+                                   .num_negative_entries =
+                                       num_negative_entries};
+    mutex_unlock(&lock);
+}
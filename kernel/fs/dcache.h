@@ -0,0 +1,73 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "fs.h"
+
+struct dcache_stats {
+    size_t lookups;
+    size_t hits;
+    size_t negative_hits;
+    size_t num_entries;
+    size_t num_negative_entries;
+};
+
+// returns the cached child with a new reference, ERR_PTR(-ENOENT) if the
+// name is known not to exist, or NULL if nothing is cached for the name.
+struct inode* dcache_lookup(struct inode* parent, const char* name);
+
+// a lookup that missed the cache passes the generation taken before asking
+// the file system, so that a result raced by an invalidation is not cached.
+size_t dcache_generation(void);
+
+// caches child (or a negative entry if child is NULL) for (parent, name)
+void dcache_insert(struct inode* parent, const char* name,
+                   struct inode* child, size_t generation);
+
+void dcache_invalidate(struct inode* parent, const char* name);
+
+// forgets every entry whose parent is dir
+void dcache_invalidate_dir(struct inode* dir);
+
+// forgets every entry in the file system rooted at fs_root, so that the cache
+// doesn't keep its inodes alive after it is unmounted
+void dcache_invalidate_fs(struct inode* fs_root);
+
+void dcache_get_stats(struct dcache_stats*);
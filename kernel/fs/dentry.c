@@ -44,10 +44,35 @@
 #include <kernel/memory/memory.h>
 #include <kernel/panic.h>
 
+static bool is_cursor(const struct dentry* dentry) { return !dentry->name; }
+
+static void unlink_dentry(struct dentry** head, struct dentry* dentry) {
+    if (dentry->prev)
+        dentry->prev->next = dentry->next;
+    else
+        *head = dentry->next;
+    if (dentry->next)
+        dentry->next->prev = dentry->prev;
+    dentry->prev = dentry->next = NULL;
+}
+
+// inserts dentry after prev, or at the head if prev is NULL
+static void insert_dentry(struct dentry** head, struct dentry* prev,
+                          struct dentry* dentry) {
+    dentry->prev = prev;
+    dentry->next = prev ? prev->next : *head;
+    if (dentry->next)
+        dentry->next->prev = dentry;
+    if (prev)
+        prev->next = dentry;
+    else
+        *head = dentry;
+}
+
 struct inode* dentry_find(const struct dentry* head, const char* name) {
     const struct dentry* dentry = head;
     while (dentry) {
-        if (!strcmp(dentry->name, name)) {
+        if (!is_cursor(dentry) && !strcmp(dentry->name, name)) {
             inode_ref(dentry->inode);
             return dentry->inode;
         }
@@ -57,31 +82,63 @@ struct inode* dentry_find(const struct dentry* head, const char* name) {
 }
 
 int dentry_getdents(struct getdents_ctx* ctx, file_description* desc,
-                    const struct dentry* head, getdents_callback_fn callback) {
-    const struct dentry* dentry = head;
-    if (!dentry)
-        return 0;
-
-    for (off_t i = 0; i < desc->offset; ++i) {
-        dentry = dentry->next;
-        if (!dentry)
-            return 0;
+                    struct dentry** head, getdents_callback_fn callback) {
+    struct dentry* cursor = desc->private_data;
+    struct dentry* prev;
+    struct dentry* dentry;
+    if (cursor && cursor->cookie == desc->offset) {
+        prev = cursor->prev;
+        dentry = cursor->next;
+        unlink_dentry(head, cursor);
+    } else {
+        // first call, or the offset was changed with lseek
+        if (cursor) {
+            unlink_dentry(head, cursor);
+        } else {
+            cursor = kmalloc(sizeof(struct dentry));
+            if (!cursor)
+                return -ENOMEM;
+            *cursor = (struct dentry){0};
+            desc->private_data = cursor;
+        }
+        prev = NULL;
+        dentry = *head;
+        while (dentry &&
+               (is_cursor(dentry) || dentry->cookie < desc->offset)) {
+            prev = dentry;
+            dentry = dentry->next;
+        }
     }
 
-    for (; dentry; dentry = dentry->next) {
+    for (; dentry; prev = dentry, dentry = dentry->next) {
+        if (is_cursor(dentry))
+            continue;
         uint8_t type = mode_to_dirent_type(dentry->inode->mode);
         if (!callback(ctx, dentry->name, type))
             break;
-        ++desc->offset;
+        desc->offset = dentry->cookie + 1;
     }
+
+    cursor->cookie = desc->offset;
+    insert_dentry(head, prev, cursor);
     return 0;
 }
 
-int dentry_append(struct dentry** head, const char* name, struct inode* child) {
+void dentry_close_cursor(file_description* desc, struct dentry** head) {
+    struct dentry* cursor = desc->private_data;
+    if (!cursor)
+        return;
+    unlink_dentry(head, cursor);
+    kfree(cursor);
+    desc->private_data = NULL;
+}
+
+int dentry_append(struct dentry** head, off_t* next_cookie, const char* name,
+                  struct inode* child) {
     struct dentry* prev = NULL;
     struct dentry* it = *head;
     while (it) {
-        if (!strcmp(it->name, name))
+        if (!is_cursor(it) && !strcmp(it->name, name))
             return -EEXIST;
         prev = it;
         it = it->next;
@@ -99,10 +156,12 @@ int dentry_append(struct dentry** head, const char* name, struct inode* child) {
     }
     new_dentry->inode = child;
 
-    if (prev)
-        prev->next = new_dentry;
-    else
-        *head = new_dentry;
+    // cookies of removed entries aren't reused, so that readers that saved
+    // an offset neither skip nor repeat entries. a cursor at the tail has a
+    // cookie no greater than the new one, so readers that are at the end
+    // see the new entry.
+    new_dentry->cookie = (*next_cookie)++;
+    insert_dentry(head, prev, new_dentry);
 
     ++child->num_links;
 
@@ -110,14 +169,10 @@ int dentry_append(struct dentry** head, const char* name, struct inode* child) {
 }
 
 struct inode* dentry_remove(struct dentry** head, const char* name) {
-    struct dentry* prev = NULL;
     struct dentry* it = *head;
     while (it) {
-        if (!strcmp(it->name, name)) {
-            if (prev)
-                prev->next = it->next;
-            else
-                *head = it->next;
+        if (!is_cursor(it) && !strcmp(it->name, name)) {
+            unlink_dentry(head, it);
             struct inode* inode = it->inode;
             kfree(it->name);
             kfree(it);
@@ -125,7 +180,6 @@ struct inode* dentry_remove(struct dentry** head, const char* name) {
             --inode->num_links;
             return inode;
         }
-        prev = it;
         it = it->next;
     }
     return ERR_PTR(-ENOENT);
@@ -134,6 +188,8 @@ struct inode* dentry_remove(struct dentry** head, const char* name) {
 void dentry_clear(struct dentry* head) {
     for (struct dentry* dentry = head; dentry;) {
         struct dentry* next = dentry->next;
+        // open directories hold a reference, so their cursors are gone
+        ASSERT(!is_cursor(dentry));
         ASSERT(dentry->inode->num_links > 0);
         --dentry->inode->num_links;
         inode_unref(dentry->inode);
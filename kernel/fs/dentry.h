@@ -44,15 +44,31 @@
 struct dentry {
     char* name;
     struct inode* inode;
+    struct dentry* prev;
     struct dentry* next;
+
+    // entries are appended in order of increasing cookies, and a cookie
+    // stays the same while the entry exists and is never given to another
+    // entry of the directory. getdents reports it as the offset of the
+    // directory.
+    off_t cookie;
 };
 
+// getdents keeps a cursor, i.e. a dentry without a name, in the list for
+// each open directory, so that the next call resumes right after the last
+// entry it returned however the list changed in between. the other
+// functions skip cursors.
+
 NODISCARD struct inode* dentry_find(const struct dentry* head,
                                     const char* name);
 NODISCARD int dentry_getdents(struct getdents_ctx* ctx, file_description*,
-                              const struct dentry* head,
+                              struct dentry** head,
                               getdents_callback_fn callback);
-NODISCARD int dentry_append(struct dentry** head, const char* name,
-                            struct inode* child);
+// removes the cursor of the file description, if any. call this from the
+// close op of the directory with the same lock held as for getdents.
+void dentry_close_cursor(file_description*, struct dentry** head);
+// next_cookie is kept by the directory, next to head, and starts at 0
+NODISCARD int dentry_append(struct dentry** head, off_t* next_cookie,
+                            const char* name, struct inode* child);
 NODISCARD struct inode* dentry_remove(struct dentry** head, const char* name);
 void dentry_clear(struct dentry* head);
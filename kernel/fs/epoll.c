@@ -0,0 +1,364 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "fs.h"
+#include <common/extra.h>
+#include <kernel/api/err.h>
+#include <kernel/api/sys/epoll.h>
+#include <kernel/interrupts.h>
+#include <kernel/memory/memory.h>
+#include <kernel/panic.h>
+#include <kernel/scheduler.h>
+#include <kernel/system.h>
+
+// an entry of an interest list. it is linked into three lists: the interest
+// list of its epoll instance, the watcher list of the watched inode and,
+// while it may have events to report, the ready list of the epoll instance.
+// all of the lists are only modified with interrupts disabled.
+struct epoll_watch {
+    struct epoll* epoll;
+    file_description* desc;
+    int fd;
+    uint32_t events;
+    epoll_data_t data;
+    bool queued;
+    struct epoll_watch* next_in_epoll;
+    struct epoll_watch* next_in_inode;
+    struct epoll_watch* next_ready;
+};
+
+struct epoll {
+    struct inode inode;
+    struct epoll_watch* watches;
+    struct epoll_watch* ready_head;
+    struct epoll_watch* ready_tail;
+};
+
+static file_ops fops;
+
+static bool is_epoll(const struct inode* inode) { return inode->fops == &fops; }
+
+static short poll_watch(struct epoll_watch* watch) {
+    return file_description_poll(watch->desc, watch->events & ~EPOLLET);
+}
+
+static void enqueue_ready(struct epoll_watch* watch) {
+    if (watch->queued)
+        return;
+    watch->queued = true;
+    watch->next_ready = NULL;
+    struct epoll* epoll = watch->epoll;
+    if (epoll->ready_tail)
+        epoll->ready_tail->next_ready = watch;
+    else
+        epoll->ready_head = watch;
+    epoll->ready_tail = watch;
+}
+
+static struct epoll_watch* dequeue_ready(struct epoll* epoll) {
+    struct epoll_watch* watch = epoll->ready_head;
+    if (!watch)
+        return NULL;
+    epoll->ready_head = watch->next_ready;
+    if (!epoll->ready_head)
+        epoll->ready_tail = NULL;
+    watch->queued = false;
+    return watch;
+}
+
+static void unlink_watch(struct epoll_watch* watch) {
+    struct epoll* epoll = watch->epoll;
+
+    struct epoll_watch** it = &watch->desc->inode->watchers;
+    while (*it != watch)
+        it = &(*it)->next_in_inode;
+    *it = watch->next_in_inode;
+
+    it = &epoll->watches;
+    while (*it != watch)
+        it = &(*it)->next_in_epoll;
+    *it = watch->next_in_epoll;
+
+    if (!watch->queued)
+        return;
+    struct epoll_watch* prev = NULL;
+    for (struct epoll_watch* w = epoll->ready_head; w != watch;
+         w = w->next_ready)
+        prev = w;
+    if (prev)
+        prev->next_ready = watch->next_ready;
+    else
+        epoll->ready_head = watch->next_ready;
+    if (epoll->ready_tail == watch)
+        epoll->ready_tail = prev;
+    watch->queued = false;
+}
+
+static struct epoll_watch* find_watch(struct epoll* epoll, int fd,
+                                      file_description* desc) {
+    for (struct epoll_watch* it = epoll->watches; it; it = it->next_in_epoll) {
+        if (it->fd == fd && it->desc == desc)
+            return it;
+    }
+    return NULL;
+}
+
+void inode_notify(struct inode* inode) {
+    if (!inode->watchers)
+        return;
+    bool int_flag = push_cli();
+    for (struct epoll_watch* it = inode->watchers; it; it = it->next_in_inode) {
+        if (!it->queued && poll_watch(it))
+            enqueue_ready(it);
+    }
+    pop_cli(int_flag);
+}
+
+void epoll_forget(file_description* desc) {
+    struct inode* inode = desc->inode;
+    if (!inode->watchers)
+        return;
+
+    struct epoll_watch* forgotten = NULL;
+    bool int_flag = push_cli();
+    struct epoll_watch* it = inode->watchers;
+    while (it) {
+        struct epoll_watch* next = it->next_in_inode;
+        if (it->desc == desc) {
+            unlink_watch(it);
+            it->next_in_inode = forgotten;
+            forgotten = it;
+        }
+        it = next;
+    }
+    pop_cli(int_flag);
+
+    while (forgotten) {
+        struct epoll_watch* next = forgotten->next_in_inode;
+        kfree(forgotten);
+        forgotten = next;
+    }
+}
+
+static void epoll_destroy_inode(struct inode* inode) {
+    struct epoll* epoll = (struct epoll*)inode;
+
+    struct epoll_watch* watches = NULL;
+    bool int_flag = push_cli();
+    while (epoll->watches) {
+        struct epoll_watch* watch = epoll->watches;
+        unlink_watch(watch);
+        watch->next_in_epoll = watches;
+        watches = watch;
+    }
+    pop_cli(int_flag);
+
+    while (watches) {
+        struct epoll_watch* next = watches->next_in_epoll;
+        kfree(watches);
+        watches = next;
+    }
+    kfree(epoll);
+}
+
+static short epoll_poll(file_description* desc, short events) {
+    const struct epoll* epoll = (const struct epoll*)desc->inode;
+    return (events & POLLIN) && epoll->ready_head ? POLLIN : 0;
+}
+
+static file_ops fops = {.destroy_inode = epoll_destroy_inode,
+                        .poll = epoll_poll};
+
+struct inode* epoll_create(void) {
+    struct epoll* epoll = kmalloc(sizeof(struct epoll));
+    if (!epoll)
+        return ERR_PTR(-ENOMEM);
+    *epoll = (struct epoll){0};
+
+    struct inode* inode = &epoll->inode;
+    inode->fops = &fops;
+    inode->ref_count = 1;
+    return inode;
+}
+
+static int add_watch(struct epoll* epoll, int fd, file_description* target,
+                     const struct epoll_event* event) {
+    struct epoll_watch* watch = kmalloc(sizeof(struct epoll_watch));
+    if (!watch)
+        return -ENOMEM;
+    *watch = (struct epoll_watch){.epoll = epoll,
+                                  .desc = target,
+                                  .fd = fd,
+                                  .events = event->events,
+                                  .data = event->data};
+
+    bool int_flag = push_cli();
+    if (find_watch(epoll, fd, target)) {
+        pop_cli(int_flag);
+        kfree(watch);
+        return -EEXIST;
+    }
+    watch->next_in_epoll = epoll->watches;
+    epoll->watches = watch;
+    watch->next_in_inode = target->inode->watchers;
+    target->inode->watchers = watch;
+    if (poll_watch(watch))
+        enqueue_ready(watch);
+    pop_cli(int_flag);
+    return 0;
+}
+
+static int modify_watch(struct epoll* epoll, int fd, file_description* target,
+                        const struct epoll_event* event) {
+    bool int_flag = push_cli();
+    struct epoll_watch* watch = find_watch(epoll, fd, target);
+    if (!watch) {
+        pop_cli(int_flag);
+        return -ENOENT;
+    }
+    watch->events = event->events;
+    watch->data = event->data;
+    if (poll_watch(watch))
+        enqueue_ready(watch);
+    pop_cli(int_flag);
+    return 0;
+}
+
+static int delete_watch(struct epoll* epoll, int fd,
+                        file_description* target) {
+    bool int_flag = push_cli();
+    struct epoll_watch* watch = find_watch(epoll, fd, target);
+    if (watch)
+        unlink_watch(watch);
+    pop_cli(int_flag);
+    if (!watch)
+        return -ENOENT;
+    kfree(watch);
+    return 0;
+}
+
+int epoll_ctl(file_description* desc, int op, int fd,
+              file_description* target, const struct epoll_event* event) {
+    if (!is_epoll(desc->inode) || is_epoll(target->inode))
+        return -EINVAL;
+    if (!target->inode->fops->poll)
+        return -EPERM;
+    struct epoll* epoll = (struct epoll*)desc->inode;
+
+    switch (op) {
+    case EPOLL_CTL_ADD:
+        if (!event)
+            return -EFAULT;
+        return add_watch(epoll, fd, target, event);
+    case EPOLL_CTL_MOD:
+        if (!event)
+            return -EFAULT;
+        return modify_watch(epoll, fd, target, event);
+    case EPOLL_CTL_DEL:
+        return delete_watch(epoll, fd, target);
+    }
+    return -EINVAL;
+}
+
+struct epoll_blocker {
+    struct epoll* epoll;
+    bool has_deadline;
+    uint32_t deadline;
+};
+
+static bool epoll_should_unblock(struct epoll_blocker* blocker) {
+    return blocker->epoll->ready_head ||
+           (blocker->has_deadline && uptime >= blocker->deadline);
+}
+
+// only the ready list is visited, so the cost of a wait is proportional to
+// the number of ready descriptors rather than the number of registered ones.
+static int harvest(struct epoll* epoll, struct epoll_event* events,
+                   int maxevents) {
+    int num_events = 0;
+    bool int_flag = push_cli();
+
+    // level-triggered watches are requeued after being reported, so stop at
+    // the last watch that was queued when we started
+    struct epoll_watch* last = epoll->ready_tail;
+    while (num_events < maxevents) {
+        struct epoll_watch* watch = dequeue_ready(epoll);
+        if (!watch)
+            break;
+        short revents = poll_watch(watch);
+        if (revents) {
+            events[num_events++] = (struct epoll_event){
+                .events = (uint16_t)revents, .data = watch->data};
+            if (!(watch->events & EPOLLET))
+                enqueue_ready(watch);
+        }
+        if (watch == last)
+            break;
+    }
+
+    pop_cli(int_flag);
+    return num_events;
+}
+
+int epoll_wait(file_description* desc, struct epoll_event* events,
+               int maxevents, int timeout) {
+    if (!is_epoll(desc->inode) || maxevents <= 0)
+        return -EINVAL;
+    struct epoll* epoll = (struct epoll*)desc->inode;
+
+    struct epoll_blocker blocker = {.epoll = epoll};
+    if (timeout >= 0) {
+        blocker.has_deadline = true;
+        blocker.deadline = uptime + div_ceil(timeout, 1000 / CLK_TCK);
+    }
+
+    for (;;) {
+        if (timeout != 0) {
+            int rc = scheduler_block((should_unblock_fn)epoll_should_unblock,
+                                     &blocker);
+            if (IS_ERR(rc))
+                return rc;
+        }
+        int num_events = harvest(epoll, events, maxevents);
+        if (num_events > 0 || timeout == 0)
+            return num_events;
+        if (blocker.has_deadline && uptime >= blocker.deadline)
+            return 0;
+    }
+}
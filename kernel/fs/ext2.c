@@ -0,0 +1,2033 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+#include "fs.h"
+#include <common/string.h>
+#include <kernel/api/dirent.h>
+#include <kernel/api/err.h>
+#include <kernel/api/sys/sysmacros.h>
+#include <kernel/api/time.h>
+#include <kernel/block/buffer_cache.h>
+#include <kernel/boot_defs.h>
+#include <kernel/kprintf.h>
+#include <kernel/memory/memory.h>
+#include <kernel/panic.h>
+#include <kernel/scheduler.h>
+#include <kernel/system.h>
+
+// the second extended file system, read and written through the buffer cache.
+// revision 0 and 1 file systems with block sizes of up to a page are
+// supported, as long as they don't use features that change how the data is
+// laid out on the disk (extents, 64-bit block numbers, checksums, ...).
+
+#define EXT2_SUPER_MAGIC 0xef53
+#define EXT2_SUPERBLOCK_OFFSET 1024
+#define EXT2_ROOT_INO 2
+#define EXT2_GOOD_OLD_FIRST_INO 11
+#define EXT2_GOOD_OLD_INODE_SIZE 128
+#define EXT2_NAME_LEN 255
+
+#define EXT2_NDIR_BLOCKS 12
+#define EXT2_IND_BLOCK 12
+#define EXT2_DIND_BLOCK 13
+#define EXT2_TIND_BLOCK 14
+#define EXT2_N_BLOCKS 15
+
+#define EXT2_FEATURE_COMPAT_DIR_INDEX 0x20
+#define EXT2_FEATURE_INCOMPAT_FILETYPE 0x2
+#define EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER 0x1
+#define EXT2_FEATURE_RO_COMPAT_LARGE_FILE 0x2
+
+#define EXT2_SUPPORTED_INCOMPAT EXT2_FEATURE_INCOMPAT_FILETYPE
+#define EXT2_SUPPORTED_RO_COMPAT                                               \
+    (EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER | EXT2_FEATURE_RO_COMPAT_LARGE_FILE)
+
+#define EXT2_FLAGS_UNSIGNED_HASH 0x2
+
+#define EXT2_INDEX_FL 0x1000
+
+#define EXT2_FT_UNKNOWN 0
+#define EXT2_FT_REG_FILE 1
+#define EXT2_FT_DIR 2
+#define EXT2_FT_CHRDEV 3
+#define EXT2_FT_BLKDEV 4
+#define EXT2_FT_FIFO 5
+#define EXT2_FT_SOCK 6
+#define EXT2_FT_SYMLINK 7
+
+struct ext2_superblock {
+    uint32_t s_inodes_count;
+    uint32_t s_blocks_count;
+    uint32_t s_r_blocks_count;
+    uint32_t s_free_blocks_count;
+    uint32_t s_free_inodes_count;
+    uint32_t s_first_data_block;
+    uint32_t s_log_block_size;
+    uint32_t s_log_frag_size;
+    uint32_t s_blocks_per_group;
+    uint32_t s_frags_per_group;
+    uint32_t s_inodes_per_group;
+    uint32_t s_mtime;
+    uint32_t s_wtime;
+    uint16_t s_mnt_count;
+    uint16_t s_max_mnt_count;
+    uint16_t s_magic;
+    uint16_t s_state;
+    uint16_t s_errors;
+    uint16_t s_minor_rev_level;
+    uint32_t s_lastcheck;
+    uint32_t s_checkinterval;
+    uint32_t s_creator_os;
+    uint32_t s_rev_level;
+    uint16_t s_def_resuid;
+    uint16_t s_def_resgid;
+
+    // revision 1
+    uint32_t s_first_ino;
+    uint16_t s_inode_size;
+    uint16_t s_block_group_nr;
+    uint32_t s_feature_compat;
+    uint32_t s_feature_incompat;
+    uint32_t s_feature_ro_compat;
+    uint8_t s_uuid[16];
+    char s_volume_name[16];
+    char s_last_mounted[64];
+    uint32_t s_algorithm_usage_bitmap;
+    uint8_t s_prealloc_blocks;
+    uint8_t s_prealloc_dir_blocks;
+    uint16_t s_reserved_gdt_blocks;
+    uint8_t s_journal_uuid[16];
+    uint32_t s_journal_inum;
+    uint32_t s_journal_dev;
+    uint32_t s_last_orphan;
+    uint32_t s_hash_seed[4];
+    uint8_t s_def_hash_version;
+    uint8_t s_jnl_backup_type;
+    uint16_t s_desc_size;
+    uint32_t s_default_mount_opts;
+    uint32_t s_first_meta_bg;
+    uint8_t s_unused[88];
+    uint32_t s_flags;
+    uint8_t s_reserved[668];
+} __attribute__((packed));
+
+_Static_assert(sizeof(struct ext2_superblock) == 1024,
+               "ext2 superblock must be 1024 bytes");
+
+struct ext2_group_desc {
+    uint32_t bg_block_bitmap;
+    uint32_t bg_inode_bitmap;
+    uint32_t bg_inode_table;
+    uint16_t bg_free_blocks_count;
+    uint16_t bg_free_inodes_count;
+    uint16_t bg_used_dirs_count;
+    uint16_t bg_pad;
+    uint32_t bg_reserved[3];
+} __attribute__((packed));
+
+// the part of an inode that is common to all inode sizes
+struct ext2_disk_inode {
+    uint16_t i_mode;
+    uint16_t i_uid;
+    uint32_t i_size;
+    uint32_t i_atime;
+    uint32_t i_ctime;
+    uint32_t i_mtime;
+    uint32_t i_dtime;
+    uint16_t i_gid;
+    uint16_t i_links_count;
+    uint32_t i_blocks; // in units of 512 bytes
+    uint32_t i_flags;
+    uint32_t i_osd1;
+    uint32_t i_block[EXT2_N_BLOCKS];
+    uint32_t i_generation;
+    uint32_t i_file_acl;
+    uint32_t i_size_high;
+    uint32_t i_faddr;
+    uint8_t i_osd2[12];
+} __attribute__((packed));
+
+_Static_assert(sizeof(struct ext2_disk_inode) == EXT2_GOOD_OLD_INODE_SIZE,
+               "ext2 inode must be 128 bytes");
+
+struct ext2_dir_entry {
+    uint32_t inode;
+    uint16_t rec_len;
+    uint8_t name_len;
+    uint8_t file_type;
+    char name[];
+} __attribute__((packed));
+
+#define DIR_ENTRY_HEADER_SIZE 8
+#define DIR_ENTRY_SIZE(name_len) round_up(DIR_ENTRY_HEADER_SIZE + (name_len), 4)
+
+// hashed directory index. the first block of an indexed directory starts with
+// "." and "..", whose entries hide the root of the index from code that reads
+// the directory linearly. the rest of the index lives in blocks that look
+// like a single unused entry.
+struct dx_root_info {
+    uint32_t reserved_zero;
+    uint8_t hash_version;
+    uint8_t info_length;
+    uint8_t indirect_levels;
+    uint8_t unused_flags;
+} __attribute__((packed));
+
+// entry 0 has no hash, and its place is taken by the limit and the count of
+// the entries
+struct dx_entry {
+    uint32_t hash;
+    uint32_t block;
+} __attribute__((packed));
+
+#define DX_ROOT_INFO_OFFSET 24 // after the entries for "." and ".."
+#define DX_NODE_ENTRIES_OFFSET DIR_ENTRY_HEADER_SIZE
+#define DX_MAX_LEVELS 3
+
+#define DX_HASH_LEGACY 0
+#define DX_HASH_HALF_MD4 1
+#define DX_HASH_TEA 2
+#define DX_HASH_LEGACY_UNSIGNED 3
+#define DX_HASH_HALF_MD4_UNSIGNED 4
+#define DX_HASH_TEA_UNSIGNED 5
+
+#define NUM_INODE_BUCKETS 256
+
+typedef struct ext2_inode ext2_inode;
+
+typedef struct ext2_fs {
+    struct block_device* dev;
+    size_t block_size;
+    size_t blocks_per_buffer;
+    size_t inode_size;
+    uint32_t num_groups;
+    uint32_t first_ino;
+    uint32_t gdt_block; // first block of the group descriptor table
+    bool has_filetype;
+    bool has_dir_index;
+    bool unsigned_hash;
+    struct inode* root;
+
+    // protects the superblock, the group descriptors, the bitmaps and the
+    // inode table. taken after the lock of an inode.
+    mutex lock;
+    struct ext2_superblock sb;
+    struct ext2_group_desc* groups;
+    ext2_inode* inodes[NUM_INODE_BUCKETS];
+} ext2_fs;
+
+struct ext2_inode {
+    struct inode inode;
+    ext2_fs* fs;
+    uint32_t ino;
+    ext2_inode* hash_next;
+
+    // protects everything below and the contents of the file
+    mutex lock;
+    struct ext2_disk_inode raw;
+    uint32_t alloc_goal; // where the next block of the file is allocated
+};
+
+static uint32_t now(void) {
+    struct timespec ts;
+    time_now(&ts);
+    return ts.tv_sec;
+}
+
+// the block of the file system, which lies in a buffer of the buffer cache
+static unsigned char* get_block(ext2_fs* fs, uint32_t block,
+                                struct buffer** out_buf) {
+    if (block == 0 || block >= fs->sb.s_blocks_count)
+        return ERR_PTR(-EIO);
+    struct buffer* buf = buffer_get(fs->dev, block / fs->blocks_per_buffer);
+    if (IS_ERR(buf))
+        return ERR_CAST(buf);
+    *out_buf = buf;
+    return buf->data + (block % fs->blocks_per_buffer) * fs->block_size;
+}
+
+// like get_block, but the block is zero-filled instead of being read if it
+// is the only block of the buffer
+static unsigned char* get_zeroed_block(ext2_fs* fs, uint32_t block,
+                                       struct buffer** out_buf) {
+    if (block == 0 || block >= fs->sb.s_blocks_count)
+        return ERR_PTR(-EIO);
+    struct buffer* buf =
+        fs->blocks_per_buffer == 1
+            ? buffer_get_new(fs->dev, block)
+            : buffer_get(fs->dev, block / fs->blocks_per_buffer);
+    if (IS_ERR(buf))
+        return ERR_CAST(buf);
+    *out_buf = buf;
+    unsigned char* data =
+        buf->data + (block % fs->blocks_per_buffer) * fs->block_size;
+    memset(data, 0, fs->block_size);
+    buffer_mark_dirty(buf);
+    return data;
+}
+
+static void write_super(ext2_fs* fs) {
+    struct buffer* buf = buffer_get(fs->dev, 0);
+    if (IS_ERR(buf)) {
+        kprintf("ext2: failed to write the superblock\n");
+        return;
+    }
+    fs->sb.s_wtime = now();
+    memcpy(buf->data + EXT2_SUPERBLOCK_OFFSET, &fs->sb,
+           sizeof(struct ext2_superblock));
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+}
+
+static void write_group_desc(ext2_fs* fs, uint32_t group) {
+    size_t offset = group * sizeof(struct ext2_group_desc);
+    struct buffer* buf;
+    unsigned char* data =
+        get_block(fs, fs->gdt_block + offset / fs->block_size, &buf);
+    if (IS_ERR(data)) {
+        kprintf("ext2: failed to write group descriptor %u\n", group);
+        return;
+    }
+    memcpy(data + offset % fs->block_size, fs->groups + group,
+           sizeof(struct ext2_group_desc));
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+}
+
+static uint32_t blocks_in_group(const ext2_fs* fs, uint32_t group) {
+    uint32_t first = fs->sb.s_first_data_block + group * fs->sb.s_blocks_per_group;
+    return MIN(fs->sb.s_blocks_per_group, fs->sb.s_blocks_count - first);
+}
+
+// returns the first clear bit in [start, end), or -1 if there is none
+static ssize_t find_zero_bit(const unsigned char* bitmap, size_t start,
+                             size_t end) {
+    for (size_t i = start; i < end;) {
+        if (i % 8 == 0 && i + 8 <= end && bitmap[i / 8] == 0xff) {
+            i += 8;
+            continue;
+        }
+        if (!(bitmap[i / 8] & (1 << (i % 8))))
+            return i;
+        ++i;
+    }
+    return -1;
+}
+
+// allocates a block of the group at or after start
+static uint32_t alloc_block_in_group(ext2_fs* fs, uint32_t group,
+                                     uint32_t start) {
+    struct ext2_group_desc* desc = fs->groups + group;
+    if (desc->bg_free_blocks_count == 0)
+        return 0;
+
+    struct buffer* buf;
+    unsigned char* bitmap = get_block(fs, desc->bg_block_bitmap, &buf);
+    if (IS_ERR(bitmap))
+        return 0;
+    // when the goal is taken, a run of free blocks is preferred to the
+    // holes that are left between the blocks of other files
+    size_t end = blocks_in_group(fs, group);
+    ssize_t bit = -1;
+    if (start < end && !(bitmap[start / 8] & (1 << (start % 8))))
+        bit = start;
+    for (size_t i = div_ceil(start, 8); bit < 0 && i < end / 8; ++i) {
+        if (bitmap[i] == 0)
+            bit = i * 8;
+    }
+    if (bit < 0)
+        bit = find_zero_bit(bitmap, start, end);
+    if (bit < 0) {
+        buffer_put(buf);
+        return 0;
+    }
+    bitmap[bit / 8] |= 1 << (bit % 8);
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+
+    --desc->bg_free_blocks_count;
+    --fs->sb.s_free_blocks_count;
+    write_group_desc(fs, group);
+    write_super(fs);
+    return fs->sb.s_first_data_block + group * fs->sb.s_blocks_per_group + bit;
+}
+
+// allocates the first free block at or after goal. the search stays in the
+// group of goal as long as it can, so that the blocks of a file that are
+// allocated one after another end up next to each other.
+static NODISCARD int alloc_block(ext2_fs* fs, uint32_t goal,
+                                 uint32_t* out_block) {
+    mutex_lock(&fs->lock);
+    if (fs->sb.s_free_blocks_count == 0) {
+        mutex_unlock(&fs->lock);
+        return -ENOSPC;
+    }
+
+    if (goal < fs->sb.s_first_data_block || goal >= fs->sb.s_blocks_count)
+        goal = fs->sb.s_first_data_block;
+    uint32_t goal_group =
+        (goal - fs->sb.s_first_data_block) / fs->sb.s_blocks_per_group;
+    uint32_t block = alloc_block_in_group(
+        fs, goal_group,
+        (goal - fs->sb.s_first_data_block) % fs->sb.s_blocks_per_group);
+    for (uint32_t i = 1; !block && i <= fs->num_groups; ++i)
+        block = alloc_block_in_group(fs, (goal_group + i) % fs->num_groups, 0);
+
+    mutex_unlock(&fs->lock);
+    if (!block)
+        return -ENOSPC;
+    *out_block = block;
+    return 0;
+}
+
+static void free_block(ext2_fs* fs, uint32_t block) {
+    if (block < fs->sb.s_first_data_block || block >= fs->sb.s_blocks_count) {
+        kprintf("ext2: freeing invalid block %u\n", block);
+        return;
+    }
+    uint32_t index = block - fs->sb.s_first_data_block;
+    uint32_t group = index / fs->sb.s_blocks_per_group;
+    uint32_t bit = index % fs->sb.s_blocks_per_group;
+
+    mutex_lock(&fs->lock);
+    struct ext2_group_desc* desc = fs->groups + group;
+    struct buffer* buf;
+    unsigned char* bitmap = get_block(fs, desc->bg_block_bitmap, &buf);
+    if (IS_ERR(bitmap)) {
+        mutex_unlock(&fs->lock);
+        return;
+    }
+    if (!(bitmap[bit / 8] & (1 << (bit % 8)))) {
+        kprintf("ext2: freeing free block %u\n", block);
+        buffer_put(buf);
+        mutex_unlock(&fs->lock);
+        return;
+    }
+    bitmap[bit / 8] &= ~(1 << (bit % 8));
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+
+    ++desc->bg_free_blocks_count;
+    ++fs->sb.s_free_blocks_count;
+    write_group_desc(fs, group);
+    write_super(fs);
+    mutex_unlock(&fs->lock);
+}
+
+// directories are spread over the groups that have more free inodes than
+// average, and the other inodes are put in the group of their parent
+static uint32_t pick_inode_group(ext2_fs* fs, uint32_t parent_ino,
+                                 bool is_dir) {
+    uint32_t parent_group = (parent_ino - 1) / fs->sb.s_inodes_per_group;
+    if (!is_dir)
+        return parent_group;
+
+    uint32_t avg_free_inodes = fs->sb.s_free_inodes_count / fs->num_groups;
+    uint32_t best = parent_group;
+    uint32_t best_free_blocks = 0;
+    for (uint32_t i = 0; i < fs->num_groups; ++i) {
+        uint32_t group = (parent_group + i) % fs->num_groups;
+        const struct ext2_group_desc* desc = fs->groups + group;
+        if (desc->bg_free_inodes_count == 0 ||
+            desc->bg_free_inodes_count < avg_free_inodes)
+            continue;
+        if (desc->bg_free_blocks_count > best_free_blocks) {
+            best = group;
+            best_free_blocks = desc->bg_free_blocks_count;
+        }
+    }
+    return best;
+}
+
+static NODISCARD int alloc_inode(ext2_fs* fs, uint32_t parent_ino,
+                                 bool is_dir, uint32_t* out_ino) {
+    mutex_lock(&fs->lock);
+    if (fs->sb.s_free_inodes_count == 0) {
+        mutex_unlock(&fs->lock);
+        return -ENOSPC;
+    }
+
+    uint32_t start_group = pick_inode_group(fs, parent_ino, is_dir);
+    for (uint32_t i = 0; i < fs->num_groups; ++i) {
+        uint32_t group = (start_group + i) % fs->num_groups;
+        struct ext2_group_desc* desc = fs->groups + group;
+        if (desc->bg_free_inodes_count == 0)
+            continue;
+
+        struct buffer* buf;
+        unsigned char* bitmap = get_block(fs, desc->bg_inode_bitmap, &buf);
+        if (IS_ERR(bitmap))
+            continue;
+        size_t first_bit = group == 0 ? fs->first_ino - 1 : 0;
+        ssize_t bit =
+            find_zero_bit(bitmap, first_bit, fs->sb.s_inodes_per_group);
+        if (bit < 0) {
+            buffer_put(buf);
+            continue;
+        }
+        bitmap[bit / 8] |= 1 << (bit % 8);
+        buffer_mark_dirty(buf);
+        buffer_put(buf);
+
+        --desc->bg_free_inodes_count;
+        if (is_dir)
+            ++desc->bg_used_dirs_count;
+        --fs->sb.s_free_inodes_count;
+        write_group_desc(fs, group);
+        write_super(fs);
+        mutex_unlock(&fs->lock);
+
+        *out_ino = group * fs->sb.s_inodes_per_group + bit + 1;
+        return 0;
+    }
+
+    mutex_unlock(&fs->lock);
+    return -ENOSPC;
+}
+
+static void free_inode(ext2_fs* fs, uint32_t ino, bool is_dir) {
+    uint32_t group = (ino - 1) / fs->sb.s_inodes_per_group;
+    uint32_t bit = (ino - 1) % fs->sb.s_inodes_per_group;
+
+    mutex_lock(&fs->lock);
+    struct ext2_group_desc* desc = fs->groups + group;
+    struct buffer* buf;
+    unsigned char* bitmap = get_block(fs, desc->bg_inode_bitmap, &buf);
+    if (IS_ERR(bitmap)) {
+        mutex_unlock(&fs->lock);
+        return;
+    }
+    bitmap[bit / 8] &= ~(1 << (bit % 8));
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+
+    ++desc->bg_free_inodes_count;
+    if (is_dir && desc->bg_used_dirs_count > 0)
+        --desc->bg_used_dirs_count;
+    ++fs->sb.s_free_inodes_count;
+    write_group_desc(fs, group);
+    write_super(fs);
+    mutex_unlock(&fs->lock);
+}
+
+// the block of the inode table and the offset in it where the inode is
+static unsigned char* get_inode_slot(ext2_fs* fs, uint32_t ino,
+                                     struct buffer** out_buf) {
+    uint32_t group = (ino - 1) / fs->sb.s_inodes_per_group;
+    size_t offset =
+        (size_t)((ino - 1) % fs->sb.s_inodes_per_group) * fs->inode_size;
+    unsigned char* data = get_block(
+        fs, fs->groups[group].bg_inode_table + offset / fs->block_size,
+        out_buf);
+    if (IS_ERR(data))
+        return data;
+    return data + offset % fs->block_size;
+}
+
+static void write_inode(ext2_inode* node) {
+    struct buffer* buf;
+    unsigned char* slot = get_inode_slot(node->fs, node->ino, &buf);
+    if (IS_ERR(slot)) {
+        kprintf("ext2: failed to write inode %u\n", node->ino);
+        return;
+    }
+    memcpy(slot, &node->raw, sizeof(struct ext2_disk_inode));
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+}
+
+static dev_t decode_device(const struct ext2_disk_inode* raw) {
+    if (raw->i_block[0])
+        return makedev((raw->i_block[0] >> 8) & 0xff, raw->i_block[0] & 0xff);
+    return raw->i_block[1];
+}
+
+// the old 16-bit encoding is used when it is enough, like Linux does
+static void encode_device(struct ext2_disk_inode* raw, dev_t dev) {
+    if (major(dev) < 256 && minor(dev) < 256) {
+        raw->i_block[0] = (major(dev) << 8) | minor(dev);
+        raw->i_block[1] = 0;
+    } else {
+        raw->i_block[0] = 0;
+        raw->i_block[1] = dev;
+    }
+}
+
+static uint8_t mode_to_file_type(mode_t mode) {
+    switch (mode & S_IFMT) {
+    case S_IFREG:
+        return EXT2_FT_REG_FILE;
+    case S_IFDIR:
+        return EXT2_FT_DIR;
+    case S_IFCHR:
+        return EXT2_FT_CHRDEV;
+    case S_IFBLK:
+        return EXT2_FT_BLKDEV;
+    case S_IFIFO:
+        return EXT2_FT_FIFO;
+    case S_IFSOCK:
+        return EXT2_FT_SOCK;
+    case S_IFLNK:
+        return EXT2_FT_SYMLINK;
+    }
+    return EXT2_FT_UNKNOWN;
+}
+
+static uint8_t file_type_to_dirent_type(uint8_t file_type) {
+    switch (file_type) {
+    case EXT2_FT_REG_FILE:
+        return DT_REG;
+    case EXT2_FT_DIR:
+        return DT_DIR;
+    case EXT2_FT_CHRDEV:
+        return DT_CHR;
+    case EXT2_FT_BLKDEV:
+        return DT_BLK;
+    case EXT2_FT_FIFO:
+        return DT_FIFO;
+    case EXT2_FT_SOCK:
+        return DT_SOCK;
+    case EXT2_FT_SYMLINK:
+        return DT_LNK;
+    }
+    return DT_UNKNOWN;
+}
+
+static file_ops dir_fops;
+static file_ops file_fops;
+
+static ext2_inode** inode_bucket(ext2_fs* fs, uint32_t ino) {
+    return fs->inodes + ino % NUM_INODE_BUCKETS;
+}
+
+// sets up the in-memory inode for ino and adds it to the inode table.
+// called with fs->lock held.
+static ext2_inode* install_inode(ext2_fs* fs, uint32_t ino,
+                                 const struct ext2_disk_inode* raw) {
+    ext2_inode* node = kmalloc(sizeof(ext2_inode));
+    if (!node)
+        return ERR_PTR(-ENOMEM);
+    *node = (ext2_inode){0};
+    node->fs = fs;
+    node->ino = ino;
+    node->raw = *raw;
+
+    struct inode* inode = &node->inode;
+    if (ino == EXT2_ROOT_INO) {
+        inode->fs_root_inode = inode;
+    } else {
+        // keeps the file system alive, see unmount()
+        inode->fs_root_inode = fs->root;
+        inode_ref(fs->root);
+    }
+    inode->fops = S_ISDIR(raw->i_mode) ? &dir_fops : &file_fops;
+    inode->mode = raw->i_mode;
+    if (S_ISCHR(raw->i_mode) || S_ISBLK(raw->i_mode))
+        inode->device_id = decode_device(raw);
+    // the links are counted on the disk, so the in-memory inode goes away
+    // once the last reference is dropped
+    inode->ref_count = 1;
+
+    ext2_inode** bucket = inode_bucket(fs, ino);
+    node->hash_next = *bucket;
+    *bucket = node;
+    return node;
+}
+
+static struct inode* iget(ext2_fs* fs, uint32_t ino) {
+    if (ino == 0 || ino > fs->sb.s_inodes_count)
+        return ERR_PTR(-EIO);
+
+    for (;;) {
+        mutex_lock(&fs->lock);
+        ext2_inode* it = *inode_bucket(fs, ino);
+        while (it && it->ino != ino)
+            it = it->hash_next;
+        if (!it)
+            break;
+
+        size_t ref_count = it->inode.ref_count;
+        while (ref_count > 0 &&
+               !atomic_compare_exchange_weak(&it->inode.ref_count,
+                                             &ref_count, ref_count + 1))
+            ;
+        mutex_unlock(&fs->lock);
+        if (ref_count > 0)
+            return &it->inode;
+
+        // the last reference was just dropped. wait for the inode to be
+        // destroyed before reading it again.
+        scheduler_yield(true);
+    }
+
+    struct ext2_disk_inode raw;
+    struct buffer* buf;
+    unsigned char* slot = get_inode_slot(fs, ino, &buf);
+    if (IS_ERR(slot)) {
+        mutex_unlock(&fs->lock);
+        return ERR_CAST(slot);
+    }
+    memcpy(&raw, slot, sizeof(struct ext2_disk_inode));
+    buffer_put(buf);
+
+    if (raw.i_links_count == 0 || !(raw.i_mode & S_IFMT)) {
+        mutex_unlock(&fs->lock);
+        kprintf("ext2: entry refers to unused inode %u\n", ino);
+        return ERR_PTR(-EIO);
+    }
+
+    ext2_inode* node = install_inode(fs, ino, &raw);
+    mutex_unlock(&fs->lock);
+    if (IS_ERR(node))
+        return ERR_CAST(node);
+    return &node->inode;
+}
+
+// maps the index-th block of the file to a block of the file system, or to 0
+// if it is a hole. with create set, a hole gets a newly allocated block, and
+// *out_is_new tells the caller that the contents of the block are garbage.
+static NODISCARD int bmap(ext2_inode* node, uint32_t index, bool create,
+                          uint32_t* out_block, bool* out_is_new) {
+    ext2_fs* fs = node->fs;
+    uint32_t per_block = fs->block_size / sizeof(uint32_t);
+
+    unsigned depth;
+    uint32_t offsets[4];
+    if (index < EXT2_NDIR_BLOCKS) {
+        depth = 0;
+        offsets[0] = index;
+    } else if ((index -= EXT2_NDIR_BLOCKS) < per_block) {
+        depth = 1;
+        offsets[0] = EXT2_IND_BLOCK;
+        offsets[1] = index;
+    } else if ((index -= per_block) < per_block * per_block) {
+        depth = 2;
+        offsets[0] = EXT2_DIND_BLOCK;
+        offsets[1] = index / per_block;
+        offsets[2] = index % per_block;
+    } else if ((index -= per_block * per_block) / per_block / per_block <
+               per_block) {
+        depth = 3;
+        offsets[0] = EXT2_TIND_BLOCK;
+        offsets[1] = index / per_block / per_block;
+        offsets[2] = index / per_block % per_block;
+        offsets[3] = index % per_block;
+    } else {
+        return -EFBIG;
+    }
+
+    uint32_t* ptr = node->raw.i_block + offsets[0];
+    struct buffer* buf = NULL; // holds ptr unless ptr is in the inode
+    for (unsigned level = 0;; ++level) {
+        uint32_t block = *ptr;
+        bool is_new = false;
+        if (!block) {
+            if (!create) {
+                if (buf)
+                    buffer_put(buf);
+                *out_block = 0;
+                return 0;
+            }
+            uint32_t goal = node->alloc_goal;
+            if (!goal)
+                goal = fs->sb.s_first_data_block +
+                       (node->ino - 1) / fs->sb.s_inodes_per_group *
+                           fs->sb.s_blocks_per_group;
+            int rc = alloc_block(fs, goal, &block);
+            if (IS_ERR(rc)) {
+                if (buf)
+                    buffer_put(buf);
+                return rc;
+            }
+            node->alloc_goal = block + 1;
+            node->raw.i_blocks += fs->block_size / 512;
+            *ptr = block;
+            if (buf)
+                buffer_mark_dirty(buf);
+            is_new = true;
+        }
+        if (buf)
+            buffer_put(buf);
+
+        if (level == depth) {
+            *out_block = block;
+            if (out_is_new)
+                *out_is_new = is_new;
+            return 0;
+        }
+
+        // a new indirect block must not point at garbage
+        unsigned char* data = is_new ? get_zeroed_block(fs, block, &buf)
+                                     : get_block(fs, block, &buf);
+        if (IS_ERR(data))
+            return PTR_ERR(data);
+        ptr = (uint32_t*)data + offsets[level + 1];
+    }
+}
+
+// frees the blocks under *ptr that hold file blocks at or after first, and
+// *ptr itself if nothing under it is left. the blocks under *ptr start at
+// file block base, and depth is the number of levels of indirection below it.
+static void free_branch(ext2_inode* node, uint32_t* ptr, unsigned depth,
+                        size_t base, size_t first) {
+    ext2_fs* fs = node->fs;
+    if (!*ptr)
+        return;
+
+    if (depth > 0) {
+        size_t per_block = fs->block_size / sizeof(uint32_t);
+        size_t span = 1;
+        for (unsigned i = 1; i < depth; ++i)
+            span *= per_block;
+
+        struct buffer* buf;
+        unsigned char* data = get_block(fs, *ptr, &buf);
+        if (IS_ERR(data))
+            return;
+        uint32_t* entries = (uint32_t*)data;
+        for (size_t i = 0; i < per_block; ++i) {
+            size_t child_base = base + i * span;
+            if (child_base + span <= first || !entries[i])
+                continue;
+            free_branch(node, entries + i, depth - 1, child_base, first);
+            buffer_mark_dirty(buf);
+        }
+        buffer_put(buf);
+    }
+
+    if (base >= first) {
+        free_block(fs, *ptr);
+        node->raw.i_blocks -= MIN(node->raw.i_blocks, fs->block_size / 512);
+        *ptr = 0;
+    }
+}
+
+// frees the blocks of the file from the first-th one on
+static void free_blocks_from(ext2_inode* node, size_t first) {
+    size_t per_block = node->fs->block_size / sizeof(uint32_t);
+    for (size_t i = 0; i < EXT2_NDIR_BLOCKS; ++i)
+        free_branch(node, node->raw.i_block + i, 0, i, first);
+    size_t base = EXT2_NDIR_BLOCKS;
+    free_branch(node, node->raw.i_block + EXT2_IND_BLOCK, 1, base, first);
+    base += per_block;
+    free_branch(node, node->raw.i_block + EXT2_DIND_BLOCK, 2, base, first);
+    base += per_block * per_block;
+    free_branch(node, node->raw.i_block + EXT2_TIND_BLOCK, 3, base, first);
+    node->alloc_goal = 0;
+}
+
+// fast symlinks and device files keep other things than block numbers in
+// i_block
+static bool has_data_blocks(const ext2_inode* node) {
+    mode_t mode = node->raw.i_mode;
+    if (S_ISCHR(mode) || S_ISBLK(mode) || S_ISFIFO(mode) || S_ISSOCK(mode))
+        return false;
+    if (S_ISLNK(mode))
+        return node->raw.i_blocks > 0;
+    return true;
+}
+
+// the root is referenced by every other in-memory inode, so it goes away
+// last, once the file system is no longer mounted and nothing is in use
+static void unmount(ext2_fs* fs) {
+    mutex_lock(&fs->lock);
+    write_super(fs);
+    mutex_unlock(&fs->lock);
+    if (IS_ERR(buffer_cache_sync(fs->dev)))
+        kprintf("ext2: failed to write back /dev/%s\n", fs->dev->name);
+    kprintf("ext2: unmounted /dev/%s\n", fs->dev->name);
+
+    fs->dev->mounted = false;
+    kfree(fs->groups);
+    kfree(fs);
+}
+
+static void ext2_destroy_inode(struct inode* inode) {
+    ext2_inode* node = (ext2_inode*)inode;
+    ext2_fs* fs = node->fs;
+    bool is_root = node->ino == EXT2_ROOT_INO;
+
+    mutex_lock(&fs->lock);
+    ext2_inode** it = inode_bucket(fs, node->ino);
+    while (*it != node)
+        it = &(*it)->hash_next;
+    *it = node->hash_next;
+    mutex_unlock(&fs->lock);
+
+    if (node->raw.i_links_count == 0) {
+        if (has_data_blocks(node))
+            free_blocks_from(node, 0);
+        node->raw.i_size = 0;
+        node->raw.i_dtime = now();
+        write_inode(node);
+        free_inode(fs, node->ino, S_ISDIR(node->raw.i_mode));
+    } else if (S_ISCHR(node->raw.i_mode) || S_ISBLK(node->raw.i_mode)) {
+        // mknod sets the device number after the file is created
+        if (decode_device(&node->raw) != inode->device_id) {
+            encode_device(&node->raw, inode->device_id);
+            write_inode(node);
+        }
+    }
+
+    kfree(node);
+    if (is_root)
+        unmount(fs);
+    else
+        inode_unref(fs->root);
+}
+
+static ssize_t read_data(ext2_inode* node, void* buffer, size_t count,
+                         size_t offset) {
+    ext2_fs* fs = node->fs;
+    size_t size = node->raw.i_size;
+    if (offset >= size)
+        return 0;
+    count = MIN(count, size - offset);
+
+    // the target of a fast symlink is kept in i_block
+    if (!has_data_blocks(node)) {
+        if (!S_ISLNK(node->raw.i_mode))
+            return 0;
+        count = MIN(count, sizeof(node->raw.i_block) - MIN(offset, sizeof(node->raw.i_block)));
+        memcpy(buffer, (unsigned char*)node->raw.i_block + offset, count);
+        return count;
+    }
+
+    unsigned char* dest = buffer;
+    size_t done = 0;
+    while (done < count) {
+        size_t index = (offset + done) / fs->block_size;
+        size_t block_offset = (offset + done) % fs->block_size;
+        size_t n = MIN(count - done, fs->block_size - block_offset);
+
+        uint32_t block;
+        int rc = bmap(node, index, false, &block, NULL);
+        if (IS_ERR(rc))
+            return done > 0 ? (ssize_t)done : rc;
+        if (!block) {
+            memset(dest + done, 0, n);
+        } else {
+            struct buffer* buf;
+            unsigned char* data = get_block(fs, block, &buf);
+            if (IS_ERR(data))
+                return done > 0 ? (ssize_t)done : PTR_ERR(data);
+            memcpy(dest + done, data + block_offset, n);
+            buffer_put(buf);
+        }
+        done += n;
+    }
+    return done;
+}
+
+static ssize_t write_data(ext2_inode* node, const void* buffer, size_t count,
+                          size_t offset) {
+    ext2_fs* fs = node->fs;
+    if (offset + count > INT32_MAX || offset + count < offset)
+        return -EFBIG;
+
+    const unsigned char* src = buffer;
+    size_t done = 0;
+    int rc = 0;
+    while (done < count) {
+        size_t index = (offset + done) / fs->block_size;
+        size_t block_offset = (offset + done) % fs->block_size;
+        size_t n = MIN(count - done, fs->block_size - block_offset);
+
+        uint32_t block;
+        bool is_new;
+        rc = bmap(node, index, true, &block, &is_new);
+        if (IS_ERR(rc))
+            break;
+
+        // blocks that are overwritten as a whole don't have to be read
+        struct buffer* buf;
+        unsigned char* data = is_new || n == fs->block_size
+                                  ? get_zeroed_block(fs, block, &buf)
+                                  : get_block(fs, block, &buf);
+        if (IS_ERR(data)) {
+            rc = PTR_ERR(data);
+            break;
+        }
+        memcpy(data + block_offset, src + done, n);
+        buffer_mark_dirty(buf);
+        buffer_put(buf);
+        done += n;
+    }
+
+    if (done > 0) {
+        if (offset + done > node->raw.i_size)
+            node->raw.i_size = offset + done;
+        node->raw.i_mtime = node->raw.i_ctime = now();
+    }
+    write_inode(node);
+    return done > 0 ? (ssize_t)done : rc;
+}
+
+// directories
+
+static bool dir_entry_is_valid(const ext2_fs* fs,
+                               const struct ext2_dir_entry* entry,
+                               size_t offset) {
+    return entry->rec_len >= DIR_ENTRY_HEADER_SIZE && entry->rec_len % 4 == 0 &&
+           offset + entry->rec_len <= fs->block_size &&
+           DIR_ENTRY_HEADER_SIZE + entry->name_len <= entry->rec_len;
+}
+
+static bool dir_entry_matches(const struct ext2_dir_entry* entry,
+                              const char* name, size_t name_len) {
+    return entry->inode && entry->name_len == name_len &&
+           !memcmp(entry->name, name, name_len);
+}
+
+// where an entry of a directory is
+struct dir_pos {
+    uint32_t block;     // block of the file system
+    size_t offset;      // of the entry in the block
+    size_t prev_offset; // of the entry before it, or SIZE_MAX if it is first
+    uint32_t ino;
+};
+
+// looks for name in the index-th block of the directory. returns 1 if it was
+// found.
+static NODISCARD int search_dir_block(ext2_inode* dir, uint32_t index,
+                                      const char* name, size_t name_len,
+                                      struct dir_pos* out_pos) {
+    ext2_fs* fs = dir->fs;
+    uint32_t block;
+    int rc = bmap(dir, index, false, &block, NULL);
+    if (IS_ERR(rc))
+        return rc;
+    if (!block)
+        return 0;
+
+    struct buffer* buf;
+    unsigned char* data = get_block(fs, block, &buf);
+    if (IS_ERR(data))
+        return PTR_ERR(data);
+    size_t prev_offset = SIZE_MAX;
+    for (size_t offset = 0; offset < fs->block_size;) {
+        const struct ext2_dir_entry* entry =
+            (const struct ext2_dir_entry*)(data + offset);
+        if (!dir_entry_is_valid(fs, entry, offset)) {
+            buffer_put(buf);
+            kprintf("ext2: corrupted directory %u\n", dir->ino);
+            return -EIO;
+        }
+        if (dir_entry_matches(entry, name, name_len)) {
+            *out_pos = (struct dir_pos){.block = block,
+                                        .offset = offset,
+                                        .prev_offset = prev_offset,
+                                        .ino = entry->inode};
+            buffer_put(buf);
+            return 1;
+        }
+        prev_offset = offset;
+        offset += entry->rec_len;
+    }
+    buffer_put(buf);
+    return 0;
+}
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void tea_transform(uint32_t buf[4], const uint32_t in[4]) {
+    uint32_t sum = 0;
+    uint32_t b0 = buf[0];
+    uint32_t b1 = buf[1];
+    for (int i = 0; i < 16; ++i) {
+        sum += 0x9e3779b9;
+        b0 += ((b1 << 4) + in[0]) ^ (b1 + sum) ^ ((b1 >> 5) + in[1]);
+        b1 += ((b0 << 4) + in[2]) ^ (b0 + sum) ^ ((b0 >> 5) + in[3]);
+    }
+    buf[0] += b0;
+    buf[1] += b1;
+}
+
+#define MD4_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD4_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define MD4_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD4_ROUND(f, a, b, c, d, x, s) ((a) += f(b, c, d) + (x), (a) = ROL32(a, s))
+#define MD4_K2 013240474631u
+#define MD4_K3 015666365641u
+
+static void half_md4_transform(uint32_t buf[4], const uint32_t in[8]) {
+    uint32_t a = buf[0];
+    uint32_t b = buf[1];
+    uint32_t c = buf[2];
+    uint32_t d = buf[3];
+
+    MD4_ROUND(MD4_F, a, b, c, d, in[0], 3);
+    MD4_ROUND(MD4_F, d, a, b, c, in[1], 7);
+    MD4_ROUND(MD4_F, c, d, a, b, in[2], 11);
+    MD4_ROUND(MD4_F, b, c, d, a, in[3], 19);
+    MD4_ROUND(MD4_F, a, b, c, d, in[4], 3);
+    MD4_ROUND(MD4_F, d, a, b, c, in[5], 7);
+    MD4_ROUND(MD4_F, c, d, a, b, in[6], 11);
+    MD4_ROUND(MD4_F, b, c, d, a, in[7], 19);
+
+    MD4_ROUND(MD4_G, a, b, c, d, in[1] + MD4_K2, 3);
+    MD4_ROUND(MD4_G, d, a, b, c, in[3] + MD4_K2, 5);
+    MD4_ROUND(MD4_G, c, d, a, b, in[5] + MD4_K2, 9);
+    MD4_ROUND(MD4_G, b, c, d, a, in[7] + MD4_K2, 13);
+    MD4_ROUND(MD4_G, a, b, c, d, in[0] + MD4_K2, 3);
+    MD4_ROUND(MD4_G, d, a, b, c, in[2] + MD4_K2, 5);
+    MD4_ROUND(MD4_G, c, d, a, b, in[4] + MD4_K2, 9);
+    MD4_ROUND(MD4_G, b, c, d, a, in[6] + MD4_K2, 13);
+
+    MD4_ROUND(MD4_H, a, b, c, d, in[3] + MD4_K3, 3);
+    MD4_ROUND(MD4_H, d, a, b, c, in[7] + MD4_K3, 9);
+    MD4_ROUND(MD4_H, c, d, a, b, in[2] + MD4_K3, 11);
+    MD4_ROUND(MD4_H, b, c, d, a, in[6] + MD4_K3, 15);
+    MD4_ROUND(MD4_H, a, b, c, d, in[1] + MD4_K3, 3);
+    MD4_ROUND(MD4_H, d, a, b, c, in[5] + MD4_K3, 9);
+    MD4_ROUND(MD4_H, c, d, a, b, in[0] + MD4_K3, 11);
+    MD4_ROUND(MD4_H, b, c, d, a, in[4] + MD4_K3, 15);
+
+    buf[0] += a;
+    buf[1] += b;
+    buf[2] += c;
+    buf[3] += d;
+}
+
+// packs the name into num words, padded with its length
+static void str2hashbuf(const char* name, size_t len, uint32_t* out,
+                        size_t num, bool is_unsigned) {
+    uint32_t pad = (uint32_t)len | ((uint32_t)len << 8);
+    pad |= pad << 16;
+    uint32_t val = pad;
+    len = MIN(len, num * 4);
+    for (size_t i = 0; i < len; ++i) {
+        int c = is_unsigned ? (int)(unsigned char)name[i]
+                            : (int)(signed char)name[i];
+        val = (uint32_t)c + (val << 8);
+        if (i % 4 == 3) {
+            *out++ = val;
+            val = pad;
+            --num;
+        }
+    }
+    if (num > 0) {
+        *out++ = val;
+        --num;
+    }
+    while (num-- > 0)
+        *out++ = pad;
+}
+
+static uint32_t legacy_hash(const char* name, size_t len, bool is_unsigned) {
+    uint32_t hash0 = 0x12a3fe2d;
+    uint32_t hash1 = 0x37abe8f9;
+    for (size_t i = 0; i < len; ++i) {
+        int c = is_unsigned ? (int)(unsigned char)name[i]
+                            : (int)(signed char)name[i];
+        uint32_t hash = hash1 + (hash0 ^ (uint32_t)(c * 7152373));
+        if (hash & 0x80000000)
+            hash -= 0x7fffffff;
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
+
+// computes the hash of the name the way the index was built, or returns
+// false if the hash version is unknown
+static bool dx_hash(const ext2_fs* fs, uint8_t version, const char* name,
+                    size_t len, uint32_t* out_hash) {
+    uint32_t buf[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    if (fs->sb.s_hash_seed[0] | fs->sb.s_hash_seed[1] | fs->sb.s_hash_seed[2] |
+        fs->sb.s_hash_seed[3])
+        memcpy(buf, fs->sb.s_hash_seed, sizeof(buf));
+
+    if (version <= DX_HASH_TEA && fs->unsigned_hash)
+        version += DX_HASH_LEGACY_UNSIGNED;
+    bool is_unsigned = version >= DX_HASH_LEGACY_UNSIGNED;
+
+    uint32_t hash;
+    uint32_t in[8];
+    switch (version) {
+    case DX_HASH_LEGACY:
+    case DX_HASH_LEGACY_UNSIGNED:
+        hash = legacy_hash(name, len, is_unsigned);
+        break;
+    case DX_HASH_HALF_MD4:
+    case DX_HASH_HALF_MD4_UNSIGNED:
+        for (size_t i = 0; i < len; i += 32) {
+            str2hashbuf(name + i, len - i, in, 8, is_unsigned);
+            half_md4_transform(buf, in);
+        }
+        hash = buf[1];
+        break;
+    case DX_HASH_TEA:
+    case DX_HASH_TEA_UNSIGNED:
+        for (size_t i = 0; i < len; i += 16) {
+            str2hashbuf(name + i, len - i, in, 4, is_unsigned);
+            tea_transform(buf, in);
+        }
+        hash = buf[0];
+        break;
+    default:
+        return false;
+    }
+
+    hash &= ~1;
+    if (hash == (0x7fffffffu << 1))
+        hash = 0x7ffffffeu << 1;
+    *out_hash = hash;
+    return true;
+}
+
+// a position in a node of the index
+struct dx_frame {
+    uint32_t index; // of the node's block in the directory
+    size_t entries_offset;
+    uint16_t count;
+    uint16_t at;
+};
+
+// returns the entries of a node of the index, which lie in *out_buf, or
+// NULL if they don't look right
+static const struct dx_entry* dx_get_node(ext2_inode* dir,
+                                          struct dx_frame* frame,
+                                          struct buffer** out_buf) {
+    ext2_fs* fs = dir->fs;
+    uint32_t block;
+    if (IS_ERR(bmap(dir, frame->index, false, &block, NULL)) || !block)
+        return NULL;
+    unsigned char* data = get_block(fs, block, out_buf);
+    if (IS_ERR(data))
+        return NULL;
+
+    const struct dx_entry* entries =
+        (const struct dx_entry*)(data + frame->entries_offset);
+    uint16_t limit = entries[0].hash & 0xffff;
+    uint16_t count = entries[0].hash >> 16;
+    size_t max_entries =
+        (fs->block_size - frame->entries_offset) / sizeof(struct dx_entry);
+    if (count == 0 || count > limit || limit > max_entries) {
+        buffer_put(*out_buf);
+        return NULL;
+    }
+    frame->count = count;
+    return entries;
+}
+
+// finds the entry of the node that covers the hash
+static uint16_t dx_search(const struct dx_entry* entries, uint16_t count,
+                          uint32_t hash) {
+    uint16_t lo = 1;
+    uint16_t hi = count;
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (entries[mid].hash > hash)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo - 1;
+}
+
+// looks up the name through the hashed index of the directory. returns 1 if
+// it was found, 0 if it wasn't, and -EAGAIN if the index can't be used.
+static NODISCARD int dx_find(ext2_inode* dir, const char* name,
+                             size_t name_len, struct dir_pos* out_pos) {
+    ext2_fs* fs = dir->fs;
+    uint32_t block;
+    if (IS_ERR(bmap(dir, 0, false, &block, NULL)) || !block)
+        return -EAGAIN;
+    struct buffer* buf;
+    unsigned char* data = get_block(fs, block, &buf);
+    if (IS_ERR(data))
+        return -EAGAIN;
+    struct dx_root_info info;
+    memcpy(&info, data + DX_ROOT_INFO_OFFSET, sizeof(info));
+    buffer_put(buf);
+
+    uint32_t hash;
+    if (info.reserved_zero || info.indirect_levels >= DX_MAX_LEVELS ||
+        !dx_hash(fs, info.hash_version, name, name_len, &hash))
+        return -EAGAIN;
+
+    // walk down to the leaf that covers the hash
+    size_t num_levels = info.indirect_levels + 1;
+    struct dx_frame frames[DX_MAX_LEVELS];
+    frames[0] = (struct dx_frame){
+        .index = 0, .entries_offset = DX_ROOT_INFO_OFFSET + info.info_length};
+    uint32_t leaf = 0;
+    for (size_t level = 0; level < num_levels; ++level) {
+        const struct dx_entry* entries = dx_get_node(dir, frames + level, &buf);
+        if (!entries)
+            return -EAGAIN;
+        frames[level].at = dx_search(entries, frames[level].count, hash);
+        uint32_t child = entries[frames[level].at].block;
+        buffer_put(buf);
+        if (level + 1 < num_levels)
+            frames[level + 1] = (struct dx_frame){
+                .index = child, .entries_offset = DX_NODE_ENTRIES_OFFSET};
+        else
+            leaf = child;
+    }
+
+    for (;;) {
+        int rc = search_dir_block(dir, leaf, name, name_len, out_pos);
+        if (rc != 0)
+            return rc;
+
+        // names with the same hash can continue in the next leaf, whose
+        // starting hash then has the collision bit set
+        size_t level = num_levels;
+        while (level > 0 &&
+               frames[level - 1].at + 1 >= frames[level - 1].count)
+            --level;
+        if (level == 0)
+            return 0;
+        struct dx_frame* frame = frames + level - 1;
+        const struct dx_entry* entries = dx_get_node(dir, frame, &buf);
+        if (!entries)
+            return -EIO;
+        ++frame->at;
+        uint32_t next_hash = entries[frame->at].hash;
+        uint32_t child = entries[frame->at].block;
+        buffer_put(buf);
+        if ((next_hash & ~1) != hash)
+            return 0;
+
+        for (; level < num_levels; ++level) {
+            frames[level] = (struct dx_frame){
+                .index = child, .entries_offset = DX_NODE_ENTRIES_OFFSET};
+            entries = dx_get_node(dir, frames + level, &buf);
+            if (!entries)
+                return -EIO;
+            child = entries[0].block;
+            buffer_put(buf);
+        }
+        leaf = child;
+    }
+}
+
+// returns 1 if the directory has an entry with the name
+static NODISCARD int find_entry(ext2_inode* dir, const char* name,
+                                struct dir_pos* out_pos) {
+    size_t name_len = strlen(name);
+    if (name_len > EXT2_NAME_LEN)
+        return 0;
+
+    if (dir->fs->has_dir_index && (dir->raw.i_flags & EXT2_INDEX_FL)) {
+        int rc = dx_find(dir, name, name_len, out_pos);
+        if (rc != -EAGAIN)
+            return rc;
+    }
+
+    size_t num_blocks = dir->raw.i_size / dir->fs->block_size;
+    for (size_t i = 0; i < num_blocks; ++i) {
+        int rc = search_dir_block(dir, i, name, name_len, out_pos);
+        if (rc != 0)
+            return rc;
+    }
+    return 0;
+}
+
+static void fill_dir_entry(ext2_fs* fs, struct ext2_dir_entry* entry,
+                           const char* name, size_t name_len, uint32_t ino,
+                           mode_t mode) {
+    entry->inode = ino;
+    entry->name_len = name_len;
+    entry->file_type = fs->has_filetype ? mode_to_file_type(mode) : 0;
+    memcpy(entry->name, name, name_len);
+}
+
+// adds an entry to the first block that has room for it, or to a new block
+// at the end of the directory
+static NODISCARD int add_entry(ext2_inode* dir, const char* name, uint32_t ino,
+                               mode_t mode) {
+    ext2_fs* fs = dir->fs;
+    size_t name_len = strlen(name);
+    size_t needed = DIR_ENTRY_SIZE(name_len);
+    size_t num_blocks = dir->raw.i_size / fs->block_size;
+
+    for (size_t i = 0; i < num_blocks; ++i) {
+        uint32_t block;
+        int rc = bmap(dir, i, false, &block, NULL);
+        if (IS_ERR(rc))
+            return rc;
+        if (!block)
+            continue;
+        struct buffer* buf;
+        unsigned char* data = get_block(fs, block, &buf);
+        if (IS_ERR(data))
+            return PTR_ERR(data);
+
+        for (size_t offset = 0; offset < fs->block_size;) {
+            struct ext2_dir_entry* entry =
+                (struct ext2_dir_entry*)(data + offset);
+            if (!dir_entry_is_valid(fs, entry, offset)) {
+                buffer_put(buf);
+                return -EIO;
+            }
+            size_t used = entry->inode ? DIR_ENTRY_SIZE(entry->name_len) : 0;
+            if (entry->rec_len - used >= needed) {
+                if (used > 0) {
+                    struct ext2_dir_entry* new_entry =
+                        (struct ext2_dir_entry*)(data + offset + used);
+                    new_entry->rec_len = entry->rec_len - used;
+                    entry->rec_len = used;
+                    entry = new_entry;
+                }
+                fill_dir_entry(fs, entry, name, name_len, ino, mode);
+                buffer_mark_dirty(buf);
+                buffer_put(buf);
+                goto added;
+            }
+            offset += entry->rec_len;
+        }
+        buffer_put(buf);
+    }
+
+    uint32_t block;
+    int rc = bmap(dir, num_blocks, true, &block, NULL);
+    if (IS_ERR(rc))
+        return rc;
+    struct buffer* buf;
+    unsigned char* data = get_zeroed_block(fs, block, &buf);
+    if (IS_ERR(data))
+        return PTR_ERR(data);
+    struct ext2_dir_entry* entry = (struct ext2_dir_entry*)data;
+    entry->rec_len = fs->block_size;
+    fill_dir_entry(fs, entry, name, name_len, ino, mode);
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+    dir->raw.i_size += fs->block_size;
+
+added:
+    // the index isn't updated, so it no longer covers every entry. the
+    // directory is read linearly from now on, as the index blocks look like
+    // unused entries.
+    dir->raw.i_flags &= ~EXT2_INDEX_FL;
+    dir->raw.i_mtime = dir->raw.i_ctime = now();
+    write_inode(dir);
+    return 0;
+}
+
+static NODISCARD int remove_entry(ext2_inode* dir, const struct dir_pos* pos) {
+    struct buffer* buf;
+    unsigned char* data = get_block(dir->fs, pos->block, &buf);
+    if (IS_ERR(data))
+        return PTR_ERR(data);
+    struct ext2_dir_entry* entry = (struct ext2_dir_entry*)(data + pos->offset);
+    if (pos->prev_offset == SIZE_MAX) {
+        entry->inode = 0;
+    } else {
+        struct ext2_dir_entry* prev =
+            (struct ext2_dir_entry*)(data + pos->prev_offset);
+        prev->rec_len += entry->rec_len;
+    }
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+
+    dir->raw.i_mtime = dir->raw.i_ctime = now();
+    write_inode(dir);
+    return 0;
+}
+
+// points ".." of the directory at parent_ino
+static NODISCARD int set_parent(ext2_inode* dir, uint32_t parent_ino) {
+    ext2_fs* fs = dir->fs;
+    uint32_t block;
+    int rc = bmap(dir, 0, false, &block, NULL);
+    if (IS_ERR(rc))
+        return rc;
+    if (!block)
+        return -EIO;
+    struct buffer* buf;
+    unsigned char* data = get_block(fs, block, &buf);
+    if (IS_ERR(data))
+        return PTR_ERR(data);
+
+    struct ext2_dir_entry* dot = (struct ext2_dir_entry*)data;
+    struct ext2_dir_entry* dotdot = NULL;
+    if (dir_entry_is_valid(fs, dot, 0) && dot->rec_len < fs->block_size)
+        dotdot = (struct ext2_dir_entry*)(data + dot->rec_len);
+    if (!dotdot || !dir_entry_is_valid(fs, dotdot, dot->rec_len) ||
+        !dir_entry_matches(dotdot, "..", 2)) {
+        buffer_put(buf);
+        return -EIO;
+    }
+    dotdot->inode = parent_ino;
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+    return 0;
+}
+
+static struct inode* ext2_lookup_child(struct inode* inode, const char* name) {
+    ext2_inode* dir = (ext2_inode*)inode;
+    mutex_lock(&dir->lock);
+    struct dir_pos pos;
+    int rc = find_entry(dir, name, &pos);
+    mutex_unlock(&dir->lock);
+
+    struct inode* child = NULL;
+    if (IS_ERR(rc))
+        child = ERR_PTR(rc);
+    else if (rc == 0)
+        child = ERR_PTR(-ENOENT);
+    else
+        child = iget(dir->fs, pos.ino);
+    inode_unref(inode);
+    return child;
+}
+
+static int ext2_getdents(struct getdents_ctx* ctx, file_description* desc,
+                         getdents_callback_fn callback) {
+    ext2_inode* dir = (ext2_inode*)desc->inode;
+    ext2_fs* fs = dir->fs;
+    mutex_lock(&dir->lock);
+    mutex_lock(&desc->offset_lock);
+
+    int rc = 0;
+    // the offset is the position in the directory of the next entry
+    while ((size_t)desc->offset < dir->raw.i_size) {
+        size_t index = desc->offset / fs->block_size;
+        size_t start = desc->offset % fs->block_size;
+        uint32_t block;
+        rc = bmap(dir, index, false, &block, NULL);
+        if (IS_ERR(rc))
+            break;
+        if (!block) {
+            desc->offset = (index + 1) * fs->block_size;
+            continue;
+        }
+        struct buffer* buf;
+        unsigned char* data = get_block(fs, block, &buf);
+        if (IS_ERR(data)) {
+            rc = PTR_ERR(data);
+            break;
+        }
+
+        bool buffer_is_full = false;
+        size_t offset = 0;
+        while (offset < fs->block_size) {
+            const struct ext2_dir_entry* entry =
+                (const struct ext2_dir_entry*)(data + offset);
+            if (!dir_entry_is_valid(fs, entry, offset)) {
+                rc = -EIO;
+                break;
+            }
+            if (offset < start || !entry->inode ||
+                dir_entry_matches(entry, ".", 1) ||
+                dir_entry_matches(entry, "..", 2)) {
+                offset += entry->rec_len;
+                continue;
+            }
+
+            char name[EXT2_NAME_LEN + 1];
+            memcpy(name, entry->name, entry->name_len);
+            name[entry->name_len] = '\0';
+            uint8_t type = fs->has_filetype
+                               ? file_type_to_dirent_type(entry->file_type)
+                               : DT_UNKNOWN;
+            if (type == DT_UNKNOWN) {
+                struct inode* child = iget(fs, entry->inode);
+                if (IS_OK(child)) {
+                    type = mode_to_dirent_type(child->mode);
+                    inode_unref(child);
+                }
+            }
+            if (!callback(ctx, name, type)) {
+                buffer_is_full = true;
+                break;
+            }
+            offset += entry->rec_len;
+            desc->offset = index * fs->block_size + offset;
+        }
+        buffer_put(buf);
+        if (IS_ERR(rc) || buffer_is_full)
+            break;
+        desc->offset = (index + 1) * fs->block_size;
+    }
+
+    mutex_unlock(&desc->offset_lock);
+    mutex_unlock(&dir->lock);
+    return rc;
+}
+
+static struct inode* ext2_create_child(struct inode* inode, const char* name,
+                                       mode_t mode) {
+    ext2_inode* dir = (ext2_inode*)inode;
+    ext2_fs* fs = dir->fs;
+    bool is_dir = S_ISDIR(mode);
+    if (strlen(name) > EXT2_NAME_LEN) {
+        inode_unref(inode);
+        return ERR_PTR(-ENAMETOOLONG);
+    }
+
+    mutex_lock(&dir->lock);
+
+    struct dir_pos pos;
+    int rc = find_entry(dir, name, &pos);
+    if (rc != 0) {
+        rc = IS_ERR(rc) ? rc : -EEXIST;
+        goto fail;
+    }
+
+    uint32_t ino;
+    rc = alloc_inode(fs, dir->ino, is_dir, &ino);
+    if (IS_ERR(rc))
+        goto fail;
+
+    // inodes larger than the common part have their extra space zeroed
+    struct buffer* buf;
+    unsigned char* slot = get_inode_slot(fs, ino, &buf);
+    if (IS_ERR(slot)) {
+        free_inode(fs, ino, is_dir);
+        rc = PTR_ERR(slot);
+        goto fail;
+    }
+    memset(slot, 0, fs->inode_size);
+    buffer_mark_dirty(buf);
+    buffer_put(buf);
+
+    uint32_t t = now();
+    struct ext2_disk_inode raw = {.i_mode = mode,
+                                  .i_links_count = is_dir ? 2 : 1,
+                                  .i_atime = t,
+                                  .i_ctime = t,
+                                  .i_mtime = t};
+    mutex_lock(&fs->lock);
+    ext2_inode* child = install_inode(fs, ino, &raw);
+    mutex_unlock(&fs->lock);
+    if (IS_ERR(child)) {
+        free_inode(fs, ino, is_dir);
+        rc = PTR_ERR(child);
+        goto fail;
+    }
+
+    if (is_dir) {
+        uint32_t block;
+        rc = bmap(child, 0, true, &block, NULL);
+        unsigned char* data = NULL;
+        if (IS_OK(rc)) {
+            data = get_zeroed_block(fs, block, &buf);
+            if (IS_ERR(data))
+                rc = PTR_ERR(data);
+        }
+        if (IS_OK(rc)) {
+            struct ext2_dir_entry* dot = (struct ext2_dir_entry*)data;
+            dot->rec_len = DIR_ENTRY_SIZE(1);
+            fill_dir_entry(fs, dot, ".", 1, ino, S_IFDIR);
+            struct ext2_dir_entry* dotdot =
+                (struct ext2_dir_entry*)(data + dot->rec_len);
+            dotdot->rec_len = fs->block_size - dot->rec_len;
+            fill_dir_entry(fs, dotdot, "..", 2, dir->ino, S_IFDIR);
+            buffer_mark_dirty(buf);
+            buffer_put(buf);
+            child->raw.i_size = fs->block_size;
+        }
+    }
+    if (IS_OK(rc))
+        rc = add_entry(dir, name, ino, mode);
+    if (IS_ERR(rc)) {
+        // dropping the in-memory inode frees what was allocated for it
+        child->raw.i_links_count = 0;
+        inode_unref(&child->inode);
+        goto fail;
+    }
+    write_inode(child);
+
+    if (is_dir) {
+        ++dir->raw.i_links_count;
+        write_inode(dir);
+    }
+
+    mutex_unlock(&dir->lock);
+    inode_unref(inode);
+    return &child->inode;
+
+fail:
+    mutex_unlock(&dir->lock);
+    inode_unref(inode);
+    return ERR_PTR(rc);
+}
+
+static int ext2_link_child(struct inode* inode, const char* name,
+                           struct inode* child_inode) {
+    ext2_inode* dir = (ext2_inode*)inode;
+    ext2_inode* child = (ext2_inode*)child_inode;
+    bool is_dir = S_ISDIR(child_inode->mode);
+    int rc = 0;
+    if (strlen(name) > EXT2_NAME_LEN) {
+        rc = -ENAMETOOLONG;
+        goto done;
+    }
+
+    mutex_lock(&dir->lock);
+    struct dir_pos pos;
+    rc = find_entry(dir, name, &pos);
+    if (rc == 0)
+        rc = add_entry(dir, name, child->ino, child_inode->mode);
+    else if (IS_OK(rc))
+        rc = -EEXIST;
+    if (IS_OK(rc) && is_dir) {
+        // ".." of the directory is going to point here
+        ++dir->raw.i_links_count;
+        write_inode(dir);
+    }
+    mutex_unlock(&dir->lock);
+    if (IS_ERR(rc))
+        goto done;
+
+    // directories are only linked when they are renamed, so the entry in
+    // the old parent is about to be removed
+    mutex_lock(&child->lock);
+    ++child->raw.i_links_count;
+    child->raw.i_ctime = now();
+    if (is_dir)
+        rc = set_parent(child, dir->ino);
+    write_inode(child);
+    mutex_unlock(&child->lock);
+
+done:
+    inode_unref(inode);
+    inode_unref(child_inode);
+    return rc;
+}
+
+static struct inode* ext2_unlink_child(struct inode* inode, const char* name) {
+    ext2_inode* dir = (ext2_inode*)inode;
+
+    mutex_lock(&dir->lock);
+    struct dir_pos pos;
+    int rc = find_entry(dir, name, &pos);
+    if (rc == 0)
+        rc = -ENOENT;
+    struct inode* child_inode = NULL;
+    if (IS_OK(rc)) {
+        child_inode = iget(dir->fs, pos.ino);
+        if (IS_ERR(child_inode))
+            rc = PTR_ERR(child_inode);
+    }
+    if (IS_OK(rc))
+        rc = remove_entry(dir, &pos);
+    if (IS_ERR(rc)) {
+        mutex_unlock(&dir->lock);
+        inode_unref(child_inode);
+        inode_unref(inode);
+        return ERR_PTR(rc);
+    }
+    bool is_dir = S_ISDIR(child_inode->mode);
+    if (is_dir && dir->raw.i_links_count > 1) {
+        // ".." of the directory no longer points here
+        --dir->raw.i_links_count;
+        write_inode(dir);
+    }
+    mutex_unlock(&dir->lock);
+
+    ext2_inode* child = (ext2_inode*)child_inode;
+    mutex_lock(&child->lock);
+    if (child->raw.i_links_count > 0)
+        --child->raw.i_links_count;
+    // a directory that is left with only its own "." is being removed
+    if (is_dir && child->raw.i_links_count == 1)
+        child->raw.i_links_count = 0;
+    child->raw.i_ctime = now();
+    write_inode(child);
+    mutex_unlock(&child->lock);
+
+    inode_unref(inode);
+    return child_inode;
+}
+
+static int ext2_stat(struct inode* inode, struct stat* buf) {
+    ext2_inode* node = (ext2_inode*)inode;
+    mutex_lock(&node->lock);
+    buf->st_mode = node->raw.i_mode;
+    buf->st_nlink = node->raw.i_links_count;
+    buf->st_rdev = inode->device_id;
+    buf->st_size = node->raw.i_size;
+    buf->st_blocks = node->raw.i_blocks;
+    mutex_unlock(&node->lock);
+    inode_unref(inode);
+    return 0;
+}
+
+static ssize_t ext2_read(file_description* desc, void* buffer, size_t count) {
+    ext2_inode* node = (ext2_inode*)desc->inode;
+    mutex_lock(&desc->offset_lock);
+    mutex_lock(&node->lock);
+    ssize_t nread = read_data(node, buffer, count, desc->offset);
+    mutex_unlock(&node->lock);
+    if (IS_OK(nread))
+        desc->offset += nread;
+    mutex_unlock(&desc->offset_lock);
+    return nread;
+}
+
+static ssize_t ext2_write(file_description* desc, const void* buffer,
+                          size_t count) {
+    ext2_inode* node = (ext2_inode*)desc->inode;
+    mutex_lock(&desc->offset_lock);
+    mutex_lock(&node->lock);
+    ssize_t nwritten = write_data(node, buffer, count, desc->offset);
+    mutex_unlock(&node->lock);
+    if (IS_OK(nwritten))
+        desc->offset += nwritten;
+    mutex_unlock(&desc->offset_lock);
+    return nwritten;
+}
+
+static int ext2_truncate(file_description* desc, off_t length) {
+    ext2_inode* node = (ext2_inode*)desc->inode;
+    ext2_fs* fs = node->fs;
+    if (length < 0)
+        return -EINVAL;
+
+    mutex_lock(&node->lock);
+    if ((size_t)length < node->raw.i_size) {
+        free_blocks_from(node, div_ceil(length, fs->block_size));
+
+        // the rest of the last block would show up again if the file grew
+        size_t tail = length % fs->block_size;
+        uint32_t block = 0;
+        if (tail > 0 &&
+            IS_OK(bmap(node, length / fs->block_size, false, &block, NULL)) &&
+            block) {
+            struct buffer* buf;
+            unsigned char* data = get_block(fs, block, &buf);
+            if (IS_OK(data)) {
+                memset(data + tail, 0, fs->block_size - tail);
+                buffer_mark_dirty(buf);
+                buffer_put(buf);
+            }
+        }
+    }
+    node->raw.i_size = length;
+    node->raw.i_mtime = node->raw.i_ctime = now();
+    write_inode(node);
+    mutex_unlock(&node->lock);
+    return 0;
+}
+
+// the mapped pages are private copies of the file, so shared writable
+// mappings, whose writes would have to reach the file, aren't supported
+static uintptr_t ext2_mmap(file_description* desc, uintptr_t addr,
+                           size_t length, off_t offset, uint16_t page_flags) {
+    // every mapping is a private copy of the file, which a shared mapping
+    // would stop matching after the next write
+    if (page_flags & PAGE_SHARED)
+        return -ENODEV;
+    ext2_inode* node = (ext2_inode*)desc->inode;
+    if (offset % PAGE_SIZE)
+        return -ENOTSUP;
+
+    mutex_lock(&node->lock);
+    if (offset + length > round_up(node->raw.i_size, PAGE_SIZE)) {
+        mutex_unlock(&node->lock);
+        return -EINVAL;
+    }
+
+    // the rest of the last page is zero-filled
+    size_t map_length = round_up(length, PAGE_SIZE);
+    int rc = paging_map_to_free_pages(addr, map_length, PAGE_WRITE);
+    if (IS_ERR(rc)) {
+        mutex_unlock(&node->lock);
+        return rc;
+    }
+    memset((void*)addr, 0, map_length);
+    ssize_t nread = read_data(node, (void*)addr, map_length, offset);
+    mutex_unlock(&node->lock);
+    if (IS_ERR(nread)) {
+        paging_unmap(addr, map_length);
+        return nread;
+    }
+
+    paging_protect(addr, map_length, page_flags);
+    return addr;
+}
+
+static int ext2_fsync(file_description* desc) {
+    return buffer_cache_sync(((ext2_inode*)desc->inode)->fs->dev);
+}
+
+static file_ops dir_fops = {.destroy_inode = ext2_destroy_inode,
+                            .lookup_child = ext2_lookup_child,
+                            .create_child = ext2_create_child,
+                            .link_child = ext2_link_child,
+                            .unlink_child = ext2_unlink_child,
+                            .stat = ext2_stat,
+                            .fsync = ext2_fsync,
+                            .getdents = ext2_getdents,
+                            .cache_lookups = true};
+static file_ops file_fops = {.destroy_inode = ext2_destroy_inode,
+                             .stat = ext2_stat,
+                             .read = ext2_read,
+                             .write = ext2_write,
+                             .mmap = ext2_mmap,
+                             .truncate = ext2_truncate,
+                             .fsync = ext2_fsync};
+
+static NODISCARD int check_superblock(const struct ext2_superblock* sb) {
+    if (sb->s_magic != EXT2_SUPER_MAGIC)
+        return -EINVAL;
+    if (sb->s_log_block_size > 2 ||
+        (1024u << sb->s_log_block_size) > BUFFER_SIZE) {
+        kprintf("ext2: unsupported block size %u\n",
+                1024 << sb->s_log_block_size);
+        return -ENOTSUP;
+    }
+    size_t block_size = 1024 << sb->s_log_block_size;
+    if (sb->s_blocks_per_group == 0 ||
+        sb->s_blocks_per_group > block_size * 8 ||
+        sb->s_inodes_per_group == 0 ||
+        sb->s_inodes_per_group > block_size * 8 ||
+        sb->s_first_data_block >= sb->s_blocks_count)
+        return -EINVAL;
+    if (sb->s_rev_level == 0)
+        return 0;
+
+    if (sb->s_inode_size < EXT2_GOOD_OLD_INODE_SIZE ||
+        sb->s_inode_size > block_size ||
+        (sb->s_inode_size & (sb->s_inode_size - 1)))
+        return -EINVAL;
+    uint32_t incompat = sb->s_feature_incompat & ~EXT2_SUPPORTED_INCOMPAT;
+    uint32_t ro_compat = sb->s_feature_ro_compat & ~EXT2_SUPPORTED_RO_COMPAT;
+    if (incompat || ro_compat) {
+        kprintf("ext2: unsupported features (incompat 0x%x, ro_compat 0x%x)\n",
+                incompat, ro_compat);
+        return -ENOTSUP;
+    }
+    return 0;
+}
+
+struct inode* ext2_mount(struct block_device* dev) {
+    if (atomic_exchange(&dev->mounted, true))
+        return ERR_PTR(-EBUSY);
+
+    int rc = 0;
+    ext2_fs* fs = kmalloc(sizeof(ext2_fs));
+    if (!fs) {
+        rc = -ENOMEM;
+        goto fail;
+    }
+    *fs = (ext2_fs){.dev = dev};
+
+    struct buffer* buf = buffer_get(dev, 0);
+    if (IS_ERR(buf)) {
+        rc = PTR_ERR(buf);
+        goto fail;
+    }
+    memcpy(&fs->sb, buf->data + EXT2_SUPERBLOCK_OFFSET,
+           sizeof(struct ext2_superblock));
+    buffer_put(buf);
+
+    struct ext2_superblock* sb = &fs->sb;
+    rc = check_superblock(sb);
+    if (IS_ERR(rc))
+        goto fail;
+
+    fs->block_size = 1024 << sb->s_log_block_size;
+    fs->blocks_per_buffer = BUFFER_SIZE / fs->block_size;
+    fs->num_groups = div_ceil(sb->s_blocks_count - sb->s_first_data_block,
+                              sb->s_blocks_per_group);
+    fs->gdt_block = sb->s_first_data_block + 1;
+    if (sb->s_rev_level == 0) {
+        fs->inode_size = EXT2_GOOD_OLD_INODE_SIZE;
+        fs->first_ino = EXT2_GOOD_OLD_FIRST_INO;
+    } else {
+        fs->inode_size = sb->s_inode_size;
+        fs->first_ino = sb->s_first_ino;
+        fs->has_filetype =
+            sb->s_feature_incompat & EXT2_FEATURE_INCOMPAT_FILETYPE;
+        fs->has_dir_index =
+            sb->s_feature_compat & EXT2_FEATURE_COMPAT_DIR_INDEX;
+    }
+    fs->unsigned_hash = sb->s_flags & EXT2_FLAGS_UNSIGNED_HASH;
+    if ((uint64_t)fs->num_groups * sb->s_inodes_per_group <
+            sb->s_inodes_count ||
+        (uint64_t)sb->s_blocks_count * fs->block_size / SECTOR_SIZE >
+            dev->num_sectors) {
+        rc = -EINVAL;
+        goto fail;
+    }
+
+    size_t gdt_size = fs->num_groups * sizeof(struct ext2_group_desc);
+    fs->groups = kmalloc(gdt_size);
+    if (!fs->groups) {
+        rc = -ENOMEM;
+        goto fail;
+    }
+    for (size_t offset = 0; offset < gdt_size; offset += fs->block_size) {
+        unsigned char* data =
+            get_block(fs, fs->gdt_block + offset / fs->block_size, &buf);
+        if (IS_ERR(data)) {
+            rc = PTR_ERR(data);
+            goto fail;
+        }
+        memcpy((unsigned char*)fs->groups + offset, data,
+               MIN(fs->block_size, gdt_size - offset));
+        buffer_put(buf);
+    }
+
+    struct inode* root = iget(fs, EXT2_ROOT_INO);
+    if (IS_ERR(root)) {
+        rc = PTR_ERR(root);
+        goto fail;
+    }
+    fs->root = root;
+    if (!S_ISDIR(root->mode)) {
+        // dropping the root tears down the file system
+        inode_unref(root);
+        return ERR_PTR(-EINVAL);
+    }
+
+    ++sb->s_mnt_count;
+    sb->s_mtime = now();
+    mutex_lock(&fs->lock);
+    write_super(fs);
+    mutex_unlock(&fs->lock);
+
+    kprintf("ext2: mounted /dev/%s (%u KiB blocks, %u groups%s)\n", dev->name,
+            fs->block_size / 1024, fs->num_groups,
+            fs->has_dir_index ? ", hashed directories" : "");
+    return root;
+
+fail:
+    if (fs) {
+        kfree(fs->groups);
+        kfree(fs);
+    }
+    dev->mounted = false;
+    return ERR_PTR(rc);
+}
@@ -39,6 +39,7 @@
 
 #include "fs.h"
 #include <kernel/api/fcntl.h>
+#include <kernel/api/poll.h>
 #include <kernel/api/signum.h>
 #include <kernel/panic.h>
 #include <kernel/process.h>
@@ -79,6 +80,7 @@ static int fifo_close(file_description* desc) {
         --fifo->num_readers;
     if (desc->flags & O_WRONLY)
         --fifo->num_writers;
+    inode_notify(desc->inode);
     return 0;
 }
 
@@ -100,6 +102,7 @@ static ssize_t fifo_read(file_description* desc, void* buffer, size_t count) {
         if (!ring_buf_is_empty(buf)) {
             ssize_t nread = ring_buf_read(buf, buffer, count);
             mutex_unlock(&buf->lock);
+            inode_notify(desc->inode);
             return nread;
         }
 
@@ -141,10 +144,29 @@ static ssize_t fifo_write(file_description* desc, const void* buffer,
 
         ssize_t nwritten = ring_buf_write(buf, buffer, count);
         mutex_unlock(&buf->lock);
+        inode_notify(desc->inode);
         return nwritten;
     }
 }
 
+static short fifo_poll(file_description* desc, short events) {
+    const struct fifo* fifo = (const struct fifo*)desc->inode;
+    short revents = 0;
+    if (desc->flags & O_RDONLY) {
+        if ((events & POLLIN) && !ring_buf_is_empty(&fifo->buf))
+            revents |= POLLIN;
+        if (fifo->num_writers == 0)
+            revents |= POLLHUP;
+    }
+    if (desc->flags & O_WRONLY) {
+        if ((events & POLLOUT) && !ring_buf_is_full(&fifo->buf))
+            revents |= POLLOUT;
+        if (fifo->num_readers == 0)
+            revents |= POLLERR;
+    }
+    return revents;
+}
+
 struct inode* fifo_create(void) {
     struct fifo* fifo = kmalloc(sizeof(struct fifo));
     if (!fifo)
@@ -160,7 +182,8 @@ struct inode* fifo_create(void) {
                             .open = fifo_open,
                             .close = fifo_close,
                             .read = fifo_read,
-                            .write = fifo_write};
+                            .write = fifo_write,
+                            .poll = fifo_poll};
     inode->fops = &fops;
     inode->mode = S_IFIFO;
     inode->ref_count = 1;
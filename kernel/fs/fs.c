@@ -38,10 +38,14 @@
  */
 
 #include "fs.h"
+#include "dcache.h"
 #include <common/string.h>
 #include <kernel/api/dirent.h>
 #include <kernel/api/fcntl.h>
+#include <kernel/api/poll.h>
 #include <kernel/api/stdio.h>
+#include <kernel/boot_defs.h>
+#include <kernel/exec_cache.h>
 #include <kernel/lock.h>
 #include <kernel/memory/memory.h>
 #include <kernel/panic.h>
@@ -97,6 +101,8 @@ void inode_unref(struct inode* inode) {
 void inode_destroy(struct inode* inode) {
     ASSERT(inode->ref_count == 0 && inode->num_links == 0);
     ASSERT(inode->fops->destroy_inode);
+    if (inode->fops->cache_pages)
+        page_cache_destroy(inode);
     inode->fops->destroy_inode(inode);
 }
 
@@ -105,7 +111,24 @@ struct inode* inode_lookup_child(struct inode* inode, const char* name) {
         inode_unref(inode);
         return ERR_PTR(-ENOTDIR);
     }
-    return inode->fops->lookup_child(inode, name);
+    if (!inode->fops->cache_lookups)
+        return inode->fops->lookup_child(inode, name);
+
+    struct inode* child = dcache_lookup(inode, name);
+    if (child) {
+        inode_unref(inode);
+        return child;
+    }
+
+    size_t generation = dcache_generation();
+    inode_ref(inode);
+    child = inode->fops->lookup_child(inode, name);
+    if (IS_OK(child))
+        dcache_insert(inode, name, child, generation);
+    else if (PTR_ERR(child) == -ENOENT)
+        dcache_insert(inode, name, NULL, generation);
+    inode_unref(inode);
+    return child;
 }
 
 struct inode* inode_create_child(struct inode* inode, const char* name, mode_t mode) {
@@ -114,9 +137,18 @@ struct inode* inode_create_child(struct inode* inode, const char* name, mode_t m
         return ERR_PTR(-ENOTDIR);
     }
     ASSERT(mode & S_IFMT);
+    inode_ref(inode);
     struct inode* child = inode->fops->create_child(inode, name, mode);
-    if (IS_ERR(child))
+    if (IS_ERR(child)) {
+        inode_unref(inode);
         return child;
+    }
+    if (inode->fops->cache_lookups) {
+        // replace the negative entry left by the lookup that preceded this
+        dcache_invalidate(inode, name);
+        dcache_insert(inode, name, child, dcache_generation());
+    }
+    inode_unref(inode);
     return child;
 }
 
@@ -132,14 +164,14 @@ int inode_link_child(struct inode* inode, const char* name,
         inode_unref(child);
         return -EXDEV;
     }
+    inode_ref(inode);
     inode_ref(child);
     int rc = inode->fops->link_child(inode, name, child);
-    if (IS_ERR(rc)) {
-        inode_unref(child);
-        return rc;
-    }
+    if (IS_OK(rc) && inode->fops->cache_lookups)
+        dcache_invalidate(inode, name);
+    inode_unref(inode);
     inode_unref(child);
-    return 0;
+    return rc;
 }
 
 int inode_unlink_child(struct inode* inode, const char* name) {
@@ -147,9 +179,19 @@ int inode_unlink_child(struct inode* inode, const char* name) {
         inode_unref(inode);
         return -ENOTDIR;
     }
+    inode_ref(inode);
     struct inode* child = inode->fops->unlink_child(inode, name);
-    if (IS_ERR(child))
+    if (IS_ERR(child)) {
+        inode_unref(inode);
         return PTR_ERR(child);
+    }
+    if (inode->fops->cache_lookups) {
+        dcache_invalidate(inode, name);
+        // entries under a removed directory would keep it alive
+        if (S_ISDIR(child->mode))
+            dcache_invalidate_dir(child);
+    }
+    inode_unref(inode);
     inode_unref(child);
     return 0;
 }
@@ -188,6 +230,7 @@ int inode_stat(struct inode* inode, struct stat* buf) {
     buf->st_mode = inode->mode;
     buf->st_nlink = inode->num_links;
     buf->st_size = 0;
+    buf->st_blocks = 0;
     inode_unref(inode);
     return 0;
 }
@@ -196,12 +239,15 @@ int file_description_close(file_description* desc) {
     ASSERT(desc->ref_count > 0);
     if (--desc->ref_count > 0)
         return 0;
+    epoll_forget(desc);
     struct inode* inode = desc->inode;
     if (inode->fops->close) {
         int rc = inode->fops->close(desc);
         if (IS_ERR(rc))
             return rc;
     }
+    if (desc->path)
+        kfree(desc->path);
     kfree(desc);
     inode_unref(inode);
     return 0;
@@ -212,10 +258,27 @@ ssize_t file_description_read(file_description* desc, void* buffer,
     struct inode* inode = desc->inode;
     if (S_ISDIR(inode->mode))
         return -EISDIR;
-    if (!inode->fops->read)
+    if (!inode->fops->read && !inode->fops->cache_pages)
         return -EINVAL;
     if (!(desc->flags & O_RDONLY))
         return -EBADF;
+    if (inode->fops->cache_pages || !S_ISREG(inode->mode)) {
+        // devices copy into the buffer with interrupts disabled, where
+        // page faults can't be resolved. the page cache copies with the
+        // mapping lock held, and a fault on a mapping of another file would
+        // take that file's lock as well.
+        int rc = vm_populate((uintptr_t)buffer, count, true);
+        if (IS_ERR(rc))
+            return rc;
+    }
+    if (inode->fops->cache_pages) {
+        mutex_lock(&desc->offset_lock);
+        ssize_t nread = page_cache_read(inode, buffer, count, desc->offset);
+        if (IS_OK(nread))
+            desc->offset += nread;
+        mutex_unlock(&desc->offset_lock);
+        return nread;
+    }
     return inode->fops->read(desc, buffer, count);
 }
 
@@ -224,24 +287,84 @@ ssize_t file_description_write(file_description* desc, const void* buffer,
     struct inode* inode = desc->inode;
     if (S_ISDIR(inode->mode))
         return -EISDIR;
-    if (!inode->fops->write)
+    if (!inode->fops->write && !inode->fops->cache_pages)
         return -EINVAL;
     if (!(desc->flags & O_WRONLY))
         return -EBADF;
-    return inode->fops->write(desc, buffer, count);
+    if (inode->fops->cache_pages) {
+        // the buffer is faulted in before the mapping lock is taken, as in
+        // file_description_read()
+        int rc = vm_populate((uintptr_t)buffer, count, false);
+        if (IS_ERR(rc))
+            return rc;
+        mutex_lock(&desc->offset_lock);
+        ssize_t nwritten =
+            page_cache_write(inode, buffer, count, desc->offset);
+        if (IS_OK(nwritten))
+            desc->offset += nwritten;
+        mutex_unlock(&desc->offset_lock);
+        exec_cache_invalidate(inode);
+        return nwritten;
+    }
+    if (!S_ISREG(inode->mode)) {
+        int rc = vm_populate((uintptr_t)buffer, count, false);
+        if (IS_ERR(rc))
+            return rc;
+        return inode->fops->write(desc, buffer, count);
+    }
+    ssize_t nwritten = inode->fops->write(desc, buffer, count);
+    exec_cache_invalidate(inode);
+    return nwritten;
+}
+
+// reads and writes at the given offset by temporarily moving the file offset.
+// offset_lock is recursive, so the read/write implementations can still take
+// it themselves.
+ssize_t file_description_pread(file_description* desc, void* buffer,
+                               size_t count, off_t offset) {
+    mode_t mode = desc->inode->mode;
+    if (S_ISFIFO(mode) || S_ISSOCK(mode))
+        return -ESPIPE;
+    if (offset < 0)
+        return -EINVAL;
+    mutex_lock(&desc->offset_lock);
+    off_t saved_offset = desc->offset;
+    desc->offset = offset;
+    ssize_t rc = file_description_read(desc, buffer, count);
+    desc->offset = saved_offset;
+    mutex_unlock(&desc->offset_lock);
+    return rc;
+}
+
+ssize_t file_description_pwrite(file_description* desc, const void* buffer,
+                                size_t count, off_t offset) {
+    mode_t mode = desc->inode->mode;
+    if (S_ISFIFO(mode) || S_ISSOCK(mode))
+        return -ESPIPE;
+    if (offset < 0)
+        return -EINVAL;
+    mutex_lock(&desc->offset_lock);
+    off_t saved_offset = desc->offset;
+    desc->offset = offset;
+    ssize_t rc = file_description_write(desc, buffer, count);
+    desc->offset = saved_offset;
+    mutex_unlock(&desc->offset_lock);
+    return rc;
 }
 
 uintptr_t file_description_mmap(file_description* desc, uintptr_t addr,
                                 size_t length, off_t offset,
                                 uint16_t page_flags) {
     struct inode* inode = desc->inode;
-    if (!inode->fops->mmap)
+    if (!inode->fops->mmap && !inode->fops->cache_pages)
         return -ENODEV;
     if (!(desc->flags & O_RDONLY))
         return -EACCES;
     if ((page_flags & PAGE_SHARED) && (page_flags & PAGE_WRITE) &&
         ((desc->flags & O_RDWR) != O_RDWR))
         return -EACCES;
+    if (inode->fops->cache_pages)
+        return page_cache_mmap(inode, addr, length, offset, page_flags);
     return inode->fops->mmap(desc, addr, length, offset, page_flags);
 }
 
@@ -249,11 +372,54 @@ int file_description_truncate(file_description* desc, off_t length) {
     struct inode* inode = desc->inode;
     if (S_ISDIR(inode->mode))
         return -EISDIR;
-    if (!inode->fops->truncate)
+    if (!inode->fops->truncate && !inode->fops->cache_pages)
         return -EROFS;
     if (!(desc->flags & O_WRONLY))
         return -EBADF;
-    return inode->fops->truncate(desc, length);
+    int rc = inode->fops->cache_pages ? page_cache_truncate(inode, length)
+                                      : inode->fops->truncate(desc, length);
+    exec_cache_invalidate(inode);
+    return rc;
+}
+
+int file_description_fallocate(file_description* desc, int mode,
+                               off_t offset, off_t length) {
+    if (offset < 0 || length <= 0)
+        return -EINVAL;
+    if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE))
+        return -ENOTSUP;
+    // a hole never changes the size of the file
+    if ((mode & FALLOC_FL_PUNCH_HOLE) && !(mode & FALLOC_FL_KEEP_SIZE))
+        return -ENOTSUP;
+    if (length > INT32_MAX - offset)
+        return -EFBIG;
+
+    struct inode* inode = desc->inode;
+    if (!(desc->flags & O_WRONLY))
+        return -EBADF;
+    if (S_ISDIR(inode->mode))
+        return -EISDIR;
+    if (!S_ISREG(inode->mode))
+        return -ENODEV;
+    if (!inode->fops->fallocate && !inode->fops->cache_pages)
+        return -ENOTSUP;
+    int rc = inode->fops->cache_pages
+                 ? page_cache_fallocate(inode, mode, offset, length)
+                 : inode->fops->fallocate(desc, mode, offset, length);
+    exec_cache_invalidate(inode);
+    return rc;
+}
+
+int file_description_fsync(file_description* desc) {
+    // files without an fsync op have nothing that isn't already in place
+    if (!desc->inode->fops->fsync)
+        return 0;
+    return desc->inode->fops->fsync(desc);
+}
+
+int file_description_stat(file_description* desc, struct stat* buf) {
+    inode_ref(desc->inode);
+    return inode_stat(desc->inode, buf);
 }
 
 off_t file_description_lseek(file_description* desc, off_t offset, int whence) {
@@ -268,8 +434,7 @@ off_t file_description_lseek(file_description* desc, off_t offset, int whence) {
         break;
     case SEEK_END: {
         struct stat stat;
-        inode_ref(desc->inode);
-        int rc = inode_stat(desc->inode, &stat);
+        int rc = file_description_stat(desc, &stat);
         if (IS_ERR(rc))
             return rc;
         new_offset = stat.st_size + offset;
@@ -304,18 +469,18 @@ struct getdents_ctx {
 static bool getdents_callback(struct getdents_ctx* ctx, const char* name,
                               uint8_t type) {
     size_t name_len = strlen(name);
-    size_t name_size = name_len + 1;
-    size_t size = offsetof(struct dirent, d_name) + name_size;
+    size_t size = offsetof(struct dirent, d_name) + name_len + 1;
     if (ctx->remaining_count < size) {
         ctx->buffer_is_too_small = true;
         return false;
     }
 
+    // the entry is written straight into the caller's buffer
     struct dirent* dent = (struct dirent*)ctx->dirp;
     dent->d_type = type;
     dent->d_reclen = size;
     dent->d_namlen = name_len;
-    strlcpy(dent->d_name, name, name_size);
+    memcpy(dent->d_name, name, name_len + 1);
 
     ctx->dirp += size;
     ctx->remaining_count -= size;
@@ -342,6 +507,184 @@ long file_description_getdents(file_description* desc, void* dirp,
     return ctx.nwritten;
 }
 
+short file_description_poll(file_description* desc, short events) {
+    struct inode* inode = desc->inode;
+    // errors and hangups are reported even if they were not requested
+    events |= POLLERR | POLLHUP;
+    if (!inode->fops->poll) {
+        // files without a wake-up source never block
+        return events & (POLLIN | POLLOUT);
+    }
+    return inode->fops->poll(desc, events) & events;
+}
+
+struct splice_dest {
+    file_description* desc;
+    off_t* offset;
+};
+
+static ssize_t write_to_splice_dest(void* ctx, const void* data,
+                                    size_t count) {
+    struct splice_dest* dest = ctx;
+    const unsigned char* src = data;
+    size_t total = 0;
+    while (total < count) {
+        ssize_t nwritten;
+        if (dest->offset)
+            nwritten = file_description_pwrite(dest->desc, src + total,
+                                               count - total, *dest->offset);
+        else
+            nwritten =
+                file_description_write(dest->desc, src + total, count - total);
+        if (IS_ERR(nwritten))
+            return total > 0 ? (ssize_t)total : nwritten;
+        if (nwritten == 0)
+            return total > 0 ? (ssize_t)total : -EIO;
+        if (dest->offset)
+            *dest->offset += nwritten;
+        total += nwritten;
+    }
+    return total;
+}
+
+// fallback for files that keep their data somewhere splice_read can't hand
+// out (ring buffers, devices). the data still never reaches user memory.
+static ssize_t splice_through_kernel_buf(file_description* in,
+                                         off_t* in_offset,
+                                         struct splice_dest* dest,
+                                         size_t count) {
+    unsigned char* buf = kmalloc(PAGE_SIZE);
+    if (!buf)
+        return -ENOMEM;
+
+    ssize_t rc = 0;
+    size_t total = 0;
+    while (total < count) {
+        size_t to_read = MIN(count - total, PAGE_SIZE);
+        ssize_t nread;
+        if (in_offset)
+            nread = file_description_pread(in, buf, to_read, *in_offset);
+        else
+            nread = file_description_read(in, buf, to_read);
+        if (IS_ERR(nread)) {
+            rc = nread;
+            break;
+        }
+        if (nread == 0)
+            break;
+        if (in_offset)
+            *in_offset += nread;
+
+        ssize_t nwritten = write_to_splice_dest(dest, buf, nread);
+        if (IS_ERR(nwritten)) {
+            rc = nwritten;
+            break;
+        }
+        total += nwritten;
+        if (nwritten < nread) {
+            // the rest stays in the file if it is read at an offset
+            if (in_offset)
+                *in_offset -= nread - nwritten;
+            break;
+        }
+
+        // a short read means no more data is available right now, so don't
+        // block waiting for more
+        if ((size_t)nread < to_read)
+            break;
+    }
+
+    kfree(buf);
+    return total > 0 ? (ssize_t)total : rc;
+}
+
+ssize_t file_description_splice(file_description* in, off_t* in_offset,
+                                file_description* out, off_t* out_offset,
+                                size_t count) {
+    if (in->inode == out->inode)
+        return -EINVAL;
+    if (!(in->flags & O_RDONLY) || !(out->flags & O_WRONLY))
+        return -EBADF;
+
+    struct splice_dest dest = {.desc = out, .offset = out_offset};
+    splice_read_fn splice_read = in->inode->fops->cache_pages
+                                     ? page_cache_splice_read
+                                     : in->inode->fops->splice_read;
+    if (!splice_read)
+        return splice_through_kernel_buf(in, in_offset, &dest, count);
+
+    if (in_offset) {
+        if (*in_offset < 0)
+            return -EINVAL;
+        ssize_t nwritten = splice_read(in, *in_offset, count,
+                                       write_to_splice_dest, &dest);
+        if (IS_OK(nwritten))
+            *in_offset += nwritten;
+        return nwritten;
+    }
+
+    mutex_lock(&in->offset_lock);
+    ssize_t nwritten =
+        splice_read(in, in->offset, count, write_to_splice_dest, &dest);
+    if (IS_OK(nwritten))
+        in->offset += nwritten;
+    mutex_unlock(&in->offset_lock);
+    return nwritten;
+}
+
+// files in the page cache share their pages instead of copying them. other
+// files are copied through splice, which never copies into user memory.
+static ssize_t copy_file_range(file_description* in, off_t* in_offset,
+                               file_description* out, off_t* out_offset,
+                               size_t count) {
+    struct inode* in_inode = in->inode;
+    struct inode* out_inode = out->inode;
+    if (*in_offset < 0 || *out_offset < 0)
+        return -EINVAL;
+    if (count > (size_t)(INT32_MAX - *out_offset))
+        return -EFBIG;
+    if (in_inode == out_inode && *in_offset < *out_offset + (off_t)count &&
+        *out_offset < *in_offset + (off_t)count)
+        return -EINVAL;
+
+    if (!in_inode->fops->cache_pages || !out_inode->fops->cache_pages)
+        return file_description_splice(in, in_offset, out, out_offset, count);
+
+    ssize_t ncopied = page_cache_copy_range(out_inode, *out_offset, in_inode,
+                                            *in_offset, count);
+    if (IS_OK(ncopied)) {
+        *in_offset += ncopied;
+        *out_offset += ncopied;
+    }
+    exec_cache_invalidate(out_inode);
+    return ncopied;
+}
+
+ssize_t file_description_copy_file_range(file_description* in,
+                                         off_t* in_offset,
+                                         file_description* out,
+                                         off_t* out_offset, size_t count) {
+    if (!(in->flags & O_RDONLY) || !(out->flags & O_WRONLY))
+        return -EBADF;
+    if (S_ISDIR(in->inode->mode) || S_ISDIR(out->inode->mode))
+        return -EISDIR;
+    if (!S_ISREG(in->inode->mode) || !S_ISREG(out->inode->mode))
+        return -EINVAL;
+
+    // the offset locks are taken in a fixed order so that copies in
+    // opposite directions don't deadlock. they are recursive, so in and out
+    // may be the same description.
+    file_description* first = in < out ? in : out;
+    file_description* second = in < out ? out : in;
+    mutex_lock(&first->offset_lock);
+    mutex_lock(&second->offset_lock);
+    ssize_t rc = copy_file_range(in, in_offset ? in_offset : &in->offset, out,
+                                 out_offset ? out_offset : &out->offset, count);
+    mutex_unlock(&second->offset_lock);
+    mutex_unlock(&first->offset_lock);
+    return rc;
+}
+
 int file_description_block(file_description* desc,
                            bool (*should_unblock)(file_description*)) {
     if ((desc->flags & O_NONBLOCK) && !should_unblock(desc))
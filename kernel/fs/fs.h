@@ -44,6 +44,7 @@
 #include <kernel/api/sys/types.h>
 #include <kernel/forward.h>
 #include <kernel/lock.h>
+#include <kernel/memory/memory.h>
 #include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -51,6 +52,7 @@
 #define PATH_SEPARATOR '/'
 #define PATH_SEPARATOR_STR "/"
 #define ROOT_DIR PATH_SEPARATOR_STR
+#define PATH_MAX 1024 // including the terminating null character
 
 #define OPEN_MAX 1024
 
@@ -60,6 +62,7 @@ typedef struct file_description {
     atomic_int flags;
     off_t offset;
     void* private_data;
+    char* path; // canonical path of a directory, used to resolve ".."
     atomic_size_t ref_count;
 } file_description;
 
@@ -82,6 +85,8 @@ typedef int (*link_child_fn)(struct inode*, const char* name,
                              struct inode* child);
 typedef struct inode* (*unlink_child_fn)(struct inode*, const char* name);
 typedef int (*stat_fn)(struct inode*, struct stat* buf);
+// fills page number index of the file from wherever the file system keeps it
+typedef int (*readpage_fn)(struct inode*, size_t index, void* page);
 
 typedef int (*open_fn)(file_description*, int flags, mode_t mode);
 typedef int (*close_fn)(file_description*);
@@ -91,7 +96,23 @@ typedef ssize_t (*write_fn)(file_description*, const void* buffer,
 typedef uintptr_t (*mmap_fn)(file_description*, uintptr_t addr, size_t length,
                              off_t offset, uint16_t page_flags);
 typedef int (*truncate_fn)(file_description*, off_t length);
+typedef int (*fallocate_fn)(file_description*, int mode, off_t offset,
+                            off_t length);
 typedef int (*ioctl_fn)(file_description*, int request, void* argp);
+// writes the data of the file that is only in memory to the device
+typedef int (*fsync_fn)(file_description*);
+
+// reports which of the requested events are ready without blocking. this is
+// called from the scheduler with interrupts disabled to decide whether a
+// process blocked in poll() should wake up, so it must not take mutexes.
+typedef short (*poll_fn)(file_description*, short events);
+
+typedef ssize_t (*splice_actor_fn)(void* ctx, const void* data, size_t count);
+// passes up to count bytes of the file starting at offset to actor straight
+// from where the file system keeps them, so they are not copied twice.
+typedef ssize_t (*splice_read_fn)(file_description*, off_t offset,
+                                  size_t count, splice_actor_fn actor,
+                                  void* ctx);
 
 struct getdents_ctx;
 typedef bool (*getdents_callback_fn)(struct getdents_ctx*, const char* name,
@@ -114,10 +135,36 @@ typedef struct file_ops {
     write_fn write;
     mmap_fn mmap;
     truncate_fn truncate;
+    fallocate_fn fallocate;
     ioctl_fn ioctl;
+    fsync_fn fsync;
     getdents_fn getdents;
+    poll_fn poll;
+    splice_read_fn splice_read;
+
+    // lookup_child results of directories with these ops may be kept in the
+    // dentry cache. only file systems that report every change to their
+    // directories through the inode_*_child functions can set this.
+    bool cache_lookups;
+
+    // reads, writes, mmap, splice, truncate and fallocate of files with these
+    // ops are served from the inode's page cache, and the per-file ops above
+    // are not used for them. missing pages are filled by readpage, or read as
+    // zeros if the file system has no backing store and leaves readpage NULL.
+    bool cache_pages;
+    readpage_fn readpage;
 } file_ops;
 
+struct epoll_watch;
+struct epoll_event;
+
+// the pages of a file that are in memory
+struct address_space {
+    mutex lock;
+    page_tree pages;
+    atomic_size_t size; // size of the file
+};
+
 struct inode {
     struct inode* fs_root_inode;
     file_ops* fops;
@@ -126,6 +173,12 @@ struct inode {
     _Atomic(nlink_t) num_links;
     atomic_size_t ref_count;
     mode_t mode;
+    struct epoll_watch* watchers; // epoll instances interested in this inode
+    struct address_space mapping; // only used if fops->cache_pages is set
+
+    // root of the file system (or the directory, for a bind mount) mounted
+    // on this directory. path walks only take the mount lock if it is set.
+    _Atomic(struct inode*) mounted;
 };
 
 void inode_ref(struct inode*);
@@ -146,21 +199,70 @@ NODISCARD ssize_t file_description_read(file_description*, void* buffer,
                                         size_t count);
 NODISCARD ssize_t file_description_write(file_description*, const void* buffer,
                                          size_t count);
+NODISCARD ssize_t file_description_pread(file_description*, void* buffer,
+                                         size_t count, off_t offset);
+NODISCARD ssize_t file_description_pwrite(file_description*,
+                                          const void* buffer, size_t count,
+                                          off_t offset);
 NODISCARD uintptr_t file_description_mmap(file_description*, uintptr_t addr,
                                           size_t length, off_t offset,
                                           uint16_t page_flags);
 NODISCARD int file_description_truncate(file_description*, off_t length);
+NODISCARD int file_description_fallocate(file_description*, int mode,
+                                         off_t offset, off_t length);
+NODISCARD int file_description_fsync(file_description*);
+NODISCARD int file_description_stat(file_description*, struct stat* buf);
 NODISCARD off_t file_description_lseek(file_description*, off_t offset,
                                        int whence);
 NODISCARD int file_description_ioctl(file_description*, int request,
                                      void* argp);
 NODISCARD long file_description_getdents(file_description*, void* dirp,
                                          unsigned int count);
+short file_description_poll(file_description*, short events);
+NODISCARD ssize_t file_description_splice(file_description* in,
+                                          off_t* in_offset,
+                                          file_description* out,
+                                          off_t* out_offset, size_t count);
+NODISCARD ssize_t file_description_copy_file_range(file_description* in,
+                                                   off_t* in_offset,
+                                                   file_description* out,
+                                                   off_t* out_offset,
+                                                   size_t count);
+
+NODISCARD ssize_t page_cache_read(struct inode*, void* buffer, size_t count,
+                                  off_t offset);
+NODISCARD ssize_t page_cache_write(struct inode*, const void* buffer,
+                                   size_t count, off_t offset);
+// fills count bytes at dest. returning less than count ends the write.
+typedef ssize_t (*page_cache_fill_fn)(void* ctx, void* dest, size_t count);
+NODISCARD ssize_t page_cache_fill(struct inode*, off_t offset, size_t count,
+                                  page_cache_fill_fn fill, void* ctx);
+NODISCARD uintptr_t page_cache_mmap(struct inode*, uintptr_t addr,
+                                    size_t length, off_t offset,
+                                    uint16_t page_flags);
+NODISCARD ssize_t page_cache_splice_read(file_description*, off_t offset,
+                                         size_t count, splice_actor_fn actor,
+                                         void* ctx);
+NODISCARD int page_cache_truncate(struct inode*, off_t length);
+NODISCARD int page_cache_fallocate(struct inode*, int mode, off_t offset,
+                                   off_t length);
+// whole pages are shared between the files until either writes to them
+NODISCARD ssize_t page_cache_copy_range(struct inode* dest, off_t dest_offset,
+                                        struct inode* src, off_t src_offset,
+                                        size_t count);
+// makes the physical page a read-only page of the file without copying it.
+// the file gets its own copy of the page when it is first written to.
+NODISCARD int page_cache_lend_page(struct inode*, size_t index,
+                                   uintptr_t physical_addr);
+void page_cache_destroy(struct inode*);
 
 NODISCARD int file_description_block(file_description*,
                                      bool (*should_unblock)(file_description*));
 
-NODISCARD int vfs_mount(const char* path, struct inode* fs_root);
+// mounts guest on the directory at the absolute path. guest is usually the
+// root of a file system, or any directory for a bind mount.
+NODISCARD int vfs_mount(const char* path, struct inode* guest);
+NODISCARD int vfs_umount(const char* path);
 struct inode* vfs_get_root(void);
 NODISCARD int vfs_register_device(struct inode* device);
 NODISCARD file_description* vfs_open(const char* pathname, int flags,
@@ -171,11 +273,44 @@ char* vfs_canonicalize_path(const char* pathname);
 struct inode* vfs_resolve_path(const char* pathname, struct inode** out_parent,
                                char** out_basename);
 
+// the *_at variants resolve relative paths from the directory base instead
+// of the working directory. base may be NULL for the working directory.
+NODISCARD file_description* vfs_open_at(file_description* base,
+                                        const char* pathname, int flags,
+                                        mode_t mode);
+NODISCARD int vfs_stat_at(file_description* base, const char* pathname,
+                          struct stat* buf);
+NODISCARD struct inode* vfs_create_at(file_description* base,
+                                      const char* pathname, mode_t mode);
+struct inode* vfs_resolve_path_at(file_description* base,
+                                  const char* pathname,
+                                  struct inode** out_parent,
+                                  char** out_basename);
+
 uint8_t mode_to_dirent_type(mode_t);
 
 struct inode* fifo_create(void);
 
+struct inode* epoll_create(void);
+NODISCARD int epoll_ctl(file_description* epoll, int op, int fd,
+                        file_description* target,
+                        const struct epoll_event* event);
+NODISCARD int epoll_wait(file_description* epoll, struct epoll_event* events,
+                         int maxevents, int timeout);
+
+// tells epoll instances watching the inode that its readiness may have
+// changed. safe to call with interrupts disabled.
+void inode_notify(struct inode*);
+void epoll_forget(file_description*);
+
 void initrd_populate_root_fs(uintptr_t physical_addr, size_t size);
 
 struct inode* tmpfs_create_root(void);
 struct inode* procfs_create_root(void);
+// drops what procfs keeps about a process that was reaped
+void procfs_forget_pid(pid_t);
+
+struct block_device;
+
+// reads the ext2 file system on the device and returns its root directory
+NODISCARD struct inode* ext2_mount(struct block_device*);
@@ -42,8 +42,11 @@
 #include <common/string.h>
 #include <kernel/api/fcntl.h>
 #include <kernel/boot_defs.h>
+#include <kernel/kprintf.h>
+#include <kernel/lz4.h>
 #include <kernel/memory/memory.h>
 #include <kernel/panic.h>
+#include <kernel/system.h>
 
 struct cpio_odc_header {
     char c_magic[6];
@@ -71,18 +74,56 @@ static size_t parse_octal(const char* s, size_t len) {
 
 #define PARSE(field) parse_octal(field, sizeof(field))
 
-void initrd_populate_root_fs(uintptr_t paddr, size_t size) {
-    uintptr_t region_start = round_down(paddr, PAGE_SIZE);
-    uintptr_t region_end = paddr + size;
-    size_t region_size = region_end - region_start;
+struct initrd_stats {
+    size_t lent_pages;
+    size_t copied_bytes;
+};
 
-    uintptr_t vaddr =
-        range_allocator_alloc(&kernel_vaddr_allocator, region_size);
-    ASSERT_OK(vaddr);
-    ASSERT_OK(
-        paging_map_to_physical_range(vaddr, region_start, region_size, 0));
+// creates the file or directory described by the header. returns the opened
+// file if it has data to be filled in.
+static file_description* create_entry(const struct cpio_odc_header* header,
+                                      const char* filename) {
+    size_t mode = PARSE(header->c_mode);
+    if (S_ISDIR(mode)) {
+        ASSERT_OK(vfs_create(filename, mode));
+        return NULL;
+    }
+
+    file_description* desc =
+        vfs_open(filename, O_CREAT | O_EXCL | O_WRONLY, mode);
+    ASSERT_OK(desc);
+    desc->inode->device_id = PARSE(header->c_rdev);
+    return desc;
+}
+
+// the archive is built by tools/mkinitrd, which places the data of files
+// spanning at least a page on page boundaries. the whole pages of such files
+// are lent to the page cache as they are, and only the rest gets copied.
+static void populate_file(file_description* desc, uintptr_t data_paddr,
+                          const unsigned char* data, size_t size,
+                          struct initrd_stats* stats) {
+    size_t num_lent_pages = 0;
+    if (data_paddr % PAGE_SIZE == 0) {
+        num_lent_pages = size / PAGE_SIZE;
+        ASSERT_OK(file_description_truncate(desc, size));
+        for (size_t i = 0; i < num_lent_pages; ++i)
+            ASSERT_OK(page_cache_lend_page(desc->inode, i,
+                                           data_paddr + i * PAGE_SIZE));
+        stats->lent_pages += num_lent_pages;
+    }
 
-    uintptr_t cursor = vaddr + (paddr - region_start);
+    for (size_t count = num_lent_pages * PAGE_SIZE; count < size;) {
+        ssize_t nwritten =
+            file_description_pwrite(desc, data + count, size - count, count);
+        ASSERT_OK(nwritten);
+        count += nwritten;
+        stats->copied_bytes += nwritten;
+    }
+}
+
+static void populate_from_archive(uintptr_t vaddr, uintptr_t paddr,
+                                  struct initrd_stats* stats) {
+    uintptr_t cursor = vaddr;
     for (;;) {
         const struct cpio_odc_header* header =
             (const struct cpio_odc_header*)cursor;
@@ -94,35 +135,123 @@ void initrd_populate_root_fs(uintptr_t paddr, size_t size) {
         if (!strncmp(filename, "TRAILER!!!", name_size))
             break;
 
-        size_t mode = PARSE(header->c_mode);
         size_t file_size = PARSE(header->c_filesize);
+        uintptr_t data = cursor + sizeof(struct cpio_odc_header) + name_size;
+
+        file_description* desc = create_entry(header, filename);
+        if (desc) {
+            populate_file(desc, paddr + (data - vaddr),
+                          (const unsigned char*)data, file_size, stats);
+            ASSERT_OK(file_description_close(desc));
+        }
+
+        cursor = data + file_size;
+    }
+}
+
+static void read_exact(struct lz4_stream* stream, void* dest, size_t count) {
+    ssize_t nread = lz4_stream_read(stream, dest, count);
+    ASSERT_OK(nread);
+    ASSERT((size_t)nread == count);
+}
+
+static ssize_t fill_from_stream(void* ctx, void* dest, size_t count) {
+    return lz4_stream_read(ctx, dest, count);
+}
 
-        if (S_ISDIR(mode)) {
-            ASSERT_OK(vfs_create(filename, mode));
-        } else {
-            file_description* desc =
-                vfs_open(filename, O_CREAT | O_EXCL | O_WRONLY, mode);
-            ASSERT_OK(desc);
-
-            desc->inode->device_id = PARSE(header->c_rdev);
-
-            const unsigned char* file_content =
-                (const unsigned char*)(cursor + sizeof(struct cpio_odc_header) +
-                                       name_size);
-            for (size_t count = 0; count < file_size;) {
-                ssize_t nwritten = file_description_write(
-                    desc, file_content + count, file_size - count);
+// the archive is decompressed one entry at a time, and file data goes
+// straight into the pages of the files without an intermediate buffer
+static void populate_from_lz4(const void* data, size_t size,
+                              struct initrd_stats* stats) {
+    struct lz4_stream stream;
+    ASSERT_OK(lz4_stream_init(&stream, data, size));
+
+    char* filename = kmalloc(PATH_MAX);
+    ASSERT(filename);
+    for (;;) {
+        struct cpio_odc_header header;
+        read_exact(&stream, &header, sizeof(header));
+        ASSERT(!strncmp(header.c_magic, "070707", 6));
+
+        size_t name_size = PARSE(header.c_namesize);
+        ASSERT(name_size > 0);
+        size_t n = MIN(name_size, PATH_MAX);
+        read_exact(&stream, filename, n);
+        filename[n - 1] = 0;
+        for (size_t skipped = n; skipped < name_size;) {
+            char buf[64];
+            size_t chunk = MIN(name_size - skipped, sizeof(buf));
+            read_exact(&stream, buf, chunk);
+            skipped += chunk;
+        }
+        if (!strcmp(filename, "TRAILER!!!"))
+            break;
+
+        size_t file_size = PARSE(header.c_filesize);
+        file_description* desc = create_entry(&header, filename);
+        if (desc) {
+            if (file_size > 0) {
+                ASSERT(desc->inode->fops->cache_pages);
+                ssize_t nwritten = page_cache_fill(
+                    desc->inode, 0, file_size, fill_from_stream, &stream);
                 ASSERT_OK(nwritten);
-                count += nwritten;
+                ASSERT((size_t)nwritten == file_size);
+                stats->copied_bytes += file_size;
             }
-
             ASSERT_OK(file_description_close(desc));
         }
-
-        cursor += sizeof(struct cpio_odc_header) + name_size + file_size;
     }
 
+    kfree(filename);
+    lz4_stream_destroy(&stream);
+}
+
+void initrd_populate_root_fs(uintptr_t paddr, size_t size) {
+    uint32_t start_time = uptime;
+
+    uintptr_t region_start = round_down(paddr, PAGE_SIZE);
+    uintptr_t region_end = paddr + size;
+    size_t region_size = region_end - region_start;
+
+    // the module stays reserved unless freeinitrd is given. then its whole
+    // pages become ordinary pages that are freed once no file uses them.
+    // the partial page at the end may share the page with whatever the boot
+    // loader put after the module, so it is left alone.
+    uintptr_t owned_start = round_up(paddr, PAGE_SIZE);
+    uintptr_t owned_end = round_down(region_end, PAGE_SIZE);
+    size_t owned_size = owned_end > owned_start ? owned_end - owned_start : 0;
+    bool release = cmdline_contains("freeinitrd");
+    if (release && owned_size > 0)
+        page_allocator_unreserve(owned_start, owned_size);
+
+    uintptr_t vaddr =
+        range_allocator_alloc(&kernel_vaddr_allocator, region_size);
+    ASSERT_OK(vaddr);
+    ASSERT_OK(
+        paging_map_to_physical_range(vaddr, region_start, region_size, 0));
+
+    struct initrd_stats stats = {0};
+    uintptr_t data = vaddr + (paddr - region_start);
+    bool compressed = lz4_is_frame((const void*)data, size);
+    if (compressed)
+        populate_from_lz4((const void*)data, size, &stats);
+    else
+        populate_from_archive(data, paddr, &stats);
+
     paging_unmap(vaddr, region_size);
     ASSERT_OK(
         range_allocator_free(&kernel_vaddr_allocator, vaddr, region_size));
+
+    if (release) {
+        for (uintptr_t page = owned_start; page < owned_end; page += PAGE_SIZE)
+            page_allocator_unref_page(page);
+    }
+
+    kprintf("initrd: %u KiB %s, %u KiB shared with files, %u KiB copied, "
+            "%u KiB released, %u ms\n",
+            size / 1024, compressed ? "compressed (lz4)" : "uncompressed",
+            stats.lent_pages * PAGE_SIZE / 1024, stats.copied_bytes / 1024,
+            release ? owned_size / 1024 - stats.lent_pages * PAGE_SIZE / 1024
+                    : 0,
+            (uptime - start_time) * 1000 / CLK_TCK);
 }
@@ -0,0 +1,501 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "fs.h"
+#include <common/string.h>
+#include <kernel/api/err.h>
+#include <kernel/api/fcntl.h>
+#include <kernel/boot_defs.h>
+#include <kernel/memory/memory.h>
+#include <kernel/panic.h>
+
+// returns the kernel address of a page of the file, reading it in if needed.
+// holes of files without a backing store are reported as 0 unless alloc is
+// set. the mapping lock must be held.
+static uintptr_t get_page(struct inode* inode, size_t index, bool alloc) {
+    struct address_space* mapping = &inode->mapping;
+    uintptr_t page = page_tree_get(&mapping->pages, index);
+    if (page)
+        return page;
+
+    readpage_fn readpage = inode->fops->readpage;
+    if (!readpage && !alloc)
+        return 0;
+
+    page = page_tree_get_or_alloc(&mapping->pages, index);
+    if (IS_ERR(page))
+        return page;
+    if (readpage) {
+        int rc = readpage(inode, index, (void*)page);
+        if (IS_ERR(rc)) {
+            page_tree_free_range(&mapping->pages, index, index + 1);
+            return rc;
+        }
+    }
+    return page;
+}
+
+// pages lent to the cache by someone else (e.g. the initrd) are read-only,
+// and get copied when they are written to for the first time
+static uintptr_t get_writable_page(struct inode* inode, size_t index) {
+    uintptr_t page = get_page(inode, index, true);
+    if (IS_ERR(page))
+        return page;
+    return page_tree_get_writable(&inode->mapping.pages, index);
+}
+
+// makes the page of the cache read-only, so that the file writes to a copy
+// of it from then on. returns -EBUSY if a process may have the page mapped
+// with MAP_SHARED, as the mapping would miss the writes that go to the copy.
+NODISCARD static int protect_page(uintptr_t page) {
+    uint16_t flags = paging_get_page_flags(page);
+    if (!(flags & PAGE_WRITE))
+        return 0;
+    if (page_allocator_get_ref_count(paging_virtual_to_physical_addr(page)) >
+        1)
+        return -EBUSY;
+    paging_protect(page, PAGE_SIZE, flags & ~PAGE_WRITE);
+    return 0;
+}
+
+// maps the physical page read-only in the kernel address space, so that a
+// page tree holding it copies the page before writing to it
+static uintptr_t map_readonly_page(uintptr_t physical_addr) {
+    uintptr_t page = range_allocator_alloc(&kernel_vaddr_allocator, PAGE_SIZE);
+    if (IS_ERR(page))
+        return page;
+    int rc = paging_map_to_physical_range(page, physical_addr, PAGE_SIZE,
+                                          PAGE_GLOBAL);
+    if (IS_ERR(rc)) {
+        ASSERT_OK(
+            range_allocator_free(&kernel_vaddr_allocator, page, PAGE_SIZE));
+        return rc;
+    }
+    return page;
+}
+
+static void unmap_readonly_page(uintptr_t page) {
+    paging_unmap(page, PAGE_SIZE);
+    ASSERT_OK(range_allocator_free(&kernel_vaddr_allocator, page, PAGE_SIZE));
+}
+
+ssize_t page_cache_read(struct inode* inode, void* buffer, size_t count,
+                        off_t offset) {
+    struct address_space* mapping = &inode->mapping;
+    mutex_lock(&mapping->lock);
+    if ((size_t)offset >= mapping->size) {
+        mutex_unlock(&mapping->lock);
+        return 0;
+    }
+    count = MIN(count, mapping->size - offset);
+
+    unsigned char* dest = buffer;
+    ssize_t rc = 0;
+    size_t total = 0;
+    while (total < count) {
+        size_t pos = offset + total;
+        size_t page_offset = pos % PAGE_SIZE;
+        size_t n = MIN(count - total, PAGE_SIZE - page_offset);
+        uintptr_t page = get_page(inode, pos / PAGE_SIZE, false);
+        if (IS_ERR(page)) {
+            rc = page;
+            break;
+        }
+        if (page)
+            memcpy(dest + total, (void*)(page + page_offset), n);
+        else
+            memset(dest + total, 0, n);
+        total += n;
+    }
+    mutex_unlock(&mapping->lock);
+    return total > 0 ? (ssize_t)total : rc;
+}
+
+// fill produces the data of each page in place, so that callers that generate
+// the data (e.g. a decompressor) don't need a buffer of their own
+ssize_t page_cache_fill(struct inode* inode, off_t offset, size_t count,
+                        page_cache_fill_fn fill, void* ctx) {
+    struct address_space* mapping = &inode->mapping;
+    mutex_lock(&mapping->lock);
+    ssize_t rc = 0;
+    size_t total = 0;
+    while (total < count) {
+        size_t pos = offset + total;
+        size_t page_offset = pos % PAGE_SIZE;
+        size_t n = MIN(count - total, PAGE_SIZE - page_offset);
+        uintptr_t page = get_writable_page(inode, pos / PAGE_SIZE);
+        if (IS_ERR(page)) {
+            rc = page;
+            break;
+        }
+        rc = fill(ctx, (void*)(page + page_offset), n);
+        if (IS_ERR(rc))
+            break;
+        total += rc;
+        if ((size_t)rc < n)
+            break;
+    }
+    if (mapping->size < offset + total)
+        mapping->size = offset + total;
+    mutex_unlock(&mapping->lock);
+    return total > 0 ? (ssize_t)total : rc;
+}
+
+static ssize_t copy_from_buffer(void* ctx, void* dest, size_t count) {
+    const unsigned char** src = ctx;
+    memcpy(dest, *src, count);
+    *src += count;
+    return count;
+}
+
+ssize_t page_cache_write(struct inode* inode, const void* buffer, size_t count,
+                         off_t offset) {
+    const unsigned char* src = buffer;
+    return page_cache_fill(inode, offset, count, copy_from_buffer, &src);
+}
+
+uintptr_t page_cache_mmap(struct inode* inode, uintptr_t addr, size_t length,
+                          off_t offset, uint16_t page_flags) {
+    // private mappings would need their own copy once written to
+    if ((offset % PAGE_SIZE) ||
+        ((page_flags & PAGE_WRITE) && !(page_flags & PAGE_SHARED)))
+        return -ENOTSUP;
+
+    struct address_space* mapping = &inode->mapping;
+    mutex_lock(&mapping->lock);
+    if (offset + length > round_up(mapping->size, PAGE_SIZE)) {
+        mutex_unlock(&mapping->lock);
+        return -EINVAL;
+    }
+
+    // holes are filled in because the mapping may be written to. shared
+    // mappings never get a lent or shared page, because writing to the file
+    // would replace it with a copy that the mapping doesn't see. private
+    // mappings (e.g. the text of running executables) keep the page as it
+    // is, so the file copies the page before writing to it.
+    bool private = page_flags & PAGE_COW;
+    size_t first_page = offset / PAGE_SIZE;
+    size_t num_pages = div_ceil(length, PAGE_SIZE);
+    for (size_t i = 0; i < num_pages; ++i) {
+        uintptr_t page = private ? get_page(inode, first_page + i, true)
+                                 : get_writable_page(inode, first_page + i);
+        int rc = IS_ERR(page) ? (int)page : 0;
+        if (IS_OK(rc) && private)
+            rc = protect_page(page);
+        if (IS_OK(rc))
+            rc = paging_copy_mapping(addr + i * PAGE_SIZE, page, PAGE_SIZE,
+                                     page_flags);
+        if (IS_ERR(rc)) {
+            paging_unmap(addr, i * PAGE_SIZE);
+            mutex_unlock(&mapping->lock);
+            return rc;
+        }
+    }
+
+    mutex_unlock(&mapping->lock);
+    return addr;
+}
+
+ssize_t page_cache_splice_read(file_description* desc, off_t offset,
+                               size_t count, splice_actor_fn actor,
+                               void* ctx) {
+    static const unsigned char zero_page[PAGE_SIZE];
+
+    struct inode* inode = desc->inode;
+    struct address_space* mapping = &inode->mapping;
+    ssize_t rc = 0;
+    size_t total = 0;
+    while (total < count) {
+        size_t pos = offset + total;
+        mutex_lock(&mapping->lock);
+        if (pos >= mapping->size) {
+            mutex_unlock(&mapping->lock);
+            break;
+        }
+        size_t page_offset = pos % PAGE_SIZE;
+        size_t n = MIN(count - total, PAGE_SIZE - page_offset);
+        n = MIN(n, mapping->size - pos);
+
+        // actor may block (e.g. on a full pipe) or write to another file in
+        // the page cache, so it gets its own reference to the page and runs
+        // without the lock
+        uintptr_t page = get_page(inode, pos / PAGE_SIZE, false);
+        if (IS_OK(page) && page)
+            page = map_readonly_page(paging_virtual_to_physical_addr(page));
+        mutex_unlock(&mapping->lock);
+        if (IS_ERR(page)) {
+            rc = page;
+            break;
+        }
+
+        const void* data =
+            page ? (const void*)(page + page_offset) : zero_page;
+        rc = actor(ctx, data, n);
+        if (page)
+            unmap_readonly_page(page);
+        if (IS_ERR(rc))
+            break;
+        total += rc;
+        if ((size_t)rc < n)
+            break;
+    }
+    return total > 0 ? (ssize_t)total : rc;
+}
+
+// clears [from, to) of a page without allocating it if it is a hole
+NODISCARD static int zero_page_range(struct address_space* mapping,
+                                     size_t index, size_t from, size_t to) {
+    if (!page_tree_get(&mapping->pages, index))
+        return 0;
+    uintptr_t page = page_tree_get_writable(&mapping->pages, index);
+    if (IS_ERR(page))
+        return page;
+    memset((void*)(page + from), 0, to - from);
+    return 0;
+}
+
+int page_cache_truncate(struct inode* inode, off_t length) {
+    struct address_space* mapping = &inode->mapping;
+    mutex_lock(&mapping->lock);
+    int rc = 0;
+    if ((size_t)length < mapping->size) {
+        // whole pages past the end go away, and the tail of the last page is
+        // cleared so that growing the file again exposes zeros. the last page
+        // may be shared with another file, in which case it is copied first.
+        page_tree_free_range(&mapping->pages, div_ceil(length, PAGE_SIZE),
+                             SIZE_MAX);
+        size_t page_offset = length % PAGE_SIZE;
+        if (page_offset > 0)
+            rc = zero_page_range(mapping, length / PAGE_SIZE, page_offset,
+                                 PAGE_SIZE);
+    }
+    if (IS_OK(rc))
+        mapping->size = length;
+    mutex_unlock(&mapping->lock);
+    return rc;
+}
+
+NODISCARD static int punch_hole(struct address_space* mapping, size_t offset,
+                                size_t end) {
+    // whole pages in the range go away, and the parts of the pages at either
+    // end that are in the range are cleared
+    size_t first_whole = div_ceil(offset, PAGE_SIZE);
+    size_t end_whole = end / PAGE_SIZE;
+    if (first_whole < end_whole)
+        page_tree_free_range(&mapping->pages, first_whole, end_whole);
+
+    size_t first = offset / PAGE_SIZE;
+    size_t last = (end - 1) / PAGE_SIZE;
+    size_t head_end = first == last ? (end - 1) % PAGE_SIZE + 1 : PAGE_SIZE;
+    if (offset % PAGE_SIZE || head_end < PAGE_SIZE) {
+        int rc = zero_page_range(mapping, first, offset % PAGE_SIZE, head_end);
+        if (IS_ERR(rc))
+            return rc;
+    }
+    if (first != last && end % PAGE_SIZE)
+        return zero_page_range(mapping, last, 0, end % PAGE_SIZE);
+    return 0;
+}
+
+int page_cache_fallocate(struct inode* inode, int mode, off_t offset,
+                         off_t length) {
+    struct address_space* mapping = &inode->mapping;
+    size_t end = offset + length;
+    mutex_lock(&mapping->lock);
+
+    int rc = 0;
+    if (mode & FALLOC_FL_PUNCH_HOLE) {
+        rc = punch_hole(mapping, offset, end);
+    } else {
+        // allocates the pages up front so that writing to the range later
+        // doesn't run out of memory
+        for (size_t i = offset / PAGE_SIZE; i < div_ceil(end, PAGE_SIZE);
+             ++i) {
+            uintptr_t page = get_writable_page(inode, i);
+            if (IS_ERR(page)) {
+                rc = page;
+                break;
+            }
+        }
+        if (IS_OK(rc) && !(mode & FALLOC_FL_KEEP_SIZE) && mapping->size < end)
+            mapping->size = end;
+    }
+
+    mutex_unlock(&mapping->lock);
+    return rc;
+}
+
+int page_cache_lend_page(struct inode* inode, size_t index,
+                         uintptr_t physical_addr) {
+    uintptr_t page = map_readonly_page(physical_addr);
+    if (IS_ERR(page))
+        return page;
+
+    struct address_space* mapping = &inode->mapping;
+    mutex_lock(&mapping->lock);
+    int rc = page_tree_insert(&mapping->pages, index, page);
+    mutex_unlock(&mapping->lock);
+    if (IS_ERR(rc))
+        unmap_readonly_page(page);
+    return rc;
+}
+
+// puts the page of the source at index of the destination. both files then
+// copy the page when they write to it. returns -EBUSY if the page can't be
+// shared, in which case nothing is changed.
+NODISCARD static int share_page(struct address_space* dest, size_t index,
+                                uintptr_t src_page) {
+    // processes map only writable pages with MAP_SHARED, and replacing one
+    // of them would leave the mapping behind
+    uintptr_t dest_page = page_tree_get(&dest->pages, index);
+    if (dest_page && (paging_get_page_flags(dest_page) & PAGE_WRITE) &&
+        page_allocator_get_ref_count(
+            paging_virtual_to_physical_addr(dest_page)) > 1)
+        return -EBUSY;
+
+    int rc = protect_page(src_page);
+    if (IS_ERR(rc))
+        return rc;
+
+    uintptr_t page =
+        map_readonly_page(paging_virtual_to_physical_addr(src_page));
+    if (IS_ERR(page))
+        return page;
+    page_tree_free_range(&dest->pages, index, index + 1);
+    rc = page_tree_insert(&dest->pages, index, page);
+    if (IS_ERR(rc))
+        unmap_readonly_page(page);
+    return rc;
+}
+
+// copies count bytes at page_offset of src_page, which is 0 for a hole, to
+// dest_offset of dest. if whole is set, the destination page takes the
+// source page as a whole instead.
+NODISCARD static int copy_page_range(struct inode* dest, size_t dest_offset,
+                                     uintptr_t src_page, size_t page_offset,
+                                     size_t count, bool whole) {
+    struct address_space* mapping = &dest->mapping;
+    size_t index = dest_offset / PAGE_SIZE;
+    size_t dest_page_offset = dest_offset % PAGE_SIZE;
+
+    if (whole) {
+        if (!src_page) {
+            page_tree_free_range(&mapping->pages, index, index + 1);
+            return 0;
+        }
+        int rc = share_page(mapping, index, src_page);
+        if (rc != -EBUSY)
+            return rc;
+    }
+
+    if (!src_page && !page_tree_get(&mapping->pages, index))
+        return 0;
+    uintptr_t page = get_writable_page(dest, index);
+    if (IS_ERR(page))
+        return page;
+    if (src_page)
+        memcpy((void*)(page + dest_page_offset),
+               (void*)(src_page + page_offset), count);
+    else
+        memset((void*)(page + dest_page_offset), 0, count);
+    return 0;
+}
+
+ssize_t page_cache_copy_range(struct inode* dest, off_t dest_offset,
+                              struct inode* src, off_t src_offset,
+                              size_t count) {
+    // the locks are taken in a fixed order so that copies in opposite
+    // directions don't deadlock
+    struct address_space* first = &src->mapping;
+    struct address_space* second = &dest->mapping;
+    if (second < first) {
+        first = &dest->mapping;
+        second = &src->mapping;
+    }
+    mutex_lock(&first->lock);
+    if (second != first)
+        mutex_lock(&second->lock);
+
+    size_t src_size = src->mapping.size;
+    ssize_t rc = 0;
+    size_t total = 0;
+    if ((size_t)src_offset < src_size)
+        count = MIN(count, src_size - src_offset);
+    else
+        count = 0;
+    while (total < count) {
+        size_t src_pos = src_offset + total;
+        size_t dest_pos = dest_offset + total;
+        size_t page_offset = src_pos % PAGE_SIZE;
+        size_t n = MIN(count - total, PAGE_SIZE - page_offset);
+        n = MIN(n, PAGE_SIZE - dest_pos % PAGE_SIZE);
+
+        // within a single file, the destination may be in the same page as
+        // the source, which must not be replaced with a copy while in use
+        size_t src_index = src_pos / PAGE_SIZE;
+        uintptr_t src_page = get_page(src, src_index, false);
+        if (src == dest && src_page && !IS_ERR(src_page))
+            src_page = page_tree_get_writable(&src->mapping.pages, src_index);
+        if (IS_ERR(src_page)) {
+            rc = src_page;
+            break;
+        }
+
+        // the bytes of the last page past the end of the file are zero, so
+        // it can be taken as a whole if the destination ends there too
+        bool whole = page_offset == 0 && dest_pos % PAGE_SIZE == 0 &&
+                     (n == PAGE_SIZE || (src_pos + n == src_size &&
+                                         dest_pos + n >= dest->mapping.size));
+        rc = copy_page_range(dest, dest_pos, src_page, page_offset, n, whole);
+        if (IS_ERR(rc))
+            break;
+        total += n;
+    }
+    if (dest->mapping.size < dest_offset + total)
+        dest->mapping.size = dest_offset + total;
+
+    if (second != first)
+        mutex_unlock(&second->lock);
+    mutex_unlock(&first->lock);
+    return total > 0 ? (ssize_t)total : rc;
+}
+
+void page_cache_destroy(struct inode* inode) {
+    page_tree_destroy(&inode->mapping.pages);
+}
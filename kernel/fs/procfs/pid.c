@@ -40,7 +40,6 @@
 #include "procfs.h"
 #include <common/string.h>
 #include <kernel/fs/dentry.h>
-#include <kernel/growable_buf.h>
 #include <kernel/interrupts.h>
 #include <kernel/panic.h>
 #include <kernel/process.h>
@@ -50,7 +49,7 @@ typedef struct procfs_pid_item_inode {
     pid_t pid;
 } procfs_pid_item_inode;
 
-static int populate_comm(file_description* desc, growable_buf* buf) {
+static int show_comm(file_description* desc, seq_file* m) {
     procfs_pid_item_inode* node = (procfs_pid_item_inode*)desc->inode;
     struct process* process = process_find_process_by_pid(node->pid);
     if (!process)
@@ -61,7 +60,8 @@ static int populate_comm(file_description* desc, growable_buf* buf) {
     strlcpy(comm, process->comm, sizeof(process->comm));
     pop_cli(int_flag);
 
-    return growable_buf_printf(buf, "%s\n", comm);
+    seq_printf(m, "%s\n", comm);
+    return 0;
 }
 
 static int add_item(procfs_dir_inode* parent, const procfs_item_def* item_def,
@@ -72,7 +72,7 @@ static int add_item(procfs_dir_inode* parent, const procfs_item_def* item_def,
     *node = (procfs_pid_item_inode){0};
 
     node->pid = pid;
-    node->item_inode.populate = item_def->populate;
+    node->item_inode.show = item_def->show;
 
     struct inode* inode = &node->item_inode.inode;
     inode->fs_root_inode = parent->inode.fs_root_inode;
@@ -80,37 +80,123 @@ static int add_item(procfs_dir_inode* parent, const procfs_item_def* item_def,
     inode->mode = S_IFREG;
     inode->ref_count = 1;
 
-    return dentry_append(&parent->children, item_def->name, inode);
+    return dentry_append(&parent->children, &parent->next_cookie,
+                         item_def->name, inode);
 }
 
-static procfs_item_def pid_items[] = {{"comm", populate_comm}};
+static procfs_item_def pid_items[] = {{"comm", show_comm}};
 #define NUM_ITEMS (sizeof(pid_items) / sizeof(procfs_item_def))
 
-struct inode* procfs_pid_dir_inode_create(procfs_dir_inode* parent, pid_t pid) {
-    struct process* process = process_find_process_by_pid(pid);
-    if (!process)
-        return ERR_PTR(-ENOENT);
+typedef struct procfs_pid_dir_inode {
+    procfs_dir_inode dir;
+    pid_t pid;
+    struct procfs_pid_dir_inode* next_in_cache;
+} procfs_pid_dir_inode;
+
+// directories of the processes that were looked up. the cache holds a
+// reference to each of them until the process is reaped, so polling /proc
+// doesn't build the same directory over and over.
+#define PID_DIR_CACHE_SIZE 64
+static procfs_pid_dir_inode* pid_dir_cache[PID_DIR_CACHE_SIZE];
+static mutex pid_dir_cache_lock;
 
-    procfs_dir_inode* node = kmalloc(sizeof(procfs_dir_inode));
+static struct inode* create_pid_dir(procfs_dir_inode* parent, pid_t pid) {
+    procfs_pid_dir_inode* node = kmalloc(sizeof(procfs_pid_dir_inode));
     if (!node)
         return ERR_PTR(-ENOMEM);
-    *node = (procfs_dir_inode){0};
+    *node = (procfs_pid_dir_inode){0};
+    node->pid = pid;
 
     static file_ops fops = {.destroy_inode = procfs_dir_destroy_inode,
                             .lookup_child = procfs_dir_lookup_child,
+                            .close = procfs_dir_close,
                             .getdents = procfs_dir_getdents};
-    struct inode* inode = &node->inode;
+    struct inode* inode = &node->dir.inode;
     inode->fs_root_inode = parent->inode.fs_root_inode;
     inode->fops = &fops;
     inode->mode = S_IFDIR;
     inode->ref_count = 1;
 
     for (size_t i = 0; i < NUM_ITEMS; ++i) {
-        int rc = add_item(node, pid_items + i, pid);
-        if (IS_ERR(rc))
+        int rc = add_item(&node->dir, pid_items + i, pid);
+        if (IS_ERR(rc)) {
+            inode_unref(inode);
             return ERR_PTR(rc);
+        }
     }
 
-    inode_unref((struct inode*)parent);
     return inode;
 }
+
+struct inode* procfs_pid_dir_lookup(procfs_dir_inode* parent, pid_t pid) {
+    struct inode* root = parent->inode.fs_root_inode;
+    procfs_pid_dir_inode** bucket = pid_dir_cache + pid % PID_DIR_CACHE_SIZE;
+
+    mutex_lock(&pid_dir_cache_lock);
+
+    struct inode* inode = NULL;
+    for (procfs_pid_dir_inode* it = *bucket; it; it = it->next_in_cache) {
+        if (it->pid == pid && it->dir.inode.fs_root_inode == root) {
+            inode = &it->dir.inode;
+            inode_ref(inode);
+            break;
+        }
+    }
+
+    // the process is looked for with the lock held, so that it can't be
+    // reaped before its directory is in the cache
+    if (!inode) {
+        if (process_find_process_by_pid(pid))
+            inode = create_pid_dir(parent, pid);
+        else
+            inode = ERR_PTR(-ENOENT);
+        if (IS_OK(inode)) {
+            procfs_pid_dir_inode* node = (procfs_pid_dir_inode*)inode;
+            node->next_in_cache = *bucket;
+            *bucket = node;
+            inode_ref(inode);
+        }
+    }
+
+    mutex_unlock(&pid_dir_cache_lock);
+    inode_unref(&parent->inode);
+    return inode;
+}
+
+// drops the cached directories of the process, or of every process if root
+// is given
+static void forget_pid_dirs(struct inode* root, pid_t pid) {
+    procfs_pid_dir_inode* forgotten = NULL;
+
+    mutex_lock(&pid_dir_cache_lock);
+    for (size_t i = 0; i < PID_DIR_CACHE_SIZE; ++i) {
+        if (!root && i != (size_t)pid % PID_DIR_CACHE_SIZE)
+            continue;
+        procfs_pid_dir_inode** prev_next = pid_dir_cache + i;
+        procfs_pid_dir_inode* it = *prev_next;
+        while (it) {
+            procfs_pid_dir_inode* next = it->next_in_cache;
+            bool matches = root ? it->dir.inode.fs_root_inode == root
+                                : it->pid == pid;
+            if (matches) {
+                *prev_next = next;
+                it->next_in_cache = forgotten;
+                forgotten = it;
+            } else {
+                prev_next = &it->next_in_cache;
+            }
+            it = next;
+        }
+    }
+    mutex_unlock(&pid_dir_cache_lock);
+
+    while (forgotten) {
+        procfs_pid_dir_inode* next = forgotten->next_in_cache;
+        inode_unref(&forgotten->dir.inode);
+        forgotten = next;
+    }
+}
+
+void procfs_forget_pid(pid_t pid) { forget_pid_dirs(NULL, pid); }
+
+void procfs_forget_root(struct inode* root) { forget_pid_dirs(root, 0); }
@@ -38,48 +38,141 @@
  */
 
 #include "procfs.h"
+#include <common/stdio.h>
+#include <common/string.h>
+#include <kernel/boot_defs.h>
 #include <kernel/fs/dentry.h>
-#include <kernel/growable_buf.h>
 #include <kernel/memory/memory.h>
 #include <kernel/panic.h>
+#include <stdarg.h>
 
-static void procfs_item_destroy_inode(struct inode* inode) { kfree(inode); }
+void seq_printf(seq_file* m, const char* format, ...) {
+    if (m->overflowed)
+        return;
+    size_t max_len = m->capacity - m->len;
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(m->buf + m->len, max_len, format, args);
+    va_end(args);
+    if ((size_t)len >= max_len)
+        m->overflowed = true;
+    else
+        m->len += len;
+}
+
+// fills the buffer with as many whole records as fit, starting over with a
+// bigger buffer if not even one record does
+NODISCARD static int seq_fill(file_description* desc, seq_file* m) {
+    procfs_item_inode* node = (procfs_item_inode*)desc->inode;
+    m->len = m->read_pos = 0;
+    while (!m->done) {
+        size_t saved_len = m->len;
+        m->overflowed = false;
+        int rc = node->show(desc, m);
+        if (IS_ERR(rc))
+            return rc;
+        if (!m->overflowed) {
+            ++m->index;
+            m->done = rc == 0;
+            continue;
+        }
+        m->len = saved_len;
+        if (m->len > 0)
+            break;
+
+        size_t new_capacity = m->capacity * 2;
+        char* new_buf = kmalloc(new_capacity);
+        if (!new_buf)
+            return -ENOMEM;
+        kfree(m->buf);
+        m->buf = new_buf;
+        m->capacity = new_capacity;
+    }
+    return 0;
+}
 
 static int procfs_item_open(file_description* desc, int flags, mode_t mode) {
     (void)flags;
     (void)mode;
 
-    growable_buf* buf = kmalloc(sizeof(growable_buf));
-    if (!buf)
+    seq_file* m = kmalloc(sizeof(seq_file));
+    if (!m)
+        return -ENOMEM;
+    *m = (seq_file){0};
+    m->capacity = PAGE_SIZE;
+    m->buf = kmalloc(m->capacity);
+    if (!m->buf) {
+        kfree(m);
         return -ENOMEM;
-    *buf = (growable_buf){0};
-
-    procfs_item_inode* node = (procfs_item_inode*)desc->inode;
-    int rc = node->populate(desc, buf);
-    if (IS_ERR(rc)) {
-        kfree(buf);
-        return rc;
     }
 
-    desc->private_data = buf;
+    desc->private_data = m;
     return 0;
 }
 
 static int procfs_item_close(file_description* desc) {
-    growable_buf_destroy(desc->private_data);
-    kfree(desc->private_data);
+    seq_file* m = desc->private_data;
+    kfree(m->buf);
+    kfree(m);
     return 0;
 }
 
-static ssize_t procfs_item_read(file_description* desc, void* buffer, size_t count) {
+static ssize_t procfs_item_read(file_description* desc, void* buffer,
+                                size_t count) {
+    seq_file* m = desc->private_data;
     mutex_lock(&desc->offset_lock);
-    ssize_t nread = growable_buf_pread(desc->private_data, buffer, count, desc->offset);
-    if (IS_OK(nread))
-        desc->offset += nread;
+
+    if (desc->offset != m->offset) {
+        // generate the file again up to the new offset
+        m->len = m->read_pos = m->index = 0;
+        m->offset = 0;
+        m->done = false;
+        while (m->offset < desc->offset) {
+            if (m->read_pos == m->len) {
+                if (m->done)
+                    break;
+                int rc = seq_fill(desc, m);
+                if (IS_ERR(rc)) {
+                    mutex_unlock(&desc->offset_lock);
+                    return rc;
+                }
+            }
+            size_t n = MIN(m->len - m->read_pos,
+                           (size_t)(desc->offset - m->offset));
+            m->read_pos += n;
+            m->offset += n;
+        }
+    }
+
+    unsigned char* dest = buffer;
+    size_t nread = 0;
+    while (nread < count) {
+        if (m->read_pos == m->len) {
+            if (m->done)
+                break;
+            int rc = seq_fill(desc, m);
+            if (IS_ERR(rc)) {
+                if (nread > 0)
+                    break;
+                mutex_unlock(&desc->offset_lock);
+                return rc;
+            }
+            continue;
+        }
+        size_t n = MIN(m->len - m->read_pos, count - nread);
+        memcpy(dest + nread, m->buf + m->read_pos, n);
+        m->read_pos += n;
+        nread += n;
+    }
+    m->offset += nread;
+    desc->offset = m->offset;
+
     mutex_unlock(&desc->offset_lock);
     return nread;
 }
 
+static void procfs_item_destroy_inode(struct inode* inode) { kfree(inode); }
+
 file_ops procfs_item_fops = {.destroy_inode = procfs_item_destroy_inode,
                              .open = procfs_item_open,
                              .close = procfs_item_close,
@@ -93,15 +186,27 @@ void procfs_dir_destroy_inode(struct inode* inode) {
 
 struct inode* procfs_dir_lookup_child(struct inode* inode, const char* name) {
     procfs_dir_inode* node = (procfs_dir_inode*)inode;
+    mutex_lock(&node->children_lock);
     struct inode* child = dentry_find(node->children, name);
+    mutex_unlock(&node->children_lock);
     inode_unref(inode);
     return child;
 }
 
 int procfs_dir_getdents(struct getdents_ctx* ctx, file_description* desc, getdents_callback_fn callback) {
     procfs_dir_inode* node = (procfs_dir_inode*)desc->inode;
+    mutex_lock(&node->children_lock);
     mutex_lock(&desc->offset_lock);
-    int rc = dentry_getdents(ctx, desc, node->children, callback);
+    int rc = dentry_getdents(ctx, desc, &node->children, callback);
     mutex_unlock(&desc->offset_lock);
+    mutex_unlock(&node->children_lock);
     return rc;
 }
+
+int procfs_dir_close(file_description* desc) {
+    procfs_dir_inode* node = (procfs_dir_inode*)desc->inode;
+    mutex_lock(&node->children_lock);
+    dentry_close_cursor(desc, &node->children);
+    mutex_unlock(&node->children_lock);
+    return 0;
+}
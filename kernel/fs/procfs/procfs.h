@@ -42,28 +42,52 @@
 #include <kernel/forward.h>
 #include <kernel/fs/fs.h>
 
-typedef int (*procfs_populate_fn)(file_description*, growable_buf*);
+// the contents of a file are generated as it is read, a record at a time,
+// into a buffer that is copied out to the reader. nothing is generated
+// until the first read, and the file starts over after a seek.
+typedef struct seq_file {
+    char* buf;
+    size_t capacity;
+    size_t len;        // bytes in buf
+    size_t read_pos;   // bytes of buf that were already returned
+    size_t index;      // record that is generated next
+    off_t offset;      // file offset of buf[read_pos]
+    bool overflowed;   // the last record didn't fit in buf
+    bool done;         // no more records
+} seq_file;
+
+// writes the record at m->index with seq_printf. returns 1 if more records
+// follow, 0 if this was the last one, or a negative error. a record that
+// doesn't fit is thrown away and generated again into a bigger buffer, so
+// show must not have side effects.
+typedef int (*procfs_show_fn)(file_description*, seq_file* m);
+
+void seq_printf(seq_file* m, const char* format, ...);
 
 typedef struct procfs_item_def {
     const char* name;
-    procfs_populate_fn populate;
+    procfs_show_fn show;
 } procfs_item_def;
 
 typedef struct procfs_item_inode {
     struct inode inode;
-    procfs_populate_fn populate;
+    procfs_show_fn show;
 } procfs_item_inode;
 
 extern file_ops procfs_item_fops;
 
 typedef struct procfs_dir_inode {
     struct inode inode;
+    mutex children_lock;
     struct dentry* children;
+    off_t next_cookie;
 } procfs_dir_inode;
 
 void procfs_dir_destroy_inode(struct inode* inode);
 struct inode* procfs_dir_lookup_child(struct inode* inode, const char* name);
 int procfs_dir_getdents(struct getdents_ctx* ctx, file_description* desc,
                         getdents_callback_fn callback);
+int procfs_dir_close(file_description* desc);
 
-struct inode* procfs_pid_dir_inode_create(procfs_dir_inode* parent, pid_t pid);
+struct inode* procfs_pid_dir_lookup(procfs_dir_inode* parent, pid_t pid);
+void procfs_forget_root(struct inode* root);
@@ -41,46 +41,121 @@
 #include <common/stdio.h>
 #include <common/stdlib.h>
 #include <kernel/api/dirent.h>
+#include <kernel/block/buffer_cache.h>
+#include <kernel/exec_cache.h>
+#include <kernel/fs/dcache.h>
 #include <kernel/fs/dentry.h>
-#include <kernel/growable_buf.h>
 #include <kernel/interrupts.h>
 #include <kernel/panic.h>
 #include <kernel/process.h>
 
-static int populate_cmdline(file_description* desc, growable_buf* buf) {
+static int show_bcache(file_description* desc, seq_file* m) {
     (void)desc;
-    return growable_buf_printf(buf, "%s\n", cmdline_get_raw());
+    struct buffer_cache_stats stats;
+    buffer_cache_get_stats(&stats);
+
+    size_t hit_rate = stats.lookups ? stats.hits * 100 / stats.lookups : 0;
+    seq_printf(m,
+               "Lookups:    %8u\n"
+               "Hits:       %8u\n"
+               "Misses:     %8u\n"
+               "HitRate:    %8u %%\n"
+               "ReadAheads: %8u\n"
+               "Writebacks: %8u\n"
+               "Buffers:    %8u\n"
+               "MaxBuffers: %8u\n"
+               "Dirty:      %8u\n",
+               stats.lookups, stats.hits, stats.misses, hit_rate,
+               stats.read_aheads, stats.writebacks, stats.num_buffers,
+               stats.max_buffers, stats.num_dirty);
+    return 0;
+}
+
+static int show_cmdline(file_description* desc, seq_file* m) {
+    (void)desc;
+    seq_printf(m, "%s\n", cmdline_get_raw());
+    return 0;
+}
+
+static int show_dcache(file_description* desc, seq_file* m) {
+    (void)desc;
+    struct dcache_stats stats;
+    dcache_get_stats(&stats);
+
+    size_t hit_rate = stats.lookups
+                          ? (stats.hits + stats.negative_hits) * 100 /
+                                stats.lookups
+                          : 0;
+    seq_printf(m,
+               "Lookups:         %8u\n"
+               "Hits:            %8u\n"
+               "NegativeHits:    %8u\n"
+               "HitRate:         %8u %%\n"
+               "Entries:         %8u\n"
+               "NegativeEntries: %8u\n",
+               stats.lookups, stats.hits, stats.negative_hits, hit_rate,
+               stats.num_entries, stats.num_negative_entries);
+    return 0;
+}
+
+static int show_execcache(file_description* desc, seq_file* m) {
+    (void)desc;
+    struct exec_cache_stats stats;
+    exec_cache_get_stats(&stats);
+
+    size_t hit_rate = stats.lookups ? stats.hits * 100 / stats.lookups : 0;
+    seq_printf(m,
+               "Lookups:     %8u\n"
+               "Hits:        %8u\n"
+               "HitRate:     %8u %%\n"
+               "Images:      %8u\n"
+               "SharedPages: %8u\n",
+               stats.lookups, stats.hits, hit_rate, stats.num_images,
+               stats.shared_pages);
+    return 0;
 }
 
-static int populate_meminfo(file_description* desc, growable_buf* buf) {
+static int show_meminfo(file_description* desc, seq_file* m) {
     (void)desc;
     struct physical_memory_info memory_info;
     page_allocator_get_info(&memory_info);
 
-    return growable_buf_printf(buf,
-                               "MemTotal: %8u kB\n"
-                               "MemFree:  %8u kB\n",
-                               memory_info.total, memory_info.free);
+    seq_printf(m,
+               "MemTotal: %8u kB\n"
+               "MemFree:  %8u kB\n",
+               memory_info.total, memory_info.free);
+    return 0;
 }
 
-static int populate_uptime(file_description* desc, growable_buf* buf) {
+static int show_uptime(file_description* desc, seq_file* m) {
     (void)desc;
-    return growable_buf_printf(buf, "%u\n", uptime / CLK_TCK);
+    seq_printf(m, "%u\n", uptime / CLK_TCK);
+    return 0;
 }
-static procfs_item_def root_items[] = {{"cmdline", populate_cmdline},
-                                       {"meminfo", populate_meminfo},
-                                       {"uptime", populate_uptime}};
+static procfs_item_def root_items[] = {{"bcache", show_bcache},
+                                       {"cmdline", show_cmdline},
+                                       {"dcache", show_dcache},
+                                       {"execcache", show_execcache},
+                                       {"meminfo", show_meminfo},
+                                       {"uptime", show_uptime}};
 #define NUM_ITEMS (sizeof(root_items) / sizeof(procfs_item_def))
 
+#define PID_BATCH_SIZE 32
+
 static struct inode* procfs_root_lookup_child(struct inode* inode,
                                               const char* name) {
     if (str_is_uint(name)) {
         pid_t pid = atoi(name);
-        return procfs_pid_dir_inode_create((procfs_dir_inode*)inode, pid);
+        return procfs_pid_dir_lookup((procfs_dir_inode*)inode, pid);
     }
     return procfs_dir_lookup_child(inode, name);
 }
 
+static void procfs_root_destroy_inode(struct inode* inode) {
+    procfs_forget_root(inode);
+    procfs_dir_destroy_inode(inode);
+}
+
 static int procfs_root_getdents(struct getdents_ctx* ctx,
                                 file_description* desc,
                                 getdents_callback_fn callback) {
@@ -88,7 +163,10 @@ static int procfs_root_getdents(struct getdents_ctx* ctx,
 
     mutex_lock(&desc->offset_lock);
     if ((size_t)desc->offset < NUM_ITEMS) {
-        int rc = dentry_getdents(ctx, desc, node->children, callback);
+        // the items never change, so their cookies are 0 to NUM_ITEMS - 1
+        mutex_lock(&node->children_lock);
+        int rc = dentry_getdents(ctx, desc, &node->children, callback);
+        mutex_unlock(&node->children_lock);
         if (IS_ERR(rc)) {
             mutex_unlock(&desc->offset_lock);
             return rc;
@@ -99,26 +177,34 @@ static int procfs_root_getdents(struct getdents_ctx* ctx,
         return 0;
     }
 
-    bool int_flag = push_cli();
-
+    // pids are copied out a batch at a time, so that interrupts are only
+    // disabled while walking the list and not while writing the entries
     pid_t offset_pid = (pid_t)(desc->offset - NUM_ITEMS);
-    struct process* it = all_processes;
-    while (it->pid <= offset_pid) {
-        it = it->next_in_all_processes;
-        if (!it)
-            break;
-    }
+    for (;;) {
+        pid_t pids[PID_BATCH_SIZE];
+        size_t num_pids = 0;
+        bool int_flag = push_cli();
+        for (struct process* it = all_processes;
+             it && num_pids < PID_BATCH_SIZE; it = it->next_in_all_processes) {
+            if (it->pid > offset_pid)
+                pids[num_pids++] = it->pid;
+        }
+        pop_cli(int_flag);
 
-    while (it) {
-        char name[16];
-        (void)snprintf(name, sizeof(name), "%d", it->pid);
-        if (!callback(ctx, name, DT_DIR))
+        for (size_t i = 0; i < num_pids; ++i) {
+            char name[16];
+            (void)snprintf(name, sizeof(name), "%d", pids[i]);
+            if (!callback(ctx, name, DT_DIR)) {
+                mutex_unlock(&desc->offset_lock);
+                return 0;
+            }
+            offset_pid = pids[i];
+            desc->offset = offset_pid + NUM_ITEMS;
+        }
+        if (num_pids < PID_BATCH_SIZE)
             break;
-        desc->offset = it->pid + NUM_ITEMS;
-        it = it->next_in_all_processes;
     }
 
-    pop_cli(int_flag);
     mutex_unlock(&desc->offset_lock);
     return 0;
 }
@@ -129,7 +215,7 @@ static int add_item(procfs_dir_inode* parent, const procfs_item_def* item_def) {
         return -ENOMEM;
     *node = (procfs_item_inode){0};
 
-    node->populate = item_def->populate;
+    node->show = item_def->show;
 
     struct inode* inode = &node->inode;
     inode->fs_root_inode = parent->inode.fs_root_inode;
@@ -137,7 +223,8 @@ static int add_item(procfs_dir_inode* parent, const procfs_item_def* item_def) {
     inode->mode = S_IFREG;
     inode->ref_count = 1;
 
-    return dentry_append(&parent->children, item_def->name, inode);
+    return dentry_append(&parent->children, &parent->next_cookie,
+                         item_def->name, inode);
 }
 
 struct inode* procfs_create_root(void) {
@@ -147,8 +234,9 @@ struct inode* procfs_create_root(void) {
     *root = (procfs_dir_inode){0};
 
     static file_ops fops = {
-        .destroy_inode = procfs_dir_destroy_inode,
+        .destroy_inode = procfs_root_destroy_inode,
         .lookup_child = procfs_root_lookup_child,
+        .close = procfs_dir_close,
         .getdents = procfs_root_getdents,
     };
 
@@ -38,20 +38,20 @@
  */
 
 #include "dentry.h"
-#include <kernel/growable_buf.h>
+#include <kernel/boot_defs.h>
 #include <kernel/memory/memory.h>
 #include <kernel/panic.h>
 
+// file data lives in the inode's page cache, which is never written back
 typedef struct tmpfs_inode {
     struct inode inode;
-    growable_buf buf;
     mutex children_lock;
     struct dentry* children;
+    off_t next_cookie;
 } tmpfs_inode;
 
 static void tmpfs_destroy_inode(struct inode* inode) {
     tmpfs_inode* node = (tmpfs_inode*)inode;
-    growable_buf_destroy(&node->buf);
     dentry_clear(node->children);
     kfree(node);
 }
@@ -66,75 +66,39 @@ static struct inode* tmpfs_lookup_child(struct inode* inode, const char* name) {
 }
 
 static int tmpfs_stat(struct inode* inode, struct stat* buf) {
-    tmpfs_inode* node = (tmpfs_inode*)inode;
     buf->st_mode = inode->mode;
     buf->st_nlink = inode->num_links;
     buf->st_rdev = 0;
-    buf->st_size = node->buf.size;
+    buf->st_size = inode->mapping.size;
+    buf->st_blocks = inode->mapping.pages.num_pages * (PAGE_SIZE / 512);
     inode_unref(inode);
     return 0;
 }
 
-static ssize_t tmpfs_read(file_description* desc, void* buffer, size_t count) {
-    tmpfs_inode* node = (tmpfs_inode*)desc->inode;
-    mutex_lock(&desc->offset_lock);
-    mutex_lock(&node->buf.lock);
-    ssize_t nread = growable_buf_pread(&node->buf, buffer, count, desc->offset);
-    mutex_unlock(&node->buf.lock);
-    if (IS_OK(nread))
-        desc->offset += nread;
-    mutex_unlock(&desc->offset_lock);
-    return nread;
-}
-
-static ssize_t tmpfs_write(file_description* desc, const void* buffer,
-                           size_t count) {
+static int tmpfs_getdents(struct getdents_ctx* ctx, file_description* desc,
+                          getdents_callback_fn callback) {
     tmpfs_inode* node = (tmpfs_inode*)desc->inode;
+    mutex_lock(&node->children_lock);
     mutex_lock(&desc->offset_lock);
-    mutex_lock(&node->buf.lock);
-    ssize_t nwritten =
-        growable_buf_pwrite(&node->buf, buffer, count, desc->offset);
-    mutex_unlock(&node->buf.lock);
-    if (IS_OK(nwritten))
-        desc->offset += nwritten;
+    int rc = dentry_getdents(ctx, desc, &node->children, callback);
     mutex_unlock(&desc->offset_lock);
-    return nwritten;
-}
-
-static uintptr_t tmpfs_mmap(file_description* desc, uintptr_t addr,
-                            size_t length, off_t offset, uint16_t page_flags) {
-    tmpfs_inode* node = (tmpfs_inode*)desc->inode;
-    mutex_lock(&node->buf.lock);
-    uintptr_t rc =
-        growable_buf_mmap(&node->buf, addr, length, offset, page_flags);
-    mutex_unlock(&node->buf.lock);
+    mutex_unlock(&node->children_lock);
     return rc;
 }
 
-static int tmpfs_truncate(file_description* desc, off_t length) {
-    tmpfs_inode* node = (tmpfs_inode*)desc->inode;
-    mutex_lock(&node->buf.lock);
-    int rc = growable_buf_truncate(&node->buf, length);
-    mutex_unlock(&node->buf.lock);
-    return rc;
-}
-
-static int tmpfs_getdents(struct getdents_ctx* ctx, file_description* desc,
-                          getdents_callback_fn callback) {
+static int tmpfs_close_dir(file_description* desc) {
     tmpfs_inode* node = (tmpfs_inode*)desc->inode;
     mutex_lock(&node->children_lock);
-    mutex_lock(&desc->offset_lock);
-    int rc = dentry_getdents(ctx, desc, node->children, callback);
-    mutex_unlock(&desc->offset_lock);
+    dentry_close_cursor(desc, &node->children);
     mutex_unlock(&node->children_lock);
-    return rc;
+    return 0;
 }
 
 static int tmpfs_link_child(struct inode* inode, const char* name,
                             struct inode* child) {
     tmpfs_inode* node = (tmpfs_inode*)inode;
     mutex_lock(&node->children_lock);
-    int rc = dentry_append(&node->children, name, child);
+    int rc = dentry_append(&node->children, &node->next_cookie, name, child);
     mutex_unlock(&node->children_lock);
     inode_unref(inode);
     return rc;
@@ -158,13 +122,12 @@ static file_ops dir_fops = {.destroy_inode = tmpfs_destroy_inode,
                             .link_child = tmpfs_link_child,
                             .unlink_child = tmpfs_unlink_child,
                             .stat = tmpfs_stat,
-                            .getdents = tmpfs_getdents};
+                            .close = tmpfs_close_dir,
+                            .getdents = tmpfs_getdents,
+                            .cache_lookups = true};
 static file_ops non_dir_fops = {.destroy_inode = tmpfs_destroy_inode,
                                 .stat = tmpfs_stat,
-                                .read = tmpfs_read,
-                                .write = tmpfs_write,
-                                .mmap = tmpfs_mmap,
-                                .truncate = tmpfs_truncate};
+                                .cache_pages = true};
 
 static struct inode* tmpfs_create_child(struct inode* inode, const char* name,
                                         mode_t mode) {
@@ -38,6 +38,7 @@
  */
 
 #include "fs.h"
+#include "dcache.h"
 #include <common/string.h>
 #include <kernel/api/fcntl.h>
 #include <kernel/api/sys/sysmacros.h>
@@ -52,16 +53,79 @@ typedef struct mount_point {
     struct mount_point* next;
 } mount_point;
 
+#define NUM_DEVICE_BUCKETS 64
+
 typedef struct device {
     struct inode* inode;
-    struct device* next;
+    struct device* next; // next device in the same bucket
 } device;
 
 static struct inode* root;
+
+// protects mount_points and the mounted field of the inodes. path walks only
+// take it when they step on an inode that has something mounted on it.
+static mutex mount_lock;
 static mount_point* mount_points;
-static device* devices;
 
-static int mount_at(struct inode* host, struct inode* guest) {
+static device* devices[NUM_DEVICE_BUCKETS];
+
+static device** device_bucket(dev_t id) {
+    return devices + (id ^ (id >> 8)) % NUM_DEVICE_BUCKETS;
+}
+
+static bool is_absolute_path(const char* path) {
+    return path[0] == PATH_SEPARATOR;
+}
+
+static bool is_root_path(const char* path) {
+    return path[0] == PATH_SEPARATOR && path[1] == '\0';
+}
+
+static struct inode* resolve_path_at(file_description* base,
+                                     const char* pathname,
+                                     struct inode** out_parent,
+                                     char** out_basename,
+                                     bool cross_last_mount);
+
+// resolves the directory at the path without crossing into what is mounted
+// on it
+static struct inode* resolve_mount_host(const char* path) {
+    struct inode* host = resolve_path_at(NULL, path, NULL, NULL, false);
+    if (IS_OK(host) && !S_ISDIR(host->mode)) {
+        inode_unref(host);
+        return ERR_PTR(-ENOTDIR);
+    }
+    return host;
+}
+
+int vfs_mount(const char* path, struct inode* guest) {
+    ASSERT(is_absolute_path(path));
+
+    if (!S_ISDIR(guest->mode)) {
+        inode_unref(guest);
+        return -ENOTDIR;
+    }
+
+    if (is_root_path(path)) {
+        mutex_lock(&mount_lock);
+        bool busy = root;
+        if (!busy)
+            root = guest;
+        mutex_unlock(&mount_lock);
+        if (busy) {
+            inode_unref(guest);
+            return -EBUSY;
+        }
+        return 0;
+    }
+
+    // the path may cross other mount points, except at the last component
+    struct inode* host = resolve_mount_host(path);
+    if (IS_ERR(host)) {
+        inode_unref(guest);
+        return PTR_ERR(host);
+    }
+
     mount_point* mp = kmalloc(sizeof(mount_point));
     if (!mp) {
         inode_unref(host);
@@ -70,70 +134,89 @@ static int mount_at(struct inode* host, struct inode* guest) {
     }
     mp->host = host;
     mp->guest = guest;
-    mp->next = NULL;
-    if (mount_points) {
-        mount_point* it = mount_points;
-        while (it->next)
-            it = it->next;
-        it->next = mp;
-    } else {
-        mount_points = mp;
-    }
-    return 0;
-}
 
-static struct inode* find_mounted_guest(struct inode* host) {
-    mount_point* it = mount_points;
-    while (it) {
-        if (it->host == host) {
-            inode_unref(host);
-            inode_ref(it->guest);
-            return it->guest;
-        }
-        it = it->next;
+    mutex_lock(&mount_lock);
+    if (host->mounted) {
+        mutex_unlock(&mount_lock);
+        kfree(mp);
+        inode_unref(host);
+        inode_unref(guest);
+        return -EBUSY;
     }
-    inode_unref(host);
-    return NULL;
-}
-
-static bool is_absolute_path(const char* path) {
-    return path[0] == PATH_SEPARATOR;
+    mp->next = mount_points;
+    mount_points = mp;
+    host->mounted = guest;
+    mutex_unlock(&mount_lock);
+    return 0;
 }
 
-int vfs_mount(const char* path, struct inode* fs_root) {
+int vfs_umount(const char* path) {
     ASSERT(is_absolute_path(path));
-
-    if (path[0] == PATH_SEPARATOR && path[1] == '\0') {
-        root = fs_root;
-        return 0;
+    if (is_root_path(path))
+        return -EBUSY;
+
+    struct inode* host = resolve_mount_host(path);
+    if (IS_ERR(host))
+        return PTR_ERR(host);
+
+    mutex_lock(&mount_lock);
+    mount_point** it = &mount_points;
+    while (*it && (*it)->host != host)
+        it = &(*it)->next;
+    mount_point* mp = *it;
+    if (!mp) {
+        mutex_unlock(&mount_lock);
+        inode_unref(host);
+        return -EINVAL;
     }
 
-    char* dup_path = kstrdup(path);
-    ASSERT(dup_path);
-
-    struct inode* parent = vfs_get_root();
-    char* saved_ptr;
-    for (const char* component =
-             strtok_r(dup_path, PATH_SEPARATOR_STR, &saved_ptr);
-         component;
-         component = strtok_r(NULL, PATH_SEPARATOR_STR, &saved_ptr)) {
-        struct inode* child = inode_lookup_child(parent, component);
-        if (IS_ERR(child)) {
-            kfree(dup_path);
-            return PTR_ERR(child);
+    // whatever is mounted inside the file system would become unreachable.
+    // a bind mount of a subdirectory leaves the file system mounted where it
+    // was, so it can always go away.
+    struct inode* guest = mp->guest;
+    bool is_fs_root = guest->fs_root_inode == guest;
+    if (is_fs_root) {
+        for (mount_point* other = mount_points; other; other = other->next) {
+            if (other->host->fs_root_inode == guest) {
+                mutex_unlock(&mount_lock);
+                inode_unref(host);
+                return -EBUSY;
+            }
         }
-        parent = child;
     }
 
-    kfree(dup_path);
+    *it = mp->next;
+    host->mounted = NULL;
+    mutex_unlock(&mount_lock);
 
-    int rc = mount_at(parent, fs_root);
-    if (IS_ERR(rc))
-        return rc;
+    // the file system is torn down once the last reference to it is dropped,
+    // so the cached lookups shouldn't hold on to it
+    if (is_fs_root)
+        dcache_invalidate_fs(guest);
 
+    inode_unref(mp->host);
+    inode_unref(mp->guest);
+    kfree(mp);
+    inode_unref(host);
     return 0;
 }
 
+// returns what is mounted on host in place of host, or host itself
+static struct inode* cross_mount(struct inode* host) {
+    if (!host->mounted)
+        return host;
+
+    mutex_lock(&mount_lock);
+    struct inode* guest = host->mounted;
+    if (guest)
+        inode_ref(guest);
+    mutex_unlock(&mount_lock);
+    if (!guest)
+        return host;
+    inode_unref(host);
+    return guest;
+}
+
 struct inode* vfs_get_root(void) {
     ASSERT(root);
     inode_ref(root);
@@ -141,195 +224,141 @@ struct inode* vfs_get_root(void) {
 }
 
 int vfs_register_device(struct inode* inode) {
-    device** dest = &devices;
-    if (devices) {
-        device* it = devices;
-        for (;;) {
-            if (it->inode->device_id == inode->device_id) {
-                inode_unref(inode);
-                return -EEXIST;
-            }
-            if (!it->next)
-                break;
-            it = it->next;
+    device** bucket = device_bucket(inode->device_id);
+    for (device* it = *bucket; it; it = it->next) {
+        if (it->inode->device_id == inode->device_id) {
+            inode_unref(inode);
+            return -EEXIST;
         }
-        dest = &it->next;
     }
     device* dev = kmalloc(sizeof(device));
     if (!dev)
         return -ENOMEM;
     dev->inode = inode;
-    dev->next = NULL;
-    *dest = dev;
+    dev->next = *bucket;
+    *bucket = dev;
     return 0;
 }
 
 static struct inode* find_device(dev_t id) {
-    device* it = devices;
-    while (it) {
+    for (device* it = *device_bucket(id); it; it = it->next) {
         if (it->inode->device_id == id) {
             inode_ref(it->inode);
             return it->inode;
         }
-        it = it->next;
     }
     return NULL;
 }
 
-typedef struct list_node {
-    char* value;
-    struct list_node* next;
-} list_node;
-
-static void list_destroy(list_node** list) {
-    list_node* it = *list;
-    while (it) {
-        list_node* next = it->next;
-        kfree(it->value);
-        kfree(it);
-        it = next;
-    }
-    *list = NULL;
-}
-
-static int list_push(list_node** list, const char* value) {
-    list_node* node = kmalloc(sizeof(list_node));
-    if (!node)
-        return -ENOMEM;
-    node->value = kstrdup(value);
-    if (!node->value) {
-        kfree(node);
-        return -ENOMEM;
-    }
-
-    node->next = NULL;
-    if (*list) {
-        list_node* it = *list;
-        while (it->next)
-            it = it->next;
-        it->next = node;
-    } else {
-        *list = node;
-    }
-    return 0;
+// a path split into its components, which are stored back to back in buf,
+// each terminated by a null character. "." and ".." are resolved lexically
+// while splitting, so walking the result never has to go back up the tree.
+struct path_walk {
+    char buf[PATH_MAX];
+    size_t len;
+    size_t num_components;
+    size_t num_parents; // ".." components that went above the start
+};
+
+static void path_walk_init(struct path_walk* walk) {
+    walk->len = 0;
+    walk->num_components = 0;
+    walk->num_parents = 0;
 }
 
-static void list_pop(list_node** list) {
-    list_node* prev = NULL;
-    list_node* it = *list;
-    while (it) {
-        if (!it->next)
-            break;
-        prev = it;
-        it = it->next;
-    }
-    if (prev)
-        prev->next = NULL;
-    else
-        *list = NULL;
-    if (it) {
-        kfree(it->value);
-        kfree(it);
-    }
+static void pop_component(struct path_walk* walk) {
+    ASSERT(walk->num_components > 0);
+    --walk->len; // null terminator of the last component
+    while (walk->len > 0 && walk->buf[walk->len - 1] != '\0')
+        --walk->len;
+    --walk->num_components;
 }
 
-static int create_path_component_list(const char* pathname,
-                                      list_node** out_list,
-                                      size_t* out_num_components) {
-    if (pathname[0] == PATH_SEPARATOR && pathname[1] == '\0') {
-        if (out_list)
-            *out_list = NULL;
-        if (out_num_components)
-            *out_num_components = 0;
-        return 0;
-    }
-
-    list_node* list = NULL;
-    size_t num_components = 0;
-
-    if (!is_absolute_path(pathname)) {
-        char* dup_cwd = kstrdup(current->cwd_path);
-        if (!dup_cwd)
-            return -ENOMEM;
-
-        char* saved_ptr;
-        for (const char* component =
-                 strtok_r(dup_cwd, PATH_SEPARATOR_STR, &saved_ptr);
-             component;
-             component = strtok_r(NULL, PATH_SEPARATOR_STR, &saved_ptr)) {
-            int rc = list_push(&list, component);
-            if (IS_ERR(rc)) {
-                list_destroy(&list);
-                kfree(dup_cwd);
-                return rc;
-            }
-            ++num_components;
+NODISCARD static int split_path(struct path_walk* walk, const char* path) {
+    const char* p = path;
+    for (;;) {
+        while (*p == PATH_SEPARATOR)
+            ++p;
+        if (!*p)
+            return 0;
+
+        const char* end = p;
+        while (*end && *end != PATH_SEPARATOR)
+            ++end;
+        size_t len = end - p;
+
+        if (len == 1 && p[0] == '.') {
+            // nothing to do
+        } else if (len == 2 && p[0] == '.' && p[1] == '.') {
+            if (walk->num_components > 0)
+                pop_component(walk);
+            else
+                ++walk->num_parents;
+        } else {
+            if (walk->len + len + 1 > sizeof(walk->buf))
+                return -ENAMETOOLONG;
+            memcpy(walk->buf + walk->len, p, len);
+            walk->buf[walk->len + len] = '\0';
+            walk->len += len + 1;
+            ++walk->num_components;
         }
 
-        kfree(dup_cwd);
+        p = end;
     }
+}
 
-    char* dup_path = kstrdup(pathname);
-    if (!dup_path)
-        return -ENOMEM;
-
-    char* saved_ptr;
-    for (const char* component =
-             strtok_r(dup_path, PATH_SEPARATOR_STR, &saved_ptr);
-         component;
-         component = strtok_r(NULL, PATH_SEPARATOR_STR, &saved_ptr)) {
-        if (component[0] == '.' && component[1] == '\0')
-            continue;
-        if (!strcmp(component, "..")) {
-            if (num_components > 0) { // "/.." becomes "/"
-                list_pop(&list);
-                --num_components;
-            }
-            continue;
-        }
-        int rc = list_push(&list, component);
-        if (IS_ERR(rc)) {
-            list_destroy(&list);
-            kfree(dup_path);
-            return rc;
-        }
-        ++num_components;
-    }
+// splits pathname and returns the inode the walk starts from. relative paths
+// start from base (the working directory if base is NULL), unless they go
+// above it, in which case base's path is walked from the root instead.
+static struct inode* start_walk(struct path_walk* walk, file_description* base,
+                                const char* pathname) {
+    path_walk_init(walk);
+    int rc = split_path(walk, pathname);
+    if (IS_ERR(rc))
+        return ERR_PTR(rc);
 
-    kfree(dup_path);
+    if (is_absolute_path(pathname))
+        return vfs_get_root();
 
-    if (out_list)
-        *out_list = list;
-    else
-        list_destroy(&list);
-    if (out_num_components)
-        *out_num_components = num_components;
+    struct inode* base_inode = base ? base->inode : current->cwd_inode;
+    const char* base_path = base ? base->path : current->cwd_path;
+    if (!S_ISDIR(base_inode->mode))
+        return ERR_PTR(-ENOTDIR);
 
-    return 0;
-}
+    if (walk->num_parents == 0) {
+        inode_ref(base_inode);
+        return base_inode;
+    }
 
-struct inode* vfs_resolve_path(const char* pathname, struct inode** out_parent,
-                               char** out_basename) {
-    list_node* component_list = NULL;
-    size_t num_components = 0;
-    int rc =
-        create_path_component_list(pathname, &component_list, &num_components);
+    if (!base_path)
+        return ERR_PTR(-ENOTSUP);
+    path_walk_init(walk);
+    rc = split_path(walk, base_path);
     if (IS_ERR(rc))
         return ERR_PTR(rc);
+    rc = split_path(walk, pathname);
+    if (IS_ERR(rc))
+        return ERR_PTR(rc);
+    return vfs_get_root();
+}
 
-    if (num_components == 0)
-        return vfs_get_root();
-
-    struct inode* parent = vfs_get_root();
-    size_t i = 0;
-    for (list_node* node = component_list; node; node = node->next) {
-        const char* component = node->value;
-        if (i == num_components - 1) { // last component
+static struct inode* resolve_path_at(file_description* base,
+                                     const char* pathname,
+                                     struct inode** out_parent,
+                                     char** out_basename,
+                                     bool cross_last_mount) {
+    struct path_walk walk;
+    struct inode* parent = start_walk(&walk, base, pathname);
+    if (IS_ERR(parent))
+        return parent;
+
+    const char* component = walk.buf;
+    for (size_t i = 0; i < walk.num_components; ++i) {
+        if (i == walk.num_components - 1) { // last component
             if (out_basename) {
                 char* dup_basename = kstrdup(component);
                 if (!dup_basename) {
                     inode_unref(parent);
-                    list_destroy(&component_list);
                     return ERR_PTR(-ENOMEM);
                 }
                 *out_basename = dup_basename;
@@ -341,67 +370,77 @@ struct inode* vfs_resolve_path(const char* pathname, struct inode** out_parent,
         }
 
         struct inode* child = inode_lookup_child(parent, component);
-        if (IS_ERR(child)) {
-            list_destroy(&component_list);
+        if (IS_ERR(child))
             return child;
-        }
-
-        inode_ref(child);
-        struct inode* guest = find_mounted_guest(child);
-        if (guest) {
-            inode_unref(child);
-            child = guest;
-        }
+        if (cross_last_mount || i < walk.num_components - 1)
+            child = cross_mount(child);
 
         parent = child;
-        ++i;
+        component += strlen(component) + 1;
     }
 
-    list_destroy(&component_list);
     return parent;
 }
 
-char* vfs_canonicalize_path(const char* pathname) {
-    list_node* component_list = NULL;
-    size_t num_components = 0;
-    int rc =
-        create_path_component_list(pathname, &component_list, &num_components);
+struct inode* vfs_resolve_path_at(file_description* base,
+                                  const char* pathname,
+                                  struct inode** out_parent,
+                                  char** out_basename) {
+    return resolve_path_at(base, pathname, out_parent, out_basename, true);
+}
+
+struct inode* vfs_resolve_path(const char* pathname, struct inode** out_parent,
+                               char** out_basename) {
+    return vfs_resolve_path_at(NULL, pathname, out_parent, out_basename);
+}
+
+static char* canonicalize_path_at(file_description* base,
+                                  const char* pathname) {
+    struct path_walk walk;
+    path_walk_init(&walk);
+    int rc = 0;
+    if (!is_absolute_path(pathname)) {
+        const char* base_path = base ? base->path : current->cwd_path;
+        if (!base_path)
+            return ERR_PTR(-ENOTSUP);
+        rc = split_path(&walk, base_path);
+    }
+    if (IS_OK(rc))
+        rc = split_path(&walk, pathname);
     if (IS_ERR(rc))
         return ERR_PTR(rc);
 
-    if (num_components == 0) {
+    if (walk.num_components == 0) {
         char* canonicalized = kstrdup(ROOT_DIR);
         if (!canonicalized)
             return ERR_PTR(-ENOMEM);
         return canonicalized;
     }
 
-    size_t len = 0;
-    for (list_node* node = component_list; node; node = node->next)
-        len += strlen(node->value) + 1;
-
-    char* canonicalized = kmalloc(len + 1);
-    if (!canonicalized) {
-        list_destroy(&component_list);
+    // every null terminator becomes a leading separator
+    char* canonicalized = kmalloc(walk.len + 1);
+    if (!canonicalized)
         return ERR_PTR(-ENOMEM);
+    canonicalized[0] = PATH_SEPARATOR;
+    memcpy(canonicalized + 1, walk.buf, walk.len);
+    for (size_t i = 1; i < walk.len; ++i) {
+        if (canonicalized[i] == '\0')
+            canonicalized[i] = PATH_SEPARATOR;
     }
-    size_t idx = 0;
-    for (list_node* node = component_list; node; node = node->next) {
-        canonicalized[idx++] = PATH_SEPARATOR;
-        strcpy(canonicalized + idx, node->value);
-        idx += strlen(node->value);
-    }
-    canonicalized[idx] = '\0';
-
-    list_destroy(&component_list);
+    canonicalized[walk.len] = '\0';
     return canonicalized;
 }
 
-static struct inode* create_inode(const char* pathname, mode_t mode,
-                                  bool exclusive) {
+char* vfs_canonicalize_path(const char* pathname) {
+    return canonicalize_path_at(NULL, pathname);
+}
+
+static struct inode* create_inode(file_description* base, const char* pathname,
+                                  mode_t mode, bool exclusive) {
     struct inode* parent = NULL;
     char* basename = NULL;
-    struct inode* inode = vfs_resolve_path(pathname, &parent, &basename);
+    struct inode* inode =
+        vfs_resolve_path_at(base, pathname, &parent, &basename);
     if (IS_OK(inode)) {
         inode_unref(parent);
         kfree(basename);
@@ -435,10 +474,12 @@ static struct inode* create_inode(const char* pathname, mode_t mode,
     return inode;
 }
 
-file_description* vfs_open(const char* pathname, int flags, mode_t mode) {
-    struct inode* inode = (flags & O_CREAT)
-                              ? create_inode(pathname, mode, flags & O_EXCL)
-                              : vfs_resolve_path(pathname, NULL, NULL);
+file_description* vfs_open_at(file_description* base, const char* pathname,
+                              int flags, mode_t mode) {
+    struct inode* inode =
+        (flags & O_CREAT)
+            ? create_inode(base, pathname, mode, flags & O_EXCL)
+            : vfs_resolve_path_at(base, pathname, NULL, NULL);
     if (IS_ERR(inode))
         return ERR_CAST(inode);
 
@@ -450,11 +491,26 @@ file_description* vfs_open(const char* pathname, int flags, mode_t mode) {
         inode = device;
     }
 
-    return inode_open(inode, flags, mode);
+    bool is_dir = S_ISDIR(inode->mode);
+    file_description* desc = inode_open(inode, flags, mode);
+    if (IS_ERR(desc) || !is_dir)
+        return desc;
+
+    // directories remember where they are so that *at() calls can resolve
+    // ".." above them
+    char* path = canonicalize_path_at(base, pathname);
+    if (IS_OK(path))
+        desc->path = path;
+    return desc;
 }
 
-int vfs_stat(const char* pathname, struct stat* buf) {
-    struct inode* inode = vfs_resolve_path(pathname, NULL, NULL);
+file_description* vfs_open(const char* pathname, int flags, mode_t mode) {
+    return vfs_open_at(NULL, pathname, flags, mode);
+}
+
+int vfs_stat_at(file_description* base, const char* pathname,
+                struct stat* buf) {
+    struct inode* inode = vfs_resolve_path_at(base, pathname, NULL, NULL);
     if (IS_ERR(inode))
         return PTR_ERR(inode);
 
@@ -469,6 +525,15 @@ int vfs_stat(const char* pathname, struct stat* buf) {
     return inode_stat(inode, buf);
 }
 
+int vfs_stat(const char* pathname, struct stat* buf) {
+    return vfs_stat_at(NULL, pathname, buf);
+}
+
+struct inode* vfs_create_at(file_description* base, const char* pathname,
+                            mode_t mode) {
+    return create_inode(base, pathname, mode, true);
+}
+
 struct inode* vfs_create(const char* pathname, mode_t mode) {
-    return create_inode(pathname, mode, true);
+    return vfs_create_at(NULL, pathname, mode);
 }
@@ -38,6 +38,7 @@
  */
 
 #include "hid.h"
+#include <kernel/api/poll.h>
 #include <kernel/api/sys/sysmacros.h>
 #include <kernel/console/console.h>
 #include <kernel/fs/fs.h>
@@ -282,6 +283,7 @@ static void set_state(uint8_t which, bool pressed) {
 static key_event queue[QUEUE_SIZE];
 static size_t queue_read_idx = 0;
 static size_t queue_write_idx = 0;
+static struct inode* device_inode;
 
 static void irq_handler(registers* reg) {
     (void)reg;
@@ -344,6 +346,8 @@ static void irq_handler(registers* reg) {
 
     received_e0 = false;
 
+    if (device_inode)
+        inode_notify(device_inode);
     fb_console_on_key(event);
 }
 
@@ -399,12 +403,19 @@ static ssize_t ps2_keyboard_device_read(file_description* desc, void* buffer, si
     #endif
 }
 
+static short ps2_keyboard_device_poll(file_description* desc, short events) {
+    if ((events & POLLIN) && read_should_unblock(desc))
+        return POLLIN;
+    return 0;
+}
+
 struct inode* ps2_keyboard_device_create(void) {
     struct inode* inode = kmalloc(sizeof(struct inode));
     if (!inode)
         return ERR_PTR(-ENOMEM);
 
-    static file_ops fops = {.read = ps2_keyboard_device_read};
+    static file_ops fops = {.read = ps2_keyboard_device_read, .poll = ps2_keyboard_device_poll};
     *inode = (struct inode){.fops = &fops, .mode = S_IFCHR, .device_id = makedev(11, 0), .ref_count = 1};
+    device_inode = inode;
     return inode;
 }
@@ -39,6 +39,7 @@
 
 #include "hid.h"
 #include <kernel/api/hid.h>
+#include <kernel/api/poll.h>
 #include <kernel/api/sys/sysmacros.h>
 #include <kernel/fs/fs.h>
 #include <kernel/interrupts.h>
@@ -60,6 +61,7 @@ static size_t state = 0;
 static mouse_event queue[QUEUE_SIZE];
 static size_t queue_read_idx = 0;
 static size_t queue_write_idx = 0;
+static struct inode* device_inode;
 
 /* IRQs are i?86-specific */
 #if defined(__i386__)
@@ -88,6 +90,8 @@ static void irq_handler(registers* reg) {
 
         queue[queue_write_idx] = (mouse_event){dx, -dy, buf[0] & 7};
         queue_write_idx = (queue_write_idx + 1) % QUEUE_SIZE;
+        if (device_inode)
+            inode_notify(device_inode);
 
         state = 0;
         return;
@@ -143,15 +147,23 @@ static ssize_t ps2_mouse_device_read(file_description* desc, void* buffer,
     }
 }
 
+static short ps2_mouse_device_poll(file_description* desc, short events) {
+    if ((events & POLLIN) && read_should_unblock(desc))
+        return POLLIN;
+    return 0;
+}
+
 struct inode* ps2_mouse_device_create(void) {
     struct inode* inode = kmalloc(sizeof(struct inode));
     if (!inode)
         return ERR_PTR(-ENOMEM);
 
-    static file_ops fops = {.read = ps2_mouse_device_read};
+    static file_ops fops = {.read = ps2_mouse_device_read,
+                            .poll = ps2_mouse_device_poll};
     *inode = (struct inode){.fops = &fops,
                             .mode = S_IFCHR,
                             .device_id = makedev(10, 1),
                             .ref_count = 1};
+    device_inode = inode;
     return inode;
 }
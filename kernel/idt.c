@@ -66,18 +66,40 @@ typedef struct idt_pointer {
 #define NUM_IDT_ENTRIES 256
 static idt_descriptor idt[NUM_IDT_ENTRIES];
 static idt_pointer idtr;
-interrupt_handler_fn interrupt_handlers[NUM_IDT_ENTRIES];
+
+// PCI devices may share an interrupt line, so every handler registered for
+// a vector is called, and each checks whether its device raised it
+#define MAX_HANDLERS_PER_VECTOR 4
+static interrupt_handler_fn interrupt_handlers[NUM_IDT_ENTRIES]
+                                              [MAX_HANDLERS_PER_VECTOR];
 
 void idt_register_interrupt_handler(uint8_t num, interrupt_handler_fn handler) {
-    interrupt_handlers[num] = handler;
+    interrupt_handler_fn* handlers = interrupt_handlers[num];
+    for (size_t i = 0; i < MAX_HANDLERS_PER_VECTOR; ++i) {
+        // drivers with several devices on a line register the same handler
+        if (handlers[i] == handler)
+            return;
+        if (!handlers[i]) {
+            handlers[i] = handler;
+            return;
+        }
+    }
+    kprintf("Too many handlers for interrupt %u\n", num);
+    PANIC("Too many handlers for interrupt");
+}
+
+bool idt_dispatch_interrupt(registers* regs) {
+    interrupt_handler_fn* handlers = interrupt_handlers[regs->num];
+    if (!handlers[0])
+        return false;
+    for (size_t i = 0; i < MAX_HANDLERS_PER_VECTOR && handlers[i]; ++i)
+        handlers[i](regs);
+    return true;
 }
 
 void isr_handler(registers* regs) {
-    interrupt_handler_fn handler = interrupt_handlers[regs->num];
-    if (handler) {
-        handler(regs);
+    if (idt_dispatch_interrupt(regs))
         return;
-    }
 
     kprintf("Unhandled interrupt: %u\n", regs->num);
     dump_registers(regs);
@@ -178,11 +200,23 @@ static void handle_exception14(registers* regs) {
     uint32_t present = regs->err_code & 0x1;
     uint32_t write = regs->err_code & 0x2;
     uint32_t user = regs->err_code & 0x4;
+    uint32_t addr = read_cr2();
+
+    // pages of executables are populated lazily. resolving a fault may
+    // block on locks, so it is only done if the faulting code could have
+    // been interrupted anyway.
+    if (regs->eflags & 0x200) {
+        sti();
+        int rc = vm_handle_page_fault(addr, write);
+        cli();
+        if (IS_OK(rc))
+            return;
+    }
 
     kprintf("Page fault (%s%s%s) at 0x%x\n",
             present ? "page-protection " : "non-present ",
             write ? "write " : "read ", user ? "user-mode" : "kernel-mode",
-            read_cr2());
+            addr);
     crash(regs, SIGSEGV);
 }
 
@@ -68,7 +68,10 @@ void idt_flush(void);
 
 typedef void (*interrupt_handler_fn)(registers*);
 
+// handlers registered for the same vector are all called
 void idt_register_interrupt_handler(uint8_t num, interrupt_handler_fn handler);
+// returns false if no handler is registered for the vector
+bool idt_dispatch_interrupt(registers*);
 
 static inline bool interrupts_enabled(void) { return read_eflags() & 0x200; }
 
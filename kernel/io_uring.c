@@ -0,0 +1,333 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "api/err.h"
+#include "api/fcntl.h"
+#include "api/io_uring.h"
+#include "boot_defs.h"
+#include "fs/fs.h"
+#include "io_uring.h"
+#include "memory/memory.h"
+#include "process.h"
+#include "scheduler.h"
+#include "syscall/syscall.h"
+#include <common/extra.h>
+#include <common/string.h>
+
+struct pending_poll {
+    file_description* desc;
+    short events;
+    uint64_t user_data;
+    struct pending_poll* next;
+};
+
+struct io_uring {
+    struct inode inode;
+    mutex lock;
+
+    void* mem;
+    size_t mem_size;
+    struct io_uring_rings* rings;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    unsigned sq_entries;
+    unsigned cq_entries;
+
+    struct pending_poll* polls;
+};
+
+static void io_uring_destroy_inode(struct inode* inode) {
+    io_uring* ring = (io_uring*)inode;
+    struct pending_poll* poll = ring->polls;
+    while (poll) {
+        struct pending_poll* next = poll->next;
+        file_description_close(poll->desc);
+        kfree(poll);
+        poll = next;
+    }
+    kfree(ring->mem);
+    kfree(ring);
+}
+
+static uintptr_t io_uring_mmap(file_description* desc, uintptr_t addr,
+                               size_t length, off_t offset,
+                               uint16_t page_flags) {
+    io_uring* ring = (io_uring*)desc->inode;
+    if (offset != 0 || !(page_flags & PAGE_SHARED))
+        return -ENOTSUP;
+    if (length > ring->mem_size)
+        return -EINVAL;
+    int rc = paging_copy_mapping(addr, (uintptr_t)ring->mem, length, page_flags);
+    if (IS_ERR(rc))
+        return rc;
+    return addr;
+}
+
+static file_ops fops = {.destroy_inode = io_uring_destroy_inode,
+                        .mmap = io_uring_mmap};
+
+static bool is_io_uring(const struct inode* inode) {
+    return inode->fops == &fops;
+}
+
+static bool is_power_of_two(unsigned x) { return x && !(x & (x - 1)); }
+
+struct inode* io_uring_create(unsigned entries, struct io_uring_params* params) {
+    if (!is_power_of_two(entries) || entries > IORING_MAX_ENTRIES)
+        return ERR_PTR(-EINVAL);
+
+    io_uring* ring = kmalloc(sizeof(io_uring));
+    if (!ring)
+        return ERR_PTR(-ENOMEM);
+    *ring = (io_uring){0};
+
+    ring->sq_entries = entries;
+    ring->cq_entries = 2 * entries;
+
+    size_t sqes_offset = round_up(sizeof(struct io_uring_rings), 16);
+    size_t cqes_offset = round_up(
+        sqes_offset + entries * sizeof(struct io_uring_sqe), 16);
+    ring->mem_size = round_up(
+        cqes_offset + ring->cq_entries * sizeof(struct io_uring_cqe),
+        PAGE_SIZE);
+    // the memory is mapped into userland page by page
+    ring->mem = kaligned_alloc(PAGE_SIZE, ring->mem_size);
+    if (!ring->mem) {
+        kfree(ring);
+        return ERR_PTR(-ENOMEM);
+    }
+    memset(ring->mem, 0, ring->mem_size);
+
+    ring->rings = ring->mem;
+    ring->rings->sq_mask = ring->sq_entries - 1;
+    ring->rings->cq_mask = ring->cq_entries - 1;
+    ring->sqes = (struct io_uring_sqe*)((uintptr_t)ring->mem + sqes_offset);
+    ring->cqes = (struct io_uring_cqe*)((uintptr_t)ring->mem + cqes_offset);
+
+    struct inode* inode = &ring->inode;
+    inode->fops = &fops;
+    inode->ref_count = 1;
+
+    *params = (struct io_uring_params){.sq_entries = ring->sq_entries,
+                                       .cq_entries = ring->cq_entries,
+                                       .sqes_offset = sqes_offset,
+                                       .cqes_offset = cqes_offset,
+                                       .ring_size = ring->mem_size};
+    return inode;
+}
+
+static unsigned cq_space(const io_uring* ring) {
+    unsigned tail = atomic_load_explicit(&ring->rings->cq_tail,
+                                         memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->rings->cq_head,
+                                         memory_order_acquire);
+    return ring->cq_entries - (tail - head);
+}
+
+static unsigned cq_ready(const io_uring* ring) {
+    return ring->cq_entries - cq_space(ring);
+}
+
+static void post_completion(io_uring* ring, uint64_t user_data, int res) {
+    unsigned tail = atomic_load_explicit(&ring->rings->cq_tail,
+                                         memory_order_relaxed);
+    ring->cqes[tail & ring->rings->cq_mask] =
+        (struct io_uring_cqe){.user_data = user_data, .res = res};
+    atomic_store_explicit(&ring->rings->cq_tail, tail + 1,
+                          memory_order_release);
+}
+
+static int submit_poll(io_uring* ring, const struct io_uring_sqe* sqe) {
+    file_description* desc = process_get_file_description(sqe->fd);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+
+    short revents = file_description_poll(desc, sqe->poll_events);
+    if (revents)
+        return revents;
+
+    struct pending_poll* poll = kmalloc(sizeof(struct pending_poll));
+    if (!poll)
+        return -ENOMEM;
+    ++desc->ref_count;
+    *poll = (struct pending_poll){.desc = desc,
+                                  .events = sqe->poll_events,
+                                  .user_data = sqe->user_data,
+                                  .next = ring->polls};
+    ring->polls = poll;
+    return 0;
+}
+
+static int do_fsync(int fd) {
+    file_description* desc = process_get_file_description(fd);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+    return file_description_fsync(desc);
+}
+
+static ssize_t pread_or_pwrite(const struct io_uring_sqe* sqe) {
+    file_description* desc = process_get_file_description(sqe->fd);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+    if (sqe->opcode == IORING_OP_PREAD)
+        return file_description_pread(desc, sqe->addr, sqe->len, sqe->off);
+    return file_description_pwrite(desc, sqe->addr, sqe->len, sqe->off);
+}
+
+// executes a submission. returns true if it completed immediately, with the
+// result stored in *res.
+static bool issue(io_uring* ring, const struct io_uring_sqe* sqe, int* res) {
+    switch (sqe->opcode) {
+    case IORING_OP_NOP:
+        *res = 0;
+        return true;
+    case IORING_OP_READ:
+        *res = sys_read(sqe->fd, sqe->addr, sqe->len);
+        return true;
+    case IORING_OP_WRITE:
+        *res = sys_write(sqe->fd, sqe->addr, sqe->len);
+        return true;
+    case IORING_OP_PREAD:
+    case IORING_OP_PWRITE:
+        *res = pread_or_pwrite(sqe);
+        return true;
+    case IORING_OP_OPENAT:
+        if (sqe->fd != AT_FDCWD)
+            *res = -ENOTSUP;
+        else
+            *res = sys_open(sqe->addr, sqe->open_flags, sqe->mode);
+        return true;
+    case IORING_OP_CLOSE:
+        *res = sys_close(sqe->fd);
+        return true;
+    case IORING_OP_FSYNC:
+        *res = do_fsync(sqe->fd);
+        return true;
+    case IORING_OP_POLL:
+        *res = submit_poll(ring, sqe);
+        return *res != 0;
+    }
+    *res = -EINVAL;
+    return true;
+}
+
+static void reap_polls(io_uring* ring) {
+    struct pending_poll** it = &ring->polls;
+    while (*it && cq_space(ring) > 0) {
+        struct pending_poll* poll = *it;
+        short revents = file_description_poll(poll->desc, poll->events);
+        if (!revents) {
+            it = &poll->next;
+            continue;
+        }
+        post_completion(ring, poll->user_data, revents);
+        *it = poll->next;
+        file_description_close(poll->desc);
+        kfree(poll);
+    }
+}
+
+static bool should_unblock(io_uring* ring) {
+    for (struct pending_poll* it = ring->polls; it; it = it->next) {
+        if (file_description_poll(it->desc, it->events))
+            return true;
+    }
+    return false;
+}
+
+static int submit(io_uring* ring, unsigned to_submit) {
+    unsigned num_submitted = 0;
+    while (num_submitted < to_submit) {
+        unsigned head = atomic_load_explicit(&ring->rings->sq_head,
+                                             memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(&ring->rings->sq_tail,
+                                             memory_order_acquire);
+        if (head == tail)
+            break;
+
+        // reserve a completion slot so that no result is ever dropped
+        if (cq_space(ring) == 0) {
+            if (num_submitted == 0)
+                return -EBUSY;
+            break;
+        }
+
+        struct io_uring_sqe sqe = ring->sqes[head & ring->rings->sq_mask];
+        atomic_store_explicit(&ring->rings->sq_head, head + 1,
+                              memory_order_release);
+        ++num_submitted;
+
+        int res;
+        if (issue(ring, &sqe, &res))
+            post_completion(ring, sqe.user_data, res);
+    }
+    return num_submitted;
+}
+
+int io_uring_enter(file_description* desc, unsigned to_submit,
+                   unsigned min_complete, unsigned flags) {
+    if (!is_io_uring(desc->inode))
+        return -EINVAL;
+    io_uring* ring = (io_uring*)desc->inode;
+
+    mutex_lock(&ring->lock);
+
+    reap_polls(ring);
+    int rc = submit(ring, to_submit);
+    if (IS_ERR(rc) || !(flags & IORING_ENTER_GETEVENTS))
+        goto done;
+
+    // everything but polls completes synchronously, so only pending polls
+    // are worth waiting for
+    min_complete = MIN(min_complete, ring->cq_entries);
+    while (cq_ready(ring) < min_complete && ring->polls) {
+        int block_rc =
+            scheduler_block((should_unblock_fn)should_unblock, ring);
+        if (IS_ERR(block_rc)) {
+            if (rc == 0)
+                rc = block_rc;
+            break;
+        }
+        reap_polls(ring);
+    }
+
+done:
+    mutex_unlock(&ring->lock);
+    return rc;
+}
@@ -101,8 +101,6 @@ static void remap_pic(void) {
 ENUMERATE_IRQS(DEFINE_IRQ)
 #undef DEFINE_IRQ
 
-extern interrupt_handler_fn interrupt_handlers[256];
-
 void irq_handler(registers* regs) {
     ASSERT(!interrupts_enabled());
 
@@ -111,9 +109,7 @@ void irq_handler(registers* regs) {
 
     out8(PIC1_CMD, PIC_EOI);
 
-    interrupt_handler_fn handler = interrupt_handlers[regs->num];
-    if (handler)
-        handler(regs);
+    idt_dispatch_interrupt(regs);
 }
 
 void irq_init(void) {
@@ -0,0 +1,224 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "lz4.h"
+#include "api/err.h"
+#include "memory/memory.h"
+#include <common/string.h>
+
+#define FRAME_MAGIC 0x184d2204
+
+#define FLG_VERSION_MASK 0xc0
+#define FLG_VERSION 0x40
+#define FLG_BLOCK_CHECKSUM 0x10
+#define FLG_CONTENT_SIZE 0x08
+#define FLG_DICT_ID 0x01
+
+#define BLOCK_UNCOMPRESSED 0x80000000
+
+#define MIN_MATCH 4
+#define WINDOW_SIZE 65536
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+
+static uint32_t read_le32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool lz4_is_frame(const void* data, size_t size) {
+    return size >= 4 && read_le32(data) == FRAME_MAGIC;
+}
+
+int lz4_stream_init(struct lz4_stream* s, const void* data, size_t size) {
+    *s = (struct lz4_stream){0};
+    const unsigned char* in = data;
+    if (size < 7 || read_le32(in) != FRAME_MAGIC)
+        return -EINVAL;
+
+    unsigned char flg = in[4];
+    if ((flg & FLG_VERSION_MASK) != FLG_VERSION)
+        return -EINVAL;
+    if (flg & FLG_DICT_ID)
+        return -ENOTSUP;
+
+    // the header checksum is not verified
+    size_t header_size = 7;
+    if (flg & FLG_CONTENT_SIZE)
+        header_size += 8;
+    if (size < header_size)
+        return -EINVAL;
+
+    s->window = kmalloc(WINDOW_SIZE);
+    if (!s->window)
+        return -ENOMEM;
+    s->in = in + header_size;
+    s->in_end = in + size;
+    s->block_checksums = flg & FLG_BLOCK_CHECKSUM;
+    return 0;
+}
+
+void lz4_stream_destroy(struct lz4_stream* s) { kfree(s->window); }
+
+static size_t in_left(const struct lz4_stream* s, const unsigned char* end) {
+    return end - s->in;
+}
+
+// lengths of 15 or more continue in the following bytes
+NODISCARD static int read_length(struct lz4_stream* s, size_t* len) {
+    unsigned char b;
+    do {
+        if (s->in >= s->block_end)
+            return -EINVAL;
+        b = *s->in++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+NODISCARD static int next_block(struct lz4_stream* s) {
+    if (s->block_end)
+        s->in = s->block_end + (s->block_checksums ? 4 : 0);
+    if (s->in > s->in_end || in_left(s, s->in_end) < 4)
+        return -EINVAL;
+    uint32_t size = read_le32(s->in);
+    s->in += 4;
+
+    // the content checksum after the end mark is not verified
+    if (size == 0) {
+        s->done = true;
+        return 0;
+    }
+
+    bool uncompressed = size & BLOCK_UNCOMPRESSED;
+    size &= ~BLOCK_UNCOMPRESSED;
+    if (size > in_left(s, s->in_end))
+        return -EINVAL;
+    s->block_end = s->in + size;
+    if (uncompressed)
+        s->literals_left = size;
+    return 0;
+}
+
+NODISCARD static int next_sequence(struct lz4_stream* s) {
+    if (!s->block_end || s->in == s->block_end)
+        return next_block(s);
+
+    unsigned char token = *s->in++;
+    size_t len = token >> 4;
+    if (len == 15) {
+        int rc = read_length(s, &len);
+        if (IS_ERR(rc))
+            return rc;
+    }
+    if (len > in_left(s, s->block_end))
+        return -EINVAL;
+
+    // the last sequence of a block consists only of literals
+    s->literals_left = len;
+    s->has_match = len < in_left(s, s->block_end);
+    s->match_token = token & 0xf;
+    return 0;
+}
+
+NODISCARD static int start_match(struct lz4_stream* s) {
+    s->has_match = false;
+    if (in_left(s, s->block_end) < 2)
+        return -EINVAL;
+    size_t offset = s->in[0] | (s->in[1] << 8);
+    s->in += 2;
+    if (offset == 0 || offset > s->pos)
+        return -EINVAL;
+
+    size_t len = s->match_token;
+    if (len == 15) {
+        int rc = read_length(s, &len);
+        if (IS_ERR(rc))
+            return rc;
+    }
+    s->match_offset = offset;
+    s->match_left = len + MIN_MATCH;
+    return 0;
+}
+
+static void append_to_window(struct lz4_stream* s, const unsigned char* data,
+                             size_t count) {
+    while (count > 0) {
+        size_t start = s->pos & WINDOW_MASK;
+        size_t n = MIN(count, WINDOW_SIZE - start);
+        memcpy(s->window + start, data, n);
+        s->pos += n;
+        data += n;
+        count -= n;
+    }
+}
+
+ssize_t lz4_stream_read(struct lz4_stream* s, void* dest, size_t count) {
+    unsigned char* out = dest;
+    size_t total = 0;
+    while (total < count) {
+        if (s->literals_left > 0) {
+            size_t n = MIN(s->literals_left, count - total);
+            memcpy(out + total, s->in, n);
+            append_to_window(s, s->in, n);
+            s->in += n;
+            s->literals_left -= n;
+            total += n;
+            continue;
+        }
+        if (s->match_left > 0) {
+            // copied byte by byte because a match may overlap itself
+            size_t n = MIN(s->match_left, count - total);
+            for (size_t i = 0; i < n; ++i) {
+                unsigned char c =
+                    s->window[(s->pos - s->match_offset) & WINDOW_MASK];
+                s->window[s->pos & WINDOW_MASK] = c;
+                out[total + i] = c;
+                ++s->pos;
+            }
+            s->match_left -= n;
+            total += n;
+            continue;
+        }
+        if (s->done)
+            break;
+        int rc = s->has_match ? start_match(s) : next_sequence(s);
+        if (IS_ERR(rc))
+            return rc;
+    }
+    return total;
+}
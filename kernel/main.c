@@ -39,6 +39,8 @@
 
 #include "../common/escp.h"
 #include "api/sys/stat.h"
+#include "block/block.h"
+#include "block/buffer_cache.h"
 #include "boot_defs.h"
 #include "console/console.h"
 #include "graphics/graphics.h"
@@ -229,6 +231,21 @@ void start(uint32_t mb_magic, uintptr_t mb_info_paddr) {
         create_char_device("/dev/dsp", ac97_device_create());
     #endif
 
+    /*
+     *  Initialize the IDE driver, which creates a block device named `hd?` (`/dev/hda` for the primary master) for every hard disk
+     *  it finds, and the virtio-blk driver, which does the same with `vd?` for every virtio disk. Like the AC97 driver, they are
+     *  i?86-only for now.
+     */
+    #if defined(__i386__)
+    ide_init();
+    virtio_blk_init();
+    #endif
+
+    /*
+     *  Create a RAM disk named `ram0` if the initrd contains a disk image, so that a file system image can be mounted without a disk.
+     */
+    ramdisk_init();
+
     /*
      *  Initialize the serial console, and serial ports COM1-COM3 as character devices. These character devices are known as `ttyS?`. The serial driver however, is
      *  initialized way earlier.
@@ -260,6 +277,11 @@ void start(uint32_t mb_magic, uintptr_t mb_info_paddr) {
     #if defined(__i386__)
     pit_init();
     #endif
+
+    /*
+     *  Start the flusher, which writes the data that was written to block devices back to the devices in the background.
+     */
+    buffer_cache_init();
     
     kprintf("%s%s[%s+%s] %s%sInitialization done%s\n", BOLD, F_CYAN, F_BLUE, F_CYAN, RESET, F_GREEN, RESET);
 
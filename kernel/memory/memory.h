@@ -40,6 +40,7 @@
 #pragma once
 
 #include <common/extra.h>
+#include <kernel/api/sys/types.h>
 #include <kernel/forward.h>
 #include <kernel/lock.h>
 #include <stddef.h>
@@ -60,10 +61,12 @@ typedef struct range_allocator {
 
 NODISCARD int range_allocator_init(range_allocator* allocator, uintptr_t start, uintptr_t end);
 uintptr_t range_allocator_alloc(range_allocator* allocator, size_t size);
+NODISCARD int range_allocator_alloc_at(range_allocator* allocator, uintptr_t addr, size_t size);
 NODISCARD int range_allocator_free(range_allocator* allocator, uintptr_t addr, size_t size);
 
 extern range_allocator kernel_vaddr_allocator;
 
+#define PAGE_PRESENT 0x1
 #define PAGE_WRITE 0x2
 #define PAGE_USER 0x4
 #define PAGE_PAT 0x80
@@ -73,6 +76,10 @@ extern range_allocator kernel_vaddr_allocator;
 // linked, not copied, when cloning a page directory
 #define PAGE_SHARED 0x200
 
+// read-only page that gets a private copy on the first write. like
+// PAGE_SHARED, it is linked when cloning a page directory.
+#define PAGE_COW 0x400
+
 void paging_init(const multiboot_info_t*);
 
 uintptr_t paging_virtual_to_physical_addr(uintptr_t virtual_addr);
@@ -87,6 +94,63 @@ NODISCARD int paging_map_to_free_pages(uintptr_t virtual_addr, uintptr_t size, u
 NODISCARD int paging_map_to_physical_range(uintptr_t virtual_addr, uintptr_t physical_addr, uintptr_t size, uint16_t flags);
 NODISCARD int paging_copy_mapping(uintptr_t to_virtual_addr, uintptr_t from_virtual_addr, uintptr_t size, uint16_t flags);
 void paging_unmap(uintptr_t virtual_addr, uintptr_t size);
+void paging_protect(uintptr_t virtual_addr, uintptr_t size, uint16_t flags);
+uint16_t paging_get_page_flags(uintptr_t virtual_addr);
+NODISCARD int paging_copy_on_write(uintptr_t virtual_addr);
+
+// part of a userland address space whose pages are populated on the first
+// access instead of up front. the bytes in [data_start, data_end) come from
+// desc starting at offset, and the rest of the region is zero-filled.
+// regions with PAGE_SHARED in page_flags are shared mappings of desc, which
+// are populated up front.
+typedef struct vm_region {
+    uintptr_t start, end;
+    uintptr_t data_start, data_end;
+    file_description* desc;
+    off_t offset;
+    uint16_t page_flags;
+
+    // read-only pages are shared through the exec cache, where the region
+    // starts at image_page in the image's page array
+    struct exec_image* image;
+    size_t image_page;
+} vm_region;
+
+NODISCARD int vm_regions_clone(vm_region** out_regions, const vm_region* regions, size_t count);
+void vm_regions_destroy(vm_region* regions, size_t count);
+
+// these operate on the regions of the current process
+vm_region* vm_find_region(uintptr_t virtual_addr);
+// the region takes over the reference to desc
+NODISCARD int vm_add_region(const vm_region*);
+// drops the parts of the regions in [start, end), splitting regions that
+// extend past both ends of the range
+NODISCARD int vm_remove_regions(uintptr_t start, uintptr_t end);
+NODISCARD int vm_handle_page_fault(uintptr_t virtual_addr, bool write);
+NODISCARD int vm_populate(uintptr_t virtual_addr, size_t size, bool write);
+
+// sparse array of pages indexed by page number. it is kept as a radix tree,
+// so only the pages that were actually allocated and the nodes leading to
+// them cost memory. pages are mapped in the kernel address space.
+typedef struct page_tree {
+    struct page_tree_node* root;
+    size_t height;
+    size_t num_pages;
+} page_tree;
+
+// returns the kernel virtual address of the page, or 0 if it is a hole
+uintptr_t page_tree_get(const page_tree*, size_t index);
+// allocates a zero-filled page if the index is a hole
+NODISCARD uintptr_t page_tree_get_or_alloc(page_tree*, size_t index);
+// like page_tree_get_or_alloc, but a page that is mapped read-only is first
+// replaced with a writable copy of it
+NODISCARD uintptr_t page_tree_get_writable(page_tree*, size_t index);
+// puts a page that is already mapped at a hole. the tree takes over the
+// mapping and unmaps it when the page is freed.
+NODISCARD int page_tree_insert(page_tree*, size_t index, uintptr_t page);
+// frees the pages with indices in [start, end)
+void page_tree_free_range(page_tree*, size_t start, size_t end);
+void page_tree_destroy(page_tree*);
 
 void* kmalloc(size_t size);
 void* kaligned_alloc(size_t alignment, size_t size);
@@ -103,6 +167,16 @@ struct physical_memory_info {
 
 void page_allocator_init(const multiboot_info_t* mb_info);
 uintptr_t page_allocator_alloc(void);
+// allocates physically contiguous pages, e.g. for devices that access memory
+// through DMA without scatter-gather. this is a linear search, so it is meant
+// for allocations made once at initialization.
+uintptr_t page_allocator_alloc_contiguous(size_t num_pages);
+// turns pages that were reserved at boot (e.g. of a multiboot module) into
+// ordinary pages with a single reference held by the caller. they return to
+// the allocator once all the references are dropped.
+void page_allocator_unreserve(uintptr_t physical_addr, size_t size);
 void page_allocator_ref_page(uintptr_t physical_addr);
 void page_allocator_unref_page(uintptr_t physical_addr);
+// a saturated count is reported as UINT8_MAX
+uint8_t page_allocator_get_ref_count(uintptr_t physical_addr);
 void page_allocator_get_info(struct physical_memory_info* out_memory_info);
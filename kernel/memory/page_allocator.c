@@ -198,6 +198,53 @@ uintptr_t page_allocator_alloc(void) {
     return first_set * PAGE_SIZE;
 }
 
+uintptr_t page_allocator_alloc_contiguous(size_t num_pages) {
+    ASSERT(num_pages > 0);
+    mutex_lock(&lock);
+
+    size_t run_length = 0;
+    for (size_t i = 0; i < bitmap_len * 32; ++i) {
+        if (!bitmap_get(i)) {
+            run_length = 0;
+            continue;
+        }
+        if (++run_length < num_pages)
+            continue;
+
+        size_t first = i + 1 - num_pages;
+        for (size_t j = first; j <= i; ++j) {
+            bitmap_clear(j);
+            ASSERT(ref_counts[j] == 0);
+            ref_counts[j] = 1;
+        }
+        memory_info.free -= num_pages * PAGE_SIZE / 1024;
+
+        mutex_unlock(&lock);
+        return first * PAGE_SIZE;
+    }
+
+    mutex_unlock(&lock);
+    kputs("Out of physically contiguous pages\n");
+    return -ENOMEM;
+}
+
+void page_allocator_unreserve(uintptr_t physical_addr, size_t size) {
+    ASSERT(physical_addr % PAGE_SIZE == 0);
+    ASSERT(size % PAGE_SIZE == 0);
+
+    mutex_lock(&lock);
+
+    for (size_t i = 0; i < size / PAGE_SIZE; ++i) {
+        size_t idx = physical_addr / PAGE_SIZE + i;
+        ASSERT(!bitmap_get(idx));
+        ASSERT(ref_counts[idx] == UINT8_MAX);
+        ref_counts[idx] = 1;
+    }
+    memory_info.total += size / 1024;
+
+    mutex_unlock(&lock);
+}
+
 void page_allocator_ref_page(uintptr_t physical_addr) {
     ASSERT(physical_addr % PAGE_SIZE == 0);
     size_t idx = physical_addr / PAGE_SIZE;
@@ -232,6 +279,14 @@ void page_allocator_unref_page(uintptr_t physical_addr) {
     mutex_unlock(&lock);
 }
 
+uint8_t page_allocator_get_ref_count(uintptr_t physical_addr) {
+    ASSERT(physical_addr % PAGE_SIZE == 0);
+    mutex_lock(&lock);
+    uint8_t ref_count = ref_counts[physical_addr / PAGE_SIZE];
+    mutex_unlock(&lock);
+    return ref_count;
+}
+
 void page_allocator_get_info(struct physical_memory_info* out_memory_info) {
     mutex_lock(&lock);
     *out_memory_info = memory_info;
@@ -0,0 +1,228 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "memory.h"
+#include <common/extra.h>
+#include <common/string.h>
+#include <kernel/api/err.h>
+#include <kernel/boot_defs.h>
+#include <kernel/panic.h>
+
+// a node is small enough that it fits in a single page along with the
+// kmalloc header
+#define PAGE_TREE_SHIFT 9
+#define PAGE_TREE_FANOUT (1 << PAGE_TREE_SHIFT)
+#define PAGE_TREE_MASK (PAGE_TREE_FANOUT - 1)
+
+struct page_tree_node {
+    // child nodes, or kernel virtual addresses of pages in the bottom level
+    void* slots[PAGE_TREE_FANOUT];
+};
+
+// number of pages a single slot covers at the given level
+static size_t slot_span(size_t level) {
+    return (size_t)1 << ((level - 1) * PAGE_TREE_SHIFT);
+}
+
+static bool covers(size_t height, size_t index) {
+    size_t shift = height * PAGE_TREE_SHIFT;
+    return shift >= sizeof(size_t) * 8 || index < ((size_t)1 << shift);
+}
+
+static struct page_tree_node* alloc_node(void) {
+    struct page_tree_node* node = kmalloc(sizeof(struct page_tree_node));
+    if (node)
+        memset(node, 0, sizeof(struct page_tree_node));
+    return node;
+}
+
+static uintptr_t alloc_page(void) {
+    uintptr_t addr = range_allocator_alloc(&kernel_vaddr_allocator, PAGE_SIZE);
+    if (IS_ERR(addr))
+        return addr;
+    int rc = paging_map_to_free_pages(addr, PAGE_SIZE, PAGE_WRITE | PAGE_GLOBAL);
+    if (IS_ERR(rc)) {
+        ASSERT_OK(range_allocator_free(&kernel_vaddr_allocator, addr, PAGE_SIZE));
+        return rc;
+    }
+    memset((void*)addr, 0, PAGE_SIZE);
+    return addr;
+}
+
+static void free_page(uintptr_t addr) {
+    paging_unmap(addr, PAGE_SIZE);
+    ASSERT_OK(range_allocator_free(&kernel_vaddr_allocator, addr, PAGE_SIZE));
+}
+
+uintptr_t page_tree_get(const page_tree* tree, size_t index) {
+    if (!tree->root || !covers(tree->height, index))
+        return 0;
+    struct page_tree_node* node = tree->root;
+    for (size_t level = tree->height; level > 1; --level) {
+        node = node->slots[(index / slot_span(level)) & PAGE_TREE_MASK];
+        if (!node)
+            return 0;
+    }
+    return (uintptr_t)node->slots[index & PAGE_TREE_MASK];
+}
+
+// adds levels on top of the root until index fits in the tree
+NODISCARD static int grow(page_tree* tree, size_t index) {
+    if (!tree->root) {
+        tree->root = alloc_node();
+        if (!tree->root)
+            return -ENOMEM;
+        tree->height = 1;
+    }
+    while (!covers(tree->height, index)) {
+        struct page_tree_node* new_root = alloc_node();
+        if (!new_root)
+            return -ENOMEM;
+        new_root->slots[0] = tree->root;
+        tree->root = new_root;
+        ++tree->height;
+    }
+    return 0;
+}
+
+// returns the slot for the index, creating the nodes leading to it
+static void** get_or_create_slot(page_tree* tree, size_t index) {
+    int rc = grow(tree, index);
+    if (IS_ERR(rc))
+        return ERR_PTR(rc);
+
+    struct page_tree_node* node = tree->root;
+    for (size_t level = tree->height; level > 1; --level) {
+        void** slot = &node->slots[(index / slot_span(level)) & PAGE_TREE_MASK];
+        if (!*slot) {
+            *slot = alloc_node();
+            if (!*slot)
+                return ERR_PTR(-ENOMEM);
+        }
+        node = *slot;
+    }
+    return &node->slots[index & PAGE_TREE_MASK];
+}
+
+uintptr_t page_tree_get_or_alloc(page_tree* tree, size_t index) {
+    void** slot = get_or_create_slot(tree, index);
+    if (IS_ERR(slot))
+        return PTR_ERR(slot);
+    if (!*slot) {
+        uintptr_t page = alloc_page();
+        if (IS_ERR(page))
+            return page;
+        *slot = (void*)page;
+        ++tree->num_pages;
+    }
+    return (uintptr_t)*slot;
+}
+
+uintptr_t page_tree_get_writable(page_tree* tree, size_t index) {
+    uintptr_t page = page_tree_get_or_alloc(tree, index);
+    if (IS_ERR(page) || (paging_get_page_flags(page) & PAGE_WRITE))
+        return page;
+
+    uintptr_t copy = alloc_page();
+    if (IS_ERR(copy))
+        return copy;
+    memcpy((void*)copy, (void*)page, PAGE_SIZE);
+    free_page(page);
+
+    void** slot = get_or_create_slot(tree, index);
+    ASSERT_OK(slot);
+    *slot = (void*)copy;
+    return copy;
+}
+
+int page_tree_insert(page_tree* tree, size_t index, uintptr_t page) {
+    ASSERT(page % PAGE_SIZE == 0);
+    void** slot = get_or_create_slot(tree, index);
+    if (IS_ERR(slot))
+        return PTR_ERR(slot);
+    ASSERT(!*slot);
+    *slot = (void*)page;
+    ++tree->num_pages;
+    return 0;
+}
+
+// frees the pages of node's subtree in [start, end) and returns whether the
+// node became empty
+static bool free_range(page_tree* tree, struct page_tree_node* node,
+                       size_t level, size_t base, size_t start, size_t end) {
+    size_t span = slot_span(level);
+    bool empty = true;
+    for (size_t i = 0; i < PAGE_TREE_FANOUT; ++i) {
+        void** slot = &node->slots[i];
+        if (!*slot)
+            continue;
+        size_t slot_start = base + i * span;
+        if (slot_start < end && start < slot_start + span) {
+            if (level == 1) {
+                free_page((uintptr_t)*slot);
+                --tree->num_pages;
+                *slot = NULL;
+                continue;
+            }
+            if (free_range(tree, *slot, level - 1, slot_start, start, end)) {
+                kfree(*slot);
+                *slot = NULL;
+                continue;
+            }
+        }
+        empty = false;
+    }
+    return empty;
+}
+
+void page_tree_free_range(page_tree* tree, size_t start, size_t end) {
+    if (!tree->root || start >= end)
+        return;
+    if (free_range(tree, tree->root, tree->height, 0, start, end)) {
+        kfree(tree->root);
+        tree->root = NULL;
+        tree->height = 0;
+    }
+}
+
+void page_tree_destroy(page_tree* tree) {
+    page_tree_free_range(tree, 0, SIZE_MAX);
+    ASSERT(!tree->root);
+    ASSERT(tree->num_pages == 0);
+}
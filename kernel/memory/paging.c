@@ -231,7 +231,8 @@ page_directory* paging_create_page_directory(void) {
 #define QUICKMAP_PAGE 1022
 #define QUICKMAP_PAGE_TABLE 1023
 
-// this is locked in paging_clone_current_page_directory
+// this is locked in paging_clone_current_page_directory and
+// paging_copy_on_write
 static mutex quickmap_lock;
 
 static uintptr_t quickmap(size_t which, uintptr_t paddr, uint32_t flags) {
@@ -269,7 +270,7 @@ uintptr_t clone_page_table(const volatile page_table* src,
             continue;
         }
 
-        if (src->entries[i].raw & PAGE_SHARED) {
+        if (src->entries[i].raw & (PAGE_SHARED | PAGE_COW)) {
             dest_pt->entries[i].raw = src->entries[i].raw;
             page_allocator_ref_page(src->entries[i].raw & ~0xfff);
             continue;
@@ -439,4 +440,48 @@ void paging_unmap(uintptr_t vaddr, uintptr_t size) {
         unmap_page(vaddr + offset);
 }
 
+void paging_protect(uintptr_t vaddr, uintptr_t size, uint16_t flags) {
+    ASSERT((vaddr % PAGE_SIZE) == 0);
+    size = round_up(size, PAGE_SIZE);
+
+    for (uintptr_t offset = 0; offset < size; offset += PAGE_SIZE) {
+        volatile page_table_entry* pte = get_pte(vaddr + offset);
+        ASSERT(pte && pte->present);
+        pte->raw = (pte->raw & ~0xfff) | flags;
+        pte->present = true;
+        flush_tlb_single(vaddr + offset);
+    }
+}
+
+uint16_t paging_get_page_flags(uintptr_t vaddr) {
+    const volatile page_table_entry* pte = get_pte(vaddr);
+    if (!pte || !pte->present)
+        return 0;
+    return pte->raw & 0xfff;
+}
+
+int paging_copy_on_write(uintptr_t vaddr) {
+    ASSERT((vaddr % PAGE_SIZE) == 0);
+    volatile page_table_entry* pte = get_pte(vaddr);
+    if (!pte || !pte->present || !(pte->raw & PAGE_COW))
+        return -EFAULT;
+
+    uintptr_t new_paddr = page_allocator_alloc();
+    if (IS_ERR(new_paddr))
+        return new_paddr;
+
+    mutex_lock(&quickmap_lock);
+    uintptr_t new_vaddr = quickmap(QUICKMAP_PAGE, new_paddr, PAGE_WRITE);
+    memcpy((void*)new_vaddr, (void*)vaddr, PAGE_SIZE);
+    unquickmap(QUICKMAP_PAGE);
+    mutex_unlock(&quickmap_lock);
+
+    uintptr_t old_paddr = pte->raw & ~0xfff;
+    pte->raw = new_paddr | ((pte->raw & 0xfff & ~PAGE_COW) | PAGE_WRITE);
+    flush_tlb_single(vaddr);
+    page_allocator_unref_page(old_paddr);
+
+    return 0;
+}
+
 #endif
\ No newline at end of file
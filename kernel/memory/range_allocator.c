@@ -117,6 +117,62 @@ uintptr_t range_allocator_alloc(range_allocator* allocator, size_t size) {
     return (uintptr_t)it;
 }
 
+// reserves exactly [addr, addr + size), which has to be entirely free
+int range_allocator_alloc_at(range_allocator* allocator, uintptr_t addr, size_t size) {
+    ASSERT(allocator->ranges);
+    if (addr % PAGE_SIZE)
+        return -EINVAL;
+    size = round_up(size, PAGE_SIZE);
+    if (size == 0 || addr < allocator->start || addr + size < addr ||
+        allocator->end < addr + size)
+        return -EINVAL;
+
+    mutex_lock(&allocator->lock);
+
+    struct range* prev = NULL;
+    struct range* it = allocator->ranges;
+    while (it && (uintptr_t)it + it->size <= addr) {
+        prev = it;
+        it = it->next;
+    }
+    if (!it || addr < (uintptr_t)it ||
+        (uintptr_t)it + it->size < addr + size) {
+        mutex_unlock(&allocator->lock);
+        return -ENOMEM;
+    }
+
+    struct range* next = it->next;
+    uintptr_t tail_addr = addr + size;
+    size_t tail_size = (uintptr_t)it + it->size - tail_addr;
+    if (tail_size > 0) {
+        int rc = paging_map_to_free_pages(tail_addr, sizeof(struct range), PAGE_WRITE);
+        if (IS_ERR(rc)) {
+            mutex_unlock(&allocator->lock);
+            return rc;
+        }
+        struct range* tail = (struct range*)tail_addr;
+        tail->size = tail_size;
+        tail->next = next;
+        next = tail;
+    }
+
+    if ((uintptr_t)it < addr) {
+        it->size = addr - (uintptr_t)it;
+        it->next = next;
+    } else {
+        if (prev) {
+            prev->next = next;
+        } else {
+            ASSERT(allocator->ranges == it);
+            allocator->ranges = next;
+        }
+        paging_unmap((uintptr_t)it, sizeof(struct range));
+    }
+
+    mutex_unlock(&allocator->lock);
+    return 0;
+}
+
 int range_allocator_free(range_allocator* allocator, uintptr_t addr, size_t size) {
     ASSERT(addr % PAGE_SIZE == 0);
     ASSERT(allocator->ranges);
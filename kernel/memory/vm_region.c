@@ -0,0 +1,296 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "memory.h"
+#include <common/extra.h>
+#include <common/string.h>
+#include <kernel/boot_defs.h>
+#include <kernel/exec_cache.h>
+#include <kernel/fs/fs.h>
+#include <kernel/panic.h>
+#include <kernel/process.h>
+
+int vm_regions_clone(vm_region** out_regions, const vm_region* regions,
+                     size_t count) {
+    if (count == 0) {
+        *out_regions = NULL;
+        return 0;
+    }
+
+    vm_region* cloned = kmalloc(count * sizeof(vm_region));
+    if (!cloned)
+        return -ENOMEM;
+    memcpy(cloned, regions, count * sizeof(vm_region));
+    for (size_t i = 0; i < count; ++i) {
+        if (cloned[i].desc)
+            ++cloned[i].desc->ref_count;
+        if (cloned[i].image)
+            exec_image_ref(cloned[i].image);
+    }
+
+    *out_regions = cloned;
+    return 0;
+}
+
+void vm_regions_destroy(vm_region* regions, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (regions[i].desc)
+            file_description_close(regions[i].desc);
+        exec_image_unref(regions[i].image);
+    }
+    kfree(regions);
+}
+
+vm_region* vm_find_region(uintptr_t vaddr) {
+    for (size_t i = 0; i < current->num_vm_regions; ++i) {
+        vm_region* region = current->vm_regions + i;
+        if (region->start <= vaddr && vaddr < region->end)
+            return region;
+    }
+    return NULL;
+}
+
+int vm_add_region(const vm_region* region) {
+    // a vfork() child shares the array with its parent
+    if (current->borrows_pd)
+        return -ENOTSUP;
+
+    vm_region* regions =
+        krealloc(current->vm_regions,
+                 (current->num_vm_regions + 1) * sizeof(vm_region));
+    if (!regions)
+        return -ENOMEM;
+    regions[current->num_vm_regions++] = *region;
+    current->vm_regions = regions;
+    return 0;
+}
+
+static void take_region_refs(const vm_region* region) {
+    if (region->desc)
+        ++region->desc->ref_count;
+    if (region->image)
+        exec_image_ref(region->image);
+}
+
+int vm_remove_regions(uintptr_t start, uintptr_t end) {
+    // the parts of the regions outside the range are kept as regions of
+    // their own
+    bool overlaps = false;
+    size_t num_kept = 0;
+    for (size_t i = 0; i < current->num_vm_regions; ++i) {
+        const vm_region* region = current->vm_regions + i;
+        if (end <= region->start || region->end <= start) {
+            ++num_kept;
+            continue;
+        }
+        overlaps = true;
+        if (region->start < start)
+            ++num_kept;
+        if (end < region->end)
+            ++num_kept;
+    }
+    if (!overlaps)
+        return 0;
+    if (current->borrows_pd)
+        return -ENOTSUP;
+
+    vm_region* regions = NULL;
+    if (num_kept > 0) {
+        regions = kmalloc(num_kept * sizeof(vm_region));
+        if (!regions)
+            return -ENOMEM;
+    }
+
+    size_t num_regions = 0;
+    for (size_t i = 0; i < current->num_vm_regions; ++i) {
+        vm_region* region = current->vm_regions + i;
+        if (end <= region->start || region->end <= start) {
+            regions[num_regions++] = *region;
+            continue;
+        }
+        if (region->start < start) {
+            vm_region* head = regions + num_regions++;
+            *head = *region;
+            head->end = start;
+            take_region_refs(head);
+        }
+        if (end < region->end) {
+            vm_region* tail = regions + num_regions++;
+            *tail = *region;
+            tail->start = end;
+            tail->image_page += (end - region->start) / PAGE_SIZE;
+            take_region_refs(tail);
+        }
+        if (region->desc)
+            file_description_close(region->desc);
+        exec_image_unref(region->image);
+    }
+
+    kfree(current->vm_regions);
+    current->vm_regions = regions;
+    current->num_vm_regions = num_regions;
+    return 0;
+}
+
+// maps the page of the file itself if it is entirely covered by file data,
+// so that every process running the executable shares it
+static int link_file_page(vm_region* region, uintptr_t page) {
+    if (!region->desc || page < region->data_start ||
+        region->data_end < page + PAGE_SIZE)
+        return -ENOTSUP;
+
+    off_t offset = region->offset + (page - region->data_start);
+    if (offset % PAGE_SIZE)
+        return -ENOTSUP;
+
+    uint16_t flags = region->page_flags;
+    if (!(flags & PAGE_SHARED)) {
+        // private mappings get their own copy of a page once written to.
+        // read-only ones are linked like shared ones, and PAGE_COW tells the
+        // file that they don't need to follow later writes to it.
+        flags = PAGE_USER | PAGE_COW;
+        if (!(region->page_flags & PAGE_WRITE))
+            flags |= PAGE_SHARED;
+    }
+    uintptr_t rc =
+        file_description_mmap(region->desc, page, PAGE_SIZE, offset, flags);
+    if (IS_ERR(rc))
+        return rc;
+    return 0;
+}
+
+static int fill_private_page(vm_region* region, uintptr_t page) {
+    int rc = paging_map_to_free_pages(page, PAGE_SIZE, PAGE_USER | PAGE_WRITE);
+    if (IS_ERR(rc))
+        return rc;
+    memset((void*)page, 0, PAGE_SIZE);
+
+    uintptr_t start = MAX(page, region->data_start);
+    uintptr_t end = MIN(page + PAGE_SIZE, region->data_end);
+    if (region->desc && start < end) {
+        off_t offset = region->offset + (start - region->data_start);
+        ssize_t nread = file_description_pread(region->desc, (void*)start,
+                                               end - start, offset);
+        if (IS_ERR(nread)) {
+            paging_unmap(page, PAGE_SIZE);
+            return nread;
+        }
+    }
+
+    if (!(region->page_flags & PAGE_WRITE))
+        paging_protect(page, PAGE_SIZE, PAGE_USER | PAGE_SHARED);
+    return 0;
+}
+
+static int populate_page(vm_region* region, uintptr_t page) {
+    // fall back to a private copy if the file can't lend its page, unless
+    // the mapping is meant to show the file itself
+    int rc = link_file_page(region, page);
+    if (IS_ERR(rc) && !(region->page_flags & PAGE_SHARED))
+        return fill_private_page(region, page);
+    return rc;
+}
+
+// the first process to touch a read-only page populates it and hands it to
+// the image, and later ones map the same physical page
+static int map_image_page(vm_region* region, uintptr_t page) {
+    struct exec_image* image = region->image;
+    size_t idx = region->image_page + (page - region->start) / PAGE_SIZE;
+    ASSERT(idx < image->num_pages);
+
+    mutex_lock(&image->lock);
+    int rc;
+    uintptr_t paddr = image->pages[idx];
+    if (paddr) {
+        rc = paging_map_to_physical_range(page, paddr, PAGE_SIZE,
+                                          PAGE_USER | PAGE_SHARED);
+    } else {
+        rc = populate_page(region, page);
+        if (IS_OK(rc)) {
+            paddr = paging_virtual_to_physical_addr(page);
+            page_allocator_ref_page(paddr);
+            image->pages[idx] = paddr;
+        }
+    }
+    mutex_unlock(&image->lock);
+    return rc;
+}
+
+int vm_handle_page_fault(uintptr_t vaddr, bool write) {
+    if (vaddr >= KERNEL_VADDR)
+        return -EFAULT;
+    vm_region* region = vm_find_region(vaddr);
+    if (!region)
+        return -EFAULT;
+    if (write && !(region->page_flags & PAGE_WRITE))
+        return -EFAULT;
+
+    uintptr_t page = round_down(vaddr, PAGE_SIZE);
+    uint16_t flags = paging_get_page_flags(page);
+    if (!flags) {
+        int rc = region->image ? map_image_page(region, page)
+                               : populate_page(region, page);
+        if (IS_ERR(rc))
+            return rc;
+        flags = paging_get_page_flags(page);
+    }
+
+    if (write && !(flags & PAGE_WRITE))
+        return paging_copy_on_write(page);
+    return 0;
+}
+
+int vm_populate(uintptr_t vaddr, size_t size, bool write) {
+    if (size == 0 || vaddr >= KERNEL_VADDR)
+        return 0;
+
+    uintptr_t end = MIN(vaddr + size, KERNEL_VADDR);
+    for (uintptr_t page = round_down(vaddr, PAGE_SIZE); page < end;
+         page += PAGE_SIZE) {
+        uint16_t flags = paging_get_page_flags(page);
+        if (flags && (!write || (flags & PAGE_WRITE)))
+            continue;
+        if (!vm_find_region(page))
+            continue;
+        int rc = vm_handle_page_fault(page, write);
+        if (IS_ERR(rc))
+            return rc;
+    }
+    return 0;
+}
@@ -48,6 +48,7 @@
 #define PCI_HEADER_TYPE 0xe
 #define PCI_BAR0 0x10
 #define PCI_BAR1 0x14
+#define PCI_BAR4 0x20
 #define PCI_SECONDARY_BUS 0x19
 #define PCI_INTERRUPT_LINE 0x3c
 #define PCI_ADDRESS_PORT 0xcf8
@@ -157,6 +158,10 @@ uint32_t pci_get_bar1(const struct pci_addr* addr) {
     return read_field32(addr, PCI_BAR1);
 }
 
+uint32_t pci_get_bar4(const struct pci_addr* addr) {
+    return read_field32(addr, PCI_BAR4);
+}
+
 uint8_t pci_get_interrupt_line(const struct pci_addr* addr) {
     return read_field8(addr, PCI_INTERRUPT_LINE);
 }
@@ -54,6 +54,7 @@ void pci_enumerate(pci_enumeration_callback_fn);
 uint16_t pci_get_type(const struct pci_addr*);
 uint32_t pci_get_bar0(const struct pci_addr*);
 uint32_t pci_get_bar1(const struct pci_addr*);
+uint32_t pci_get_bar4(const struct pci_addr*);
 uint8_t pci_get_interrupt_line(const struct pci_addr*);
 void pci_set_interrupt_line_enabled(const struct pci_addr*, bool enabled);
 void pci_set_bus_mastering_enabled(const struct pci_addr*, bool enabled);
@@ -160,7 +160,17 @@ static noreturn void die(void) {
         PANIC("init process exited");
 
     sti();
-    paging_destroy_current_page_directory();
+    if (current->borrows_pd) {
+        // the address space belongs to the vfork() parent
+        paging_switch_page_directory(
+            (page_directory*)((uintptr_t)kernel_page_directory + KERNEL_VADDR));
+        current->borrows_pd = false;
+    } else {
+        paging_destroy_current_page_directory();
+        vm_regions_destroy(current->vm_regions, current->num_vm_regions);
+    }
+    current->vm_regions = NULL;
+    current->num_vm_regions = 0;
     file_descriptor_table_destroy(&current->fd_table);
     kfree(current->cwd_path);
     inode_unref(current->cwd_inode);
@@ -62,8 +62,12 @@ struct process {
     char comm[16];
 
     page_directory* pd;
+    // set while a vfork() child runs in its parent's address space
+    bool borrows_pd;
     uintptr_t stack_top;
     range_allocator vaddr_allocator;
+    vm_region* vm_regions;
+    size_t num_vm_regions;
 
     char* cwd_path;
     struct inode* cwd_inode;
@@ -84,6 +84,7 @@ void scheduler_unregister(struct process* process) {
             prev->next_in_all_processes = it->next_in_all_processes;
         else
             all_processes = it->next_in_all_processes;
+        break;
     }
 
     pop_cli(int_flag);
@@ -42,10 +42,14 @@
 #include <common/string.h>
 #include <kernel/api/elf.h>
 #include <kernel/api/fcntl.h>
+#include <kernel/api/spawn.h>
+#include <kernel/api/sys/syscall.h>
 #include <kernel/asm_wrapper.h>
 #include <kernel/boot_defs.h>
+#include <kernel/exec_cache.h>
 #include <kernel/panic.h>
 #include <kernel/process.h>
+#include <kernel/scheduler.h>
 
 typedef struct string_list {
     size_t count;
@@ -159,12 +163,187 @@ NODISCARD static int push_ptrs(uintptr_t* sp, uintptr_t stack_base,
     return 0;
 }
 
-int sys_execve(const char* pathname, char* const argv[], char* const envp[]) {
-    /* Contains i?86-specific code, so we'll add guards that check if we're compiling for i?86... */
-    #if defined(__i386__)
-    if (!pathname || !argv || !envp)
-        return -EFAULT;
+typedef struct loaded_image {
+    page_directory* pd;
+    range_allocator vaddr_allocator;
+    vm_region* vm_regions;
+    size_t num_vm_regions;
+    uintptr_t entry_point;
+    uintptr_t max_segment_addr;
+    uintptr_t sp;
+    char comm[sizeof(current->comm)];
+} loaded_image;
+
+static bool regions_overlap(const vm_region* a, const vm_region* b) {
+    return a->start < b->end && b->start < a->end;
+}
+
+NODISCARD static int parse_segments(file_description* desc, size_t file_size,
+                                    vm_region** out_regions,
+                                    size_t* out_num_regions,
+                                    struct exec_info* out_info) {
+    Elf32_Ehdr ehdr;
+    ssize_t nread = file_description_pread(desc, &ehdr, sizeof(ehdr), 0);
+    if (IS_ERR(nread))
+        return nread;
+    if ((size_t)nread < sizeof(ehdr) || !IS_ELF(ehdr) ||
+        ehdr.e_ident[EI_CLASS] != ELFCLASS32 ||
+        ehdr.e_ident[EI_DATA] != ELFDATA2LSB ||
+        ehdr.e_ident[EI_VERSION] != EV_CURRENT ||
+        ehdr.e_ident[EI_OSABI] != ELFOSABI_SYSV ||
+        ehdr.e_ident[EI_ABIVERSION] != 0 || ehdr.e_machine != EM_386 ||
+        ehdr.e_type != ET_EXEC || ehdr.e_version != EV_CURRENT ||
+        ehdr.e_phentsize != sizeof(Elf32_Phdr) || ehdr.e_phnum == 0)
+        return -ENOEXEC;
 
+    size_t phdrs_size = ehdr.e_phnum * sizeof(Elf32_Phdr);
+    Elf32_Phdr* phdrs = kmalloc(phdrs_size);
+    if (!phdrs)
+        return -ENOMEM;
+    nread = file_description_pread(desc, phdrs, phdrs_size, ehdr.e_phoff);
+    if (IS_ERR(nread)) {
+        kfree(phdrs);
+        return nread;
+    }
+    if ((size_t)nread < phdrs_size) {
+        kfree(phdrs);
+        return -ENOEXEC;
+    }
+
+    size_t num_regions = 0;
+    for (size_t i = 0; i < ehdr.e_phnum; ++i) {
+        if (phdrs[i].p_type == PT_LOAD)
+            ++num_regions;
+    }
+    if (num_regions == 0) {
+        kfree(phdrs);
+        return -ENOEXEC;
+    }
+
+    vm_region* regions = kmalloc(num_regions * sizeof(vm_region));
+    if (!regions) {
+        kfree(phdrs);
+        return -ENOMEM;
+    }
+
+    struct exec_info info = {.entry_point = ehdr.e_entry,
+                             .num_phdrs = ehdr.e_phnum};
+    size_t count = 0;
+    for (size_t i = 0; i < ehdr.e_phnum; ++i) {
+        const Elf32_Phdr* phdr = phdrs + i;
+        if (phdr->p_type == PT_PHDR) {
+            info.phdr_addr = phdr->p_vaddr;
+            continue;
+        }
+        if (phdr->p_type == PT_INTERP) {
+            if (phdr->p_filesz == 0 || phdr->p_filesz > sizeof(info.interp))
+                goto fail;
+            nread = file_description_pread(desc, info.interp, phdr->p_filesz,
+                                           phdr->p_offset);
+            if (IS_ERR(nread) || (size_t)nread < phdr->p_filesz ||
+                info.interp[phdr->p_filesz - 1] != '\0')
+                goto fail;
+            continue;
+        }
+        if (phdr->p_type != PT_LOAD)
+            continue;
+        if (phdr->p_filesz > phdr->p_memsz ||
+            phdr->p_offset + phdr->p_filesz > file_size ||
+            phdr->p_offset + phdr->p_filesz < phdr->p_offset ||
+            phdr->p_vaddr + phdr->p_memsz >= KERNEL_VADDR ||
+            phdr->p_vaddr + phdr->p_memsz < phdr->p_vaddr)
+            goto fail;
+
+        vm_region* region = regions + count;
+        *region = (vm_region){
+            .start = round_down(phdr->p_vaddr, PAGE_SIZE),
+            .end = round_up(phdr->p_vaddr + phdr->p_memsz, PAGE_SIZE),
+            .data_start = phdr->p_vaddr,
+            .data_end = phdr->p_vaddr + phdr->p_filesz,
+            .offset = phdr->p_offset,
+            .page_flags = PAGE_USER};
+        if (phdr->p_flags & PF_W)
+            region->page_flags |= PAGE_WRITE;
+
+        // a page can only be populated from a single region
+        for (size_t j = 0; j < count; ++j) {
+            if (regions_overlap(regions + j, region))
+                goto fail;
+        }
+        ++count;
+
+        if (info.max_segment_addr < region->end)
+            info.max_segment_addr = region->end;
+
+        // the dynamic linker finds the program headers through the auxiliary
+        // vector, so remember where they end up if there is no PT_PHDR
+        if (!info.phdr_addr && phdr->p_offset <= ehdr.e_phoff &&
+            ehdr.e_phoff + phdrs_size <= phdr->p_offset + phdr->p_filesz)
+            info.phdr_addr = phdr->p_vaddr + (ehdr.e_phoff - phdr->p_offset);
+    }
+
+    kfree(phdrs);
+
+    *out_regions = regions;
+    *out_num_regions = count;
+    *out_info = info;
+    return 0;
+
+fail:
+    kfree(phdrs);
+    kfree(regions);
+    return -ENOEXEC;
+}
+
+// program headers are parsed once per executable and kept in the exec cache
+NODISCARD static int load_segments(file_description* desc, size_t file_size,
+                                   vm_region** out_regions,
+                                   size_t* out_num_regions,
+                                   struct exec_info* out_info) {
+    struct exec_image* cached = exec_cache_lookup(desc->inode);
+    if (!cached) {
+        vm_region* regions;
+        size_t num_regions;
+        struct exec_info info;
+        int rc =
+            parse_segments(desc, file_size, &regions, &num_regions, &info);
+        if (IS_ERR(rc))
+            return rc;
+        cached = exec_cache_insert(desc->inode, regions, num_regions, &info);
+        kfree(regions);
+        if (IS_ERR(cached))
+            return PTR_ERR(cached);
+    }
+
+    size_t num_regions = cached->num_regions;
+    vm_region* regions = kmalloc(num_regions * sizeof(vm_region));
+    if (!regions) {
+        exec_image_unref(cached);
+        return -ENOMEM;
+    }
+    memcpy(regions, cached->regions, num_regions * sizeof(vm_region));
+    for (size_t i = 0; i < num_regions; ++i) {
+        vm_region* region = regions + i;
+        region->desc = desc;
+        ++desc->ref_count;
+        if (!(region->page_flags & PAGE_WRITE)) {
+            region->image = cached;
+            exec_image_ref(cached);
+        }
+    }
+
+    *out_regions = regions;
+    *out_num_regions = num_regions;
+    *out_info = cached->info;
+
+    exec_image_unref(cached);
+    return 0;
+}
+
+NODISCARD static int load_executable(const char* pathname,
+                                     vm_region** out_regions,
+                                     size_t* out_num_regions,
+                                     struct exec_info* out_info) {
     struct stat stat;
     int rc = vfs_stat(pathname, &stat);
     if (IS_ERR(rc))
@@ -174,39 +353,122 @@ int sys_execve(const char* pathname, char* const argv[], char* const envp[]) {
     if ((size_t)stat.st_size < sizeof(Elf32_Ehdr))
         return -ENOEXEC;
 
-    char* dup_pathname = kstrdup(pathname);
-    if (!dup_pathname)
-        return -ENOMEM;
-    const char* exe_basename = basename(dup_pathname);
-    char comm[sizeof(current->comm)];
-    strlcpy(comm, exe_basename, sizeof(current->comm));
-    kfree(dup_pathname);
-
     file_description* desc = vfs_open(pathname, O_RDONLY, 0);
     if (IS_ERR(desc))
         return PTR_ERR(desc);
 
-    void* executable_buf = kmalloc(stat.st_size);
-    if (!executable_buf) {
-        file_description_close(desc);
-        return -ENOMEM;
-    }
-    ssize_t nread = file_description_read(desc, executable_buf, stat.st_size);
+    // segments are not read here. they are registered as regions and their
+    // pages are brought in by page faults, so only the pages a program
+    // actually touches are ever loaded.
+    rc = load_segments(desc, stat.st_size, out_regions, out_num_regions,
+                       out_info);
     file_description_close(desc);
-    if (IS_ERR(nread)) {
-        kfree(executable_buf);
-        return nread;
+    return rc;
+}
+
+// loads the program interpreter named by PT_INTERP next to the program. the
+// interpreter is itself a static executable, linked at an address that does
+// not collide with ordinary programs.
+NODISCARD static int load_interpreter(loaded_image* image,
+                                      const struct exec_info* info,
+                                      Elf32_auxv_t* auxv) {
+    vm_region* interp_regions;
+    size_t num_interp_regions;
+    struct exec_info interp_info;
+    int rc = load_executable(info->interp, &interp_regions,
+                             &num_interp_regions, &interp_info);
+    if (IS_ERR(rc))
+        return rc;
+
+    rc = -ENOEXEC;
+    if (interp_info.interp[0])
+        goto fail;
+    for (size_t i = 0; i < num_interp_regions; ++i) {
+        for (size_t j = 0; j < image->num_vm_regions; ++j) {
+            if (regions_overlap(interp_regions + i, image->vm_regions + j))
+                goto fail;
+        }
     }
 
-    Elf32_Ehdr* ehdr = (Elf32_Ehdr*)executable_buf;
-    if (!IS_ELF(*ehdr) || ehdr->e_ident[EI_CLASS] != ELFCLASS32 ||
-        ehdr->e_ident[EI_DATA] != ELFDATA2LSB ||
-        ehdr->e_ident[EI_VERSION] != EV_CURRENT ||
-        ehdr->e_ident[EI_OSABI] != ELFOSABI_SYSV ||
-        ehdr->e_ident[EI_ABIVERSION] != 0 || ehdr->e_machine != EM_386 ||
-        ehdr->e_type != ET_EXEC || ehdr->e_version != EV_CURRENT) {
-        kfree(executable_buf);
-        return -ENOEXEC;
+    size_t num_regions = image->num_vm_regions + num_interp_regions;
+    vm_region* regions = kmalloc(num_regions * sizeof(vm_region));
+    if (!regions) {
+        rc = -ENOMEM;
+        goto fail;
+    }
+    memcpy(regions, image->vm_regions,
+           image->num_vm_regions * sizeof(vm_region));
+    memcpy(regions + image->num_vm_regions, interp_regions,
+           num_interp_regions * sizeof(vm_region));
+
+    uintptr_t interp_base = interp_regions[0].start;
+    for (size_t i = 1; i < num_interp_regions; ++i) {
+        if (interp_regions[i].start < interp_base)
+            interp_base = interp_regions[i].start;
+    }
+
+    // ownership of the region contents moved to the merged array
+    kfree(interp_regions);
+    kfree(image->vm_regions);
+    image->vm_regions = regions;
+    image->num_vm_regions = num_regions;
+    image->entry_point = interp_info.entry_point;
+    if (image->max_segment_addr < interp_info.max_segment_addr)
+        image->max_segment_addr = interp_info.max_segment_addr;
+
+    for (Elf32_auxv_t* it = auxv; it->a_type != AT_NULL; ++it) {
+        if (it->a_type == AT_BASE)
+            it->a_val = interp_base;
+    }
+    return 0;
+
+fail:
+    vm_regions_destroy(interp_regions, num_interp_regions);
+    return rc;
+}
+
+// builds a new address space containing the executable and its initial
+// stack. the current page directory is left as it was.
+NODISCARD static int load_image(loaded_image* image, const char* pathname,
+                                char* const argv[], char* const envp[]) {
+    /* Contains i?86-specific code, so we'll add guards that check if we're compiling for i?86... */
+    #if defined(__i386__)
+    if (!pathname || !argv || !envp)
+        return -EFAULT;
+
+    char* dup_pathname = kstrdup(pathname);
+    if (!dup_pathname)
+        return -ENOMEM;
+    const char* exe_basename = basename(dup_pathname);
+    strlcpy(image->comm, exe_basename, sizeof(image->comm));
+    kfree(dup_pathname);
+
+    struct exec_info info;
+    int rc = load_executable(pathname, &image->vm_regions,
+                             &image->num_vm_regions, &info);
+    if (IS_ERR(rc))
+        return rc;
+    image->entry_point = info.entry_point;
+    image->max_segment_addr = info.max_segment_addr;
+
+    Elf32_auxv_t auxv[] = {
+        {AT_PHDR, info.phdr_addr},
+        {AT_PHENT, sizeof(Elf32_Phdr)},
+        {AT_PHNUM, info.num_phdrs},
+        {AT_PAGESZ, PAGE_SIZE},
+        {AT_BASE, 0},
+        {AT_ENTRY, info.entry_point},
+        {AT_NULL, 0},
+    };
+
+    // dynamically linked programs start in their interpreter, which finds
+    // the program through the auxiliary vector
+    if (info.interp[0]) {
+        rc = load_interpreter(image, &info, auxv);
+        if (IS_ERR(rc)) {
+            vm_regions_destroy(image->vm_regions, image->num_vm_regions);
+            return rc;
+        }
     }
 
     // after switching page directory we will no longer be able to access
@@ -214,14 +476,14 @@ int sys_execve(const char* pathname, char* const argv[], char* const envp[]) {
     string_list copied_argv = (string_list){0};
     rc = string_list_create(&copied_argv, argv);
     if (IS_ERR(rc)) {
-        kfree(executable_buf);
+        vm_regions_destroy(image->vm_regions, image->num_vm_regions);
         return rc;
     }
 
     string_list copied_envp = (string_list){0};
     rc = string_list_create(&copied_envp, envp);
     if (IS_ERR(rc)) {
-        kfree(executable_buf);
+        vm_regions_destroy(image->vm_regions, image->num_vm_regions);
         string_list_destroy(&copied_argv);
         return rc;
     }
@@ -230,7 +492,7 @@ int sys_execve(const char* pathname, char* const argv[], char* const envp[]) {
 
     page_directory* new_pd = paging_create_page_directory();
     if (IS_ERR(new_pd)) {
-        kfree(executable_buf);
+        vm_regions_destroy(image->vm_regions, image->num_vm_regions);
         string_list_destroy(&copied_argv);
         string_list_destroy(&copied_envp);
         return PTR_ERR(new_pd);
@@ -244,36 +506,9 @@ int sys_execve(const char* pathname, char* const argv[], char* const envp[]) {
     ptr_list envp_ptrs = (ptr_list){0};
     ptr_list argv_ptrs = (ptr_list){0};
 
-    Elf32_Phdr* phdr = (Elf32_Phdr*)((uintptr_t)executable_buf + ehdr->e_phoff);
-    uintptr_t max_segment_addr = 0;
-    for (size_t i = 0; i < ehdr->e_phnum; ++i, ++phdr) {
-        if (phdr->p_type != PT_LOAD)
-            continue;
-        if (phdr->p_filesz > phdr->p_memsz) {
-            ret = -ENOEXEC;
-            goto fail;
-        }
-
-        uintptr_t region_start = round_down(phdr->p_vaddr, PAGE_SIZE);
-        uintptr_t region_end = round_up(phdr->p_vaddr + phdr->p_memsz, PAGE_SIZE);
-        ret = paging_map_to_free_pages(region_start, region_end - region_start, PAGE_USER | PAGE_WRITE);
-        if (IS_ERR(ret))
-            goto fail;
-
-        memset((void*)region_start, 0, phdr->p_vaddr - region_start);
-        memcpy((void*)phdr->p_vaddr, (void*)((uintptr_t)executable_buf + phdr->p_offset), phdr->p_filesz);
-        memset((void*)(phdr->p_vaddr + phdr->p_filesz), 0, region_end - phdr->p_vaddr - phdr->p_filesz);
-
-        if (max_segment_addr < region_end)
-            max_segment_addr = region_end;
-    }
-
-    uint32_t entry_point = ehdr->e_entry;
-    kfree(executable_buf);
-    executable_buf = NULL;
-
     range_allocator vaddr_allocator;
-    ret = range_allocator_init(&vaddr_allocator, max_segment_addr, KERNEL_VADDR);
+    ret = range_allocator_init(&vaddr_allocator, image->max_segment_addr,
+                               KERNEL_VADDR);
     if (IS_ERR(ret))
         goto fail;
 
@@ -304,6 +539,15 @@ int sys_execve(const char* pathname, char* const argv[], char* const envp[]) {
     if (IS_ERR(ret))
         goto fail;
 
+    for (size_t i = sizeof(auxv) / sizeof(Elf32_auxv_t); i-- > 0;) {
+        ret = push_value(&sp, stack_base, auxv[i].a_val);
+        if (IS_ERR(ret))
+            goto fail;
+        ret = push_value(&sp, stack_base, auxv[i].a_type);
+        if (IS_ERR(ret))
+            goto fail;
+    }
+
     ret = push_value(&sp, stack_base, 0);
     if (IS_ERR(ret))
         goto fail;
@@ -338,18 +582,75 @@ int sys_execve(const char* pathname, char* const argv[], char* const envp[]) {
         goto fail;
 
     paging_switch_page_directory(prev_pd);
+
+    image->pd = new_pd;
+    image->vaddr_allocator = vaddr_allocator;
+    image->sp = sp;
+    return 0;
+
+fail:
+    ASSERT(IS_ERR(ret));
+
+    vm_regions_destroy(image->vm_regions, image->num_vm_regions);
+    string_list_destroy(&copied_envp);
+    string_list_destroy(&copied_argv);
+    ptr_list_destroy(&envp_ptrs);
+    ptr_list_destroy(&argv_ptrs);
+
     paging_destroy_current_page_directory();
-    paging_switch_page_directory(new_pd);
+    paging_switch_page_directory(prev_pd);
+
+    return ret;
+    #else
+    (void)image;
+    (void)pathname;
+    (void)argv;
+    (void)envp;
+    return -ENOTSUP;
+    #endif
+}
+
+static void destroy_image(loaded_image* image) {
+    page_directory* prev_pd = paging_current_page_directory();
+    paging_switch_page_directory(image->pd);
+    paging_destroy_current_page_directory();
+    paging_switch_page_directory(prev_pd);
+    vm_regions_destroy(image->vm_regions, image->num_vm_regions);
+}
+
+int sys_execve(const char* pathname, char* const argv[], char* const envp[]) {
+    /* Contains i?86-specific code, so we'll add guards that check if we're compiling for i?86... */
+    #if defined(__i386__)
+    loaded_image image;
+    int rc = load_image(&image, pathname, argv, envp);
+    if (IS_ERR(rc))
+        return rc;
+
+    if (current->borrows_pd) {
+        // the old address space belongs to the vfork() parent, which can
+        // resume as soon as we have moved off it
+        paging_switch_page_directory(image.pd);
+        current->borrows_pd = false;
+    } else {
+        paging_destroy_current_page_directory();
+        paging_switch_page_directory(image.pd);
+        vm_regions_destroy(current->vm_regions, current->num_vm_regions);
+    }
+    current->vm_regions = image.vm_regions;
+    current->num_vm_regions = image.num_vm_regions;
 
     cli();
 
-    current->vaddr_allocator = vaddr_allocator;
-    current->eip = entry_point;
+    current->vaddr_allocator = image.vaddr_allocator;
+    current->eip = image.entry_point;
     current->esp = current->ebp = current->stack_top;
     current->ebx = current->esi = current->edi = 0;
     current->fpu_state = initial_fpu_state;
 
-    strlcpy(current->comm, comm, sizeof(current->comm));
+    strlcpy(current->comm, image.comm, sizeof(current->comm));
+
+    uintptr_t sp = image.sp;
+    uintptr_t entry_point = image.entry_point;
 
     // enter userland
     __asm__ volatile("movw $0x23, %%ax\n"
@@ -370,19 +671,164 @@ int sys_execve(const char* pathname, char* const argv[], char* const envp[]) {
                      "r"(entry_point)
                      : "eax");
     UNREACHABLE();
+    #else
+    (void)pathname;
+    (void)argv;
+    (void)envp;
+    return -ENOTSUP;
+    #endif
+}
 
-fail:
-    ASSERT(IS_ERR(ret));
+static void install_fd(file_descriptor_table* table, int fd,
+                       file_description* desc) {
+    file_description** entry = table->entries + fd;
+    if (*entry)
+        file_description_close(*entry);
+    *entry = desc;
+}
 
-    kfree(executable_buf);
-    string_list_destroy(&copied_envp);
-    string_list_destroy(&copied_argv);
-    ptr_list_destroy(&envp_ptrs);
-    ptr_list_destroy(&argv_ptrs);
+NODISCARD static int
+apply_file_actions(file_descriptor_table* table,
+                   const posix_spawn_file_actions_t* file_actions) {
+    if (file_actions->count > POSIX_SPAWN_MAX_FILE_ACTIONS)
+        return -EINVAL;
+
+    for (size_t i = 0; i < file_actions->count; ++i) {
+        const struct posix_spawn_file_action* action =
+            file_actions->actions + i;
+        if (action->fd < 0 || OPEN_MAX <= action->fd)
+            return -EBADF;
+        file_description** entry = table->entries + action->fd;
+
+        switch (action->type) {
+        case POSIX_SPAWN_ACTION_CLOSE:
+            if (*entry) {
+                file_description_close(*entry);
+                *entry = NULL;
+            }
+            break;
+        case POSIX_SPAWN_ACTION_DUP2: {
+            if (action->new_fd < 0 || OPEN_MAX <= action->new_fd)
+                return -EBADF;
+            if (!*entry)
+                return -EBADF;
+            if (action->fd == action->new_fd)
+                break;
+            file_description* desc = *entry;
+            ++desc->ref_count;
+            install_fd(table, action->new_fd, desc);
+            break;
+        }
+        case POSIX_SPAWN_ACTION_OPEN: {
+            file_description* desc =
+                vfs_open(action->path, action->oflag,
+                         (action->mode & 0777) | S_IFREG);
+            if (IS_ERR(desc))
+                return PTR_ERR(desc);
+            install_fd(table, action->fd, desc);
+            break;
+        }
+        default:
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
 
-    paging_destroy_current_page_directory();
-    paging_switch_page_directory(prev_pd);
+void return_to_userland(registers);
 
-    return ret;
+// creates the child directly from the executable, so unlike fork() + exec()
+// the parent's address space is never cloned.
+pid_t sys_posix_spawn(const posix_spawn_params* params) {
+    #if defined(__i386__)
+    const posix_spawnattr_t* attr = params->attr;
+    if (attr && (attr->flags & ~POSIX_SPAWN_SETPGROUP))
+        return -EINVAL;
+    if (attr && (attr->flags & POSIX_SPAWN_SETPGROUP) && attr->pgroup < 0)
+        return -EINVAL;
+
+    struct process* process = kaligned_alloc(alignof(struct process), sizeof(struct process));
+    if (!process)
+        return -ENOMEM;
+    *process = (struct process){0};
+
+    int rc = file_descriptor_table_clone_from(&process->fd_table, &current->fd_table);
+    if (IS_ERR(rc)) {
+        kfree(process);
+        return rc;
+    }
+
+    if (params->file_actions) {
+        rc = apply_file_actions(&process->fd_table, params->file_actions);
+        if (IS_ERR(rc))
+            goto fail_fd_table;
+    }
+
+    loaded_image image;
+    rc = load_image(&image, params->path, params->argv, params->envp);
+    if (IS_ERR(rc))
+        goto fail_fd_table;
+
+    process->cwd_path = kstrdup(current->cwd_path);
+    if (!process->cwd_path) {
+        rc = -ENOMEM;
+        goto fail_image;
+    }
+
+    void* stack = kmalloc(STACK_SIZE);
+    if (!stack) {
+        rc = -ENOMEM;
+        goto fail_cwd;
+    }
+
+    process->cwd_inode = current->cwd_inode;
+    inode_ref(process->cwd_inode);
+
+    process->pd = image.pd;
+    process->vaddr_allocator = image.vaddr_allocator;
+    process->vm_regions = image.vm_regions;
+    process->num_vm_regions = image.num_vm_regions;
+    process->pid = process_generate_next_pid();
+    process->ppid = current->pid;
+    process->pgid = current->pgid;
+    if (attr && (attr->flags & POSIX_SPAWN_SETPGROUP))
+        process->pgid = attr->pgroup ? attr->pgroup : process->pid;
+    process->eip = (uintptr_t)return_to_userland;
+    process->fpu_state = initial_fpu_state;
+    process->state = PROCESS_STATE_RUNNABLE;
+    strlcpy(process->comm, image.comm, sizeof(process->comm));
+
+    process->stack_top = (uintptr_t)stack + STACK_SIZE;
+    process->esp = process->ebp = process->stack_top;
+
+    // push the argument of return_to_userland(), which enters userland
+    // at the entry point of the executable
+    process->esp -= sizeof(registers);
+    registers* regs = (registers*)process->esp;
+    *regs = (registers){.gs = 0x23,
+                        .fs = 0x23,
+                        .es = 0x23,
+                        .ds = 0x23,
+                        .eip = image.entry_point,
+                        .cs = 0x1b,
+                        .eflags = 0x202, // IF
+                        .user_esp = image.sp,
+                        .user_ss = 0x23};
+
+    scheduler_register(process);
+
+    return process->pid;
+
+fail_cwd:
+    kfree(process->cwd_path);
+fail_image:
+    destroy_image(&image);
+fail_fd_table:
+    file_descriptor_table_destroy(&process->fd_table);
+    kfree(process);
+    return rc;
+    #else
+    (void)params;
+    return -ENOTSUP;
     #endif
 }
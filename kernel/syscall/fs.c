@@ -37,21 +37,47 @@
  *  THE SOFTWARE.
  */
 
+#include <common/string.h>
 #include <kernel/api/err.h>
 #include <kernel/api/fcntl.h>
+#include <kernel/api/sys/mount.h>
 #include <kernel/api/sys/stat.h>
+#include <kernel/api/sys/syscall.h>
+#include <kernel/block/block.h>
+#include <kernel/block/buffer_cache.h>
 #include <kernel/fs/fs.h>
 #include <kernel/panic.h>
 #include <kernel/process.h>
 #include <kernel/system.h>
 
-int sys_open(const char* pathname, int flags, unsigned mode) {
-    file_description* desc = vfs_open(pathname, flags, (mode & 0777) | S_IFREG);
+// looks up the directory that relative paths of *at() calls start from.
+// NULL stands for the working directory.
+static file_description* get_base(int dirfd, const char* pathname) {
+    if (dirfd == AT_FDCWD || pathname[0] == PATH_SEPARATOR)
+        return NULL;
+    file_description* desc = process_get_file_description(dirfd);
+    if (IS_ERR(desc))
+        return desc;
+    if (!S_ISDIR(desc->inode->mode))
+        return ERR_PTR(-ENOTDIR);
+    return desc;
+}
+
+int sys_openat(int dirfd, const char* pathname, int flags, unsigned mode) {
+    file_description* base = get_base(dirfd, pathname);
+    if (IS_ERR(base))
+        return PTR_ERR(base);
+    file_description* desc =
+        vfs_open_at(base, pathname, flags, (mode & 0777) | S_IFREG);
     if (IS_ERR(desc))
         return PTR_ERR(desc);
     return process_alloc_file_descriptor(-1, desc);
 }
 
+int sys_open(const char* pathname, int flags, unsigned mode) {
+    return sys_openat(AT_FDCWD, pathname, flags, mode);
+}
+
 int sys_close(int fd) {
     file_description* desc = process_get_file_description(fd);
     if (IS_ERR(desc))
@@ -78,6 +104,49 @@ ssize_t sys_write(int fd, const void* buf, size_t count) {
     return file_description_write(desc, buf, count);
 }
 
+ssize_t sys_sendfile(int out_fd, int in_fd, off_t* offset, size_t count) {
+    file_description* out = process_get_file_description(out_fd);
+    if (IS_ERR(out))
+        return PTR_ERR(out);
+    file_description* in = process_get_file_description(in_fd);
+    if (IS_ERR(in))
+        return PTR_ERR(in);
+    return file_description_splice(in, offset, out, NULL, count);
+}
+
+ssize_t sys_splice(const splice_params* params) {
+    if (params->flags != 0)
+        return -EINVAL;
+    file_description* in = process_get_file_description(params->fd_in);
+    if (IS_ERR(in))
+        return PTR_ERR(in);
+    file_description* out = process_get_file_description(params->fd_out);
+    if (IS_ERR(out))
+        return PTR_ERR(out);
+    return file_description_splice(in, params->off_in, out, params->off_out,
+                                   params->length);
+}
+
+ssize_t sys_copy_file_range(const splice_params* params) {
+    if (params->flags != 0)
+        return -EINVAL;
+    file_description* in = process_get_file_description(params->fd_in);
+    if (IS_ERR(in))
+        return PTR_ERR(in);
+    file_description* out = process_get_file_description(params->fd_out);
+    if (IS_ERR(out))
+        return PTR_ERR(out);
+    return file_description_copy_file_range(in, params->off_in, out,
+                                            params->off_out, params->length);
+}
+
+int sys_fallocate(int fd, int mode, off_t offset, off_t len) {
+    file_description* desc = process_get_file_description(fd);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+    return file_description_fallocate(desc, mode, offset, len);
+}
+
 int sys_ftruncate(int fd, off_t length) {
     file_description* desc = process_get_file_description(fd);
     if (IS_ERR(desc))
@@ -85,6 +154,80 @@ int sys_ftruncate(int fd, off_t length) {
     return file_description_truncate(desc, length);
 }
 
+int sys_fsync(int fd) {
+    file_description* desc = process_get_file_description(fd);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+    return file_description_fsync(desc);
+}
+
+int sys_sync(void) {
+    // sync has no way to report errors
+    int rc = buffer_cache_sync(NULL);
+    (void)rc;
+    return 0;
+}
+
+static struct inode* create_fs_root(const char* source,
+                                    const char* filesystemtype) {
+    if (!strcmp(filesystemtype, "tmpfs"))
+        return tmpfs_create_root();
+    if (!strcmp(filesystemtype, "procfs"))
+        return procfs_create_root();
+    if (strcmp(filesystemtype, "ext2"))
+        return ERR_PTR(-ENODEV);
+
+    file_description* desc = vfs_open(source, O_RDWR, 0);
+    if (IS_ERR(desc))
+        return ERR_CAST(desc);
+    struct inode* root;
+    if (S_ISBLK(desc->inode->mode))
+        root = ext2_mount((struct block_device*)desc->inode);
+    else
+        root = ERR_PTR(-ENOTBLK);
+    file_description_close(desc);
+    return root;
+}
+
+int sys_mount(const char* source, const char* target,
+              const char* filesystemtype, unsigned long flags) {
+    if (flags & ~MS_BIND)
+        return -EINVAL;
+
+    struct inode* inode = vfs_resolve_path(target, NULL, NULL);
+    if (IS_ERR(inode))
+        return PTR_ERR(inode);
+    bool is_dir = S_ISDIR(inode->mode);
+    inode_unref(inode);
+    if (!is_dir)
+        return -ENOTDIR;
+
+    char* path = vfs_canonicalize_path(target);
+    if (IS_ERR(path))
+        return PTR_ERR(path);
+
+    struct inode* guest = (flags & MS_BIND)
+                              ? vfs_resolve_path(source, NULL, NULL)
+                              : create_fs_root(source, filesystemtype);
+    if (IS_ERR(guest)) {
+        kfree(path);
+        return PTR_ERR(guest);
+    }
+
+    int rc = vfs_mount(path, guest);
+    kfree(path);
+    return rc;
+}
+
+int sys_umount(const char* target) {
+    char* path = vfs_canonicalize_path(target);
+    if (IS_ERR(path))
+        return PTR_ERR(path);
+    int rc = vfs_umount(path);
+    kfree(path);
+    return rc;
+}
+
 off_t sys_lseek(int fd, off_t offset, int whence) {
     file_description* desc = process_get_file_description(fd);
     if (IS_ERR(desc))
@@ -92,8 +235,25 @@ off_t sys_lseek(int fd, off_t offset, int whence) {
     return file_description_lseek(desc, offset, whence);
 }
 
+int sys_fstatat(int dirfd, const char* pathname, struct stat* buf,
+                int flags) {
+    if (flags != 0)
+        return -EINVAL;
+    file_description* base = get_base(dirfd, pathname);
+    if (IS_ERR(base))
+        return PTR_ERR(base);
+    return vfs_stat_at(base, pathname, buf);
+}
+
 int sys_stat(const char* pathname, struct stat* buf) {
-    return vfs_stat(pathname, buf);
+    return sys_fstatat(AT_FDCWD, pathname, buf, 0);
+}
+
+int sys_fstat(int fd, struct stat* buf) {
+    file_description* desc = process_get_file_description(fd);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+    return file_description_stat(desc, buf);
 }
 
 int sys_ioctl(int fd, int request, void* argp) {
@@ -103,14 +263,22 @@ int sys_ioctl(int fd, int request, void* argp) {
     return file_description_ioctl(desc, request, argp);
 }
 
-int sys_mkdir(const char* pathname, mode_t mode) {
-    struct inode* inode = vfs_create(pathname, (mode & 0777) | S_IFDIR);
+int sys_mkdirat(int dirfd, const char* pathname, mode_t mode) {
+    file_description* base = get_base(dirfd, pathname);
+    if (IS_ERR(base))
+        return PTR_ERR(base);
+    struct inode* inode =
+        vfs_create_at(base, pathname, (mode & 0777) | S_IFDIR);
     if (IS_ERR(inode))
         return PTR_ERR(inode);
     inode_unref(inode);
     return 0;
 }
 
+int sys_mkdir(const char* pathname, mode_t mode) {
+    return sys_mkdirat(AT_FDCWD, pathname, mode);
+}
+
 int sys_mknod(const char* pathname, mode_t mode, dev_t dev) {
     switch (mode & S_IFMT) {
     case S_IFREG:
@@ -168,10 +336,11 @@ int sys_link(const char* oldpath, const char* newpath) {
     return rc;
 }
 
-int sys_unlink(const char* pathname) {
+static int unlink_file(file_description* base, const char* pathname) {
     struct inode* parent = NULL;
     char* basename = NULL;
-    struct inode* inode = vfs_resolve_path(pathname, &parent, &basename);
+    struct inode* inode =
+        vfs_resolve_path_at(base, pathname, &parent, &basename);
     if (IS_ERR(inode)) {
         inode_unref(parent);
         kfree(basename);
@@ -218,7 +387,15 @@ static int make_sure_directory_is_empty(struct inode* inode) {
     return nread > 0 ? -ENOTEMPTY : nread;
 }
 
-int sys_rename(const char* oldpath, const char* newpath) {
+int sys_renameat(int olddirfd, const char* oldpath, int newdirfd,
+                 const char* newpath) {
+    file_description* old_base = get_base(olddirfd, oldpath);
+    if (IS_ERR(old_base))
+        return PTR_ERR(old_base);
+    file_description* new_base = get_base(newdirfd, newpath);
+    if (IS_ERR(new_base))
+        return PTR_ERR(new_base);
+
     int rc = 0;
     struct inode* old_parent = NULL;
     char* old_basename = NULL;
@@ -227,7 +404,8 @@ int sys_rename(const char* oldpath, const char* newpath) {
     char* new_basename = NULL;
     struct inode* new_inode = NULL;
 
-    old_inode = vfs_resolve_path(oldpath, &old_parent, &old_basename);
+    old_inode =
+        vfs_resolve_path_at(old_base, oldpath, &old_parent, &old_basename);
     if (IS_ERR(old_inode)) {
         rc = PTR_ERR(old_inode);
         old_inode = NULL;
@@ -239,7 +417,8 @@ int sys_rename(const char* oldpath, const char* newpath) {
     }
     ASSERT(old_basename);
 
-    new_inode = vfs_resolve_path(newpath, &new_parent, &new_basename);
+    new_inode =
+        vfs_resolve_path_at(new_base, newpath, &new_parent, &new_basename);
     if (IS_OK(new_inode)) {
         if (new_inode == old_inode) {
             rc = 0;
@@ -297,10 +476,15 @@ fail:
     return rc;
 }
 
-int sys_rmdir(const char* pathname) {
+int sys_rename(const char* oldpath, const char* newpath) {
+    return sys_renameat(AT_FDCWD, oldpath, AT_FDCWD, newpath);
+}
+
+static int remove_directory(file_description* base, const char* pathname) {
     struct inode* parent = NULL;
     char* basename = NULL;
-    struct inode* inode = vfs_resolve_path(pathname, &parent, &basename);
+    struct inode* inode =
+        vfs_resolve_path_at(base, pathname, &parent, &basename);
     if (IS_ERR(inode)) {
         inode_unref(parent);
         kfree(basename);
@@ -329,6 +513,25 @@ int sys_rmdir(const char* pathname) {
     return rc;
 }
 
+int sys_unlinkat(int dirfd, const char* pathname, int flags) {
+    if (flags & ~AT_REMOVEDIR)
+        return -EINVAL;
+    file_description* base = get_base(dirfd, pathname);
+    if (IS_ERR(base))
+        return PTR_ERR(base);
+    if (flags & AT_REMOVEDIR)
+        return remove_directory(base, pathname);
+    return unlink_file(base, pathname);
+}
+
+int sys_unlink(const char* pathname) {
+    return sys_unlinkat(AT_FDCWD, pathname, 0);
+}
+
+int sys_rmdir(const char* pathname) {
+    return sys_unlinkat(AT_FDCWD, pathname, AT_REMOVEDIR);
+}
+
 long sys_getdents(int fd, void* dirp, size_t count) {
     file_description* desc = process_get_file_description(fd);
     if (IS_ERR(desc))
@@ -40,24 +40,62 @@
 #include <common/extra.h>
 #include <common/string.h>
 #include <kernel/api/err.h>
+#include <kernel/api/fcntl.h>
 #include <kernel/api/sys/mman.h>
 #include <kernel/api/sys/stat.h>
 #include <kernel/api/sys/syscall.h>
 #include <kernel/boot_defs.h>
+#include <kernel/fs/fs.h>
 #include <kernel/memory/memory.h>
 #include <kernel/process.h>
 
-void* sys_mmap(const mmap_params* params) {
-    if (params->length == 0 || params->offset < 0 || (params->offset % PAGE_SIZE) || !((params->flags & MAP_PRIVATE) ^ (params->flags & MAP_SHARED)))
-        return ERR_PTR(-EINVAL);
+// private mappings of files are populated as they are touched, and get a copy
+// of a page of the file once they write to it. shared mappings are populated
+// up front, and are recorded so that msync() knows which file they show.
+static uintptr_t map_file(const mmap_params* params, uintptr_t addr, uint16_t page_flags) {
+    file_description* desc = process_get_file_description(params->fd);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+    struct inode* inode = desc->inode;
+    if (S_ISDIR(inode->mode))
+        return -ENODEV;
+    // private pages that the file can't lend are filled with pread() on a
+    // page fault, which streams and devices without mmap can't serve
+    if (!S_ISREG(inode->mode) && !inode->fops->cache_pages &&
+        !inode->fops->mmap)
+        return -ENODEV;
 
-    if ((params->flags & MAP_FIXED) || !(params->prot & PROT_READ))
-        return ERR_PTR(-ENOTSUP);
+    bool shared = page_flags & PAGE_SHARED;
+    if (shared) {
+        uintptr_t rc = file_description_mmap(desc, addr, params->length, params->offset, page_flags);
+        if (IS_ERR(rc))
+            return rc;
+    } else if (!(desc->flags & O_RDONLY)) {
+        return -EACCES;
+    }
 
-    uintptr_t addr = range_allocator_alloc(&current->vaddr_allocator, params->length);
-    if (IS_ERR(addr))
-        return ERR_PTR(addr);
+    uintptr_t end = addr + round_up(params->length, PAGE_SIZE);
+    vm_region region = {
+        .start = addr,
+        .end = end,
+        .data_start = addr,
+        .data_end = end,
+        .desc = desc,
+        .offset = params->offset,
+        .page_flags = page_flags,
+    };
+    ++desc->ref_count;
+    int rc = vm_add_region(&region);
+    if (IS_ERR(rc)) {
+        file_description_close(desc);
+        if (shared)
+            paging_unmap(addr, params->length);
+        return rc;
+    }
+    return addr;
+}
 
+static uintptr_t map_pages(const mmap_params* params, uintptr_t addr) {
     uint16_t page_flags = PAGE_USER;
     if (params->prot & PROT_WRITE)
         page_flags |= PAGE_WRITE;
@@ -66,28 +104,96 @@ void* sys_mmap(const mmap_params* params) {
 
     if (params->flags & MAP_ANONYMOUS) {
         if (params->offset != 0)
-            return ERR_PTR(-ENOTSUP);
+            return -ENOTSUP;
 
         int rc = paging_map_to_free_pages(addr, params->length, page_flags);
         if (IS_ERR(rc))
-            return ERR_PTR(rc);
+            return rc;
 
         memset((void*)addr, 0, params->length);
-        return (void*)addr;
+        return addr;
     }
 
-    file_description* desc = process_get_file_description(params->fd);
-    if (IS_ERR(desc))
-        return desc;
-    if (S_ISDIR(desc->inode->mode))
-        return ERR_PTR(-ENODEV);
+    return map_file(params, addr, page_flags);
+}
 
-    return (void*)file_description_mmap(desc, addr, params->length, params->offset, page_flags);
+void* sys_mmap(const mmap_params* params) {
+    if (params->length == 0 || params->offset < 0 || (params->offset % PAGE_SIZE) || !((params->flags & MAP_PRIVATE) ^ (params->flags & MAP_SHARED)))
+        return ERR_PTR(-EINVAL);
+
+    if (!(params->prot & PROT_READ))
+        return ERR_PTR(-ENOTSUP);
+
+    uintptr_t addr;
+    if (params->flags & MAP_FIXED) {
+        // existing mappings are not replaced
+        addr = (uintptr_t)params->addr;
+        int rc = range_allocator_alloc_at(&current->vaddr_allocator, addr,
+                                          params->length);
+        if (IS_ERR(rc))
+            return ERR_PTR(rc);
+    } else {
+        addr = range_allocator_alloc(&current->vaddr_allocator, params->length);
+        if (IS_ERR(addr))
+            return ERR_PTR(addr);
+    }
+
+    uintptr_t rc = map_pages(params, addr);
+    if (IS_ERR(rc)) {
+        // give the range back so that the caller can retry at the same address
+        int free_rc = range_allocator_free(&current->vaddr_allocator, addr,
+                                           params->length);
+        (void)free_rc;
+    }
+    return (void*)rc;
+}
+
+static bool is_user_range(uintptr_t start, uintptr_t end) {
+    return start <= end && end <= KERNEL_VADDR;
 }
 
 int sys_munmap(void* addr, size_t length) {
-    if ((uintptr_t)addr % PAGE_SIZE)
+    uintptr_t start = (uintptr_t)addr;
+    uintptr_t end = start + round_up(length, PAGE_SIZE);
+    if ((start % PAGE_SIZE) || length == 0 || !is_user_range(start, end))
+        return -EINVAL;
+
+    int rc = vm_remove_regions(start, end);
+    if (IS_ERR(rc))
+        return rc;
+
+    // pages of regions that were never touched are not mapped
+    for (uintptr_t page = start; page < end; page += PAGE_SIZE) {
+        if (paging_get_page_flags(page))
+            paging_unmap(page, PAGE_SIZE);
+    }
+    return range_allocator_free(&current->vaddr_allocator, start, end - start);
+}
+
+int sys_msync(void* addr, size_t length, int flags) {
+    uintptr_t start = (uintptr_t)addr;
+    uintptr_t end = start + round_up(length, PAGE_SIZE);
+    if ((start % PAGE_SIZE) || (flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) || ((flags & MS_ASYNC) && (flags & MS_SYNC)))
         return -EINVAL;
-    paging_unmap((uintptr_t)addr, length);
-    return range_allocator_free(&current->vaddr_allocator, (uintptr_t)addr, length);
+    if (!is_user_range(start, end))
+        return -ENOMEM;
+    for (uintptr_t page = start; page < end; page += PAGE_SIZE) {
+        if (!paging_get_page_flags(page) && !vm_find_region(page))
+            return -ENOMEM;
+    }
+
+    // shared mappings are the pages of the file itself, so what is left is
+    // to write the file back, which MS_ASYNC leaves to the background
+    // write-back
+    if (!(flags & MS_SYNC))
+        return 0;
+    for (size_t i = 0; i < current->num_vm_regions; ++i) {
+        const vm_region* region = current->vm_regions + i;
+        if (!region->desc || !(region->page_flags & PAGE_SHARED) || region->end <= start || end <= region->start)
+            continue;
+        int rc = file_description_fsync(region->desc);
+        if (IS_ERR(rc))
+            return rc;
+    }
+    return 0;
 }
@@ -0,0 +1,178 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <common/extra.h>
+#include <kernel/api/err.h>
+#include <kernel/api/fcntl.h>
+#include <kernel/api/poll.h>
+#include <kernel/api/sys/epoll.h>
+#include <kernel/fs/fs.h>
+#include <kernel/memory/memory.h>
+#include <kernel/process.h>
+#include <kernel/scheduler.h>
+#include <kernel/system.h>
+
+struct poll_entry {
+    file_description* desc;
+    short events;
+    short revents;
+};
+
+struct poll_blocker {
+    struct poll_entry* entries;
+    nfds_t nfds;
+    bool has_deadline;
+    uint32_t deadline;
+    int num_ready;
+};
+
+// this runs in the context of whichever process the scheduler is switching
+// from, so it only touches the kernel copies of the file descriptions.
+static bool poll_should_unblock(struct poll_blocker* blocker) {
+    int num_ready = 0;
+    for (nfds_t i = 0; i < blocker->nfds; ++i) {
+        struct poll_entry* entry = blocker->entries + i;
+        if (entry->desc)
+            entry->revents = file_description_poll(entry->desc, entry->events);
+        if (entry->revents)
+            ++num_ready;
+    }
+    blocker->num_ready = num_ready;
+    return num_ready > 0 ||
+           (blocker->has_deadline && uptime >= blocker->deadline);
+}
+
+int sys_poll(struct pollfd* fds, nfds_t nfds, int timeout) {
+    if (nfds > OPEN_MAX)
+        return -EINVAL;
+    if (nfds > 0 && !fds)
+        return -EFAULT;
+
+    struct poll_entry* entries = NULL;
+    if (nfds > 0) {
+        entries = kmalloc(nfds * sizeof(struct poll_entry));
+        if (!entries)
+            return -ENOMEM;
+    }
+
+    for (nfds_t i = 0; i < nfds; ++i) {
+        struct poll_entry* entry = entries + i;
+        *entry = (struct poll_entry){.events = fds[i].events};
+        if (fds[i].fd < 0)
+            continue;
+        file_description* desc = process_get_file_description(fds[i].fd);
+        if (IS_ERR(desc)) {
+            entry->revents = POLLNVAL;
+            continue;
+        }
+        // keep the description alive even if the fd is closed while blocked
+        ++desc->ref_count;
+        entry->desc = desc;
+    }
+
+    struct poll_blocker blocker = {.entries = entries, .nfds = nfds};
+    if (timeout >= 0) {
+        blocker.has_deadline = true;
+        blocker.deadline = uptime + div_ceil(timeout, 1000 / CLK_TCK);
+    }
+
+    int rc = 0;
+    if (timeout == 0)
+        poll_should_unblock(&blocker);
+    else
+        rc = scheduler_block((should_unblock_fn)poll_should_unblock, &blocker);
+
+    for (nfds_t i = 0; i < nfds; ++i) {
+        if (IS_OK(rc))
+            fds[i].revents = entries[i].revents;
+        if (entries[i].desc)
+            file_description_close(entries[i].desc);
+    }
+    kfree(entries);
+
+    if (IS_ERR(rc))
+        return rc;
+    return blocker.num_ready;
+}
+
+int sys_epoll_create(int size) {
+    if (size <= 0)
+        return -EINVAL;
+
+    struct inode* epoll = epoll_create();
+    if (IS_ERR(epoll))
+        return PTR_ERR(epoll);
+    file_description* desc = inode_open(epoll, O_RDWR, 0);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+    int fd = process_alloc_file_descriptor(-1, desc);
+    if (IS_ERR(fd))
+        file_description_close(desc);
+    return fd;
+}
+
+int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event* event) {
+    file_description* desc = process_get_file_description(epfd);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+    file_description* target = process_get_file_description(fd);
+    if (IS_ERR(target))
+        return PTR_ERR(target);
+    return epoll_ctl(desc, op, fd, target, event);
+}
+
+int sys_epoll_wait(int epfd, struct epoll_event* events, int maxevents,
+                   int timeout) {
+    if (!events)
+        return -EFAULT;
+    file_description* desc = process_get_file_description(epfd);
+    if (IS_ERR(desc))
+        return PTR_ERR(desc);
+    if (maxevents > 0) {
+        // events are stored with interrupts disabled
+        int rc = vm_populate((uintptr_t)events,
+                             maxevents * sizeof(struct epoll_event), true);
+        if (IS_ERR(rc))
+            return rc;
+    }
+    ++desc->ref_count;
+    int rc = epoll_wait(desc, events, maxevents, timeout);
+    file_description_close(desc);
+    return rc;
+}
@@ -79,16 +79,13 @@ int sys_sched_yield(void) {
 
 void return_to_userland(registers);
 
-pid_t sys_fork(registers* regs) {
+static struct process* create_child(registers* regs, page_directory* pd) {
     struct process* process = kaligned_alloc(alignof(struct process), sizeof(struct process));
     if (!process)
-        return -ENOMEM;
+        return ERR_PTR(-ENOMEM);
     *process = (struct process){0};
 
-    process->pd = paging_clone_current_page_directory();
-    if (IS_ERR(process->pd))
-        return PTR_ERR(process->pd);
-
+    process->pd = pd;
     process->vaddr_allocator = current->vaddr_allocator;
 
     process->pid = process_generate_next_pid();
@@ -107,17 +104,17 @@ pid_t sys_fork(registers* regs) {
 
     process->cwd_path = kstrdup(current->cwd_path);
     if (!process->cwd_path)
-        return -ENOMEM;
+        return ERR_PTR(-ENOMEM);
     process->cwd_inode = current->cwd_inode;
     inode_ref(process->cwd_inode);
 
     int rc = file_descriptor_table_clone_from(&process->fd_table, &current->fd_table);
     if (IS_ERR(rc))
-        return rc;
+        return ERR_PTR(rc);
 
     void* stack = kmalloc(STACK_SIZE);
     if (!stack)
-        return -ENOMEM;
+        return ERR_PTR(-ENOMEM);
     process->stack_top = (uintptr_t)stack + STACK_SIZE;
     process->esp = process->ebp = process->stack_top;
 
@@ -127,11 +124,56 @@ pid_t sys_fork(registers* regs) {
     *child_regs = *regs;
     child_regs->eax = 0; // fork() returns 0 in the child
 
+    return process;
+}
+
+pid_t sys_fork(registers* regs) {
+    page_directory* pd = paging_clone_current_page_directory();
+    if (IS_ERR(pd))
+        return PTR_ERR(pd);
+
+    struct process* process = create_child(regs, pd);
+    if (IS_ERR(process))
+        return PTR_ERR(process);
+
+    int rc = vm_regions_clone(&process->vm_regions, current->vm_regions,
+                              current->num_vm_regions);
+    if (IS_ERR(rc))
+        return rc;
+    process->num_vm_regions = current->num_vm_regions;
+
     scheduler_register(process);
 
     return process->pid;
 }
 
+static bool vfork_should_unblock(pid_t* pid) {
+    struct process* child = process_find_process_by_pid(*pid);
+    return !child || !child->borrows_pd;
+}
+
+// the child runs in our address space until it calls execve() or exits, so
+// nothing has to be copied. we stay blocked until then because the child
+// uses our user stack.
+pid_t sys_vfork(registers* regs) {
+    struct process* process = create_child(regs, current->pd);
+    if (IS_ERR(process))
+        return PTR_ERR(process);
+    process->borrows_pd = true;
+    process->vm_regions = current->vm_regions;
+    process->num_vm_regions = current->num_vm_regions;
+
+    pid_t pid = process->pid;
+    scheduler_register(process);
+
+    // signals are handled once the child has let go of the address space
+    while (scheduler_block((should_unblock_fn)vfork_should_unblock, &pid) ==
+           -EINTR)
+        ;
+
+    return pid;
+}
+
 int sys_kill(pid_t pid, int sig) {
     if (pid > 0)
         return process_send_signal_to_one(pid, sig);
@@ -223,6 +265,7 @@ pid_t sys_waitpid(pid_t pid, int* wstatus, int options) {
         return -ECHILD;
 
     scheduler_unregister(waited_process);
+    procfs_forget_pid(waited_process->pid);
     if (wstatus)
         *wstatus = waited_process->exit_status;
     pid_t result = waited_process->pid;
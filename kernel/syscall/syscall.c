@@ -107,7 +107,7 @@ static void syscall_handler(registers* regs) {
     syscall_handler_fn handler = syscall_handlers[regs->eax];
     ASSERT(handler);
 
-    if (regs->eax == SYS_fork)
+    if (regs->eax == SYS_fork || regs->eax == SYS_vfork)
         regs->eax = handler((uintptr_t)regs, 0, 0, 0);
     else
         regs->eax = handler(regs->edx, regs->ecx, regs->ebx, regs->esi);
@@ -39,6 +39,9 @@
 
 #pragma once
 
+#include <kernel/api/io_uring.h>
+#include <kernel/api/poll.h>
+#include <kernel/api/sys/epoll.h>
 #include <kernel/api/sys/socket.h>
 #include <kernel/api/sys/stat.h>
 #include <kernel/api/sys/syscall.h>
@@ -57,38 +60,66 @@ int sys_clock_nanosleep(clockid_t clockid, int flags,
                         struct timespec* remain);
 int sys_close(int fd);
 int sys_connect(int sockfd, const struct sockaddr* addr, socklen_t addrlen);
+ssize_t sys_copy_file_range(const splice_params* params);
 int sys_dbgputs(const char* str);
 int sys_dup2(int oldfd, int newfd);
+int sys_epoll_create(int size);
+int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event* event);
+int sys_epoll_wait(int epfd, struct epoll_event* events, int maxevents,
+                   int timeout);
 int sys_execve(const char* pathname, char* const argv[], char* const envp[]);
 noreturn void sys_exit(int status);
+int sys_fallocate(int fd, int mode, off_t offset, off_t len);
 int sys_fcntl(int fd, int cmd, uintptr_t arg);
 pid_t sys_fork(registers*);
+int sys_fstat(int fd, struct stat* buf);
+int sys_fstatat(int dirfd, const char* pathname, struct stat* buf,
+                int flags);
+int sys_fsync(int fd);
 int sys_ftruncate(int fd, off_t length);
 char* sys_getcwd(char* buf, size_t size);
 long sys_getdents(int fd, void* dirp, size_t count);
 pid_t sys_getpgid(pid_t pid);
 pid_t sys_getpid(void);
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                       unsigned flags);
+int sys_io_uring_setup(unsigned entries, struct io_uring_params* params);
 int sys_ioctl(int fd, int request, void* argp);
 int sys_kill(pid_t pid, int sig);
 int sys_link(const char* oldpath, const char* newpath);
 int sys_listen(int sockfd, int backlog);
 off_t sys_lseek(int fd, off_t offset, int whence);
 int sys_mkdir(const char* pathname, mode_t mode);
+int sys_mkdirat(int dirfd, const char* pathname, mode_t mode);
 int sys_mknod(const char* pathname, mode_t mode, dev_t dev);
 void* sys_mmap(const mmap_params* params);
+int sys_mount(const char* source, const char* target,
+              const char* filesystemtype, unsigned long flags);
+int sys_msync(void* addr, size_t length, int flags);
 int sys_munmap(void* addr, size_t length);
 int sys_open(const char* pathname, int flags, unsigned mode);
+int sys_openat(int dirfd, const char* pathname, int flags, unsigned mode);
 int sys_pipe(int pipefd[2]);
+int sys_poll(struct pollfd* fds, nfds_t nfds, int timeout);
+pid_t sys_posix_spawn(const posix_spawn_params*);
 ssize_t sys_read(int fd, void* buf, size_t count);
 int sys_reboot(int howto);
 int sys_rename(const char* oldpath, const char* newpath);
+int sys_renameat(int olddirfd, const char* oldpath, int newdirfd,
+                 const char* newpath);
 int sys_rmdir(const char* pathname);
 int sys_sched_yield(void);
+ssize_t sys_sendfile(int out_fd, int in_fd, off_t* offset, size_t count);
 int sys_setpgid(pid_t pid, pid_t pgid);
 int sys_socket(int domain, int type, int protocol);
+ssize_t sys_splice(const splice_params* params);
 int sys_stat(const char* pathname, struct stat* buf);
+int sys_sync(void);
 long sys_sysconf(int name);
 clock_t sys_times(struct tms* buf);
+int sys_umount(const char* target);
 int sys_unlink(const char* pathname);
+int sys_unlinkat(int dirfd, const char* pathname, int flags);
+pid_t sys_vfork(registers*);
 pid_t sys_waitpid(pid_t pid, int* wstatus, int options);
 ssize_t sys_write(int fd, const void* buf, size_t count);
@@ -37,6 +37,7 @@
  *  THE SOFTWARE.
  */
 
+#include "api/poll.h"
 #include "memory/memory.h"
 #include "panic.h"
 #include "scheduler.h"
@@ -81,6 +82,7 @@ static ssize_t unix_socket_read(file_description* desc, void* buffer, size_t cou
         }
         ssize_t nread = ring_buf_read(buf, buffer, count);
         mutex_unlock(&buf->lock);
+        inode_notify(desc->inode);
         return nread;
     }
 }
@@ -107,10 +109,23 @@ static ssize_t unix_socket_write(file_description* desc, const void* buffer, siz
         }
         ssize_t nwritten = ring_buf_write(buf, buffer, count);
         mutex_unlock(&buf->lock);
+        inode_notify(desc->inode);
         return nwritten;
     }
 }
 
+static short unix_socket_poll(file_description* desc, short events) {
+    unix_socket* socket = (unix_socket*)desc->inode;
+    short revents = 0;
+    if (socket->num_pending > 0) // listening socket with a pending connection
+        revents |= POLLIN;
+    if ((events & POLLIN) && !ring_buf_is_empty(get_buf_to_read(socket, desc)))
+        revents |= POLLIN;
+    if ((events & POLLOUT) && !ring_buf_is_full(get_buf_to_write(socket, desc)))
+        revents |= POLLOUT;
+    return revents;
+}
+
 unix_socket* unix_socket_create(void) {
     unix_socket* socket = kmalloc(sizeof(unix_socket));
     if (!socket)
@@ -118,7 +133,7 @@ unix_socket* unix_socket_create(void) {
     *socket = (unix_socket){0};
 
     struct inode* inode = &socket->inode;
-    static file_ops fops = {.destroy_inode = unix_socket_destroy_inode, .read = unix_socket_read, .write = unix_socket_write};
+    static file_ops fops = {.destroy_inode = unix_socket_destroy_inode, .read = unix_socket_read, .write = unix_socket_write, .poll = unix_socket_poll};
     inode->fops = &fops;
     inode->mode = S_IFSOCK;
     inode->ref_count = 1;
@@ -152,6 +167,7 @@ static void enqueue_pending(unix_socket* listener, unix_socket* connector) {
 
     mutex_unlock(&listener->pending_queue_lock);
     ++listener->num_pending;
+    inode_notify(&listener->inode);
 }
 
 static unix_socket* deque_pending(unix_socket* listener) {
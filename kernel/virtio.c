@@ -0,0 +1,271 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "virtio.h"
+#include "api/err.h"
+#include "asm_wrapper.h"
+#include "boot_defs.h"
+#include "memory/memory.h"
+#include "panic.h"
+#include <common/string.h>
+#include <stdatomic.h>
+
+/* Like the PCI code it is built on, the virtio transport is i?86-only for now. */
+
+#if defined(__i386__)
+
+#define VIRTIO_PCI_DEVICE_FEATURES 0x00
+#define VIRTIO_PCI_GUEST_FEATURES 0x04
+#define VIRTIO_PCI_QUEUE_PFN 0x08
+#define VIRTIO_PCI_QUEUE_SIZE 0x0c
+#define VIRTIO_PCI_QUEUE_SELECT 0x0e
+#define VIRTIO_PCI_QUEUE_NOTIFY 0x10
+#define VIRTIO_PCI_STATUS 0x12
+#define VIRTIO_PCI_ISR 0x13
+#define VIRTIO_PCI_CONFIG 0x14 // MSI-X is not enabled
+
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x1
+#define VIRTIO_STATUS_DRIVER 0x2
+#define VIRTIO_STATUS_DRIVER_OK 0x4
+#define VIRTIO_STATUS_FAILED 0x80
+
+#define VIRTQ_USED_F_NO_NOTIFY 0x1
+
+// legacy devices expect the used ring to start on a page boundary
+#define VIRTQ_ALIGN PAGE_SIZE
+
+int virtio_init(virtio_device* dev, const struct pci_addr* addr,
+                uint32_t driver_features) {
+    // legacy devices have their registers in I/O space
+    uint32_t bar0 = pci_get_bar0(addr);
+    if (!(bar0 & 1))
+        return -ENODEV;
+    *dev = (virtio_device){.pci_addr = *addr, .io_base = bar0 & ~3};
+
+    pci_set_interrupt_line_enabled(addr, true);
+    pci_set_bus_mastering_enabled(addr, true);
+
+    uint16_t io = dev->io_base;
+    out8(io + VIRTIO_PCI_STATUS, 0);
+    out8(io + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    out8(io + VIRTIO_PCI_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    dev->features = in32(io + VIRTIO_PCI_DEVICE_FEATURES) & driver_features;
+    out32(io + VIRTIO_PCI_GUEST_FEATURES, dev->features);
+    return 0;
+}
+
+void virtio_driver_ok(virtio_device* dev) {
+    uint16_t port = dev->io_base + VIRTIO_PCI_STATUS;
+    out8(port, in8(port) | VIRTIO_STATUS_DRIVER_OK);
+}
+
+void virtio_fail(virtio_device* dev) {
+    uint16_t port = dev->io_base + VIRTIO_PCI_STATUS;
+    out8(port, in8(port) | VIRTIO_STATUS_FAILED);
+}
+
+bool virtio_has_feature(const virtio_device* dev, unsigned bit) {
+    return dev->features & (1u << bit);
+}
+
+uint32_t virtio_read_config32(const virtio_device* dev, size_t offset) {
+    return in32(dev->io_base + VIRTIO_PCI_CONFIG + offset);
+}
+
+uint8_t virtio_read_isr(const virtio_device* dev) {
+    return in8(dev->io_base + VIRTIO_PCI_ISR);
+}
+
+static size_t used_ring_offset(uint16_t size) {
+    return round_up(sizeof(struct virtq_desc) * size +
+                        sizeof(struct virtq_avail) +
+                        sizeof(uint16_t) * (size + 1),
+                    VIRTQ_ALIGN);
+}
+
+static size_t rings_size(uint16_t size) {
+    return used_ring_offset(size) +
+           round_up(sizeof(struct virtq_used) +
+                        sizeof(struct virtq_used_elem) * size +
+                        sizeof(uint16_t),
+                    VIRTQ_ALIGN);
+}
+
+int virtqueue_init(virtqueue* vq, virtio_device* dev, uint16_t index) {
+    uint16_t io = dev->io_base;
+    out16(io + VIRTIO_PCI_QUEUE_SELECT, index);
+    uint16_t size = in16(io + VIRTIO_PCI_QUEUE_SIZE);
+    if (size == 0)
+        return -ENODEV;
+
+    void** cookies = kmalloc(size * sizeof(void*));
+    if (!cookies)
+        return -ENOMEM;
+
+    size_t num_bytes = rings_size(size);
+    uintptr_t paddr = page_allocator_alloc_contiguous(num_bytes / PAGE_SIZE);
+    if (IS_ERR(paddr)) {
+        kfree(cookies);
+        return paddr;
+    }
+    uintptr_t vaddr = range_allocator_alloc(&kernel_vaddr_allocator, num_bytes);
+    int rc = IS_ERR(vaddr) ? (int)vaddr
+                           : paging_map_to_physical_range(
+                                 vaddr, paddr, num_bytes,
+                                 PAGE_WRITE | PAGE_GLOBAL);
+    // from here on, the mapping holds the references to the pages
+    for (size_t offset = 0; offset < num_bytes; offset += PAGE_SIZE)
+        page_allocator_unref_page(paddr + offset);
+    if (IS_ERR(rc)) {
+        kfree(cookies);
+        return rc;
+    }
+    memset((void*)vaddr, 0, num_bytes);
+
+    *vq = (virtqueue){
+        .dev = dev,
+        .index = index,
+        .size = size,
+        .desc = (struct virtq_desc*)vaddr,
+        .avail = (struct virtq_avail*)(vaddr +
+                                       sizeof(struct virtq_desc) * size),
+        .used = (struct virtq_used*)(vaddr + used_ring_offset(size)),
+        .free_head = 0,
+        .num_free = size,
+        .cookies = cookies,
+    };
+    for (uint16_t i = 0; i + 1 < size; ++i)
+        vq->desc[i].next = i + 1;
+
+    out32(io + VIRTIO_PCI_QUEUE_PFN, paddr / PAGE_SIZE);
+    return 0;
+}
+
+int virtqueue_add(virtqueue* vq, const struct virtq_buf* bufs,
+                  size_t num_out, size_t num_in, struct virtq_desc* indirect,
+                  void* cookie) {
+    size_t num_bufs = num_out + num_in;
+    ASSERT(num_bufs > 0);
+    bool use_indirect = indirect && num_bufs > 1 &&
+                        virtio_has_feature(vq->dev, VIRTIO_F_INDIRECT_DESC);
+    size_t num_descs = use_indirect ? 1 : num_bufs;
+    if (vq->num_free < num_descs)
+        return -ENOSPC;
+
+    uint16_t head = vq->free_head;
+    if (use_indirect) {
+        for (size_t i = 0; i < num_bufs; ++i) {
+            uint16_t flags = i >= num_out ? VIRTQ_DESC_F_WRITE : 0;
+            if (i + 1 < num_bufs)
+                flags |= VIRTQ_DESC_F_NEXT;
+            indirect[i] = (struct virtq_desc){.addr = bufs[i].paddr,
+                                              .len = bufs[i].len,
+                                              .flags = flags,
+                                              .next = i + 1};
+        }
+        struct virtq_desc* desc = vq->desc + head;
+        vq->free_head = desc->next;
+        desc->addr = paging_virtual_to_physical_addr((uintptr_t)indirect);
+        desc->len = num_bufs * sizeof(struct virtq_desc);
+        desc->flags = VIRTQ_DESC_F_INDIRECT;
+    } else {
+        // the chain is taken from the front of the free list, so the next
+        // fields already link it together
+        uint16_t idx = head;
+        for (size_t i = 0; i < num_bufs; ++i) {
+            struct virtq_desc* desc = vq->desc + idx;
+            uint16_t flags = i >= num_out ? VIRTQ_DESC_F_WRITE : 0;
+            if (i + 1 < num_bufs)
+                flags |= VIRTQ_DESC_F_NEXT;
+            desc->addr = bufs[i].paddr;
+            desc->len = bufs[i].len;
+            desc->flags = flags;
+            idx = desc->next;
+        }
+        vq->free_head = idx;
+    }
+    vq->num_free -= num_descs;
+    vq->cookies[head] = cookie;
+
+    volatile struct virtq_avail* avail = vq->avail;
+    avail->ring[avail->idx % vq->size] = head;
+    // the device must see the descriptors before the new index
+    atomic_thread_fence(memory_order_seq_cst);
+    ++avail->idx;
+    return 0;
+}
+
+void virtqueue_kick(virtqueue* vq) {
+    atomic_thread_fence(memory_order_seq_cst);
+    volatile struct virtq_used* used = vq->used;
+    if (!(used->flags & VIRTQ_USED_F_NO_NOTIFY))
+        out16(vq->dev->io_base + VIRTIO_PCI_QUEUE_NOTIFY, vq->index);
+}
+
+void* virtqueue_get_used(virtqueue* vq, uint32_t* out_len) {
+    volatile struct virtq_used* used = vq->used;
+    if (vq->last_used_idx == used->idx)
+        return NULL;
+    atomic_thread_fence(memory_order_seq_cst);
+
+    volatile struct virtq_used_elem* elem =
+        used->ring + vq->last_used_idx % vq->size;
+    uint16_t head = elem->id;
+    if (out_len)
+        *out_len = elem->len;
+    ++vq->last_used_idx;
+
+    uint16_t tail = head;
+    uint16_t num_descs = 1;
+    while (vq->desc[tail].flags & VIRTQ_DESC_F_NEXT) {
+        tail = vq->desc[tail].next;
+        ++num_descs;
+    }
+    vq->desc[tail].next = vq->free_head;
+    vq->free_head = head;
+    vq->num_free += num_descs;
+
+    void* cookie = vq->cookies[head];
+    vq->cookies[head] = NULL;
+    return cookie;
+}
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "pci.h"
+#include <common/extra.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// transport for virtio devices exposed through the legacy PCI interface
+
+#define VIRTIO_PCI_VENDOR_ID 0x1af4
+
+// legacy device IDs are 0x1000 + the virtio device type - 1
+#define VIRTIO_PCI_DEVICE_ID_BLOCK 0x1001
+
+#define VIRTIO_F_INDIRECT_DESC 28
+
+#define VIRTQ_DESC_F_NEXT 0x1
+#define VIRTQ_DESC_F_WRITE 0x2 // the device writes to the buffer
+#define VIRTQ_DESC_F_INDIRECT 0x4
+
+struct virtq_desc {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed));
+
+struct virtq_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed));
+
+struct virtq_used_elem {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed));
+
+struct virtq_used {
+    uint16_t flags;
+    uint16_t idx;
+    struct virtq_used_elem ring[];
+} __attribute__((packed));
+
+typedef struct virtio_device {
+    struct pci_addr pci_addr;
+    uint16_t io_base;
+    uint32_t features; // negotiated with the device
+} virtio_device;
+
+typedef struct virtqueue {
+    virtio_device* dev;
+    uint16_t index;
+    uint16_t size;
+
+    // the rings live in physically contiguous memory
+    struct virtq_desc* desc;
+    struct virtq_avail* avail;
+    struct virtq_used* used;
+
+    uint16_t free_head; // unused descriptors are chained through next
+    uint16_t num_free;
+    uint16_t last_used_idx;
+    void** cookies; // indexed by the head descriptor of each buffer
+} virtqueue;
+
+// a physically contiguous part of a buffer
+struct virtq_buf {
+    uintptr_t paddr;
+    size_t len;
+};
+
+// resets the device and negotiates the features the driver supports
+NODISCARD int virtio_init(virtio_device*, const struct pci_addr*,
+                          uint32_t driver_features);
+void virtio_driver_ok(virtio_device*);
+void virtio_fail(virtio_device*);
+bool virtio_has_feature(const virtio_device*, unsigned bit);
+uint32_t virtio_read_config32(const virtio_device*, size_t offset);
+// reading the ISR status acknowledges the interrupt
+uint8_t virtio_read_isr(const virtio_device*);
+
+NODISCARD int virtqueue_init(virtqueue*, virtio_device*, uint16_t index);
+
+// makes a buffer of num_out device-readable parts followed by num_in
+// device-writable parts available to the device. if the indirect descriptor
+// feature was negotiated and indirect is non-NULL, the parts are described in
+// indirect, which must be physically contiguous and have room for all of
+// them, and the buffer takes up a single descriptor of the ring. cookie is
+// handed back by virtqueue_get_used(). returns -ENOSPC if the ring is full.
+// must be called with interrupts disabled.
+NODISCARD int virtqueue_add(virtqueue*, const struct virtq_buf* bufs,
+                            size_t num_out, size_t num_in,
+                            struct virtq_desc* indirect, void* cookie);
+void virtqueue_kick(virtqueue*);
+
+// returns the cookie of a buffer the device is done with, or NULL if there is
+// none. must be called with interrupts disabled.
+void* virtqueue_get_used(virtqueue*, uint32_t* out_len);
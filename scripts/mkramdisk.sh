@@ -0,0 +1,63 @@
+#!/bin/bash
+
+#
+#   __  __                      
+#  |  \/  |__ _ __ _ _ __  __ _ 
+#  | |\/| / _` / _` | '  \/ _` |
+#  |_|  |_\__,_\__, |_|_|_\__,_|
+#              |___/        
+#
+# Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+# i?86 assembly, and userland binaries written in C.
+#    
+# Copyright (c) 2023 Nexuss, John Paul Wohlscheid, rilysh, Milton612, and FueledByCocaine
+#
+# This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+# https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+# project, and the license can be seen below:
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+# 
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+# 
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+
+# builds the ext2 image that the kernel loads as /dev/ram0. the big directory
+# gets a hashed index, so both directory formats are covered.
+
+set -e
+
+OUTPUT="$1"
+
+if ! command -v mke2fs >/dev/null; then
+	echo "mke2fs not found, skipping ${OUTPUT}" >&2
+	exit 0
+fi
+
+ROOT=$(mktemp -d)
+trap 'rm -rf "${ROOT}"' EXIT
+
+mkdir -p "${ROOT}/small" "${ROOT}/big"
+echo 'hello from ext2' > "${ROOT}/hello.txt"
+seq 1 20000 > "${ROOT}/small/numbers"
+for i in $(seq 1 500); do
+	echo "${i}" > "${ROOT}/big/file${i}"
+done
+
+rm -f "${OUTPUT}"
+mke2fs -q -t ext2 -b 1024 -O dir_index -d "${ROOT}" "${OUTPUT}" 4M >/dev/null
+# -D indexes the directories that mke2fs populated linearly
+e2fsck -fyD "${OUTPUT}" >/dev/null 2>&1 || [ $? -le 1 ]
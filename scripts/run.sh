@@ -39,6 +39,7 @@ set -e
 
 KERNEL='kernel/kernel'
 INITRD='initrd'
+DISK_IMAGE='disk_image'
 
 QEMU_DISPLAY_ARGS=(-display "sdl,gl=off,show-cursor=off")
 if [ "$1" = "shell" ]; then
@@ -57,6 +58,15 @@ if command -v wslpath >/dev/null; then
 	QEMU_VIRT_TECH_ARGS=(-accel "whpx,kernel-irqchip=off" -accel tcg)
 	KERNEL=$(wslpath -w "${KERNEL}")
 	INITRD=$(wslpath -w "${INITRD}")
+	if [ -f "${DISK_IMAGE}" ]; then
+		DISK_IMAGE=$(wslpath -w "${DISK_IMAGE}")
+	fi
+fi
+
+# `make disk_image` creates a scratch disk, which shows up as /dev/hda
+QEMU_DISK_ARGS=()
+if [ -f disk_image ]; then
+	QEMU_DISK_ARGS=(-drive "file=${DISK_IMAGE},format=raw,if=ide,index=0")
 fi
 
 QEMU_BIN="${QEMU_BINARY_PREFIX}qemu-system-i386${QEMU_BINARY_SUFFIX}"
@@ -64,6 +74,7 @@ QEMU_BIN="${QEMU_BINARY_PREFIX}qemu-system-i386${QEMU_BINARY_SUFFIX}"
 	-initrd "${INITRD}" \
 	-d guest_errors \
 	"${QEMU_DISPLAY_ARGS[@]}" \
+	"${QEMU_DISK_ARGS[@]}" \
 	-device ac97 \
 	-chardev stdio,mux=on,id=char0 \
 	-serial chardev:char0 \
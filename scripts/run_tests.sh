@@ -37,10 +37,17 @@
 
 set -e
 
+DISK_IMAGE=$(mktemp)
+VIRTIO_DISK_IMAGE=$(mktemp)
+trap 'rm -f "${DISK_IMAGE}" "${VIRTIO_DISK_IMAGE}"' EXIT
+truncate -s 8M "${DISK_IMAGE}" "${VIRTIO_DISK_IMAGE}"
+
 ! qemu-system-i386 \
     -kernel kernel/kernel \
     -initrd initrd \
-    -append 'panic=poweroff init=/bin/init-test' \
+    -drive "file=${DISK_IMAGE},format=raw,if=ide,index=0" \
+    -drive "file=${VIRTIO_DISK_IMAGE},format=raw,if=virtio" \
+    -append 'panic=poweroff init=/bin/init-test freeinitrd' \
     -d guest_errors \
     -no-reboot \
     -serial stdio \
@@ -0,0 +1,285 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <common/escp.h>
+
+#define PAGE_SIZE 4096
+#define HEADER_SIZE 76
+#define BLOCK_SIZE 512
+
+#define LZ4_MAGIC 0x184d2204
+#define LZ4_BLOCK_SIZE (4 << 20)
+#define LZ4_HASH_BITS 16
+#define LZ4_MIN_MATCH 4
+#define LZ4_MF_LIMIT 12
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MAX_OFFSET 65535
+
+/*
+ *  The tool `mkinitrd` writes the paths read from stdin (relative to a base directory) into an initrd, which is a cpio archive in the odc format.
+ *  Unlike `cpio -o`, it pads the name of every file that spans at least one page with null characters so that the file's data starts on a page
+ *  boundary. The kernel can then hand out the pages of the loaded archive as the file's pages instead of copying them.
+ *
+ *  With `-z`, the archive is compressed as an LZ4 frame instead. The kernel decompresses it into the files, so the data isn't aligned.
+ */
+
+static unsigned long offset = 0;
+static int compress = 0;
+static unsigned char* archive = NULL;
+static size_t archive_capacity = 0;
+
+static void write_bytes(FILE* out, const void* bytes, size_t size) {
+    if (compress) {
+        if (offset + size > archive_capacity) {
+            while (offset + size > archive_capacity)
+                archive_capacity = archive_capacity ? archive_capacity * 2 : (1 << 20);
+            archive = realloc(archive, archive_capacity);
+            if (archive == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        memcpy(archive + offset, bytes, size);
+    } else if (fwrite(bytes, 1, size, out) != size) {
+        perror("fwrite");
+        exit(1);
+    }
+    offset += size;
+}
+
+static void write_padding(FILE* out, size_t size) {
+    static const char zeros[PAGE_SIZE];
+    while (size > 0) {
+        size_t n = size < sizeof(zeros) ? size : sizeof(zeros);
+        write_bytes(out, zeros, n);
+        size -= n;
+    }
+}
+
+static void write_header(FILE* out, unsigned long ino, const struct stat* st, const char* name, unsigned long file_size, int align_data) {
+    unsigned long name_size = strlen(name) + 1;
+    unsigned long padding = 0;
+    if (align_data)
+        padding = (PAGE_SIZE - (offset + HEADER_SIZE + name_size) % PAGE_SIZE) % PAGE_SIZE;
+
+    char header[HEADER_SIZE + 1];
+    snprintf(header, sizeof(header), "070707%06o%06lo%06o%06o%06o%06o%06o%011lo%06lo%011lo",
+             0, ino & 0777777, (unsigned)st->st_mode & 0777777, 0, 0, (unsigned)st->st_nlink & 0777777, (unsigned)st->st_rdev & 0777777,
+             (unsigned long)st->st_mtime & 077777777777, (name_size + padding) & 0777777, file_size);
+    write_bytes(out, header, HEADER_SIZE);
+    write_bytes(out, name, name_size);
+    write_padding(out, padding);
+}
+
+static void copy_file(FILE* out, const char* path, unsigned long size) {
+    FILE* in = fopen(path, "rb");
+    if (in == NULL) {
+        printf("error: cannot open file '%s'\n", path);
+        exit(1);
+    }
+    char buf[PAGE_SIZE];
+    unsigned long total = 0;
+    while (total < size) {
+        size_t n = fread(buf, 1, sizeof(buf), in);
+        if (n == 0)
+            break;
+        write_bytes(out, buf, n);
+        total += n;
+    }
+    fclose(in);
+    if (total != size) {
+        printf("error: '%s' changed while it was being archived\n", path);
+        exit(1);
+    }
+}
+
+static void put_le32(unsigned char* p, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        p[i] = value >> (i * 8);
+}
+
+static uint32_t read_le32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+// xxHash32 of inputs shorter than 16 bytes, which is all the frame header needs
+static uint32_t xxh32_short(const unsigned char* p, size_t len) {
+    uint32_t h = 374761393U + (uint32_t)len;
+    for (; len >= 4; p += 4, len -= 4)
+        h = rotl32(h + read_le32(p) * 3266489917U, 17) * 668265263U;
+    for (; len > 0; ++p, --len)
+        h = rotl32(h + *p * 374761393U, 11) * 2654435761U;
+    h ^= h >> 15;
+    h *= 2246822519U;
+    h ^= h >> 13;
+    h *= 3266489917U;
+    h ^= h >> 16;
+    return h;
+}
+
+static unsigned char* put_length(unsigned char* dest, size_t len) {
+    for (; len >= 255; len -= 255)
+        *dest++ = 255;
+    *dest++ = len;
+    return dest;
+}
+
+static unsigned char* put_sequence(unsigned char* dest, const unsigned char* literals, size_t num_literals, size_t match_offset,
+                                   size_t match_len) {
+    unsigned char* token = dest++;
+    *token = (num_literals < 15 ? num_literals : 15) << 4;
+    if (num_literals >= 15)
+        dest = put_length(dest, num_literals - 15);
+    memcpy(dest, literals, num_literals);
+    dest += num_literals;
+    if (match_len == 0)
+        return dest;
+
+    *dest++ = match_offset & 0xff;
+    *dest++ = match_offset >> 8;
+    match_len -= LZ4_MIN_MATCH;
+    *token |= match_len < 15 ? match_len : 15;
+    if (match_len >= 15)
+        dest = put_length(dest, match_len - 15);
+    return dest;
+}
+
+// greedy compressor finding matches through a hash table of the last position of every 4 bytes.
+// the format requires the last match to start at least 12 bytes before the end of the block and the last 5 bytes to be literals.
+static size_t compress_block(const unsigned char* src, size_t size, unsigned char* dest) {
+    static uint32_t table[1 << LZ4_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    unsigned char* out = dest;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (size > LZ4_MF_LIMIT && pos < size - LZ4_MF_LIMIT) {
+        uint32_t sequence = read_le32(src + pos);
+        uint32_t hash = (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+        size_t candidate = table[hash];
+        table[hash] = pos;
+        if (candidate >= pos || pos - candidate > LZ4_MAX_OFFSET || read_le32(src + candidate) != sequence) {
+            ++pos;
+            continue;
+        }
+
+        size_t len = LZ4_MIN_MATCH;
+        size_t max_len = size - LZ4_LAST_LITERALS - pos;
+        while (len < max_len && src[candidate + len] == src[pos + len])
+            ++len;
+        out = put_sequence(out, src + anchor, pos - anchor, pos - candidate, len);
+        pos += len;
+        anchor = pos;
+    }
+    out = put_sequence(out, src + anchor, size - anchor, 0, 0);
+    return out - dest;
+}
+
+static void write_lz4_frame(FILE* out, const unsigned char* data, size_t size) {
+    unsigned char header[7];
+    put_le32(header, LZ4_MAGIC);
+    header[4] = 0x60; // version 01, independent blocks
+    header[5] = 0x70; // 4MiB blocks
+    header[6] = (xxh32_short(header + 4, 2) >> 8) & 0xff;
+    write_bytes(out, header, sizeof(header));
+
+    unsigned char* block = malloc(LZ4_BLOCK_SIZE + LZ4_BLOCK_SIZE / 255 + 16);
+    if (block == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (size_t i = 0; i < size; i += LZ4_BLOCK_SIZE) {
+        size_t n = size - i < LZ4_BLOCK_SIZE ? size - i : LZ4_BLOCK_SIZE;
+        size_t compressed_size = compress_block(data + i, n, block);
+        unsigned char block_size[4];
+        if (compressed_size < n) {
+            put_le32(block_size, compressed_size);
+            write_bytes(out, block_size, sizeof(block_size));
+            write_bytes(out, block, compressed_size);
+        } else {
+            // stored as is, as indicated by the highest bit of the size
+            put_le32(block_size, n | 0x80000000);
+            write_bytes(out, block_size, sizeof(block_size));
+            write_bytes(out, data + i, n);
+        }
+    }
+    free(block);
+
+    unsigned char end_mark[4] = {0};
+    write_bytes(out, end_mark, sizeof(end_mark));
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && !strcmp(argv[1], "-z")) {
+        compress = 1;
+        ++argv;
+        --argc;
+    }
+    if (argc != 3) {
+        printf("%susage: %smkinitrd %s[%s-z%s] <%sbase_directory%s> <%soutput_file%s>%s\n", F_MAGENTA, F_GREEN, F_BLUE, F_GREEN, F_BLUE,
+               F_GREEN, F_BLUE, F_GREEN, F_BLUE, RESET);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[2], "wb");
+    if (out == NULL) {
+        printf("error: cannot open file '%s'\n", argv[2]);
+        return 1;
+    }
+
+    char name[4096];
+    unsigned long ino = 0;
+    while (fgets(name, sizeof(name), stdin)) {
+        name[strcspn(name, "\n")] = '\0';
+        if (name[0] == '\0')
+            continue;
+
+        char path[8192];
+        snprintf(path, sizeof(path), "%s/%s", argv[1], name);
+        struct stat st;
+        if (lstat(path, &st) < 0) {
+            perror(path);
+            return 1;
+        }
+
+        ++ino;
+        if (S_ISREG(st.st_mode)) {
+            write_header(out, ino, &st, name, st.st_size, !compress && st.st_size >= PAGE_SIZE);
+            copy_file(out, path, st.st_size);
+        } else if (S_ISLNK(st.st_mode)) {
+            char target[4096];
+            ssize_t len = readlink(path, target, sizeof(target));
+            if (len < 0) {
+                perror(path);
+                return 1;
+            }
+            write_header(out, ino, &st, name, len, 0);
+            write_bytes(out, target, len);
+        } else {
+            write_header(out, ino, &st, name, 0, 0);
+        }
+    }
+
+    struct stat trailer = {0};
+    trailer.st_nlink = 1;
+    write_header(out, 0, &trailer, "TRAILER!!!", 0, 0);
+    if (compress) {
+        size_t archive_size = offset;
+        compress = 0;
+        offset = 0;
+        write_lz4_frame(out, archive, archive_size);
+        free(archive);
+    } else {
+        write_padding(out, (BLOCK_SIZE - offset % BLOCK_SIZE) % BLOCK_SIZE);
+    }
+
+    fclose(out);
+    return 0;
+}
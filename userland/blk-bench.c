@@ -0,0 +1,147 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <panic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// 4KiB reads and writes from several processes at once, so that the device
+// has more than one request to work on. it overwrites the device.
+
+#define BLOCK_SIZE 4096
+#define NUM_OPS 256 // per job
+#define DEFAULT_NUM_JOBS 4
+#define MAX_JOBS 32
+
+static unsigned elapsed_ms(const struct timespec* start) {
+    struct timespec now;
+    ASSERT_OK(clock_gettime(CLOCK_MONOTONIC, &now));
+    return (now.tv_sec - start->tv_sec) * 1000 +
+           (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void run_job(const char* path, unsigned job, unsigned num_blocks,
+                    bool is_write, bool random) {
+    int fd = open(path, is_write ? O_WRONLY : O_RDONLY);
+    ASSERT_OK(fd);
+    srand(getpid());
+
+    static char buf[BLOCK_SIZE];
+    for (unsigned i = 0; i < BLOCK_SIZE; ++i)
+        buf[i] = job + i;
+
+    // sequential jobs work on disjoint parts of the device
+    unsigned first = job * NUM_OPS % num_blocks;
+    for (unsigned i = 0; i < NUM_OPS; ++i) {
+        unsigned block = random ? (unsigned)rand() % num_blocks
+                                : (first + i) % num_blocks;
+        ASSERT(lseek(fd, block * BLOCK_SIZE, SEEK_SET) >= 0);
+        ssize_t n = is_write ? write(fd, buf, BLOCK_SIZE)
+                          : read(fd, buf, BLOCK_SIZE);
+        ASSERT(n == BLOCK_SIZE);
+    }
+    ASSERT_OK(close(fd));
+}
+
+static void run(const char* label, const char* path, unsigned num_jobs,
+                unsigned num_blocks, bool is_write, bool random) {
+    struct timespec start;
+    ASSERT_OK(clock_gettime(CLOCK_MONOTONIC, &start));
+
+    pid_t pids[MAX_JOBS];
+    for (unsigned i = 0; i < num_jobs; ++i) {
+        pids[i] = fork();
+        ASSERT_OK(pids[i]);
+        if (pids[i] == 0) {
+            run_job(path, i, num_blocks, is_write, random);
+            exit(EXIT_SUCCESS);
+        }
+    }
+    bool failed = false;
+    for (unsigned i = 0; i < num_jobs; ++i) {
+        int status;
+        ASSERT(waitpid(pids[i], &status, 0) == pids[i]);
+        failed |= status != 0;
+    }
+
+    unsigned ms = elapsed_ms(&start);
+    if (ms == 0)
+        ms = 1;
+    unsigned num_ops = num_jobs * NUM_OPS;
+    printf("%-12s %6u ms %6u IOPS %8u KiB/s%s\n", label, ms,
+           num_ops * 1000 / ms, num_ops * (BLOCK_SIZE / 1024) * 1000 / ms,
+           failed ? " (failed)" : "");
+}
+
+int main(int argc, char* const argv[]) {
+    if (argc < 2) {
+        dprintf(STDERR_FILENO, "usage: blk-bench DEVICE [jobs]\n");
+        return EXIT_FAILURE;
+    }
+    const char* path = argv[1];
+    unsigned num_jobs = argc > 2 ? (unsigned)atoi(argv[2]) : DEFAULT_NUM_JOBS;
+    if (num_jobs == 0 || num_jobs > MAX_JOBS) {
+        dprintf(STDERR_FILENO, "blk-bench: jobs must be 1-%u\n", MAX_JOBS);
+        return EXIT_FAILURE;
+    }
+
+    struct stat st;
+    if (stat(path, &st) < 0) {
+        perror("stat");
+        return EXIT_FAILURE;
+    }
+    unsigned num_blocks = st.st_size / BLOCK_SIZE;
+    if (num_blocks == 0) {
+        dprintf(STDERR_FILENO, "blk-bench: %s is too small\n", path);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s, %u jobs\n", path, num_jobs);
+    run("seq write", path, num_jobs, num_blocks, true, false);
+    run("seq read", path, num_jobs, num_blocks, false, false);
+    run("rand write", path, num_jobs, num_blocks, true, true);
+    run("rand read", path, num_jobs, num_blocks, false, true);
+    return EXIT_SUCCESS;
+}
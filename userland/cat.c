@@ -41,14 +41,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/sendfile.h>
 #include <unistd.h>
 
 #define BUF_SIZE 1024
+#define SENDFILE_CHUNK_SIZE 65536
 
 static int dump_file(const char* filename) {
     int fd = strcmp(filename, "-") ? open(filename, O_RDONLY) : 0;
     if (fd < 0)
         return -1;
+
+    // let the kernel move the data unless it refuses, e.g. for cat f > f
+    for (;;) {
+        ssize_t nsent = sendfile(STDOUT_FILENO, fd, NULL, SENDFILE_CHUNK_SIZE);
+        if (nsent == 0) {
+            if (fd > 0)
+                close(fd);
+            return 0;
+        }
+        if (nsent < 0)
+            break;
+    }
+
     for (;;) {
         static char buf[BUF_SIZE];
         ssize_t nread = read(fd, buf, BUF_SIZE);
@@ -38,51 +38,246 @@
  */
 
 #include <fcntl.h>
+#include <io_uring.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <escp.h>
 
 #define BUF_SIZE 1024
 
-int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        dprintf(STDERR_FILENO, "%susage: %scp %s<%ssource%s> <%sdestination%s>%s\n", F_MAGENTA, F_GREEN, F_BLUE, F_GREEN, F_BLUE, F_GREEN, F_BLUE, RESET);
-        return EXIT_FAILURE;
-    }
+#define SENDFILE_CHUNK_SIZE 65536
 
-    int src_fd = open(argv[1], O_RDONLY);
-    if (src_fd < 0) {
-        perror("open");
-        return EXIT_FAILURE;
-    }
-    int dest_fd = open(argv[2], O_CREAT | O_WRONLY);
-    if (dest_fd < 0) {
-        perror("open");
-        return EXIT_FAILURE;
-    }
+#define COPY_CHUNK_SIZE (1 << 24)
 
+#define RING_ENTRIES 16
+#define RING_BUF_SIZE 4096
+
+static int copy_with_read_write(int src_fd, int dest_fd) {
     for (;;) {
         static char buf[BUF_SIZE];
         ssize_t nread = read(src_fd, buf, BUF_SIZE);
         if (nread < 0) {
             perror("read");
-            close(src_fd);
-            close(dest_fd);
-            return EXIT_FAILURE;
+            return -1;
         }
         if (nread == 0)
             break;
         if (write(dest_fd, buf, nread) < 0) {
             perror("write");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// files in tmpfs share their pages instead of copying them
+static int copy_with_copy_file_range(int src_fd, int dest_fd) {
+    for (;;) {
+        ssize_t ncopied = copy_file_range(src_fd, NULL, dest_fd, NULL,
+                                          COPY_CHUNK_SIZE, 0);
+        if (ncopied < 0) {
+            perror("copy_file_range");
+            return -1;
+        }
+        if (ncopied == 0)
+            return 0;
+    }
+}
+
+static int copy_with_sendfile(int src_fd, int dest_fd) {
+    for (;;) {
+        ssize_t nsent = sendfile(dest_fd, src_fd, NULL, SENDFILE_CHUNK_SIZE);
+        if (nsent < 0) {
+            perror("sendfile");
+            return -1;
+        }
+        if (nsent == 0)
+            return 0;
+    }
+}
+
+struct ring {
+    int fd;
+    struct io_uring_params params;
+    unsigned char* mem;
+    struct io_uring_rings* rings;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+};
+
+static void push_sqe(struct ring* ring, const struct io_uring_sqe* sqe) {
+    unsigned tail = ring->rings->sq_tail;
+    ring->sqes[tail & ring->rings->sq_mask] = *sqe;
+    ring->rings->sq_tail = tail + 1;
+}
+
+// submits the queued entries and collects the results indexed by user_data
+static int submit_and_reap(struct ring* ring, unsigned count,
+                           ssize_t results[]) {
+    if (io_uring_enter(ring->fd, count, count, IORING_ENTER_GETEVENTS) < 0) {
+        perror("io_uring_enter");
+        return -1;
+    }
+    unsigned head = ring->rings->cq_head;
+    while (head != ring->rings->cq_tail) {
+        const struct io_uring_cqe* cqe =
+            ring->cqes + (head & ring->rings->cq_mask);
+        results[cqe->user_data] = cqe->res;
+        ++head;
+    }
+    ring->rings->cq_head = head;
+    return 0;
+}
+
+// copies RING_ENTRIES chunks per round trip: one enter for a batch of
+// preads and one for the matching pwrites.
+static int copy_with_ring(int src_fd, int dest_fd) {
+    struct ring ring;
+    ring.fd = io_uring_setup(RING_ENTRIES, &ring.params);
+    if (ring.fd < 0) {
+        perror("io_uring_setup");
+        return -1;
+    }
+    ring.mem = mmap(NULL, ring.params.ring_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, ring.fd, 0);
+    if (ring.mem == MAP_FAILED) {
+        perror("mmap");
+        close(ring.fd);
+        return -1;
+    }
+    ring.rings = (struct io_uring_rings*)ring.mem;
+    ring.sqes = (struct io_uring_sqe*)(ring.mem + ring.params.sqes_offset);
+    ring.cqes = (struct io_uring_cqe*)(ring.mem + ring.params.cqes_offset);
+
+    static char bufs[RING_ENTRIES][RING_BUF_SIZE];
+    ssize_t results[RING_ENTRIES];
+    int rc = 0;
+    off_t offset = 0;
+    bool eof = false;
+    while (!eof) {
+        for (unsigned i = 0; i < RING_ENTRIES; ++i) {
+            struct io_uring_sqe sqe = {.opcode = IORING_OP_PREAD,
+                                       .fd = src_fd,
+                                       .off = offset + i * RING_BUF_SIZE,
+                                       .addr = bufs[i],
+                                       .len = RING_BUF_SIZE,
+                                       .user_data = i};
+            push_sqe(&ring, &sqe);
+        }
+        if (submit_and_reap(&ring, RING_ENTRIES, results) < 0) {
+            rc = -1;
+            break;
+        }
+
+        unsigned num_writes = 0;
+        for (unsigned i = 0; i < RING_ENTRIES && !eof; ++i) {
+            if (results[i] < 0) {
+                dprintf(STDERR_FILENO, "read: %s\n", strerror(-results[i]));
+                rc = -1;
+                goto done;
+            }
+            if (results[i] < RING_BUF_SIZE)
+                eof = true;
+            if (results[i] == 0)
+                break;
+            struct io_uring_sqe sqe = {.opcode = IORING_OP_PWRITE,
+                                       .fd = dest_fd,
+                                       .off = offset + i * RING_BUF_SIZE,
+                                       .addr = bufs[i],
+                                       .len = results[i],
+                                       .user_data = i};
+            push_sqe(&ring, &sqe);
+            ++num_writes;
+        }
+        if (submit_and_reap(&ring, num_writes, results) < 0) {
+            rc = -1;
+            break;
+        }
+        for (unsigned i = 0; i < num_writes; ++i) {
+            if (results[i] < 0) {
+                dprintf(STDERR_FILENO, "write: %s\n", strerror(-results[i]));
+                rc = -1;
+                goto done;
+            }
+        }
+        offset += RING_ENTRIES * RING_BUF_SIZE;
+    }
+
+done:
+    munmap(ring.mem, ring.params.ring_size);
+    close(ring.fd);
+    return rc;
+}
+
+int main(int argc, char* argv[]) {
+    bool use_ring = argc == 4 && !strcmp(argv[1], "-u");
+    if (argc != 3 && !use_ring) {
+        dprintf(STDERR_FILENO, "%susage: %scp %s[-u] <%ssource%s> <%sdestination%s>%s\n", F_MAGENTA, F_GREEN, F_BLUE, F_GREEN, F_BLUE, F_GREEN, F_BLUE, RESET);
+        return EXIT_FAILURE;
+    }
+    const char* src = argv[argc - 2];
+    const char* dest = argv[argc - 1];
+
+    int src_fd = open(src, O_RDONLY);
+    if (src_fd < 0) {
+        perror("open");
+        return EXIT_FAILURE;
+    }
+    struct stat src_stat;
+    if (fstat(src_fd, &src_stat) < 0) {
+        perror("fstat");
+        close(src_fd);
+        return EXIT_FAILURE;
+    }
+    if (S_ISDIR(src_stat.st_mode)) {
+        dprintf(STDERR_FILENO, "cp: %s: Is a directory\n", src);
+        close(src_fd);
+        return EXIT_FAILURE;
+    }
+
+    // copying into a directory creates the file relative to the
+    // directory's fd instead of building and resolving "dest/name"
+    int dest_dir_fd = AT_FDCWD;
+    const char* dest_name = dest;
+    struct stat dest_stat;
+    if (stat(dest, &dest_stat) == 0 && S_ISDIR(dest_stat.st_mode)) {
+        dest_dir_fd = open(dest, O_RDONLY);
+        if (dest_dir_fd < 0) {
+            perror("open");
             close(src_fd);
-            close(dest_fd);
             return EXIT_FAILURE;
         }
+        const char* slash = strrchr(src, '/');
+        dest_name = slash ? slash + 1 : src;
     }
+    int dest_fd = openat(dest_dir_fd, dest_name, O_CREAT | O_WRONLY,
+                         src_stat.st_mode & 0777);
+    if (dest_dir_fd != AT_FDCWD)
+        close(dest_dir_fd);
+    if (dest_fd < 0) {
+        perror("openat");
+        close(src_fd);
+        return EXIT_FAILURE;
+    }
+
+    int rc;
+    if (use_ring)
+        rc = copy_with_ring(src_fd, dest_fd);
+    else if (copy_file_range(src_fd, NULL, dest_fd, NULL, 0, 0) == 0)
+        rc = copy_with_copy_file_range(src_fd, dest_fd);
+    else if (sendfile(dest_fd, src_fd, NULL, 0) == 0)
+        rc = copy_with_sendfile(src_fd, dest_fd);
+    else
+        rc = copy_with_read_write(src_fd, dest_fd);
 
     close(src_fd);
     close(dest_fd);
 
-    return EXIT_SUCCESS;
+    return rc < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
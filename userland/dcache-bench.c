@@ -0,0 +1,129 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <panic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DIR_PATH "/tmp/dcache-bench"
+#define DEFAULT_NUM_FILES 10000
+
+static unsigned elapsed_ms(const struct timespec* start) {
+    struct timespec now;
+    ASSERT_OK(clock_gettime(CLOCK_MONOTONIC, &now));
+    return (now.tv_sec - start->tv_sec) * 1000 +
+           (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void file_path(char* buf, size_t size, char prefix, unsigned i) {
+    snprintf(buf, size, DIR_PATH "/%c%u", prefix, i);
+}
+
+static void stat_all(const char* label, unsigned num_files, char prefix,
+                     bool should_exist) {
+    struct timespec start;
+    ASSERT_OK(clock_gettime(CLOCK_MONOTONIC, &start));
+    for (unsigned i = 0; i < num_files; ++i) {
+        char path[64];
+        file_path(path, sizeof(path), prefix, i);
+        struct stat st;
+        if (should_exist)
+            ASSERT_OK(stat(path, &st));
+        else
+            ASSERT_ERR(stat(path, &st));
+    }
+    printf("%-16s %6u ms\n", label, elapsed_ms(&start));
+}
+
+static void print_dcache_stats(void) {
+    int fd = open("/proc/dcache", O_RDONLY);
+    if (fd < 0)
+        return;
+    char buf[512];
+    ssize_t nread = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (nread <= 0)
+        return;
+    buf[nread] = 0;
+    printf("%s", buf);
+}
+
+int main(int argc, char* const argv[]) {
+    unsigned num_files = argc > 1 ? (unsigned)atoi(argv[1]) : DEFAULT_NUM_FILES;
+    if (num_files == 0) {
+        dprintf(STDERR_FILENO, "usage: dcache-bench [num-files]\n");
+        return EXIT_FAILURE;
+    }
+
+    ASSERT_OK(mkdir(DIR_PATH, 0));
+
+    struct timespec start;
+    ASSERT_OK(clock_gettime(CLOCK_MONOTONIC, &start));
+    for (unsigned i = 0; i < num_files; ++i) {
+        char path[64];
+        file_path(path, sizeof(path), 'f', i);
+        int fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0);
+        ASSERT_OK(fd);
+        ASSERT_OK(close(fd));
+    }
+    printf("%-16s %6u ms\n", "create", elapsed_ms(&start));
+
+    stat_all("stat", num_files, 'f', true);
+    stat_all("stat again", num_files, 'f', true);
+    stat_all("stat missing", num_files, 'g', false);
+    stat_all("stat missing 2", num_files, 'g', false);
+
+    ASSERT_OK(clock_gettime(CLOCK_MONOTONIC, &start));
+    for (unsigned i = 0; i < num_files; ++i) {
+        char path[64];
+        file_path(path, sizeof(path), 'f', i);
+        ASSERT_OK(unlink(path));
+    }
+    printf("%-16s %6u ms\n", "unlink", elapsed_ms(&start));
+    ASSERT_OK(rmdir(DIR_PATH));
+
+    print_dcache_stats();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// copies count blocks of bs bytes, and reports the throughput, which makes it
+// usable as a benchmark of block devices:
+//   dd if=/dev/hda of=/dev/null bs=1M count=64
+//   dd if=/dev/zero of=/dev/hda bs=1M count=64
+
+static void usage(void) {
+    dprintf(STDERR_FILENO, "usage: dd [if=FILE] [of=FILE] [bs=BYTES] "
+                           "[count=N] [skip=N] [seek=N]\n");
+    exit(EXIT_FAILURE);
+}
+
+// accepts the suffixes k (KiB) and M (MiB)
+static size_t parse_size(const char* s) {
+    size_t value = 0;
+    for (; *s >= '0' && *s <= '9'; ++s)
+        value = value * 10 + (*s - '0');
+    if (!strcmp(s, "k") || !strcmp(s, "K"))
+        return value * 1024;
+    if (!strcmp(s, "M"))
+        return value * 1024 * 1024;
+    if (*s)
+        usage();
+    return value;
+}
+
+static unsigned elapsed_ms(const struct timespec* start) {
+    struct timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) < 0)
+        return 0;
+    return (now.tv_sec - start->tv_sec) * 1000 +
+           (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+int main(int argc, char* argv[]) {
+    const char* in_path = NULL;
+    const char* out_path = NULL;
+    size_t block_size = 512;
+    size_t count = SIZE_MAX;
+    size_t skip = 0;
+    size_t seek = 0;
+    for (int i = 1; i < argc; ++i) {
+        char* value = strchr(argv[i], '=');
+        if (!value)
+            usage();
+        *value++ = 0;
+        if (!strcmp(argv[i], "if"))
+            in_path = value;
+        else if (!strcmp(argv[i], "of"))
+            out_path = value;
+        else if (!strcmp(argv[i], "bs"))
+            block_size = parse_size(value);
+        else if (!strcmp(argv[i], "count"))
+            count = parse_size(value);
+        else if (!strcmp(argv[i], "skip"))
+            skip = parse_size(value);
+        else if (!strcmp(argv[i], "seek"))
+            seek = parse_size(value);
+        else
+            usage();
+    }
+    if (block_size == 0)
+        usage();
+
+    int in_fd = in_path ? open(in_path, O_RDONLY) : STDIN_FILENO;
+    if (in_fd < 0) {
+        perror("open");
+        return EXIT_FAILURE;
+    }
+    int out_fd =
+        out_path ? open(out_path, O_WRONLY | O_CREAT, 0) : STDOUT_FILENO;
+    if (out_fd < 0) {
+        perror("open");
+        return EXIT_FAILURE;
+    }
+    if ((skip && lseek(in_fd, skip * block_size, SEEK_SET) < 0) ||
+        (seek && lseek(out_fd, seek * block_size, SEEK_SET) < 0)) {
+        perror("lseek");
+        return EXIT_FAILURE;
+    }
+
+    char* buf = malloc(block_size);
+    if (!buf) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    struct timespec start;
+    if (clock_gettime(CLOCK_MONOTONIC, &start) < 0) {
+        perror("clock_gettime");
+        return EXIT_FAILURE;
+    }
+
+    size_t full_in = 0, partial_in = 0, full_out = 0, partial_out = 0;
+    size_t total = 0;
+    int status = EXIT_SUCCESS;
+    while (full_in + partial_in < count) {
+        ssize_t nread = read(in_fd, buf, block_size);
+        if (nread < 0) {
+            perror("read");
+            status = EXIT_FAILURE;
+            break;
+        }
+        if (nread == 0)
+            break;
+        if ((size_t)nread == block_size)
+            ++full_in;
+        else
+            ++partial_in;
+
+        ssize_t nwritten = write(out_fd, buf, nread);
+        if (nwritten < 0) {
+            perror("write");
+            status = EXIT_FAILURE;
+            break;
+        }
+        if (nwritten == nread)
+            ++full_out;
+        else
+            ++partial_out;
+        total += nwritten;
+    }
+
+    unsigned ms = elapsed_ms(&start);
+    unsigned kib_per_sec = ms ? total / 1024 * 1000 / ms : 0;
+    dprintf(STDERR_FILENO,
+            "%u+%u records in\n%u+%u records out\n"
+            "%u bytes copied, %u ms, %u KiB/s\n",
+            full_in, partial_in, full_out, partial_out, total, ms,
+            kib_per_sec);
+
+    free(buf);
+    if (in_path)
+        close(in_fd);
+    if (out_path)
+        close(out_fd);
+    return status;
+}
@@ -0,0 +1,142 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <panic.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// lists a large directory with small getdents buffers, and with ls, whose
+// output goes to /dev/null
+
+#define DIR_PATH "/tmp/getdents-bench"
+#define DEFAULT_NUM_FILES 20000
+
+static unsigned elapsed_ms(const struct timespec* start) {
+    struct timespec now;
+    ASSERT_OK(clock_gettime(CLOCK_MONOTONIC, &now));
+    return (now.tv_sec - start->tv_sec) * 1000 +
+           (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static void file_path(char* buf, size_t size, unsigned i) {
+    snprintf(buf, size, DIR_PATH "/file%u", i);
+}
+
+static void list(unsigned num_files, size_t buf_size) {
+    struct timespec start;
+    ASSERT_OK(clock_gettime(CLOCK_MONOTONIC, &start));
+
+    int fd = open(DIR_PATH, O_RDONLY);
+    ASSERT_OK(fd);
+    static unsigned char buf[4096];
+    ASSERT(buf_size <= sizeof(buf));
+    unsigned num_entries = 0;
+    for (;;) {
+        long nread = getdents(fd, buf, buf_size);
+        ASSERT_OK(nread);
+        if (nread == 0)
+            break;
+        for (long pos = 0; pos < nread; ++num_entries)
+            pos += ((struct dirent*)(buf + pos))->d_reclen;
+    }
+    ASSERT_OK(close(fd));
+    ASSERT(num_entries == num_files);
+
+    char label[32];
+    snprintf(label, sizeof(label), "getdents %uB", buf_size);
+    printf("%-16s %6u ms\n", label, elapsed_ms(&start));
+}
+
+static void run_ls(void) {
+    struct timespec start;
+    ASSERT_OK(clock_gettime(CLOCK_MONOTONIC, &start));
+
+    posix_spawn_file_actions_t file_actions;
+    ASSERT(posix_spawn_file_actions_init(&file_actions) == 0);
+    ASSERT(posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO,
+                                            "/dev/null", O_WRONLY, 0) == 0);
+    char* argv[] = {"ls", DIR_PATH, NULL};
+    char* envp[] = {NULL};
+    pid_t pid;
+    ASSERT(posix_spawn(&pid, "/bin/ls", &file_actions, NULL, argv, envp) ==
+           0);
+    int status;
+    ASSERT(waitpid(pid, &status, 0) == pid);
+    ASSERT(status == 0);
+    ASSERT(posix_spawn_file_actions_destroy(&file_actions) == 0);
+
+    printf("%-16s %6u ms\n", "ls", elapsed_ms(&start));
+}
+
+int main(int argc, char* const argv[]) {
+    unsigned num_files = argc > 1 ? (unsigned)atoi(argv[1]) : DEFAULT_NUM_FILES;
+    if (num_files == 0) {
+        dprintf(STDERR_FILENO, "usage: getdents-bench [num-files]\n");
+        return EXIT_FAILURE;
+    }
+
+    ASSERT_OK(mkdir(DIR_PATH, 0));
+    for (unsigned i = 0; i < num_files; ++i) {
+        char path[64];
+        file_path(path, sizeof(path), i);
+        int fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0);
+        ASSERT_OK(fd);
+        ASSERT_OK(close(fd));
+    }
+
+    list(num_files, 64);
+    list(num_files, 1024);
+    list(num_files, 4096);
+    run_ls();
+
+    for (unsigned i = 0; i < num_files; ++i) {
+        char path[64];
+        file_path(path, sizeof(path), i);
+        ASSERT_OK(unlink(path));
+    }
+    ASSERT_OK(rmdir(DIR_PATH));
+    return EXIT_SUCCESS;
+}
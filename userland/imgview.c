@@ -47,6 +47,7 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <escp.h>
 
@@ -84,6 +85,18 @@ static uint32_t swap_bytes(uint32_t x) {
            ((x << 24) & 0xff000000);
 }
 
+struct cursor {
+    const unsigned char* ptr;
+    const unsigned char* end;
+};
+
+// a truncated image reads as zeros instead of faulting past the mapping
+static uint8_t next_byte(struct cursor* cursor) {
+    if (cursor->ptr >= cursor->end)
+        return 0;
+    return *cursor->ptr++;
+}
+
 int main(int argc, char* const argv[]) {
     if (argc != 2) {
         dprintf(STDERR_FILENO, "%susage: %simgview %s<%sfile%s>%s\n", F_MAGENTA, F_GREEN, F_BLUE, F_GREEN, F_BLUE, RESET);
@@ -119,19 +132,33 @@ int main(int argc, char* const argv[]) {
         return EXIT_FAILURE;
     }
 
-    struct qoi_header header;
-    ssize_t nread = read(img_fd, &header, sizeof(struct qoi_header));
-    if (nread < 0) {
-        perror("read");
+    struct stat st;
+    if (fstat(img_fd, &st) < 0) {
+        perror("fstat");
         close(img_fd);
         return EXIT_FAILURE;
     }
-    if ((size_t)nread < sizeof(struct qoi_header) ||
-        strncmp(header.magic, "qoif", 4) != 0) {
+    size_t img_size = st.st_size;
+    if (img_size < sizeof(struct qoi_header)) {
         dprintf(STDERR_FILENO, "Not a QOI file\n");
         close(img_fd);
         return EXIT_FAILURE;
     }
+    unsigned char* img =
+        mmap(NULL, img_size, PROT_READ, MAP_PRIVATE, img_fd, 0);
+    close(img_fd);
+    if (img == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    struct qoi_header header;
+    memcpy(&header, img, sizeof(struct qoi_header));
+    if (strncmp(header.magic, "qoif", 4) != 0) {
+        dprintf(STDERR_FILENO, "Not a QOI file\n");
+        munmap(img, img_size);
+        return EXIT_FAILURE;
+    }
 
     header.width = swap_bytes(header.width);
     header.height = swap_bytes(header.height);
@@ -144,6 +171,8 @@ int main(int argc, char* const argv[]) {
 
     qoi_rgba_t px = {.rgba = {.r = 0, .g = 0, .b = 0, .a = 255}};
 
+    struct cursor cursor = {.ptr = img + sizeof(struct qoi_header),
+                            .end = img + img_size};
     size_t run = 0;
     uintptr_t fb_row_addr = (uintptr_t)fb;
 
@@ -154,15 +183,19 @@ int main(int argc, char* const argv[]) {
             if (run > 0) {
                 --run;
             } else {
-                uint8_t b1;
-                read(img_fd, &b1, 1);
+                uint8_t b1 = next_byte(&cursor);
 
                 switch (b1) {
                 case QOI_OP_RGB:
-                    read(img_fd, &px.rgba, 3);
+                    px.rgba.r = next_byte(&cursor);
+                    px.rgba.g = next_byte(&cursor);
+                    px.rgba.b = next_byte(&cursor);
                     break;
                 case QOI_OP_RGBA:
-                    read(img_fd, &px.rgba, 4);
+                    px.rgba.r = next_byte(&cursor);
+                    px.rgba.g = next_byte(&cursor);
+                    px.rgba.b = next_byte(&cursor);
+                    px.rgba.a = next_byte(&cursor);
                     break;
                 default:
                     switch (b1 & QOI_MASK_2) {
@@ -175,8 +208,7 @@ int main(int argc, char* const argv[]) {
                         px.rgba.b += (b1 & 0x03) - 2;
                         break;
                     case QOI_OP_LUMA: {
-                        uint8_t b2;
-                        read(img_fd, &b2, 1);
+                        uint8_t b2 = next_byte(&cursor);
                         int vg = (b1 & 0x3f) - 32;
                         px.rgba.r += vg - 8 + ((b2 >> 4) & 0x0f);
                         px.rgba.g += vg;
@@ -200,7 +232,7 @@ int main(int argc, char* const argv[]) {
         fb_row_addr += fb_info.pitch;
     }
 
-    close(img_fd);
+    munmap(img, img_size);
 
     (void)getchar();
 
@@ -37,29 +37,29 @@
  *  THE SOFTWARE.
  */
 
+#include <errno.h>
 #include <fcntl.h>
 #include <panic.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 static pid_t spawn(char* filename) {
-    pid_t pid = fork();
-    if (pid < 0)
-        return -1;
-    if (pid == 0) {
-        if (setpgid(0, 0) < 0) {
-            perror("setpgid");
-            abort();
-        }
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
 
-        char* argv[] = {filename, NULL};
-        static char* envp[] = {"PATH=/bin", "HOME=/root", NULL};
-        if (execve(filename, argv, envp) < 0) {
-            perror("execve");
-            abort();
-        }
+    char* argv[] = {filename, NULL};
+    static char* envp[] = {"PATH=/bin", "HOME=/root", NULL};
+    pid_t pid;
+    int rc = posix_spawn(&pid, filename, NULL, &attr, argv, envp);
+    posix_spawnattr_destroy(&attr);
+    if (rc) {
+        errno = rc;
+        return -1;
     }
     return pid;
 }
@@ -0,0 +1,443 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+// the dynamic linker. the kernel maps it next to every program with a
+// PT_INTERP header and starts it instead of the program. it maps the shared
+// libraries the program needs, relocates everything and jumps to the
+// program's entry point. calls through the PLT are bound on first use.
+
+#include <elf.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define LIB_DIR "/lib/"
+#define MAX_OBJECTS 8
+#define PAGE_SIZE 4096
+
+#define ROUND_DOWN(x, align) ((x) & ~((align)-1))
+#define ROUND_UP(x, align) ROUND_DOWN((x) + (align)-1, align)
+
+struct object {
+    char name[64];
+    uintptr_t base; // 0 for the program itself
+    const Elf32_Dyn* dynamic;
+    const char* strtab;
+    const Elf32_Sym* symtab;
+    const Elf32_Word* hash;
+    const Elf32_Rel* rel;
+    size_t rel_size;
+    const Elf32_Rel* jmprel;
+    size_t jmprel_size;
+    uintptr_t* pltgot;
+    bool bind_now;
+};
+
+static struct object objects[MAX_OBJECTS];
+static size_t num_objects;
+
+// entered with the stack the kernel set up for the program, which is
+// handed over to the program untouched
+__attribute__((naked)) void ld_start(void) {
+    __asm__ volatile("pushl %esp\n"
+                     "call ld_main\n"
+                     "addl $4, %esp\n"
+                     "jmp *%eax");
+}
+
+uintptr_t ld_bind(struct object*, size_t reloc_offset);
+
+// PLT0 pushes GOT[1] (the object) and jumps here through GOT[2], on top of
+// the relocation offset pushed by the PLT entry
+__attribute__((naked)) void ld_bind_trampoline(void) {
+    __asm__ volatile("pushl %eax\n"
+                     "pushl %ecx\n"
+                     "pushl %edx\n"
+                     "pushl 16(%esp)\n" // reloc_offset
+                     "pushl 16(%esp)\n" // object
+                     "call ld_bind\n"
+                     "addl $8, %esp\n"
+                     "popl %edx\n"
+                     "popl %ecx\n"
+                     "xchgl %eax, (%esp)\n"
+                     "ret $8");
+}
+
+static _Noreturn void fail(const struct object* obj, const char* message,
+                           const char* detail) {
+    dprintf(STDERR_FILENO, "ld.so: %s: %s%s\n", obj->name, message, detail);
+    exit(127);
+}
+
+static uint32_t elf_hash(const char* name) {
+    uint32_t h = 0;
+    for (const unsigned char* p = (const unsigned char*)name; *p; ++p) {
+        h = (h << 4) + *p;
+        uint32_t g = h & 0xf0000000;
+        if (g)
+            h ^= g >> 24;
+        h &= ~g;
+    }
+    return h;
+}
+
+static const Elf32_Sym* find_symbol(const struct object* obj,
+                                    const char* name, uint32_t hash) {
+    if (!obj->hash)
+        return NULL;
+    Elf32_Word num_buckets = obj->hash[0];
+    const Elf32_Word* buckets = obj->hash + 2;
+    const Elf32_Word* chains = buckets + num_buckets;
+    for (Elf32_Word i = buckets[hash % num_buckets]; i != STN_UNDEF;
+         i = chains[i]) {
+        const Elf32_Sym* sym = obj->symtab + i;
+        if (sym->st_shndx == SHN_UNDEF ||
+            ELF32_ST_BIND(sym->st_info) == STB_LOCAL)
+            continue;
+        if (!strcmp(obj->strtab + sym->st_name, name))
+            return sym;
+    }
+    return NULL;
+}
+
+// symbols are searched in the program first and then in the libraries in
+// load order, so copy relocations in the program take precedence
+static uintptr_t resolve(const struct object* obj, size_t sym_index,
+                         const struct object* skip, const Elf32_Sym** out) {
+    const Elf32_Sym* ref = obj->symtab + sym_index;
+    const char* name = obj->strtab + ref->st_name;
+    uint32_t hash = elf_hash(name);
+    for (size_t i = 0; i < num_objects; ++i) {
+        const struct object* it = objects + i;
+        if (it == skip)
+            continue;
+        const Elf32_Sym* sym = find_symbol(it, name, hash);
+        if (sym) {
+            if (out)
+                *out = sym;
+            return it->base + sym->st_value;
+        }
+    }
+    if (ELF32_ST_BIND(ref->st_info) == STB_WEAK)
+        return 0;
+    fail(obj, "undefined symbol ", name);
+}
+
+static void parse_dynamic(struct object* obj) {
+    size_t pltrel_size = 0;
+    for (const Elf32_Dyn* dyn = obj->dynamic; dyn->d_tag != DT_NULL; ++dyn) {
+        uintptr_t ptr = obj->base + dyn->d_un.d_ptr;
+        switch (dyn->d_tag) {
+        case DT_HASH:
+            obj->hash = (const Elf32_Word*)ptr;
+            break;
+        case DT_STRTAB:
+            obj->strtab = (const char*)ptr;
+            break;
+        case DT_SYMTAB:
+            obj->symtab = (const Elf32_Sym*)ptr;
+            break;
+        case DT_REL:
+            obj->rel = (const Elf32_Rel*)ptr;
+            break;
+        case DT_RELSZ:
+            obj->rel_size = dyn->d_un.d_val;
+            break;
+        case DT_JMPREL:
+            obj->jmprel = (const Elf32_Rel*)ptr;
+            break;
+        case DT_PLTRELSZ:
+            pltrel_size = dyn->d_un.d_val;
+            break;
+        case DT_PLTGOT:
+            obj->pltgot = (uintptr_t*)ptr;
+            break;
+        case DT_PLTREL:
+            if (dyn->d_un.d_val != DT_REL)
+                fail(obj, "unsupported relocation format", "");
+            break;
+        case DT_RELA:
+        case DT_TEXTREL:
+            fail(obj, "text or RELA relocations are not supported", "");
+        case DT_BIND_NOW:
+            obj->bind_now = true;
+            break;
+        }
+    }
+    obj->jmprel_size = pltrel_size;
+}
+
+static void read_at(int fd, const struct object* obj, void* buf,
+                    size_t count, off_t offset) {
+    if (lseek(fd, offset, SEEK_SET) < 0)
+        fail(obj, "seek failed", "");
+    size_t total = 0;
+    while (total < count) {
+        ssize_t nread = read(fd, (char*)buf + total, count - total);
+        if (nread <= 0)
+            fail(obj, "unexpected end of file", "");
+        total += nread;
+    }
+}
+
+// read-only segments are mapped straight from the file, so their pages are
+// shared by every process using the library. writable segments get private
+// pages filled from the file.
+static void map_segment(int fd, const struct object* obj,
+                        const Elf32_Phdr* phdr) {
+    uintptr_t start = ROUND_DOWN(obj->base + phdr->p_vaddr, PAGE_SIZE);
+    uintptr_t end = ROUND_UP(obj->base + phdr->p_vaddr + phdr->p_memsz,
+                             PAGE_SIZE);
+    off_t offset = ROUND_DOWN(phdr->p_offset, PAGE_SIZE);
+
+    if (!(phdr->p_flags & PF_W) && phdr->p_filesz == phdr->p_memsz) {
+        void* addr = mmap((void*)start, end - start, PROT_READ,
+                          MAP_PRIVATE | MAP_FIXED, fd, offset);
+        if (addr != MAP_FAILED)
+            return;
+    }
+
+    void* addr = mmap((void*)start, end - start, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if (addr == MAP_FAILED)
+        fail(obj, "failed to map segment", "");
+    read_at(fd, obj, (void*)(obj->base + phdr->p_vaddr), phdr->p_filesz,
+            phdr->p_offset);
+}
+
+static void load_library(struct object* obj) {
+    char path[sizeof(LIB_DIR) + sizeof(obj->name)];
+    strcpy(path, LIB_DIR);
+    strcat(path, obj->name);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        fail(obj, "cannot open ", path);
+
+    Elf32_Ehdr ehdr;
+    read_at(fd, obj, &ehdr, sizeof(ehdr), 0);
+    if (!IS_ELF(ehdr) || ehdr.e_ident[EI_CLASS] != ELFCLASS32 ||
+        ehdr.e_machine != EM_386 || ehdr.e_type != ET_DYN ||
+        ehdr.e_phentsize != sizeof(Elf32_Phdr) || ehdr.e_phnum == 0)
+        fail(obj, "not a shared object", "");
+
+    Elf32_Phdr phdrs[16];
+    if (ehdr.e_phnum > sizeof(phdrs) / sizeof(Elf32_Phdr))
+        fail(obj, "too many program headers", "");
+    read_at(fd, obj, phdrs, ehdr.e_phnum * sizeof(Elf32_Phdr), ehdr.e_phoff);
+
+    uintptr_t min_vaddr = UINTPTR_MAX;
+    uintptr_t max_vaddr = 0;
+    for (size_t i = 0; i < ehdr.e_phnum; ++i) {
+        const Elf32_Phdr* phdr = phdrs + i;
+        if (phdr->p_type != PT_LOAD)
+            continue;
+        if (phdr->p_vaddr < min_vaddr)
+            min_vaddr = phdr->p_vaddr;
+        if (phdr->p_vaddr + phdr->p_memsz > max_vaddr)
+            max_vaddr = phdr->p_vaddr + phdr->p_memsz;
+    }
+    if (min_vaddr >= max_vaddr)
+        fail(obj, "no loadable segments", "");
+    min_vaddr = ROUND_DOWN(min_vaddr, PAGE_SIZE);
+    max_vaddr = ROUND_UP(max_vaddr, PAGE_SIZE);
+
+    // find a hole large enough for the whole library, then map the segments
+    // into it at their relative positions
+    void* hole = mmap(NULL, max_vaddr - min_vaddr, PROT_READ,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (hole == MAP_FAILED || munmap(hole, max_vaddr - min_vaddr) < 0)
+        fail(obj, "out of address space", "");
+    obj->base = (uintptr_t)hole - min_vaddr;
+
+    for (size_t i = 0; i < ehdr.e_phnum; ++i) {
+        const Elf32_Phdr* phdr = phdrs + i;
+        if (phdr->p_type == PT_LOAD)
+            map_segment(fd, obj, phdr);
+        else if (phdr->p_type == PT_DYNAMIC)
+            obj->dynamic = (const Elf32_Dyn*)(obj->base + phdr->p_vaddr);
+    }
+    close(fd);
+
+    if (!obj->dynamic)
+        fail(obj, "no dynamic section", "");
+    parse_dynamic(obj);
+}
+
+static void add_needed(const struct object* obj) {
+    for (const Elf32_Dyn* dyn = obj->dynamic; dyn->d_tag != DT_NULL; ++dyn) {
+        if (dyn->d_tag != DT_NEEDED)
+            continue;
+        const char* name = obj->strtab + dyn->d_un.d_val;
+        bool loaded = false;
+        for (size_t i = 0; i < num_objects; ++i) {
+            if (!strcmp(objects[i].name, name)) {
+                loaded = true;
+                break;
+            }
+        }
+        if (loaded)
+            continue;
+        if (num_objects >= MAX_OBJECTS)
+            fail(obj, "too many libraries", "");
+        if (strlen(name) >= sizeof(objects[0].name) || strchr(name, '/'))
+            fail(obj, "bad library name ", name);
+        struct object* lib = objects + num_objects++;
+        strcpy(lib->name, name);
+        load_library(lib);
+    }
+}
+
+static void relocate(struct object* obj) {
+    size_t count = obj->rel_size / sizeof(Elf32_Rel);
+    for (size_t i = 0; i < count; ++i) {
+        const Elf32_Rel* rel = obj->rel + i;
+        uintptr_t* where = (uintptr_t*)(obj->base + rel->r_offset);
+        size_t sym_index = ELF32_R_SYM(rel->r_info);
+        switch (ELF32_R_TYPE(rel->r_info)) {
+        case R_386_NONE:
+            break;
+        case R_386_RELATIVE:
+            *where += obj->base;
+            break;
+        case R_386_32:
+            *where += resolve(obj, sym_index, NULL, NULL);
+            break;
+        case R_386_PC32:
+            *where += resolve(obj, sym_index, NULL, NULL) - (uintptr_t)where;
+            break;
+        case R_386_GLOB_DAT:
+        case R_386_JMP_SLOT:
+            *where = resolve(obj, sym_index, NULL, NULL);
+            break;
+        case R_386_COPY: {
+            const Elf32_Sym* sym = NULL;
+            uintptr_t src = resolve(obj, sym_index, obj, &sym);
+            if (sym)
+                memcpy(where, (const void*)src, sym->st_size);
+            break;
+        }
+        default:
+            fail(obj, "unsupported relocation type", "");
+        }
+    }
+
+    count = obj->jmprel_size / sizeof(Elf32_Rel);
+    for (size_t i = 0; i < count; ++i) {
+        const Elf32_Rel* rel = obj->jmprel + i;
+        uintptr_t* where = (uintptr_t*)(obj->base + rel->r_offset);
+        if (ELF32_R_TYPE(rel->r_info) != R_386_JMP_SLOT)
+            fail(obj, "unsupported PLT relocation type", "");
+        if (obj->bind_now)
+            *where = resolve(obj, ELF32_R_SYM(rel->r_info), NULL, NULL);
+        else
+            *where += obj->base; // still points back into the PLT
+    }
+
+    if (obj->pltgot && count > 0 && !obj->bind_now) {
+        obj->pltgot[1] = (uintptr_t)obj;
+        obj->pltgot[2] = (uintptr_t)ld_bind_trampoline;
+    }
+}
+
+uintptr_t ld_bind(struct object* obj, size_t reloc_offset) {
+    const Elf32_Rel* rel =
+        (const Elf32_Rel*)((uintptr_t)obj->jmprel + reloc_offset);
+    uintptr_t addr = resolve(obj, ELF32_R_SYM(rel->r_info), NULL, NULL);
+    *(uintptr_t*)(obj->base + rel->r_offset) = addr;
+    return addr;
+}
+
+uintptr_t ld_main(const uintptr_t* sp) {
+    // sp[0] is the fake return address, followed by argc, argv and envp
+    char* const* argv = (char* const*)sp[2];
+    char* const* envp = (char* const*)sp[3];
+    char* const* it = envp;
+    bool bind_now = false;
+    for (; *it; ++it) {
+        if (!strncmp(*it, "LD_BIND_NOW=", 12) && (*it)[12])
+            bind_now = true;
+    }
+
+    uintptr_t phdr_addr = 0;
+    size_t num_phdrs = 0;
+    uintptr_t entry_point = 0;
+    for (const Elf32_auxv_t* auxv = (const Elf32_auxv_t*)(it + 1);
+         auxv->a_type != AT_NULL; ++auxv) {
+        switch (auxv->a_type) {
+        case AT_PHDR:
+            phdr_addr = auxv->a_val;
+            break;
+        case AT_PHNUM:
+            num_phdrs = auxv->a_val;
+            break;
+        case AT_ENTRY:
+            entry_point = auxv->a_val;
+            break;
+        }
+    }
+
+    struct object* program = objects + num_objects++;
+    strlcpy(program->name, argv[0] ? argv[0] : "", sizeof(program->name));
+    const Elf32_Phdr* phdrs = (const Elf32_Phdr*)phdr_addr;
+    for (size_t i = 0; phdrs && i < num_phdrs; ++i) {
+        if (phdrs[i].p_type == PT_DYNAMIC)
+            program->dynamic = (const Elf32_Dyn*)phdrs[i].p_vaddr;
+    }
+    if (!entry_point || !program->dynamic)
+        fail(program, "not a dynamically linked program", "");
+    parse_dynamic(program);
+
+    // breadth-first, so that the search order follows DT_NEEDED
+    for (size_t i = 0; i < num_objects; ++i)
+        add_needed(objects + i);
+
+    // libraries first, so that their data is in place before the program
+    // copies it with copy relocations
+    for (size_t i = num_objects; i-- > 0;) {
+        objects[i].bind_now |= bind_now;
+        relocate(objects + i);
+    }
+
+    return entry_point;
+}
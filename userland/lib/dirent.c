@@ -98,3 +98,5 @@ struct dirent* readdir(DIR* dirp) {
     dirp->buf_cursor += dent->d_reclen;
     return dent;
 }
+
+int dirfd(DIR* dirp) { return dirp->fd; }
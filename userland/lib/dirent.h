@@ -47,5 +47,6 @@ typedef struct DIR DIR;
 DIR* opendir(const char* name);
 int closedir(DIR* dirp);
 struct dirent* readdir(DIR* dirp);
+int dirfd(DIR* dirp);
 
 long getdents(int fd, void* dirp, size_t count);
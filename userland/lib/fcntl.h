@@ -40,5 +40,10 @@
 #pragma once
 
 #include <kernel/api/fcntl.h>
+#include <kernel/api/sys/types.h>
+#include <stddef.h>
 
 int fcntl(int fd, int cmd, ...);
+int fallocate(int fd, int mode, off_t offset, off_t len);
+ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out,
+               size_t length, unsigned int flags);
@@ -0,0 +1,118 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "sys/select.h"
+#include "errno.h"
+#include "poll.h"
+#include "stdlib.h"
+
+// select is emulated on top of poll so that drivers only have to implement
+// a single readiness callback.
+int select(int nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds,
+           struct timeval* timeout) {
+    if (nfds < 0 || nfds > FD_SETSIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct pollfd* fds = NULL;
+    if (nfds > 0) {
+        fds = malloc(nfds * sizeof(struct pollfd));
+        if (!fds)
+            return -1;
+    }
+
+    nfds_t num_fds = 0;
+    for (int fd = 0; fd < nfds; ++fd) {
+        short events = 0;
+        if (readfds && FD_ISSET(fd, readfds))
+            events |= POLLIN;
+        if (writefds && FD_ISSET(fd, writefds))
+            events |= POLLOUT;
+        if (exceptfds && FD_ISSET(fd, exceptfds))
+            events |= POLLPRI;
+        if (events)
+            fds[num_fds++] = (struct pollfd){.fd = fd, .events = events};
+    }
+
+    int timeout_ms = -1;
+    if (timeout)
+        timeout_ms = timeout->tv_sec * 1000 + timeout->tv_usec / 1000;
+
+    int rc = poll(fds, num_fds, timeout_ms);
+    if (rc < 0) {
+        free(fds);
+        return -1;
+    }
+
+    if (readfds)
+        FD_ZERO(readfds);
+    if (writefds)
+        FD_ZERO(writefds);
+    if (exceptfds)
+        FD_ZERO(exceptfds);
+
+    int num_set = 0;
+    for (nfds_t i = 0; i < num_fds; ++i) {
+        struct pollfd* pfd = fds + i;
+        if (pfd->revents & POLLNVAL) {
+            free(fds);
+            errno = EBADF;
+            return -1;
+        }
+        if (readfds && (pfd->events & POLLIN) &&
+            (pfd->revents & (POLLIN | POLLHUP | POLLERR))) {
+            FD_SET(pfd->fd, readfds);
+            ++num_set;
+        }
+        if (writefds && (pfd->events & POLLOUT) &&
+            (pfd->revents & (POLLOUT | POLLERR))) {
+            FD_SET(pfd->fd, writefds);
+            ++num_set;
+        }
+        if (exceptfds && (pfd->events & POLLPRI) &&
+            (pfd->revents & POLLPRI)) {
+            FD_SET(pfd->fd, exceptfds);
+            ++num_set;
+        }
+    }
+
+    free(fds);
+    return num_set;
+}
@@ -0,0 +1,159 @@
+/*
+ *  .OOOOOO.   OOOO                                .    O8O              
+ *  D8P'  `Y8B  `888                              .O8    `"'              
+ * 888           888 .OO.    .OOOO.    .OOOOO.  .O888OO OOOO  OOOO    OOO 
+ * 888           888P"Y88B  `P  )88B  D88' `88B   888   `888   `88B..8P'  
+ * 888           888   888   .OP"888  888   888   888    888     Y888'    
+ * `88B    OOO   888   888  D8(  888  888   888   888 .  888   .O8"'88B   
+ *  `Y8BOOD8P'  O888O O888O `Y888""8O `Y8BOD8P'   "888" O888O O88'   888O 
+ * 
+ *  Chaotix is a UNIX-like operating system that consists of a kernel written in C and
+ *  i?86 assembly, and userland binaries written in C.
+ *     
+ *  Copyright (c) 2023 Nexuss
+ *  Copyright (c) 2022 mosm
+ *  Copyright (c) 2006-2018 Frans Kaashoek, Robert Morris, Russ Cox, Massachusetts Institute of Technology
+ *
+ *  This file may or may not contain code from https://github.com/mosmeh/yagura, and/or
+ *  https://github.com/mit-pdos/xv6-public. Both projects have the same license as this
+ *  project, and the license can be seen below:
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *  
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *  
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *  THE SOFTWARE.
+ */
+
+#include "spawn.h"
+#include "errno.h"
+#include "panic.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+int posix_spawnp(pid_t* pid, const char* file,
+                 const posix_spawn_file_actions_t* file_actions,
+                 const posix_spawnattr_t* attrp, char* const argv[],
+                 char* const envp[]) {
+    if (strchr(file, '/'))
+        return posix_spawn(pid, file, file_actions, attrp, argv, envp);
+
+    const char* path = getenv("PATH");
+    if (!path)
+        path = "/bin";
+    char* dup_path = strdup(path);
+    if (!dup_path)
+        return ENOMEM;
+
+    static const char* sep = ":";
+    char* saved_ptr;
+    for (const char* part = strtok_r(dup_path, sep, &saved_ptr); part;
+         part = strtok_r(NULL, sep, &saved_ptr)) {
+        static char buf[1024];
+        ASSERT(sprintf(buf, "%s/%s", part, file) > 0);
+        int rc = posix_spawn(pid, buf, file_actions, attrp, argv, envp);
+        if (rc != ENOENT) {
+            free(dup_path);
+            return rc;
+        }
+    }
+
+    free(dup_path);
+    return ENOENT;
+}
+
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t* file_actions) {
+    file_actions->count = 0;
+    return 0;
+}
+
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t* file_actions) {
+    (void)file_actions;
+    return 0;
+}
+
+static struct posix_spawn_file_action*
+append_action(posix_spawn_file_actions_t* file_actions) {
+    if (file_actions->count >= POSIX_SPAWN_MAX_FILE_ACTIONS)
+        return NULL;
+    struct posix_spawn_file_action* action =
+        file_actions->actions + file_actions->count++;
+    *action = (struct posix_spawn_file_action){0};
+    return action;
+}
+
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t* file_actions,
+                                      int fd) {
+    if (fd < 0)
+        return EBADF;
+    struct posix_spawn_file_action* action = append_action(file_actions);
+    if (!action)
+        return ENOMEM;
+    action->type = POSIX_SPAWN_ACTION_CLOSE;
+    action->fd = fd;
+    return 0;
+}
+
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t* file_actions,
+                                     int fd, int new_fd) {
+    if (fd < 0 || new_fd < 0)
+        return EBADF;
+    struct posix_spawn_file_action* action = append_action(file_actions);
+    if (!action)
+        return ENOMEM;
+    action->type = POSIX_SPAWN_ACTION_DUP2;
+    action->fd = fd;
+    action->new_fd = new_fd;
+    return 0;
+}
+
+int posix_spawn_file_actions_addopen(posix_spawn_file_actions_t* file_actions,
+                                     int fd, const char* path, int oflag,
+                                     mode_t mode) {
+    if (fd < 0)
+        return EBADF;
+    struct posix_spawn_file_action* action = append_action(file_actions);
+    if (!action)
+        return ENOMEM;
+    action->type = POSIX_SPAWN_ACTION_OPEN;
+    action->fd = fd;
+    action->path = path;
+    action->oflag = oflag;
+    action->mode = mode;
+    return 0;
+}
+
+int posix_spawnattr_init(posix_spawnattr_t* attr) {
+    *attr = (posix_spawnattr_t){0};
+    return 0;
+}
+
+int posix_spawnattr_destroy(posix_spawnattr_t* attr) {
+    (void)attr;
+    return 0;
+}
+
+int posix_spawnattr_setflags(posix_spawnattr_t* attr, short flags) {
+    if (flags & ~POSIX_SPAWN_SETPGROUP)
+        return EINVAL;
+    attr->flags = flags;
+    return 0;
+}
+
+int posix_spawnattr_setpgroup(posix_spawnattr_t* attr, pid_t pgroup) {
+    attr->pgroup = pgroup;
+    return 0;
+}
@@ -45,3 +45,4 @@
 
 void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset);
 int munmap(void* addr, size_t length);
+int msync(void* addr, size_t length, int flags);
@@ -42,4 +42,7 @@
 #include <kernel/api/sys/stat.h>
 
 int stat(const char* pathname, struct stat* buf);
+int fstat(int fd, struct stat* buf);
+int fstatat(int dirfd, const char* pathname, struct stat* buf, int flags);
 int mkdir(const char* pathname, mode_t mode);
+int mkdirat(int dirfd, const char* pathname, mode_t mode);
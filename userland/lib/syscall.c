@@ -41,8 +41,14 @@
 #include <errno.h>
 #include <extra.h>
 #include <fcntl.h>
+#include <io_uring.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <stdnoreturn.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/mount.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/times.h>
@@ -111,6 +117,20 @@ int connect(int sockfd, const struct sockaddr* addr, socklen_t addrlen) {
     RETURN_WITH_ERRNO(rc, int)
 }
 
+ssize_t copy_file_range(int fd_in, off_t* off_in, int fd_out, off_t* off_out,
+                        size_t length, unsigned int flags) {
+    splice_params params;
+    params.fd_in = fd_in;
+    params.off_in = off_in;
+    params.fd_out = fd_out;
+    params.off_out = off_out;
+    params.length = length;
+    params.flags = flags;
+
+    int rc = syscall(SYS_copy_file_range, (uintptr_t)&params, 0, 0, 0);
+    RETURN_WITH_ERRNO(rc, ssize_t)
+}
+
 int dbgputs(const char* str) {
     int rc = syscall(SYS_dbgputs, (uintptr_t)str, 0, 0, 0);
     RETURN_WITH_ERRNO(rc, int)
@@ -121,6 +141,23 @@ int dup2(int oldfd, int newfd) {
     RETURN_WITH_ERRNO(rc, int)
 }
 
+int epoll_create(int size) {
+    int rc = syscall(SYS_epoll_create, size, 0, 0, 0);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event) {
+    int rc = syscall(SYS_epoll_ctl, epfd, op, fd, (uintptr_t)event);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
+int epoll_wait(int epfd, struct epoll_event* events, int maxevents,
+               int timeout) {
+    int rc =
+        syscall(SYS_epoll_wait, epfd, (uintptr_t)events, maxevents, timeout);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
 int execve(const char* pathname, char* const argv[], char* const envp[]) {
     int rc = syscall(SYS_execve, (uintptr_t)pathname, (uintptr_t)argv,
                      (uintptr_t)envp, 0);
@@ -132,6 +169,11 @@ noreturn void exit(int status) {
     __builtin_unreachable();
 }
 
+int fallocate(int fd, int mode, off_t offset, off_t len) {
+    int rc = syscall(SYS_fallocate, fd, mode, offset, len);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
 int fcntl(int fd, int cmd, ...) {
     va_list args;
     va_start(args, cmd);
@@ -146,6 +188,22 @@ pid_t fork(void) {
     RETURN_WITH_ERRNO(rc, pid_t)
 }
 
+int fstat(int fd, struct stat* buf) {
+    int rc = syscall(SYS_fstat, fd, (uintptr_t)buf, 0, 0);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
+int fstatat(int dirfd, const char* pathname, struct stat* buf, int flags) {
+    int rc = syscall(SYS_fstatat, dirfd, (uintptr_t)pathname, (uintptr_t)buf,
+                     flags);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
+int fsync(int fd) {
+    int rc = syscall(SYS_fsync, fd, 0, 0, 0);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
 int ftruncate(int fd, off_t length) {
     int rc = syscall(SYS_ftruncate, fd, length, 0, 0);
     RETURN_WITH_ERRNO(rc, int)
@@ -175,6 +233,18 @@ pid_t getpid(void) {
     RETURN_WITH_ERRNO(rc, pid_t)
 }
 
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags) {
+    int rc =
+        syscall(SYS_io_uring_enter, fd, to_submit, min_complete, flags);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
+int io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    int rc = syscall(SYS_io_uring_setup, entries, (uintptr_t)params, 0, 0);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
 int ioctl(int fd, int request, void* argp) {
     int rc = syscall(SYS_ioctl, fd, request, (uintptr_t)argp, 0);
     RETURN_WITH_ERRNO(rc, int)
@@ -205,6 +275,11 @@ int mkdir(const char* pathname, mode_t mode) {
     RETURN_WITH_ERRNO(rc, int)
 }
 
+int mkdirat(int dirfd, const char* pathname, mode_t mode) {
+    int rc = syscall(SYS_mkdirat, dirfd, (uintptr_t)pathname, mode, 0);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
 int mknod(const char* pathname, mode_t mode, dev_t dev) {
     int rc = syscall(SYS_mknod, (uintptr_t)pathname, mode, dev, 0);
     RETURN_WITH_ERRNO(rc, int)
@@ -224,6 +299,18 @@ void* mmap(void* addr, size_t length, int prot, int flags, int fd,
     RETURN_WITH_ERRNO(rc, void*)
 }
 
+int mount(const char* source, const char* target, const char* filesystemtype,
+          unsigned long flags) {
+    int rc = syscall(SYS_mount, (uintptr_t)source, (uintptr_t)target,
+                     (uintptr_t)filesystemtype, flags);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
+int msync(void* addr, size_t length, int flags) {
+    int rc = syscall(SYS_msync, (uintptr_t)addr, length, flags, 0);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
 int munmap(void* addr, size_t length) {
     int rc = syscall(SYS_munmap, (uintptr_t)addr, length, 0, 0);
     RETURN_WITH_ERRNO(rc, int)
@@ -241,11 +328,46 @@ int open(const char* pathname, int flags, ...) {
     RETURN_WITH_ERRNO(rc, int)
 }
 
+int openat(int dirfd, const char* pathname, int flags, ...) {
+    unsigned mode = 0;
+    if (flags & O_CREAT) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, unsigned);
+        va_end(args);
+    }
+    int rc = syscall(SYS_openat, dirfd, (uintptr_t)pathname, flags, mode);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
 int pipe(int pipefd[2]) {
     int rc = syscall(SYS_pipe, (uintptr_t)pipefd, 0, 0, 0);
     RETURN_WITH_ERRNO(rc, int)
 }
 
+int poll(struct pollfd* fds, nfds_t nfds, int timeout) {
+    int rc = syscall(SYS_poll, (uintptr_t)fds, nfds, timeout, 0);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
+int posix_spawn(pid_t* pid, const char* path,
+                const posix_spawn_file_actions_t* file_actions,
+                const posix_spawnattr_t* attrp, char* const argv[],
+                char* const envp[]) {
+    posix_spawn_params params;
+    params.path = path;
+    params.file_actions = file_actions;
+    params.attr = attrp;
+    params.argv = argv;
+    params.envp = envp;
+    int rc = syscall(SYS_posix_spawn, (uintptr_t)&params, 0, 0, 0);
+    if (IS_ERR(rc))
+        return -rc; // posix_spawn() reports errors without touching errno
+    if (pid)
+        *pid = rc;
+    return 0;
+}
+
 ssize_t read(int fd, void* buf, size_t count) {
     int rc = syscall(SYS_read, fd, (uintptr_t)buf, count, 0);
     RETURN_WITH_ERRNO(rc, ssize_t)
@@ -261,6 +383,13 @@ int rename(const char* oldpath, const char* newpath) {
     RETURN_WITH_ERRNO(rc, int)
 }
 
+int renameat(int olddirfd, const char* oldpath, int newdirfd,
+             const char* newpath) {
+    int rc = syscall(SYS_renameat, olddirfd, (uintptr_t)oldpath, newdirfd,
+                     (uintptr_t)newpath);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
 int rmdir(const char* pathname) {
     int rc = syscall(SYS_rmdir, (uintptr_t)pathname, 0, 0, 0);
     RETURN_WITH_ERRNO(rc, int)
@@ -271,6 +400,11 @@ int sched_yield(void) {
     RETURN_WITH_ERRNO(rc, int)
 }
 
+ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count) {
+    int rc = syscall(SYS_sendfile, out_fd, in_fd, (uintptr_t)offset, count);
+    RETURN_WITH_ERRNO(rc, ssize_t)
+}
+
 int setpgid(pid_t pid, pid_t pgid) {
     int rc = syscall(SYS_setpgid, pid, pgid, 0, 0);
     RETURN_WITH_ERRNO(rc, int)
@@ -281,11 +415,27 @@ int socket(int domain, int type, int protocol) {
     RETURN_WITH_ERRNO(rc, int)
 }
 
+ssize_t splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out,
+               size_t length, unsigned int flags) {
+    splice_params params;
+    params.fd_in = fd_in;
+    params.off_in = off_in;
+    params.fd_out = fd_out;
+    params.off_out = off_out;
+    params.length = length;
+    params.flags = flags;
+
+    int rc = syscall(SYS_splice, (uintptr_t)&params, 0, 0, 0);
+    RETURN_WITH_ERRNO(rc, ssize_t)
+}
+
 int stat(const char* pathname, struct stat* buf) {
     int rc = syscall(SYS_stat, (uintptr_t)pathname, (uintptr_t)buf, 0, 0);
     RETURN_WITH_ERRNO(rc, int)
 }
 
+void sync(void) { syscall(SYS_sync, 0, 0, 0, 0); }
+
 long sysconf(int name) {
     int rc = syscall(SYS_sysconf, name, 0, 0, 0);
     RETURN_WITH_ERRNO(rc, long)
@@ -296,11 +446,46 @@ clock_t times(struct tms* buf) {
     RETURN_WITH_ERRNO(rc, clock_t)
 }
 
+int umount(const char* target) {
+    int rc = syscall(SYS_umount, (uintptr_t)target, 0, 0, 0);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
 int unlink(const char* pathname) {
     int rc = syscall(SYS_unlink, (uintptr_t)pathname, 0, 0, 0);
     RETURN_WITH_ERRNO(rc, int)
 }
 
+int unlinkat(int dirfd, const char* pathname, int flags) {
+    int rc = syscall(SYS_unlinkat, dirfd, (uintptr_t)pathname, flags, 0);
+    RETURN_WITH_ERRNO(rc, int)
+}
+
+// errno is only reachable through the GOT when libc is built as a shared
+// object, so the assembly below leaves setting it to the compiler
+__attribute__((used)) static void vfork_set_errno(int rc) { errno = rc; }
+
+// the child borrows our stack until it calls execve() or exits, so the
+// return address is kept in ecx (restored for both processes by the kernel)
+// instead of on the stack, where the child would overwrite it.
+__attribute__((naked)) pid_t vfork(void) {
+    __asm__ volatile("popl %%ecx\n"
+                     "movl %0, %%eax\n"
+                     "int $" STRINGIFY(SYSCALL_VECTOR) "\n"
+                     "pushl %%ecx\n"
+                     "cmpl %1, %%eax\n"
+                     "jae 1f\n"
+                     "ret\n"
+                     "1:\n"
+                     "negl %%eax\n"
+                     "pushl %%eax\n"
+                     "call vfork_set_errno\n"
+                     "addl $4, %%esp\n"
+                     "movl $-1, %%eax\n"
+                     "ret" ::"i"(SYS_vfork),
+                     "i"(-EMAXERRNO));
+}
+
 pid_t waitpid(pid_t pid, int* wstatus, int options) {
     int rc = syscall(SYS_waitpid, pid, (uintptr_t)wstatus, options, 0);
     RETURN_WITH_ERRNO(rc, pid_t)
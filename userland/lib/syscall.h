@@ -49,39 +49,62 @@
     F(clock_nanosleep)                                                         \
     F(close)                                                                   \
     F(connect)                                                                 \
+    F(copy_file_range)                                                         \
     F(dbgputs)                                                                 \
     F(dup2)                                                                    \
+    F(epoll_create)                                                            \
+    F(epoll_ctl)                                                               \
+    F(epoll_wait)                                                              \
     F(execve)                                                                  \
     F(exit)                                                                    \
+    F(fallocate)                                                               \
     F(fcntl)                                                                   \
     F(fork)                                                                    \
+    F(fstat)                                                                   \
+    F(fstatat)                                                                 \
+    F(fsync)                                                                   \
     F(ftruncate)                                                               \
     F(getcwd)                                                                  \
     F(getdents)                                                                \
     F(getpgid)                                                                 \
     F(getpid)                                                                  \
+    F(io_uring_enter)                                                          \
+    F(io_uring_setup)                                                          \
     F(ioctl)                                                                   \
     F(kill)                                                                    \
     F(link)                                                                    \
     F(listen)                                                                  \
     F(lseek)                                                                   \
     F(mkdir)                                                                   \
+    F(mkdirat)                                                                 \
     F(mknod)                                                                   \
     F(mmap)                                                                    \
+    F(mount)                                                                   \
+    F(msync)                                                                   \
     F(munmap)                                                                  \
     F(open)                                                                    \
+    F(openat)                                                                  \
     F(pipe)                                                                    \
+    F(poll)                                                                    \
+    F(posix_spawn)                                                             \
     F(read)                                                                    \
     F(reboot)                                                                  \
     F(rename)                                                                  \
+    F(renameat)                                                                \
     F(rmdir)                                                                   \
     F(sched_yield)                                                             \
+    F(sendfile)                                                                \
     F(setpgid)                                                                 \
     F(socket)                                                                  \
+    F(splice)                                                                  \
     F(stat)                                                                    \
+    F(sync)                                                                    \
     F(sysconf)                                                                 \
     F(times)                                                                   \
+    F(umount)                                                                  \
     F(unlink)                                                                  \
+    F(unlinkat)                                                                \
+    F(vfork)                                                                   \
     F(waitpid)                                                                 \
     F(write)
 
@@ -100,3 +123,21 @@ typedef struct mmap_params {
     int fd;
     int offset;
 } mmap_params;
+
+// also used by copy_file_range, which takes the same arguments
+typedef struct splice_params {
+    int fd_in;
+    int* off_in;
+    int fd_out;
+    int* off_out;
+    unsigned int length;
+    unsigned int flags;
+} splice_params;
+
+typedef struct posix_spawn_params {
+    const char* path;
+    const void* file_actions;
+    const void* attr;
+    char* const* argv;
+    char* const* envp;
+} posix_spawn_params;
@@ -50,19 +50,28 @@ int setpgid(pid_t pid, pid_t pgid);
 pid_t getpgid(pid_t pid);
 
 pid_t fork(void);
+pid_t vfork(void);
 int execve(const char* pathname, char* const argv[], char* const envp[]);
 int execvpe(const char* file, char* const argv[], char* const envp[]);
 
 int open(const char* pathname, int flags, ...);
+int openat(int dirfd, const char* pathname, int flags, ...);
 int close(int fd);
 ssize_t read(int fd, void* buf, size_t count);
 ssize_t write(int fd, const void* buf, size_t count);
+ssize_t copy_file_range(int fd_in, off_t* off_in, int fd_out, off_t* off_out,
+                        size_t length, unsigned int flags);
 int ftruncate(int fd, off_t length);
+int fsync(int fd);
+void sync(void);
 off_t lseek(int fd, off_t offset, int whence);
 int mknod(const char* pathname, mode_t mode, dev_t dev);
 int link(const char* oldpath, const char* newpath);
 int unlink(const char* pathname);
+int unlinkat(int dirfd, const char* pathname, int flags);
 int rename(const char* oldpath, const char* newpath);
+int renameat(int olddirfd, const char* oldpath, int newdirfd,
+             const char* newpath);
 int rmdir(const char* pathname);
 
 int dup(int oldfd);
@@ -46,10 +46,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-static int get_format(const struct dirent* dent, const char** out_format,
-                      size_t* out_len) {
+static int get_format(int dir_fd, const struct dirent* dent,
+                      const char** out_format, size_t* out_len) {
     struct stat stat_buf;
-    if (stat(dent->d_name, &stat_buf) < 0)
+    if (fstatat(dir_fd, dent->d_name, &stat_buf, 0) < 0)
         return -1;
     switch (stat_buf.st_mode & S_IFMT) {
     case S_IFDIR:
@@ -107,7 +107,6 @@ int main(int argc, char* argv[]) {
         perror("opendir");
         return EXIT_FAILURE;
     }
-    chdir(path);
 
     size_t width = 0;
     for (;;) {
@@ -122,7 +121,7 @@ int main(int argc, char* argv[]) {
 
         const char* format;
         size_t len;
-        if (get_format(dent, &format, &len) < 0) {
+        if (get_format(dirfd(dirp), dent, &format, &len) < 0) {
             perror("get_format");
             return EXIT_FAILURE;
         }
@@ -37,19 +37,98 @@
  *  THE SOFTWARE.
  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <escp.h>
 
+#define COPY_CHUNK_SIZE (1 << 24)
+
+// files can't be renamed across file systems, so they are copied and the
+// source is removed
+static int move_across_file_systems(const char* src, int dest_dir_fd,
+                                    const char* dest_name) {
+    int src_fd = open(src, O_RDONLY);
+    if (src_fd < 0) {
+        perror("open");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(src_fd, &st) < 0) {
+        perror("fstat");
+        close(src_fd);
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        dprintf(STDERR_FILENO, "mv: %s: Not a regular file\n", src);
+        close(src_fd);
+        return -1;
+    }
+    int dest_fd =
+        openat(dest_dir_fd, dest_name, O_CREAT | O_WRONLY, st.st_mode & 0777);
+    if (dest_fd < 0) {
+        perror("openat");
+        close(src_fd);
+        return -1;
+    }
+
+    int rc = ftruncate(dest_fd, 0);
+    if (rc < 0)
+        perror("ftruncate");
+    while (rc == 0) {
+        ssize_t ncopied = copy_file_range(src_fd, NULL, dest_fd, NULL,
+                                          COPY_CHUNK_SIZE, 0);
+        if (ncopied < 0) {
+            perror("copy_file_range");
+            rc = -1;
+            break;
+        }
+        if (ncopied == 0)
+            break;
+    }
+    close(src_fd);
+    close(dest_fd);
+    if (rc < 0)
+        return -1;
+
+    if (unlink(src) < 0) {
+        perror("unlink");
+        return -1;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     if (argc != 3) {
         dprintf(STDERR_FILENO, "%susage: %smv %s<%ssource%s> <%sdestination%s>%s\n", F_MAGENTA, F_GREEN, F_BLUE, F_GREEN, F_BLUE, F_GREEN, F_BLUE, RESET);
         return EXIT_FAILURE;
     }
-    if (rename(argv[1], argv[2]) < 0) {
-        perror("rename");
-        return EXIT_FAILURE;
+    const char* src = argv[1];
+    const char* dest = argv[2];
+
+    // moving into a directory renames relative to the directory's fd
+    int dest_dir_fd = AT_FDCWD;
+    const char* dest_name = dest;
+    struct stat st;
+    if (stat(dest, &st) == 0 && S_ISDIR(st.st_mode)) {
+        dest_dir_fd = open(dest, O_RDONLY);
+        if (dest_dir_fd < 0) {
+            perror("open");
+            return EXIT_FAILURE;
+        }
+        const char* slash = strrchr(src, '/');
+        dest_name = slash ? slash + 1 : src;
     }
-    return EXIT_SUCCESS;
+    int rc = renameat(AT_FDCWD, src, dest_dir_fd, dest_name);
+    if (rc < 0 && errno == EXDEV)
+        rc = move_across_file_systems(src, dest_dir_fd, dest_name);
+    else if (rc < 0)
+        perror("renameat");
+    if (dest_dir_fd != AT_FDCWD)
+        close(dest_dir_fd);
+    return rc < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
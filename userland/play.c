@@ -46,6 +46,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <escp.h>
@@ -156,29 +157,17 @@ int main(int argc, char* const argv[]) {
         return EXIT_FAILURE;
     }
 
-    unsigned char* bytes = malloc(num_bytes);
-    if (!bytes) {
-        perror("malloc");
-        close(input_fd);
+    unsigned char* bytes =
+        mmap(NULL, num_bytes, PROT_READ, MAP_PRIVATE, input_fd, 0);
+    close(input_fd);
+    if (bytes == MAP_FAILED) {
+        perror("mmap");
         return EXIT_FAILURE;
     }
 
-    size_t total_nread = 0;
-    while (total_nread < num_bytes) {
-        ssize_t nread = read(input_fd, bytes, num_bytes);
-        if (nread < 0) {
-            perror("read");
-            close(input_fd);
-            free(bytes);
-            return EXIT_FAILURE;
-        }
-        total_nread += nread;
-    }
-    close(input_fd);
-
     if (strncmp((char*)bytes, "qoaf", 4) != 0) {
         dprintf(STDERR_FILENO, "Not a QOA file\n");
-        free(bytes);
+        munmap(bytes, num_bytes);
         return EXIT_FAILURE;
     }
 
@@ -189,13 +178,13 @@ int main(int argc, char* const argv[]) {
     uint32_t sample_rate = (first_header >> 32) & 0xffffff;
     if (num_samples == 0 || num_channels == 0 || sample_rate == 0) {
         dprintf(STDERR_FILENO, "Invalid format\n");
-        free(bytes);
+        munmap(bytes, num_bytes);
         return EXIT_FAILURE;
     }
     if (num_channels != NUM_CHANNELS || sample_rate > UINT16_MAX) {
         dprintf(STDERR_FILENO,
                 "Unsupported number of channels or sample rate\n");
-        free(bytes);
+        munmap(bytes, num_bytes);
         return EXIT_FAILURE;
     }
 
@@ -203,7 +192,7 @@ int main(int argc, char* const argv[]) {
     size_t num_sample_bytes = total_samples * sizeof(int16_t);
     int16_t* samples = malloc(num_sample_bytes);
     if (!samples) {
-        free(bytes);
+        munmap(bytes, num_bytes);
         return EXIT_FAILURE;
     }
 
@@ -213,7 +202,7 @@ int main(int argc, char* const argv[]) {
         if (((header >> 56) & 0xff) != num_channels ||
             ((header >> 32) & 0xffffff) != sample_rate) {
             dprintf(STDERR_FILENO, "Invalid format\n");
-            free(bytes);
+            munmap(bytes, num_bytes);
             free(samples);
             return EXIT_FAILURE;
         }
@@ -258,7 +247,7 @@ int main(int argc, char* const argv[]) {
 
         sample_idx += num_samples_in_frame * num_channels;
     }
-    free(bytes);
+    munmap(bytes, num_bytes);
 
     int dsp_fd = open("/dev/dsp", O_WRONLY);
     if (dsp_fd < 0) {
@@ -37,21 +37,84 @@
  *  THE SOFTWARE.
  */
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <escp.h>
 
+// removes the entry `name` in the directory `dir_fd`. Subdirectories are
+// walked through their own fds so that no path is resolved more than once.
+static int remove_at(int dir_fd, const char* name, bool recursive) {
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, 0) < 0) {
+        perror("fstatat");
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        if (unlinkat(dir_fd, name, 0) < 0) {
+            perror("unlinkat");
+            return -1;
+        }
+        return 0;
+    }
+    if (!recursive) {
+        dprintf(STDERR_FILENO, "rm: %s: %s\n", name, strerror(EISDIR));
+        return -1;
+    }
+
+    int fd = openat(dir_fd, name, O_RDONLY);
+    if (fd < 0) {
+        perror("openat");
+        return -1;
+    }
+    for (;;) {
+        // the directory cursor stays valid across unlinks, so every entry
+        // in the buffer can be removed before reading the next batch
+        char buf[1024];
+        long nread = getdents(fd, buf, sizeof(buf));
+        if (nread < 0) {
+            perror("getdents");
+            close(fd);
+            return -1;
+        }
+        if (nread == 0)
+            break;
+        for (long pos = 0; pos < nread;) {
+            struct dirent* dent = (struct dirent*)(buf + pos);
+            pos += dent->d_reclen;
+            if (!strcmp(dent->d_name, ".") || !strcmp(dent->d_name, ".."))
+                continue;
+            if (remove_at(fd, dent->d_name, true) < 0) {
+                close(fd);
+                return -1;
+            }
+        }
+    }
+    close(fd);
+
+    if (unlinkat(dir_fd, name, AT_REMOVEDIR) < 0) {
+        perror("unlinkat");
+        return -1;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        dprintf(STDERR_FILENO, "%susage: %srm %s<%sfile-to-remove%s>%s\n", F_MAGENTA, F_GREEN, F_BLUE, F_GREEN, F_BLUE, RESET);
+    bool recursive = argc >= 2 && !strcmp(argv[1], "-r");
+    int first = recursive ? 2 : 1;
+    if (argc <= first) {
+        dprintf(STDERR_FILENO, "%susage: %srm %s[-r] <%sfile-to-remove%s>%s\n", F_MAGENTA, F_GREEN, F_BLUE, F_GREEN, F_BLUE, RESET);
         return EXIT_FAILURE;
     }
-    for (int i = 1; i < argc; ++i) {
-        if (unlink(argv[i]) < 0) {
-            perror("unlink");
+    for (int i = first; i < argc; ++i) {
+        if (remove_at(AT_FDCWD, argv[i], recursive) < 0)
             return EXIT_FAILURE;
-        }
     }
     return EXIT_SUCCESS;
 }
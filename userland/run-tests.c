@@ -37,16 +37,24 @@
  *  THE SOFTWARE.
  */
 
+#include <dirent.h>
 #include <errno.h>
 #include <extra.h>
 #include <fb.h>
 #include <fcntl.h>
+#include <io_uring.h>
 #include <panic.h>
+#include <poll.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/mount.h>
+#include <sys/select.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
@@ -325,6 +333,49 @@ static void test_framebuffer(void) {
     ASSERT_OK(munmap(fb, size));
 }
 
+static void test_poll(void) {
+    puts("poll");
+
+    int pipefd[2];
+    ASSERT_OK(pipe(pipefd));
+
+    struct pollfd fds[] = {
+        {.fd = pipefd[0], .events = POLLIN},
+        {.fd = pipefd[1], .events = POLLOUT},
+        {.fd = -1, .events = POLLIN},
+    };
+    ASSERT(poll(fds, 1, 0) == 0);
+    ASSERT(fds[0].revents == 0);
+    ASSERT(poll(fds, 1, 20) == 0);
+
+    ASSERT(poll(fds, 3, -1) == 1);
+    ASSERT(fds[0].revents == 0);
+    ASSERT(fds[1].revents == POLLOUT);
+    ASSERT(fds[2].revents == 0);
+
+    ASSERT(write(pipefd[1], "x", 1) == 1);
+    ASSERT(poll(fds, 3, -1) == 2);
+    ASSERT(fds[0].revents == POLLIN);
+
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(pipefd[0], &readfds);
+    struct timeval timeout = {0, 0};
+    ASSERT(select(pipefd[0] + 1, &readfds, NULL, NULL, &timeout) == 1);
+    ASSERT(FD_ISSET(pipefd[0], &readfds));
+
+    char c;
+    ASSERT(read(pipefd[0], &c, 1) == 1);
+    ASSERT_OK(close(pipefd[1]));
+    ASSERT(poll(fds, 1, -1) == 1);
+    ASSERT(fds[0].revents & POLLHUP);
+    ASSERT_OK(close(pipefd[0]));
+
+    struct pollfd bad = {.fd = pipefd[0], .events = POLLIN};
+    ASSERT(poll(&bad, 1, 0) == 1);
+    ASSERT(bad.revents == POLLNVAL);
+}
+
 static void test_malloc(void) {
     puts("malloc");
     free(malloc(0));
@@ -338,12 +389,1171 @@ static void test_malloc(void) {
     }
 }
 
+static void test_epoll(void) {
+    puts("epoll");
+
+    int epfd = epoll_create(1);
+    ASSERT_OK(epfd);
+
+    int pipefd[2];
+    ASSERT_OK(pipe(pipefd));
+
+    struct epoll_event event = {.events = EPOLLIN, .data.fd = pipefd[0]};
+    ASSERT_OK(epoll_ctl(epfd, EPOLL_CTL_ADD, pipefd[0], &event));
+    ASSERT(epoll_ctl(epfd, EPOLL_CTL_ADD, pipefd[0], &event) < 0);
+    ASSERT(errno == EEXIST);
+
+    struct epoll_event events[4];
+    ASSERT(epoll_wait(epfd, events, 4, 0) == 0);
+    ASSERT(epoll_wait(epfd, events, 4, 20) == 0);
+
+    // level-triggered: reported for as long as data is available
+    ASSERT(write(pipefd[1], "xy", 2) == 2);
+    ASSERT(epoll_wait(epfd, events, 4, -1) == 1);
+    ASSERT(events[0].events == EPOLLIN);
+    ASSERT(events[0].data.fd == pipefd[0]);
+    ASSERT(epoll_wait(epfd, events, 4, 0) == 1);
+
+    // edge-triggered: reported once per new write
+    event.events = EPOLLIN | EPOLLET;
+    ASSERT_OK(epoll_ctl(epfd, EPOLL_CTL_MOD, pipefd[0], &event));
+    ASSERT(epoll_wait(epfd, events, 4, 0) == 1);
+    ASSERT(epoll_wait(epfd, events, 4, 0) == 0);
+    ASSERT(write(pipefd[1], "z", 1) == 1);
+    ASSERT(epoll_wait(epfd, events, 4, 0) == 1);
+
+    char buf[3];
+    ASSERT(read(pipefd[0], buf, 3) == 3);
+    ASSERT(epoll_wait(epfd, events, 4, 0) == 0);
+
+    pid_t pid = fork();
+    ASSERT_OK(pid);
+    if (pid == 0) {
+        ASSERT(write(pipefd[1], "w", 1) == 1);
+        exit(0);
+    }
+    ASSERT(epoll_wait(epfd, events, 4, -1) == 1);
+    ASSERT(events[0].events == EPOLLIN);
+    ASSERT_OK(waitpid(pid, NULL, 0));
+
+    ASSERT_OK(close(pipefd[1]));
+    ASSERT(epoll_wait(epfd, events, 4, -1) == 1);
+    ASSERT(events[0].events & EPOLLHUP);
+
+    ASSERT_OK(epoll_ctl(epfd, EPOLL_CTL_DEL, pipefd[0], NULL));
+    ASSERT(epoll_ctl(epfd, EPOLL_CTL_DEL, pipefd[0], NULL) < 0);
+    ASSERT(errno == ENOENT);
+
+    ASSERT_OK(close(pipefd[0]));
+    ASSERT_OK(close(epfd));
+}
+
+static void test_io_uring(void) {
+    puts("io_uring");
+
+    struct io_uring_params params;
+    ASSERT(io_uring_setup(3, &params) < 0);
+    ASSERT(errno == EINVAL);
+    int ring_fd = io_uring_setup(4, &params);
+    ASSERT_OK(ring_fd);
+    ASSERT(params.sq_entries == 4);
+    unsigned char* mem = mmap(NULL, params.ring_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, ring_fd, 0);
+    ASSERT(mem != MAP_FAILED);
+    struct io_uring_rings* rings = (struct io_uring_rings*)mem;
+    struct io_uring_sqe* sqes = (struct io_uring_sqe*)(mem + params.sqes_offset);
+    struct io_uring_cqe* cqes = (struct io_uring_cqe*)(mem + params.cqes_offset);
+
+    unlink("/tmp/test-io-uring");
+    sqes[0] = (struct io_uring_sqe){.opcode = IORING_OP_OPENAT,
+                                    .fd = AT_FDCWD,
+                                    .addr = "/tmp/test-io-uring",
+                                    .open_flags = O_CREAT | O_RDWR,
+                                    .user_data = 100};
+    rings->sq_tail = 1;
+    ASSERT(io_uring_enter(ring_fd, 1, 1, IORING_ENTER_GETEVENTS) == 1);
+    ASSERT(rings->cq_tail == 1);
+    ASSERT(cqes[0].user_data == 100);
+    int fd = cqes[0].res;
+    ASSERT_OK(fd);
+    rings->cq_head = 1;
+
+    char buf[8] = {0};
+    sqes[1] = (struct io_uring_sqe){
+        .opcode = IORING_OP_PWRITE, .fd = fd, .off = 3, .addr = "abc",
+        .len = 3, .user_data = 1};
+    sqes[2] = (struct io_uring_sqe){.opcode = IORING_OP_PREAD,
+                                    .fd = fd,
+                                    .off = 3,
+                                    .addr = buf,
+                                    .len = sizeof(buf),
+                                    .user_data = 2};
+    sqes[3] = (struct io_uring_sqe){
+        .opcode = IORING_OP_FSYNC, .fd = fd, .user_data = 3};
+    sqes[0] = (struct io_uring_sqe){
+        .opcode = IORING_OP_CLOSE, .fd = fd, .user_data = 4};
+    rings->sq_tail = 5;
+    ASSERT(io_uring_enter(ring_fd, 4, 4, IORING_ENTER_GETEVENTS) == 4);
+    ASSERT(rings->cq_tail == 5);
+    for (unsigned i = 1; i < 5; ++i)
+        ASSERT(cqes[i].user_data == i);
+    ASSERT(cqes[1].res == 3);
+    ASSERT(cqes[2].res == 3);
+    ASSERT(!strcmp(buf, "abc"));
+    ASSERT(cqes[3].res == 0);
+    ASSERT(cqes[4].res == 0);
+    rings->cq_head = 5;
+
+    int pipefd[2];
+    ASSERT_OK(pipe(pipefd));
+    sqes[1] = (struct io_uring_sqe){.opcode = IORING_OP_POLL,
+                                    .fd = pipefd[0],
+                                    .poll_events = POLLIN,
+                                    .user_data = 5};
+    rings->sq_tail = 6;
+    ASSERT(io_uring_enter(ring_fd, 1, 0, 0) == 1);
+    ASSERT(rings->cq_tail == 5);
+    ASSERT(write(pipefd[1], "x", 1) == 1);
+    ASSERT(io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) == 0);
+    ASSERT(rings->cq_tail == 6);
+    ASSERT(cqes[5].user_data == 5);
+    ASSERT(cqes[5].res == POLLIN);
+
+    ASSERT_OK(close(pipefd[0]));
+    ASSERT_OK(close(pipefd[1]));
+    ASSERT_OK(munmap(mem, params.ring_size));
+    ASSERT_OK(close(ring_fd));
+
+    // a full ring spans several pages, all of which are shared with the
+    // kernel
+    ring_fd = io_uring_setup(IORING_MAX_ENTRIES, &params);
+    ASSERT_OK(ring_fd);
+    ASSERT(params.ring_size > 4096);
+    mem = mmap(NULL, params.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+               ring_fd, 0);
+    ASSERT(mem != MAP_FAILED);
+    rings = (struct io_uring_rings*)mem;
+    sqes = (struct io_uring_sqe*)(mem + params.sqes_offset);
+    cqes = (struct io_uring_cqe*)(mem + params.cqes_offset);
+    for (unsigned i = 0; i < params.sq_entries; ++i)
+        sqes[i] = (struct io_uring_sqe){.opcode = IORING_OP_NOP,
+                                        .user_data = i + 1};
+    rings->sq_tail = params.sq_entries;
+    ASSERT(io_uring_enter(ring_fd, params.sq_entries, params.sq_entries,
+                          IORING_ENTER_GETEVENTS) ==
+           (int)params.sq_entries);
+    ASSERT(rings->sq_head == params.sq_entries);
+    ASSERT(rings->cq_tail == params.sq_entries);
+    for (unsigned i = 0; i < params.sq_entries; ++i) {
+        ASSERT(cqes[i].user_data == i + 1);
+        ASSERT(cqes[i].res == 0);
+    }
+    rings->cq_head = rings->cq_tail;
+    ASSERT_OK(munmap(mem, params.ring_size));
+    ASSERT_OK(close(ring_fd));
+}
+
+static void test_sendfile(void) {
+    puts("sendfile/splice");
+
+    unlink("/tmp/test-sendfile");
+    int fd = open("/tmp/test-sendfile", O_CREAT | O_RDWR);
+    ASSERT_OK(fd);
+    ASSERT(write(fd, "hello world", 11) == 11);
+    ASSERT(sendfile(fd, fd, NULL, 11) < 0);
+    ASSERT(errno == EINVAL);
+
+    int pipefd[2];
+    ASSERT_OK(pipe(pipefd));
+    off_t offset = 6;
+    ASSERT(sendfile(pipefd[1], fd, &offset, 100) == 5);
+    ASSERT(offset == 11);
+    char buf[16] = {0};
+    ASSERT(read(pipefd[0], buf, sizeof(buf)) == 5);
+    ASSERT(!strcmp(buf, "world"));
+
+    ASSERT(write(pipefd[1], "HELLO", 5) == 5);
+    offset = 0;
+    ASSERT(splice(pipefd[0], NULL, fd, &offset, 100, 0) == 5);
+    ASSERT(offset == 5);
+    ASSERT(splice(pipefd[0], &offset, fd, NULL, 100, 0) < 0);
+    ASSERT(errno == ESPIPE);
+
+    memset(buf, 0, sizeof(buf));
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(read(fd, buf, sizeof(buf)) == 11);
+    ASSERT(!strcmp(buf, "HELLO world"));
+
+    ASSERT_OK(close(pipefd[0]));
+    ASSERT_OK(close(pipefd[1]));
+    ASSERT_OK(close(fd));
+}
+
+static void test_spawn(void) {
+    puts("vfork/posix_spawn");
+
+    static volatile int shared = 0;
+    pid_t pid = vfork();
+    ASSERT_OK(pid);
+    if (pid == 0) {
+        // the parent does not run until we exit
+        shared = 1;
+        exit(42);
+    }
+    ASSERT(shared == 1);
+    int wstatus;
+    ASSERT(waitpid(pid, &wstatus, 0) == pid);
+    ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 42);
+
+    unlink("/tmp/test-spawn");
+    posix_spawn_file_actions_t file_actions;
+    ASSERT_OK(posix_spawn_file_actions_init(&file_actions));
+    ASSERT_OK(posix_spawn_file_actions_addopen(
+        &file_actions, STDOUT_FILENO, "/tmp/test-spawn", O_WRONLY | O_CREAT,
+        0));
+    posix_spawnattr_t attr;
+    ASSERT_OK(posix_spawnattr_init(&attr));
+    ASSERT_OK(posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP));
+    ASSERT_OK(posix_spawnattr_setpgroup(&attr, 0));
+
+    char* argv[] = {"echo", "spawned", NULL};
+    char* envp[] = {NULL};
+    ASSERT(posix_spawn(&pid, "/bin/echo", &file_actions, &attr, argv, envp) ==
+           0);
+    ASSERT(getpgid(pid) == pid);
+    ASSERT(waitpid(pid, &wstatus, 0) == pid);
+    ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+    ASSERT_OK(posix_spawn_file_actions_destroy(&file_actions));
+    ASSERT_OK(posix_spawnattr_destroy(&attr));
+
+    int fd = open("/tmp/test-spawn", O_RDONLY);
+    ASSERT_OK(fd);
+    char buf[16] = {0};
+    ASSERT(read(fd, buf, sizeof(buf)) == 8);
+    ASSERT(!strcmp(buf, "spawned\n"));
+    ASSERT_OK(close(fd));
+
+    ASSERT(posix_spawn(&pid, "/nonexistent", NULL, NULL, argv, envp) ==
+           ENOENT);
+}
+
+static char untouched_bss[65536];
+static int initialized_data = 42;
+
+static void test_demand_paging(void) {
+    puts("demand paging");
+
+    // the kernel fills bss pages that were never touched by userland
+    int pipefd[2];
+    ASSERT_OK(pipe(pipefd));
+    ASSERT(write(pipefd[1], "hello", 5) == 5);
+    char* buf = untouched_bss + sizeof(untouched_bss) / 2;
+    ASSERT(read(pipefd[0], buf, 5) == 5);
+    ASSERT(!memcmp(buf, "hello", 5));
+    ASSERT_OK(close(pipefd[0]));
+    ASSERT_OK(close(pipefd[1]));
+
+    // data pages are copied on write
+    pid_t pid = fork();
+    ASSERT_OK(pid);
+    if (pid == 0) {
+        initialized_data = 0;
+        exit(initialized_data);
+    }
+    int wstatus;
+    ASSERT(waitpid(pid, &wstatus, 0) == pid);
+    ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+    ASSERT(initialized_data == 42);
+
+    // segments without PF_W are mapped read-only
+    static const char rodata[] = "read-only";
+    pid = fork();
+    ASSERT_OK(pid);
+    if (pid == 0) {
+        *(volatile char*)rodata = 0;
+        exit(0);
+    }
+    ASSERT(waitpid(pid, &wstatus, 0) == pid);
+    ASSERT(WIFSIGNALED(wstatus));
+}
+
+static size_t read_proc_field(const char* path, const char* name) {
+    int fd = open(path, O_RDONLY);
+    ASSERT_OK(fd);
+    static char buf[256];
+    memset(buf, 0, sizeof(buf));
+    ASSERT(read(fd, buf, sizeof(buf) - 1) > 0);
+    ASSERT_OK(close(fd));
+
+    char* p = strstr(buf, name);
+    ASSERT(p);
+    p += strlen(name);
+    while (*p == ' ')
+        ++p;
+    return atoi(p);
+}
+
+static void test_procfs(void) {
+    puts("procfs");
+
+    // output is generated as it is read, whatever the size of the reads
+    int fd = open("/proc/cmdline", O_RDONLY);
+    ASSERT_OK(fd);
+    static char whole[1024];
+    ssize_t len = read(fd, whole, sizeof(whole));
+    ASSERT(len > 0);
+    ASSERT(whole[len - 1] == '\n');
+    ASSERT(read(fd, whole + len, 1) == 0);
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    static char bytes[1024];
+    for (ssize_t i = 0; i < len; ++i)
+        ASSERT(read(fd, bytes + i, 1) == 1);
+    ASSERT(read(fd, bytes, 1) == 0);
+    ASSERT(!memcmp(whole, bytes, len));
+    ASSERT(lseek(fd, 1, SEEK_SET) == 1);
+    ASSERT(read(fd, bytes, sizeof(bytes)) == len - 1);
+    ASSERT(!memcmp(bytes, whole + 1, len - 1));
+    ASSERT_OK(close(fd));
+
+    // pid directories stay around until the process is reaped
+    pid_t pid = fork();
+    ASSERT_OK(pid);
+    if (pid == 0)
+        exit(0);
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+    for (int i = 0; i < 2; ++i) {
+        struct stat st;
+        ASSERT_OK(stat(path, &st));
+    }
+    ASSERT(waitpid(pid, NULL, 0) == pid);
+    struct stat st;
+    ASSERT_ERR(stat(path, &st));
+    ASSERT(errno == ENOENT);
+
+    DIR* dirp = opendir("/proc");
+    ASSERT(dirp);
+    bool found = false;
+    struct dirent* dent;
+    while ((dent = readdir(dirp)))
+        found |= atoi(dent->d_name) == getpid();
+    ASSERT_OK(closedir(dirp));
+    ASSERT(found);
+}
+
+static void test_sparse_file(void) {
+    puts("sparse file");
+
+    // a write far past the end only costs the pages that are written
+    size_t mem_free = read_proc_field("/proc/meminfo", "MemFree:");
+    int fd = open("/tmp/test-sparse", O_CREAT | O_EXCL | O_RDWR, 0);
+    ASSERT_OK(fd);
+    off_t far = 64 * 1024 * 1024;
+    ASSERT(lseek(fd, far, SEEK_SET) == far);
+    ASSERT(write(fd, "end", 3) == 3);
+    ASSERT(read_proc_field("/proc/meminfo", "MemFree:") + 1024 > mem_free);
+
+    struct stat st;
+    ASSERT_OK(fstat(fd, &st));
+    ASSERT(st.st_size == far + 3);
+    ASSERT(st.st_blocks == 4096 / 512);
+
+    char buf[16];
+    ASSERT(lseek(fd, 12345, SEEK_SET) == 12345);
+    ASSERT(read(fd, buf, sizeof(buf)) == sizeof(buf));
+    for (size_t i = 0; i < sizeof(buf); ++i)
+        ASSERT(buf[i] == 0);
+
+    // mapping at a page-aligned offset sees the same pages as read/write
+    size_t page_size = 4096;
+    char* p = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                   far);
+    ASSERT(p != MAP_FAILED);
+    ASSERT(!memcmp(p, "end", 3));
+    p[0] = 'E';
+    ASSERT_OK(munmap(p, page_size));
+    ASSERT(lseek(fd, far, SEEK_SET) == far);
+    ASSERT(read(fd, buf, 3) == 3);
+    ASSERT(!memcmp(buf, "End", 3));
+
+    // shrinking and growing again exposes zeros, not the old data
+    ASSERT_OK(ftruncate(fd, far + 1));
+    ASSERT_OK(ftruncate(fd, far + 3));
+    ASSERT(lseek(fd, far, SEEK_SET) == far);
+    ASSERT(read(fd, buf, 3) == 3);
+    ASSERT(buf[0] == 'E' && buf[1] == 0 && buf[2] == 0);
+
+    ASSERT_OK(close(fd));
+    ASSERT_OK(unlink("/tmp/test-sparse"));
+}
+
+static void test_fallocate(void) {
+    puts("fallocate");
+
+    const size_t page_size = 4096;
+    const blkcnt_t blocks_per_page = page_size / 512;
+    int fd = open("/tmp/test-fallocate", O_CREAT | O_EXCL | O_RDWR, 0);
+    ASSERT_OK(fd);
+
+    // preallocation grows the file unless asked not to
+    struct stat st;
+    ASSERT_OK(fallocate(fd, 0, 0, 4 * page_size));
+    ASSERT_OK(fstat(fd, &st));
+    ASSERT(st.st_size == (off_t)(4 * page_size));
+    ASSERT(st.st_blocks == 4 * blocks_per_page);
+    ASSERT_OK(fallocate(fd, FALLOC_FL_KEEP_SIZE, 4 * page_size, page_size));
+    ASSERT_OK(fstat(fd, &st));
+    ASSERT(st.st_size == (off_t)(4 * page_size));
+    ASSERT(st.st_blocks == 5 * blocks_per_page);
+
+    static char data[4 * 4096];
+    memset(data, 'x', sizeof(data));
+    ASSERT(write(fd, data, sizeof(data)) == (ssize_t)sizeof(data));
+
+    // whole pages in a hole are freed, and the rest of it reads as zeros
+    ASSERT_ERR(fallocate(fd, FALLOC_FL_PUNCH_HOLE, 0, page_size));
+    ASSERT(errno == ENOTSUP);
+    ASSERT_OK(fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 100,
+                        2 * page_size));
+    ASSERT_OK(fstat(fd, &st));
+    ASSERT(st.st_size == (off_t)(4 * page_size));
+    ASSERT(st.st_blocks == 4 * blocks_per_page);
+    static char check[4 * 4096];
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(read(fd, check, sizeof(check)) == (ssize_t)sizeof(check));
+    for (size_t i = 0; i < sizeof(check); ++i)
+        ASSERT(check[i] == (i < 100 || i >= 100 + 2 * page_size ? 'x' : 0));
+
+    // truncation gives back the pages past the new end
+    ASSERT_OK(ftruncate(fd, page_size + 1));
+    ASSERT_OK(fstat(fd, &st));
+    ASSERT(st.st_blocks == blocks_per_page);
+    ASSERT_OK(ftruncate(fd, 0));
+    ASSERT_OK(fstat(fd, &st));
+    ASSERT(st.st_blocks == 0);
+
+    ASSERT_ERR(fallocate(fd, 0, 0, 0));
+    ASSERT(errno == EINVAL);
+    ASSERT_OK(close(fd));
+    fd = open("/tmp/test-fallocate", O_RDONLY);
+    ASSERT_OK(fd);
+    ASSERT_ERR(fallocate(fd, 0, 0, page_size));
+    ASSERT(errno == EBADF);
+    ASSERT_OK(close(fd));
+    ASSERT_OK(unlink("/tmp/test-fallocate"));
+}
+
+static void test_page_cache(void) {
+    puts("page cache");
+
+    int fd = open("/tmp/test-page-cache", O_CREAT | O_EXCL | O_RDWR, 0);
+    ASSERT_OK(fd);
+    ASSERT(write(fd, "before", 6) == 6);
+
+    // read-only private mappings are backed by the cached pages themselves,
+    // so they observe later writes through the file descriptor
+    size_t page_size = 4096;
+    char* p = mmap(NULL, page_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ASSERT(p != MAP_FAILED);
+    ASSERT(!memcmp(p, "before", 6));
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(write(fd, "after!", 6) == 6);
+    ASSERT(!memcmp(p, "after!", 6));
+    ASSERT_OK(munmap(p, page_size));
+
+    ASSERT_OK(close(fd));
+    ASSERT_OK(unlink("/tmp/test-page-cache"));
+}
+
+static void test_mmap_private(void) {
+    puts("mmap(MAP_PRIVATE)");
+
+    size_t page_size = 4096;
+    int fd = open("/tmp/test-mmap-private", O_CREAT | O_EXCL | O_RDWR, 0);
+    ASSERT_OK(fd);
+    static char buf[3 * 4096];
+    for (size_t i = 0; i < sizeof(buf); ++i)
+        buf[i] = 'a' + i / page_size;
+    ASSERT(write(fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+
+    // the mapping starts at the second page and extends past the end of
+    // the file, which reads as zeros
+    char* p = mmap(NULL, 3 * page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                   fd, page_size);
+    ASSERT(p != MAP_FAILED);
+    ASSERT(p[0] == 'b' && p[page_size] == 'c');
+    ASSERT(p[2 * page_size] == 0 && p[3 * page_size - 1] == 0);
+
+    // writes stay in the mapping
+    p[0] = 'x';
+    ASSERT(p[0] == 'x');
+    char ch;
+    ASSERT(lseek(fd, page_size, SEEK_SET) == (off_t)page_size);
+    ASSERT(read(fd, &ch, 1) == 1);
+    ASSERT(ch == 'b');
+
+    pid_t pid = fork();
+    ASSERT_OK(pid);
+    if (pid == 0) {
+        ASSERT(p[0] == 'x');
+        p[0] = 'y';
+        exit(0);
+    }
+    ASSERT_OK(waitpid(pid, NULL, 0));
+    ASSERT(p[0] == 'x');
+
+    // unmapping the middle page keeps the pages around it
+    ASSERT_OK(munmap(p + page_size, page_size));
+    ASSERT(p[0] == 'x' && p[2 * page_size] == 0);
+    ASSERT_OK(munmap(p, page_size));
+    ASSERT_OK(munmap(p + 2 * page_size, page_size));
+
+    char* shared =
+        mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ASSERT(shared != MAP_FAILED);
+    shared[0] = 'z';
+    ASSERT_OK(msync(shared, page_size, MS_SYNC));
+    ASSERT_ERR(msync(shared, page_size, MS_SYNC | MS_ASYNC));
+    ASSERT(errno == EINVAL);
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(read(fd, &ch, 1) == 1);
+    ASSERT(ch == 'z');
+    ASSERT_OK(munmap(shared, page_size));
+
+    // like the text of a running executable, a read-only private mapping
+    // keeps the page it got while the file is rewritten
+    p = mmap(NULL, page_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ASSERT(p != MAP_FAILED);
+    ASSERT(p[0] == 'z');
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(write(fd, "w", 1) == 1);
+    ASSERT(p[0] == 'z');
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(read(fd, &ch, 1) == 1);
+    ASSERT(ch == 'w');
+    ASSERT_OK(munmap(p, page_size));
+
+    ASSERT_OK(close(fd));
+    ASSERT_OK(unlink("/tmp/test-mmap-private"));
+
+    // pages of streams can't be read on a page fault
+    int pipefd[2];
+    ASSERT_OK(pipe(pipefd));
+    ASSERT(mmap(NULL, page_size, PROT_READ, MAP_PRIVATE, pipefd[0], 0) ==
+           MAP_FAILED);
+    ASSERT(errno == ENODEV);
+    ASSERT_OK(close(pipefd[0]));
+    ASSERT_OK(close(pipefd[1]));
+}
+
+static void test_copy_file_range(void) {
+    puts("copy_file_range");
+
+    size_t page_size = 4096;
+    static char data[2 * 4096 + 100];
+    for (size_t i = 0; i < sizeof(data); ++i)
+        data[i] = i * 7;
+    int src_fd = open("/tmp/test-cfr-src", O_CREAT | O_EXCL | O_RDWR, 0);
+    ASSERT_OK(src_fd);
+    ASSERT(write(src_fd, data, sizeof(data)) == (ssize_t)sizeof(data));
+    ASSERT(lseek(src_fd, 0, SEEK_SET) == 0);
+    int dest_fd = open("/tmp/test-cfr-dest", O_CREAT | O_EXCL | O_RDWR, 0);
+    ASSERT_OK(dest_fd);
+
+    ASSERT(copy_file_range(src_fd, NULL, dest_fd, NULL, 1 << 20, 0) ==
+           (ssize_t)sizeof(data));
+    ASSERT(copy_file_range(src_fd, NULL, dest_fd, NULL, 1 << 20, 0) == 0);
+    struct stat st;
+    ASSERT_OK(fstat(dest_fd, &st));
+    ASSERT(st.st_size == (off_t)sizeof(data));
+    static char buf[sizeof(data)];
+    ASSERT(lseek(dest_fd, 0, SEEK_SET) == 0);
+    ASSERT(read(dest_fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+    ASSERT(!memcmp(buf, data, sizeof(data)));
+
+    // the files share their pages until either is written to
+    ASSERT(lseek(dest_fd, 0, SEEK_SET) == 0);
+    ASSERT(write(dest_fd, "dest", 4) == 4);
+    ASSERT(lseek(src_fd, page_size, SEEK_SET) == (off_t)page_size);
+    ASSERT(write(src_fd, "src", 3) == 3);
+    ASSERT(lseek(src_fd, 0, SEEK_SET) == 0);
+    ASSERT(read(src_fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+    ASSERT(!memcmp(buf, data, 4));
+    ASSERT(!memcmp(buf + page_size, "src", 3));
+    ASSERT(lseek(dest_fd, 0, SEEK_SET) == 0);
+    ASSERT(read(dest_fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+    ASSERT(!memcmp(buf, "dest", 4));
+    ASSERT(!memcmp(buf + page_size, data + page_size, page_size));
+
+    // pages mapped into a process are copied instead, so that writes
+    // through the mapping don't show up in the copy
+    char* p = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, src_fd,
+                   0);
+    ASSERT(p != MAP_FAILED);
+    off_t in_offset = 0;
+    off_t out_offset = 0;
+    ASSERT(copy_file_range(src_fd, &in_offset, dest_fd, &out_offset,
+                           page_size, 0) == (ssize_t)page_size);
+    ASSERT(in_offset == (off_t)page_size && out_offset == (off_t)page_size);
+    p[0] = 'x';
+    ASSERT(lseek(dest_fd, 0, SEEK_SET) == 0);
+    ASSERT(read(dest_fd, buf, 1) == 1);
+    ASSERT(buf[0] == data[0]);
+    ASSERT_OK(munmap(p, page_size));
+
+    // unaligned offsets are copied byte by byte
+    in_offset = 10;
+    out_offset = 5;
+    ASSERT(copy_file_range(src_fd, &in_offset, dest_fd, &out_offset, 100,
+                           0) == 100);
+    ASSERT(lseek(dest_fd, 5, SEEK_SET) == 5);
+    ASSERT(read(dest_fd, buf, 100) == 100);
+    ASSERT(!memcmp(buf, data + 10, 100));
+
+    in_offset = 0;
+    out_offset = 100;
+    ASSERT_ERR(copy_file_range(src_fd, &in_offset, src_fd, &out_offset, 200,
+                               0));
+    ASSERT(errno == EINVAL);
+    ASSERT_ERR(copy_file_range(src_fd, NULL, dest_fd, NULL, 1, 1));
+    ASSERT(errno == EINVAL);
+
+    ASSERT_OK(close(src_fd));
+    ASSERT_OK(close(dest_fd));
+    ASSERT_OK(unlink("/tmp/test-cfr-src"));
+    ASSERT_OK(unlink("/tmp/test-cfr-dest"));
+}
+
+static void test_initrd_file(void) {
+    puts("initrd file");
+
+    // libc.so spans several pages, so its pages come straight from the
+    // initrd module until the file is written to
+    size_t page_size = 4096;
+    int fd = open("/lib/libc.so", O_RDWR);
+    ASSERT_OK(fd);
+    static char before[4096];
+    ASSERT(read(fd, before, page_size) == (ssize_t)page_size);
+    ASSERT(!memcmp(before, "\x7f" "ELF", 4));
+
+    char* p = mmap(NULL, page_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ASSERT(p != MAP_FAILED);
+    ASSERT(!memcmp(p, before, page_size));
+    ASSERT_OK(munmap(p, page_size));
+
+    // writing gives the file its own copy of the page, which shared
+    // mappings made before the write see as well
+    p = mmap(NULL, page_size, PROT_READ, MAP_SHARED, fd, 0);
+    ASSERT(p != MAP_FAILED);
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(write(fd, "\x7f" "FLE", 4) == 4);
+    ASSERT(!memcmp(p, "\x7f" "FLE", 4));
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(write(fd, before, page_size) == (ssize_t)page_size);
+    ASSERT(!memcmp(p, before, page_size));
+    ASSERT_OK(munmap(p, page_size));
+
+    static char after[4096];
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(read(fd, after, page_size) == (ssize_t)page_size);
+    ASSERT(!memcmp(before, after, page_size));
+
+    ASSERT_OK(close(fd));
+}
+
+static void test_block_device_file(const char* path) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        ASSERT(errno == ENOENT);
+        return;
+    }
+    struct stat st;
+    ASSERT_OK(fstat(fd, &st));
+    ASSERT(S_ISBLK(st.st_mode));
+    ASSERT(st.st_size >= 65536);
+
+    // the transfer is split into a bio per page, which the elevator merges
+    // back into requests spanning many pages
+    static unsigned char buf[65536];
+    static unsigned char check[65536];
+    for (size_t i = 0; i < sizeof(buf); ++i)
+        buf[i] = i * 7 + 3;
+    ASSERT(write(fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf));
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(read(fd, check, sizeof(check)) == (ssize_t)sizeof(check));
+    ASSERT(!memcmp(buf, check, sizeof(buf)));
+
+    // writes to parts of sectors keep the rest of the sectors
+    ASSERT(lseek(fd, 1000, SEEK_SET) == 1000);
+    ASSERT(write(fd, "hello", 5) == 5);
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(read(fd, check, 2048) == 2048);
+    ASSERT(!memcmp(check, buf, 1000));
+    ASSERT(!memcmp(check + 1000, "hello", 5));
+    ASSERT(!memcmp(check + 1005, buf + 1005, 2048 - 1005));
+
+    ASSERT(lseek(fd, 0, SEEK_END) == st.st_size);
+    ASSERT(read(fd, check, 1) == 0);
+    ASSERT_ERR(write(fd, "x", 1));
+    ASSERT(errno == ENOSPC);
+
+    // the blocks are in the buffer cache now, and fsync writes them back
+    size_t hits = read_proc_field("/proc/bcache", "Hits:");
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(read(fd, check, sizeof(check)) == (ssize_t)sizeof(check));
+    ASSERT(read_proc_field("/proc/bcache", "Hits:") >= hits + 16);
+    ASSERT_OK(fsync(fd));
+    ASSERT(read_proc_field("/proc/bcache", "Dirty:") == 0);
+
+    ASSERT_OK(close(fd));
+}
+
+static void test_block_device(void) {
+    puts("block device");
+
+    // scripts/run_tests.sh attaches scratch disks as the primary IDE master
+    // and as a virtio disk
+    test_block_device_file("/dev/hda");
+    test_block_device_file("/dev/vda");
+}
+
+static void test_ext2(void) {
+    puts("ext2");
+
+    // scripts/mkramdisk.sh builds the image, which is missing when the host
+    // has no mke2fs. it stays mounted if the tests run again.
+    if (mount("/dev/ram0", "/mnt", "ext2", 0) < 0) {
+        if (errno == ENOENT)
+            return;
+        ASSERT(errno == EBUSY);
+    }
+
+    char buf[64];
+    int fd = open("/mnt/hello.txt", O_RDONLY);
+    ASSERT_OK(fd);
+    ASSERT(read(fd, buf, sizeof(buf)) == 16);
+    ASSERT(!memcmp(buf, "hello from ext2\n", 16));
+
+    // copies across file systems go through the kernel
+    int copy_fd = open("/tmp/test-ext2-copy", O_CREAT | O_EXCL | O_RDWR, 0);
+    ASSERT_OK(copy_fd);
+    off_t offset = 0;
+    ASSERT(copy_file_range(fd, &offset, copy_fd, NULL, sizeof(buf), 0) == 16);
+    ASSERT(offset == 16);
+    ASSERT(lseek(copy_fd, 0, SEEK_SET) == 0);
+    ASSERT(read(copy_fd, buf, sizeof(buf)) == 16);
+    ASSERT(!memcmp(buf, "hello from ext2\n", 16));
+    ASSERT_OK(close(copy_fd));
+    ASSERT_OK(unlink("/tmp/test-ext2-copy"));
+    ASSERT_OK(close(fd));
+
+    // /mnt/big has a hashed index
+    fd = open("/mnt/big/file123", O_RDONLY);
+    ASSERT_OK(fd);
+    ASSERT(read(fd, buf, sizeof(buf)) == 4);
+    ASSERT(!memcmp(buf, "123\n", 4));
+    ASSERT_OK(close(fd));
+    ASSERT_ERR(open("/mnt/big/file501", O_RDONLY));
+    ASSERT(errno == ENOENT);
+
+    DIR* dirp = opendir("/mnt/big");
+    ASSERT(dirp);
+    size_t num_files = 0;
+    struct dirent* dent;
+    while ((dent = readdir(dirp))) {
+        if (!strncmp(dent->d_name, "file", 4)) {
+            ASSERT(dent->d_type == DT_REG);
+            ++num_files;
+        }
+    }
+    ASSERT_OK(closedir(dirp));
+    ASSERT(num_files == 500);
+
+    // spans indirect blocks with 1KiB blocks
+    static int data[50000];
+    for (size_t i = 0; i < 50000; ++i)
+        data[i] = i * 31;
+    fd = open("/mnt/test-ext2", O_RDWR | O_CREAT | O_EXCL, 0644);
+    ASSERT_OK(fd);
+    ASSERT(write(fd, data, sizeof(data)) == (ssize_t)sizeof(data));
+    ASSERT_OK(close(fd));
+
+    ASSERT_OK(rename("/mnt/test-ext2", "/mnt/big/test-ext2"));
+    ASSERT_ERR(open("/mnt/test-ext2", O_RDONLY));
+    ASSERT(errno == ENOENT);
+    fd = open("/mnt/big/test-ext2", O_RDWR);
+    ASSERT_OK(fd);
+    static int check[50000];
+    ASSERT(read(fd, check, sizeof(check)) == (ssize_t)sizeof(check));
+    ASSERT(!memcmp(data, check, sizeof(data)));
+
+    int* p = mmap(NULL, sizeof(data), PROT_READ, MAP_PRIVATE, fd, 0);
+    ASSERT(p != MAP_FAILED);
+    ASSERT(!memcmp(p, data, sizeof(data)));
+    ASSERT_OK(munmap(p, sizeof(data)));
+    ASSERT(mmap(NULL, sizeof(data), PROT_READ, MAP_SHARED, fd, 0) ==
+           MAP_FAILED);
+    ASSERT(errno == ENODEV);
+
+    // the tail of the last block is zeroed when the file grows again
+    ASSERT_OK(ftruncate(fd, 1000));
+    ASSERT_OK(ftruncate(fd, 8192));
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    ASSERT(read(fd, check, 8192) == 8192);
+    ASSERT(!memcmp(data, check, 1000));
+    for (size_t i = 1000 / sizeof(int); i < 8192 / sizeof(int); ++i)
+        ASSERT(check[i] == 0);
+    ASSERT_OK(close(fd));
+
+    ASSERT_OK(mkdir("/mnt/big/dir", 0755));
+    ASSERT_ERR(rmdir("/mnt/big"));
+    ASSERT(errno == ENOTEMPTY);
+    ASSERT_OK(rmdir("/mnt/big/dir"));
+    ASSERT_OK(unlink("/mnt/big/test-ext2"));
+    ASSERT_ERR(open("/mnt/big/test-ext2", O_RDONLY));
+    ASSERT(errno == ENOENT);
+
+    // the file system is torn down once nothing uses it, after which the
+    // device can be mounted again
+    ASSERT_OK(umount("/mnt"));
+    ASSERT_ERR(open("/mnt/hello.txt", O_RDONLY));
+    ASSERT(errno == ENOENT);
+    ASSERT_OK(mount("/dev/ram0", "/mnt", "ext2", 0));
+    fd = open("/mnt/hello.txt", O_RDONLY);
+    ASSERT_OK(fd);
+    ASSERT_OK(close(fd));
+}
+
+static void test_mount(void) {
+    puts("mount");
+
+    ASSERT_OK(mkdir("/tmp/test-mount", 0));
+    ASSERT_OK(mkdir("/tmp/test-mount/a", 0));
+    ASSERT_OK(mkdir("/tmp/test-mount/b", 0));
+    int fd = open("/tmp/test-mount/a/hidden", O_CREAT | O_EXCL | O_WRONLY, 0);
+    ASSERT_OK(fd);
+    ASSERT_OK(close(fd));
+
+    // a mount hides what is in the directory
+    struct stat st;
+    ASSERT_OK(mount("tmpfs", "/tmp/test-mount/a", "tmpfs", 0));
+    ASSERT_ERR(stat("/tmp/test-mount/a/hidden", &st));
+    ASSERT(errno == ENOENT);
+    ASSERT_ERR(mount("tmpfs", "/tmp/test-mount/a", "tmpfs", 0));
+    ASSERT(errno == EBUSY);
+    ASSERT_ERR(mount("tmpfs", "/tmp/test-mount/b/../a/hidden", "tmpfs", 0));
+    ASSERT(errno == ENOENT);
+    fd = open("/tmp/test-mount/a/file", O_CREAT | O_EXCL | O_WRONLY, 0);
+    ASSERT_OK(fd);
+    ASSERT_OK(close(fd));
+
+    // a bind mount makes the same directory visible at another path
+    ASSERT_OK(mount("/tmp/test-mount/a", "/tmp/test-mount/b", NULL, MS_BIND));
+    ASSERT_OK(stat("/tmp/test-mount/b/file", &st));
+    ASSERT_OK(unlink("/tmp/test-mount/b/file"));
+    ASSERT_ERR(stat("/tmp/test-mount/a/file", &st));
+    ASSERT(errno == ENOENT);
+
+    // file systems with something mounted inside them stay mounted
+    ASSERT_OK(mkdir("/tmp/test-mount/a/sub", 0));
+    ASSERT_OK(mount("tmpfs", "/tmp/test-mount/b/sub", "tmpfs", 0));
+    ASSERT_ERR(umount("/tmp/test-mount/a"));
+    ASSERT(errno == EBUSY);
+    ASSERT_OK(umount("/tmp/test-mount/a/sub"));
+
+    ASSERT_OK(umount("/tmp/test-mount/b"));
+    ASSERT_ERR(stat("/tmp/test-mount/b/sub", &st));
+    ASSERT(errno == ENOENT);
+    ASSERT_ERR(umount("/tmp/test-mount/b"));
+    ASSERT(errno == EINVAL);
+    ASSERT_OK(umount("/tmp/test-mount/a"));
+    ASSERT_OK(stat("/tmp/test-mount/a/hidden", &st));
+    ASSERT_ERR(umount("/"));
+    ASSERT(errno == EBUSY);
+
+    ASSERT_ERR(mount("tmpfs", "/tmp/test-mount/a/hidden", "tmpfs", 0));
+    ASSERT(errno == ENOTDIR);
+    ASSERT_ERR(mount("/tmp/test-mount/a/hidden", "/tmp/test-mount/b", NULL,
+                     MS_BIND));
+    ASSERT(errno == ENOTDIR);
+
+    ASSERT_OK(unlink("/tmp/test-mount/a/hidden"));
+    ASSERT_OK(rmdir("/tmp/test-mount/a"));
+    ASSERT_OK(rmdir("/tmp/test-mount/b"));
+    ASSERT_OK(rmdir("/tmp/test-mount"));
+}
+
+static void test_exec_cache(void) {
+    puts("exec cache");
+
+    size_t hits = read_proc_field("/proc/execcache", "Hits:");
+    for (int i = 0; i < 2; ++i) {
+        char* argv[] = {"echo", NULL};
+        char* envp[] = {NULL};
+        pid_t pid;
+        ASSERT(posix_spawn(&pid, "/bin/echo", NULL, NULL, argv, envp) == 0);
+        ASSERT(waitpid(pid, NULL, 0) == pid);
+    }
+    ASSERT(read_proc_field("/proc/execcache", "Hits:") > hits);
+    ASSERT(read_proc_field("/proc/execcache", "Images:") > 0);
+    ASSERT(read_proc_field("/proc/execcache", "SharedPages:") > 0);
+}
+
+static void test_dcache(void) {
+    puts("dentry cache");
+
+    struct stat st;
+    ASSERT_ERR(stat("/tmp/test-dcache", &st));
+    size_t negative_hits =
+        read_proc_field("/proc/dcache", "NegativeHits:");
+    ASSERT_ERR(stat("/tmp/test-dcache", &st));
+    ASSERT(errno == ENOENT);
+    ASSERT(read_proc_field("/proc/dcache", "NegativeHits:") > negative_hits);
+
+    // creating the file replaces the negative entry
+    int fd = open("/tmp/test-dcache", O_CREAT | O_EXCL, 0);
+    ASSERT_OK(fd);
+    ASSERT_OK(close(fd));
+    ASSERT_OK(stat("/tmp/test-dcache", &st));
+    ASSERT_OK(link("/tmp/test-dcache", "/tmp/test-dcache-link"));
+    ASSERT_OK(stat("/tmp/test-dcache-link", &st));
+    ASSERT(st.st_nlink == 2);
+
+    ASSERT_OK(unlink("/tmp/test-dcache"));
+    ASSERT_ERR(stat("/tmp/test-dcache", &st));
+    ASSERT(errno == ENOENT);
+    ASSERT_OK(unlink("/tmp/test-dcache-link"));
+    ASSERT_ERR(stat("/tmp/test-dcache-link", &st));
+
+    // nothing is served from under a removed directory
+    ASSERT_OK(mkdir("/tmp/test-dcache", 0));
+    fd = open("/tmp/test-dcache/a", O_CREAT | O_EXCL, 0);
+    ASSERT_OK(fd);
+    ASSERT_OK(close(fd));
+    ASSERT_OK(stat("/tmp/test-dcache/a", &st));
+    ASSERT_OK(unlink("/tmp/test-dcache/a"));
+    ASSERT_OK(rmdir("/tmp/test-dcache"));
+    ASSERT_ERR(stat("/tmp/test-dcache/a", &st));
+    ASSERT(errno == ENOENT);
+}
+
+static void test_dynamic_linking(void) {
+    puts("dynamic linking");
+
+    // the dynamic linker places libraries with MAP_FIXED
+    const size_t page_size = 4096;
+    size_t size = 4 * page_size;
+    char* hole = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT(hole != MAP_FAILED);
+    ASSERT_OK(munmap(hole, size));
+    char* buf = mmap(hole + page_size, page_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    ASSERT(buf == hole + page_size);
+    buf[0] = 1;
+    ASSERT(mmap(buf, page_size, PROT_READ,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED);
+    ASSERT_OK(munmap(buf, page_size));
+
+    struct stat st;
+    ASSERT_OK(stat("/lib/libc.so", &st));
+
+    // binding every PLT entry up front works as well as lazy binding
+    char* argv[] = {"echo", NULL};
+    char* envp[] = {"LD_BIND_NOW=1", NULL};
+    pid_t pid;
+    ASSERT(posix_spawn(&pid, "/bin/echo", NULL, NULL, argv, envp) == 0);
+    int wstatus;
+    ASSERT(waitpid(pid, &wstatus, 0) == pid);
+    ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+}
+
+static void test_path_walk(void) {
+    puts("path walk");
+
+    ASSERT_OK(mkdir("/tmp/test-path", 0));
+    ASSERT_OK(mkdir("/tmp/test-path/a", 0));
+    int fd = open("/tmp/test-path/a/b", O_CREAT | O_EXCL, 0);
+    ASSERT_OK(fd);
+    ASSERT_OK(close(fd));
+
+    ASSERT_OK(chdir("/tmp/test-path/a"));
+    struct stat st;
+    ASSERT_OK(stat("b", &st));
+    ASSERT_OK(stat("./b", &st));
+    ASSERT_OK(stat(".//b", &st));
+    ASSERT_OK(stat("../a/b", &st));
+    ASSERT_OK(stat("../../../../tmp/test-path/a/b", &st));
+    ASSERT_ERR(stat("../b", &st));
+    ASSERT(errno == ENOENT);
+    ASSERT_ERR(stat("b/c", &st));
+    ASSERT(errno == ENOTDIR);
+
+    ASSERT_OK(chdir(".."));
+    char buf[64];
+    ASSERT(getcwd(buf, sizeof(buf)));
+    ASSERT(!strcmp(buf, "/tmp/test-path"));
+    ASSERT_OK(stat("a/b", &st));
+
+    ASSERT_OK(chdir("/"));
+    ASSERT_OK(unlink("/tmp/test-path/a/b"));
+    ASSERT_OK(rmdir("/tmp/test-path/a"));
+    ASSERT_OK(rmdir("/tmp/test-path"));
+}
+
+static void test_getdents(void) {
+    puts("getdents");
+
+    ASSERT_OK(mkdir("/tmp/test-getdents", 0));
+    char path[64];
+    for (int i = 0; i < 100; ++i) {
+        snprintf(path, sizeof(path), "/tmp/test-getdents/%d", i);
+        int fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0);
+        ASSERT_OK(fd);
+        ASSERT_OK(close(fd));
+    }
+
+    // entries that are removed while the directory is being read don't
+    // shift the others, and new ones show up at the end
+    int fd = open("/tmp/test-getdents", O_RDONLY);
+    ASSERT_OK(fd);
+    bool seen[101] = {0};
+    int max_seen = -1;
+    int max_seen_first = -1;
+    for (;;) {
+        unsigned char buf[32];
+        long nread = getdents(fd, buf, sizeof(buf));
+        ASSERT_OK(nread);
+        if (nread == 0)
+            break;
+        for (long pos = 0; pos < nread;) {
+            struct dirent* dent = (struct dirent*)(buf + pos);
+            int i = atoi(dent->d_name);
+            ASSERT(0 <= i && i <= 100);
+            ASSERT(!seen[i]);
+            seen[i] = true;
+            if (i > max_seen)
+                max_seen = i;
+            pos += dent->d_reclen;
+        }
+        if (max_seen_first < 0) {
+            max_seen_first = max_seen;
+            for (int i = max_seen + 1; i < 100; ++i) {
+                if (i % 2 == 0)
+                    continue;
+                snprintf(path, sizeof(path), "/tmp/test-getdents/%d", i);
+                ASSERT_OK(unlink(path));
+            }
+            int new_fd = open("/tmp/test-getdents/100", O_CREAT | O_WRONLY, 0);
+            ASSERT_OK(new_fd);
+            ASSERT_OK(close(new_fd));
+        }
+    }
+    ASSERT(max_seen == 100);
+    for (int i = 0; i <= 100; ++i)
+        ASSERT(seen[i] == (i <= max_seen_first || i % 2 == 0));
+
+    // an entry created after the last one is removed doesn't take its
+    // offset, so a reader that seeks back to the end sees it
+    off_t end = lseek(fd, 0, SEEK_CUR);
+    ASSERT(end > 0);
+    ASSERT_OK(unlink("/tmp/test-getdents/100"));
+    seen[100] = false;
+    int new_fd = open("/tmp/test-getdents/101", O_CREAT | O_WRONLY, 0);
+    ASSERT_OK(new_fd);
+    ASSERT_OK(close(new_fd));
+    ASSERT(lseek(fd, end, SEEK_SET) == end);
+    unsigned char buf[1024];
+    long nread = getdents(fd, buf, sizeof(buf));
+    ASSERT(nread > 0);
+    ASSERT(!strcmp(((struct dirent*)buf)->d_name, "101"));
+    ASSERT_OK(unlink("/tmp/test-getdents/101"));
+
+    // rewinding starts over
+    ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+    nread = getdents(fd, buf, sizeof(buf));
+    ASSERT(nread > 0);
+    ASSERT(!strcmp(((struct dirent*)buf)->d_name, "0"));
+    ASSERT_OK(close(fd));
+
+    for (int i = 0; i <= 100; ++i) {
+        if (!seen[i])
+            continue;
+        snprintf(path, sizeof(path), "/tmp/test-getdents/%d", i);
+        ASSERT_OK(unlink(path));
+    }
+    ASSERT_OK(rmdir("/tmp/test-getdents"));
+}
+
+static void test_at_functions(void) {
+    puts("*at functions");
+
+    ASSERT_OK(mkdir("/tmp/test-at", 0));
+    int dir_fd = open("/tmp/test-at", O_RDONLY);
+    ASSERT_OK(dir_fd);
+
+    ASSERT_OK(mkdirat(dir_fd, "sub", 0));
+    int fd = openat(dir_fd, "sub/file", O_CREAT | O_EXCL | O_WRONLY, 0);
+    ASSERT_OK(fd);
+    ASSERT(write(fd, "hello", 5) == 5);
+    struct stat st;
+    ASSERT_OK(fstat(fd, &st));
+    ASSERT(S_ISREG(st.st_mode));
+    ASSERT(st.st_size == 5);
+    ASSERT(lseek(fd, 0, SEEK_END) == 5);
+    ASSERT_ERR(openat(fd, "x", O_RDONLY));
+    ASSERT(errno == ENOTDIR);
+    ASSERT_OK(close(fd));
+
+    ASSERT_OK(fstatat(dir_fd, "sub/file", &st, 0));
+    ASSERT(st.st_size == 5);
+    ASSERT_OK(fstatat(dir_fd, "sub/../sub/file", &st, 0));
+    ASSERT_OK(fstatat(dir_fd, "/tmp/test-at/sub", &st, 0));
+    ASSERT(S_ISDIR(st.st_mode));
+    ASSERT_OK(fstatat(AT_FDCWD, "/tmp/test-at", &st, 0));
+
+    int sub_fd = openat(dir_fd, "sub", O_RDONLY);
+    ASSERT_OK(sub_fd);
+    ASSERT_OK(renameat(sub_fd, "file", dir_fd, "moved"));
+    ASSERT_ERR(fstatat(sub_fd, "file", &st, 0));
+    ASSERT(errno == ENOENT);
+    ASSERT_OK(fstatat(sub_fd, "../moved", &st, 0));
+
+    ASSERT_ERR(unlinkat(dir_fd, "sub", 0));
+    ASSERT_OK(unlinkat(sub_fd, "../moved", 0));
+    ASSERT_OK(close(sub_fd));
+    ASSERT_OK(unlinkat(dir_fd, "sub", AT_REMOVEDIR));
+    ASSERT_OK(close(dir_fd));
+    ASSERT_OK(rmdir("/tmp/test-at"));
+}
+
 int main(void) {
     test_fs();
+    test_path_walk();
+    test_at_functions();
+    test_getdents();
+    test_dcache();
+    test_procfs();
     test_socket();
     test_mmap_shared();
+    test_sparse_file();
+    test_fallocate();
+    test_page_cache();
+    test_mmap_private();
+    test_copy_file_range();
+    test_initrd_file();
+    test_block_device();
+    test_ext2();
+    test_mount();
     test_framebuffer();
     test_malloc();
+    test_poll();
+    test_epoll();
+    test_io_uring();
+    test_sendfile();
+    test_spawn();
+    test_demand_paging();
+    test_exec_cache();
+    test_dynamic_linking();
 
     return EXIT_SUCCESS;
 }
@@ -42,6 +42,7 @@
 #include <extra.h>
 #include <fcntl.h>
 #include <panic.h>
+#include <spawn.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -558,25 +559,26 @@ static int run_execute(const struct execute_node* node,
         return 0;
     }
 
-    pid_t pid = fork();
-    if (pid < 0)
-        return RUN_ERROR;
-    if (pid == 0) {
-        if (!ctx.pgid)
-            ctx.pgid = getpid();
-        if (setpgid(0, ctx.pgid) < 0) {
-            perror("setpgpid");
-            abort();
-        }
-        if (ctx.foreground)
-            tcsetpgrp(STDERR_FILENO, ctx.pgid);
-        if (execvpe(node->argv[0], node->argv, ctx.envp) < 0) {
-            perror("execvpe");
-            abort();
-        }
-        UNREACHABLE();
+    // the child is created straight from the executable, so the shell's
+    // address space is never duplicated
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, ctx.pgid);
+
+    pid_t pid;
+    int rc = posix_spawnp(&pid, node->argv[0], NULL, &attr, node->argv,
+                          ctx.envp);
+    posix_spawnattr_destroy(&attr);
+    if (rc) {
+        errno = rc;
+        perror("posix_spawnp");
+        return RUN_SIGNALED;
     }
 
+    if (ctx.foreground)
+        tcsetpgrp(STDERR_FILENO, ctx.pgid ? ctx.pgid : pid);
+
     int wstatus = 0;
     if (waitpid(pid, &wstatus, 0) < 0)
         return RUN_ERROR;